@@ -0,0 +1,119 @@
+#include <thread_pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace tp;
+
+static const size_t SLICES_PER_WORKER = 4;
+static const size_t SLICE_SIZE = 1024 * 1024;
+static const size_t PASSES = 20;
+
+struct Slice
+{
+    std::unique_ptr<uint64_t[]> data;
+    uint64_t sum;
+};
+
+struct Pass
+{
+    std::atomic<size_t> pending;
+    std::promise<void> done;
+
+    explicit Pass(size_t count) : pending(count)
+    {
+    }
+
+    void finish()
+    {
+        if(1 == pending.fetch_sub(1))
+        {
+            done.set_value();
+        }
+    }
+};
+
+static void runPass(ThreadPool& thread_pool, std::vector<Slice>& slices,
+                    bool first_touch)
+{
+    Pass pass(slices.size());
+
+    // Slice count is a multiple of thread count, so round-robin posting
+    // sends every slice to the same worker on every pass.
+    for(auto& slice : slices)
+    {
+        Slice* s = &slice;
+        Pass* p = &pass;
+        thread_pool.post([s, p, first_touch]()
+        {
+            if(first_touch)
+            {
+                s->data.reset(new uint64_t[SLICE_SIZE]);
+                for(size_t i = 0; i < SLICE_SIZE; ++i)
+                {
+                    s->data[i] = i;
+                }
+            }
+            else
+            {
+                uint64_t sum = 0;
+                for(size_t i = 0; i < SLICE_SIZE; ++i)
+                {
+                    sum += s->data[i];
+                    s->data[i] = sum;
+                }
+                s->sum = sum;
+            }
+            p->finish();
+        });
+    }
+
+    pass.done.get_future().wait();
+}
+
+static void run(const std::string& name, AffinityPolicy policy)
+{
+    ThreadPoolOptions options;
+    options.setAffinity(policy);
+    ThreadPool thread_pool(options);
+
+    std::vector<Slice> slices(options.threadCount() * SLICES_PER_WORKER);
+    runPass(thread_pool, slices, true);
+
+    const auto begin = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < PASSES; ++i)
+    {
+        runPass(thread_pool, slices, false);
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    const double ms = std::chrono::duration<double, std::milli>(end - begin).count();
+    const double gb = double(PASSES) * slices.size() * SLICE_SIZE *
+                      sizeof(uint64_t) * 2 / 1e9;
+    std::cout << name << ": " << ms << " ms, " << gb / ms * 1000 << " GB/s"
+              << std::endl;
+}
+
+int main(int, const char* [])
+{
+    const Topology topology = Topology::detect();
+    std::cout << "Benchmark memory-bound tasks on " << topology.cpus().size()
+              << " CPUs, " << topology.nodeCount() << " NUMA nodes"
+              << std::endl;
+
+    for(int i = 0; i < 3; ++i)
+    {
+        run("unpinned", AffinityPolicy::None);
+        run("compact", AffinityPolicy::Compact);
+        run("scatter", AffinityPolicy::Scatter);
+        run("physical cores", AffinityPolicy::PhysicalCores);
+    }
+
+    return 0;
+}
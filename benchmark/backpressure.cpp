@@ -0,0 +1,140 @@
+#include <thread_pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace tp;
+
+static const size_t TASKS_PER_PRODUCER = 200000;
+static const auto TASK_TIME = std::chrono::microseconds(2);
+
+typedef std::chrono::steady_clock Clock;
+
+struct BusyJob
+{
+    std::atomic<size_t>* counter;
+
+    void operator()()
+    {
+        const auto end = Clock::now() + TASK_TIME;
+        while(Clock::now() < end)
+        {
+        }
+        counter->fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+enum class Mode
+{
+    PostWait,
+    YieldRetry,
+    SleepRetry
+};
+
+static void post(ThreadPool& thread_pool, Mode mode, BusyJob job)
+{
+    switch(mode)
+    {
+    case Mode::PostWait:
+        thread_pool.postWait(job);
+        break;
+
+    case Mode::YieldRetry:
+        while(!thread_pool.tryPost(job))
+        {
+            std::this_thread::yield();
+        }
+        break;
+
+    case Mode::SleepRetry:
+        while(!thread_pool.tryPost(job))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        break;
+    }
+}
+
+static void run(const std::string& name, Mode mode)
+{
+    ThreadPoolOptions options;
+    options.setQueueSize(256);
+    ThreadPool thread_pool(options);
+
+    // As many producers as workers, both flooding all CPUs.
+    const size_t producer_count = options.threadCount();
+    const size_t total = producer_count * TASKS_PER_PRODUCER;
+
+    std::atomic<size_t> counter(0);
+    std::vector<double> stall_ms(producer_count);
+
+    const std::clock_t cpu_begin = std::clock();
+    const auto begin = Clock::now();
+
+    std::vector<std::thread> producers;
+    for(size_t i = 0; i < producer_count; ++i)
+    {
+        producers.emplace_back([&, i]()
+        {
+            Clock::duration stall(0);
+            for(size_t j = 0; j < TASKS_PER_PRODUCER; ++j)
+            {
+                const auto post_begin = Clock::now();
+                post(thread_pool, mode, BusyJob{&counter});
+                const auto post_time = Clock::now() - post_begin;
+                // Count only waits, not the post itself.
+                if(post_time > std::chrono::microseconds(10))
+                {
+                    stall += post_time;
+                }
+            }
+            stall_ms[i] =
+                std::chrono::duration<double, std::milli>(stall).count();
+        });
+    }
+
+    for(auto& producer : producers)
+    {
+        producer.join();
+    }
+
+    while(counter.load() != total)
+    {
+        std::this_thread::yield();
+    }
+
+    const double ms =
+        std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+    const double cpu_ms = 1000.0 * (std::clock() - cpu_begin) / CLOCKS_PER_SEC;
+
+    double stall = 0;
+    for(double s : stall_ms)
+    {
+        stall += s;
+    }
+
+    std::cout << name << ": " << total / ms / 1000 << " M tasks/s, "
+              << "producer stall " << 100 * stall / producer_count / ms
+              << "% of " << ms << " ms, cpu " << cpu_ms << " ms"
+              << std::endl;
+}
+
+int main(int, const char* [])
+{
+    std::cout << "Benchmark producer backpressure at 2x oversubscription"
+              << std::endl;
+
+    for(int i = 0; i < 2; ++i)
+    {
+        run("postWait", Mode::PostWait);
+        run("tryPost + yield", Mode::YieldRetry);
+        run("tryPost + sleep 1 ms", Mode::SleepRetry);
+    }
+
+    return 0;
+}
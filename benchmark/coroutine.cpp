@@ -0,0 +1,85 @@
+#include <thread_pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+using namespace tp;
+
+static const size_t CHAINS = 64;
+static const size_t RESUMES = 100000;
+
+typedef std::chrono::steady_clock Clock;
+
+static uint64_t rate(Clock::duration elapsed)
+{
+    const auto us =
+        std::chrono::duration_cast<std::chrono::microseconds>(elapsed)
+            .count();
+    return us ? CHAINS * RESUMES * 1000000 / us : 0;
+}
+
+static CoTask<void> chain(ThreadPool& thread_pool)
+{
+    for(size_t i = 0; i < RESUMES; ++i)
+    {
+        co_await scheduleOn(thread_pool);
+    }
+}
+
+// Lambda reposting itself, the equivalent of a coroutine awaiting
+// scheduleOn() in a loop.
+struct Repost
+{
+    ThreadPool* thread_pool;
+    size_t remaining;
+
+    void operator()()
+    {
+        if(--remaining != 0)
+        {
+            thread_pool->post(*this);
+        }
+    }
+};
+
+static void run(size_t threads)
+{
+    ThreadPoolOptions options;
+    options.setThreadCount(threads);
+    ThreadPool thread_pool(options);
+
+    std::vector<CoTask<void>> tasks;
+    for(size_t i = 0; i < CHAINS; ++i)
+    {
+        tasks.push_back(chain(thread_pool));
+    }
+
+    auto begin = Clock::now();
+    syncWait(whenAll(std::move(tasks)));
+    const auto resumed = Clock::now() - begin;
+
+    begin = Clock::now();
+    for(size_t i = 0; i < CHAINS; ++i)
+    {
+        thread_pool.post(Repost{&thread_pool, RESUMES});
+    }
+    thread_pool.waitIdle();
+    const auto reposted = Clock::now() - begin;
+
+    std::cout << "  " << threads << " workers: " << rate(resumed)
+              << " coroutine resumes per second, " << rate(reposted)
+              << " lambda posts per second" << std::endl;
+}
+
+int main(int, const char* [])
+{
+    std::cout << "***" << CHAINS << " chains of " << RESUMES
+              << " resumes***" << std::endl;
+    run(1);
+    run(4);
+    run(16);
+
+    return 0;
+}
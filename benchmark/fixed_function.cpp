@@ -0,0 +1,199 @@
+#include <thread_pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace tp;
+
+static const size_t OPERATIONS = 2 * 1024 * 1024;
+static const size_t QUEUE_SIZE = 1024;
+static const size_t MOVES = 16 * 1024 * 1024;
+static const size_t RING_SIZE = 1024;
+
+static std::atomic<size_t> g_sink(0);
+static size_t g_counter = 0;
+
+template <size_t SIZE>
+struct Capture
+{
+    char data[SIZE];
+};
+
+/**
+ * Makes job capturing SIZE bytes. Jobs larger than the FixedFunction
+ * storage are captured through shared_ptr if heap fallback is off, which is
+ * the workaround the heap fallback replaces.
+ */
+template <typename Function, size_t SIZE, bool FITS>
+struct JobMaker
+{
+    template <typename Queue>
+    static bool push(Queue& queue, const Capture<SIZE>& capture)
+    {
+        return queue.push([capture]()
+        {
+            g_sink.fetch_add(capture.data[0], std::memory_order_relaxed);
+        });
+    }
+};
+
+template <typename Function, size_t SIZE>
+struct JobMaker<Function, SIZE, false>
+{
+    template <typename Queue>
+    static bool push(Queue& queue, const Capture<SIZE>& capture)
+    {
+        auto shared = std::make_shared<Capture<SIZE>>(capture);
+        return queue.push([shared]()
+        {
+            g_sink.fetch_add(shared->data[0], std::memory_order_relaxed);
+        });
+    }
+};
+
+template <typename Function, size_t SIZE, bool FITS>
+static void run(const std::string& name)
+{
+    MPMCBoundedQueue<Function> queue(QUEUE_SIZE);
+    std::atomic<bool> start(false);
+
+    // Tasks are created by the producer and destroyed by the consumer.
+    std::thread consumer([&]()
+    {
+        while(!start.load())
+        {
+            std::this_thread::yield();
+        }
+
+        Function function;
+        for(size_t i = 0; i < OPERATIONS; ++i)
+        {
+            while(!queue.pop(function))
+            {
+                std::this_thread::yield();
+            }
+            function();
+            function = Function();
+        }
+    });
+
+    Capture<SIZE> capture;
+    capture.data[0] = 1;
+
+    const auto begin = std::chrono::steady_clock::now();
+    start = true;
+
+    for(size_t i = 0; i < OPERATIONS; ++i)
+    {
+        while(!JobMaker<Function, SIZE, FITS>::push(queue, capture))
+        {
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+
+    const double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - begin).count();
+
+    std::cout << "  " << name << ": " << OPERATIONS / ms / 1000
+              << " M tasks/s" << std::endl;
+}
+
+template <size_t SIZE>
+static void runSize()
+{
+    // Lambda capturing the array is a bit larger than it, so the current
+    // type keeps captures smaller than its storage only.
+    static const bool FITS = SIZE < 128;
+
+    std::cout << "capture " << SIZE << " bytes" << std::endl;
+    run<std::function<void()>, SIZE, true>("std::function           ");
+    run<FixedFunction<void(), 128>, SIZE, FITS>(
+        FITS ? "FixedFunction<128>      " : "FixedFunction<128> + ptr");
+    run<FixedFunction<void(), 128, true>, SIZE, true>(
+        "FixedFunction<128, heap>");
+}
+
+/**
+ * Moves functions around a ring and invokes each one, the way tasks go
+ * through queue cells.
+ */
+template <typename Function, typename Handler>
+static void runMove(const std::string& name, const Handler& handler)
+{
+    std::vector<Function> ring(RING_SIZE);
+    for(size_t i = 0; i + 1 < RING_SIZE; ++i)
+    {
+        ring[i] = Handler(handler);
+    }
+
+    const auto begin = std::chrono::steady_clock::now();
+
+    size_t empty = RING_SIZE - 1;
+    for(size_t i = 0; i < MOVES; ++i)
+    {
+        const size_t next = (empty + 1) % RING_SIZE;
+        ring[empty] = std::move(ring[next]);
+        ring[empty]();
+        empty = next;
+    }
+
+    const double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - begin).count();
+
+    std::cout << "  " << name << ": " << ms * 1000000 / MOVES
+              << " ns per move+invoke, sizeof " << sizeof(Function)
+              << std::endl;
+}
+
+template <typename Function>
+static void runMoves(const std::string& name)
+{
+    std::cout << name << std::endl;
+
+    size_t value = 1;
+    runMove<Function>("trivial 8 bytes    ", [&value]()
+    {
+        g_counter += value;
+    });
+
+    Capture<64> capture;
+    capture.data[0] = 1;
+    runMove<Function>("trivial 64 bytes   ", [capture]()
+    {
+        g_counter += capture.data[0];
+    });
+
+    std::shared_ptr<size_t> shared = std::make_shared<size_t>(1);
+    runMove<Function>("shared_ptr 16 bytes", [shared]()
+    {
+        g_counter += *shared;
+    });
+}
+
+int main(int, const char* [])
+{
+    std::cout << "Benchmark move and invoke" << std::endl;
+
+    runMoves<std::function<void()>>("std::function");
+    runMoves<FixedFunction<void(), 128>>("FixedFunction<128>");
+    runMoves<FixedFunction<void(), 128, true>>("FixedFunction<128, heap>");
+
+    std::cout << "Benchmark task types by capture size" << std::endl;
+
+    runSize<8>();
+    runSize<16>();
+    runSize<32>();
+    runSize<64>();
+    runSize<128>();
+    runSize<256>();
+    runSize<512>();
+
+    return 0;
+}
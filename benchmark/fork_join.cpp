@@ -0,0 +1,148 @@
+#include <thread_pool.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace tp;
+
+static const size_t QUEUE_SIZE = 65536;
+static const unsigned FIB_N = 32;
+static const unsigned FIB_CUTOFF = 12;
+static const size_t SORT_SIZE = 4 * 1024 * 1024;
+static const size_t SORT_CUTOFF = 4096;
+
+static unsigned long long fibSerial(unsigned n)
+{
+    return n < 2 ? n : fibSerial(n - 1) + fibSerial(n - 2);
+}
+
+template <typename Pool>
+struct Fib
+{
+    Pool* pool;
+    std::atomic<unsigned long long>* result;
+    std::atomic<size_t>* pending;
+    std::promise<void>* done;
+    unsigned n;
+
+    void operator()()
+    {
+        // Fork the smaller half and continue inline with the bigger one.
+        while(n >= FIB_CUTOFF)
+        {
+            pending->fetch_add(1);
+            Fib child = *this;
+            child.n = n - 2;
+            pool->post(child);
+            --n;
+        }
+
+        result->fetch_add(fibSerial(n));
+
+        if(1 == pending->fetch_sub(1))
+        {
+            done->set_value();
+        }
+    }
+};
+
+template <typename Pool>
+struct QuickSort
+{
+    Pool* pool;
+    std::atomic<size_t>* sorted;
+    std::promise<void>* done;
+    int* first;
+    int* last;
+
+    void operator()()
+    {
+        size_t finished = 0;
+
+        while(static_cast<size_t>(last - first) > SORT_CUTOFF)
+        {
+            const int pivot = first[(last - first) / 2];
+            int* middle1 = std::partition(first, last,
+                                          [pivot](int x) { return x < pivot; });
+            int* middle2 = std::partition(middle1, last,
+                                          [pivot](int x) { return !(pivot < x); });
+            finished += middle2 - middle1;
+
+            QuickSort child = *this;
+            child.last = middle1;
+            pool->post(child);
+
+            first = middle2;
+        }
+
+        std::sort(first, last);
+        finished += last - first;
+
+        if(SORT_SIZE == sorted->fetch_add(finished) + finished)
+        {
+            done->set_value();
+        }
+    }
+};
+
+template <typename Pool>
+static void run(const std::string& name)
+{
+    ThreadPoolOptions options;
+    options.setQueueSize(QUEUE_SIZE);
+    Pool thread_pool(options);
+
+    {
+        std::atomic<unsigned long long> result(0);
+        std::atomic<size_t> pending(1);
+        std::promise<void> done;
+
+        const auto begin = std::chrono::steady_clock::now();
+        thread_pool.post(Fib<Pool>{&thread_pool, &result, &pending, &done, FIB_N});
+        done.get_future().wait();
+        const auto end = std::chrono::steady_clock::now();
+
+        std::cout << name << " fib(" << FIB_N << ") = " << result << " in "
+                  << std::chrono::duration<double, std::milli>(end - begin).count()
+                  << " ms" << std::endl;
+    }
+
+    {
+        std::vector<int> data(SORT_SIZE);
+        std::srand(42);
+        std::generate(data.begin(), data.end(), std::rand);
+
+        std::atomic<size_t> sorted(0);
+        std::promise<void> done;
+
+        const auto begin = std::chrono::steady_clock::now();
+        thread_pool.post(QuickSort<Pool>{&thread_pool, &sorted, &done,
+                                         data.data(), data.data() + data.size()});
+        done.get_future().wait();
+        const auto end = std::chrono::steady_clock::now();
+
+        std::cout << name << " quicksort " << SORT_SIZE << " ints in "
+                  << std::chrono::duration<double, std::milli>(end - begin).count()
+                  << " ms" << (std::is_sorted(data.begin(), data.end()) ? "" : " (FAILED)")
+                  << std::endl;
+    }
+}
+
+int main(int, const char* [])
+{
+    std::cout << "Benchmark fork/join recursion" << std::endl;
+
+    for(int i = 0; i < 3; ++i)
+    {
+        run<ThreadPool>("MPMCBoundedQueue");
+        run<WorkStealingThreadPool>("WorkStealingQueue");
+    }
+
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include <thread_pool.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace tp;
+
+static const size_t SHARDS = 64;
+static const size_t KEYS_PER_SHARD = 16 * 1024;
+static const size_t TASKS = 2 * 1024 * 1024;
+static const size_t WAVE = 16 * 1024;
+
+typedef std::chrono::steady_clock Clock;
+
+struct Shard
+{
+    std::mutex mutex;
+    std::unordered_map<uint64_t, uint64_t> table;
+};
+
+enum class Mode
+{
+    RoundRobin,
+    Keyed,
+    Pinned,
+};
+
+static void run(size_t threads, Mode mode)
+{
+    ThreadPoolOptions options;
+    options.setThreadCount(threads);
+    options.setQueueSize(64 * 1024);
+    options.setStealKeyedTasks(mode != Mode::Pinned);
+    ThreadPool thread_pool(options);
+
+    std::vector<Shard> shards(SHARDS);
+    for(size_t i = 0; i < SHARDS; ++i)
+    {
+        shards[i].table.reserve(KEYS_PER_SHARD);
+    }
+
+    // Every task updates a few random entries of its shard table, so tasks
+    // of a shard landing on the same core find the table in its cache.
+    std::mt19937 random(42);
+    std::uniform_int_distribution<size_t> any_shard(0, SHARDS - 1);
+
+    const auto begin = Clock::now();
+    for(size_t i = 0; i < TASKS; ++i)
+    {
+        const size_t shard_id = any_shard(random);
+        Shard* shard = &shards[shard_id];
+        auto task = [shard, i]()
+        {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            uint64_t key = i;
+            for(int j = 0; j < 8; ++j)
+            {
+                key = key * 6364136223846793005ULL + 1442695040888963407ULL;
+                ++shard->table[(key >> 33) % KEYS_PER_SHARD];
+            }
+        };
+
+        if(mode == Mode::RoundRobin)
+        {
+            thread_pool.post(task);
+        }
+        else
+        {
+            thread_pool.postKeyed(shard_id, task);
+        }
+
+        if((i + 1) % WAVE == 0)
+        {
+            thread_pool.waitIdle();
+        }
+    }
+    thread_pool.waitIdle();
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now() - begin).count();
+
+    static const char* const names[] = {
+        "round-robin post:  ",
+        "stealable keyed:   ",
+        "pinned keyed:      ",
+    };
+    std::cout << "  " << threads << " workers, "
+              << names[static_cast<int>(mode)]
+              << (elapsed ? TASKS * 1000000 / elapsed : 0)
+              << " tasks per second" << std::endl;
+}
+
+int main(int, const char* [])
+{
+    const size_t thread_counts[] = {1, 4, 16};
+
+    std::cout << "***" << SHARDS << " shards of " << KEYS_PER_SHARD
+              << " keys***" << std::endl;
+    for(size_t threads : thread_counts)
+    {
+        run(threads, Mode::RoundRobin);
+        run(threads, Mode::Keyed);
+        run(threads, Mode::Pinned);
+    }
+
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include <thread_pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace tp;
+
+static const size_t OPERATIONS = 4 * 1024 * 1024;
+static const size_t QUEUE_SIZE = 1024;
+
+typedef FixedFunction<void(), 128> Task;
+
+template <typename T>
+struct Payload
+{
+    static T make(size_t value)
+    {
+        return T(value);
+    }
+};
+
+template <>
+struct Payload<Task>
+{
+    static Task make(size_t value)
+    {
+        return Task([value]() { (void)value; });
+    }
+};
+
+template <typename T, CellLayout LAYOUT>
+static void run(const std::string& name, size_t threads)
+{
+    BasicMPMCBoundedQueue<T, LAYOUT> queue(QUEUE_SIZE);
+    const size_t per_thread = OPERATIONS / threads;
+
+    std::atomic<bool> start(false);
+    std::vector<std::thread> workers;
+
+    for(size_t i = 0; i < threads; ++i)
+    {
+        workers.emplace_back([&, i]()
+        {
+            while(!start.load())
+            {
+                std::this_thread::yield();
+            }
+
+            T value = Payload<T>::make(i);
+            for(size_t j = 0; j < per_thread; ++j)
+            {
+                while(!queue.push(std::move(value)))
+                {
+                    std::this_thread::yield();
+                }
+                value = Payload<T>::make(j);
+            }
+        });
+
+        workers.emplace_back([&]()
+        {
+            while(!start.load())
+            {
+                std::this_thread::yield();
+            }
+
+            T value;
+            for(size_t j = 0; j < per_thread; ++j)
+            {
+                while(!queue.pop(value))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    const auto begin = std::chrono::steady_clock::now();
+    start = true;
+
+    for(auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    const double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - begin).count();
+
+    std::cout << "  " << name << " " << threads << "P" << threads << "C: "
+              << per_thread * threads / ms / 1000 << " M ops/s" << std::endl;
+}
+
+template <typename T>
+static void runLayouts(size_t threads)
+{
+    run<T, CellLayout::Packed>("packed   ", threads);
+    run<T, CellLayout::Padded>("padded   ", threads);
+    run<T, CellLayout::Scrambled>("scrambled", threads);
+}
+
+int main(int, const char* [])
+{
+    std::cout << "Benchmark MPMCBoundedQueue cell layouts" << std::endl;
+
+    for(size_t threads : {1, 4, 16})
+    {
+        std::cout << "FixedFunction<void(), 128>" << std::endl;
+        runLayouts<Task>(threads);
+
+        std::cout << "size_t" << std::endl;
+        runLayouts<size_t>(threads);
+    }
+
+    return 0;
+}
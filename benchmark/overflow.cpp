@@ -0,0 +1,93 @@
+#include <thread_pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace tp;
+
+static const size_t QUEUE_SIZE = 1024;
+static const size_t OVERLOAD = 10;
+static const size_t BURSTS = 5;
+static const auto TASK_TIME = std::chrono::microseconds(1);
+
+struct BusyJob
+{
+    std::atomic<size_t>* counter;
+
+    void operator()()
+    {
+        const auto end = std::chrono::steady_clock::now() + TASK_TIME;
+        while(std::chrono::steady_clock::now() < end)
+        {
+        }
+        counter->fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+static void run(const std::string& name, OverflowPolicy policy)
+{
+    ThreadPoolOptions options;
+    options.setQueueSize(QUEUE_SIZE);
+    options.setOverflowPolicy(policy);
+    ThreadPool thread_pool(options);
+
+    // Bursts of 10x total capacity of workers' queues.
+    const size_t burst = OVERLOAD * QUEUE_SIZE * options.threadCount();
+
+    std::atomic<size_t> counter(0);
+    size_t accepted = 0;
+    size_t rejected = 0;
+    double post_ms = 0;
+
+    const auto begin = std::chrono::steady_clock::now();
+
+    for(size_t i = 0; i < BURSTS; ++i)
+    {
+        const auto post_begin = std::chrono::steady_clock::now();
+        for(size_t j = 0; j < burst; ++j)
+        {
+            try
+            {
+                thread_pool.post(BusyJob{&counter});
+                ++accepted;
+            }
+            catch(const std::runtime_error&)
+            {
+                ++rejected;
+            }
+        }
+        post_ms += std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - post_begin).count();
+
+        while(counter.load() != accepted)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    const double total_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - begin).count();
+
+    std::cout << name << ": " << accepted << " executed, " << rejected
+              << " rejected, posting " << post_ms << " ms, total "
+              << total_ms << " ms, " << accepted / total_ms / 1000
+              << " M tasks/s" << std::endl;
+}
+
+int main(int, const char* [])
+{
+    std::cout << "Benchmark " << OVERLOAD << "x burst overload" << std::endl;
+
+    for(int i = 0; i < 2; ++i)
+    {
+        run("reject", OverflowPolicy::Reject);
+        run("spill", OverflowPolicy::Spill);
+        run("block", OverflowPolicy::Block);
+    }
+
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include <thread_pool.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#ifdef WITH_OPENMP
+#include <omp.h>
+#endif
+
+using namespace tp;
+
+static const size_t DATA_SIZE = 16 * 1024 * 1024;
+static const size_t BINS = 256;
+static const int REPEATS = 5;
+
+typedef std::vector<float>::const_iterator ConstIterator;
+typedef std::vector<size_t> Histogram;
+
+template <typename Function>
+static void measure(const std::string& name, Function&& function)
+{
+    double best = 0;
+    for(int i = 0; i < REPEATS; ++i)
+    {
+        const auto begin = std::chrono::steady_clock::now();
+        function();
+        const auto end = std::chrono::steady_clock::now();
+
+        const double ms = std::chrono::duration<double, std::milli>(end - begin).count();
+        if(i == 0 || ms < best)
+        {
+            best = ms;
+        }
+    }
+
+    std::cout << "  " << name << ": " << best << " ms" << std::endl;
+}
+
+static size_t bin(float x)
+{
+    return static_cast<size_t>(x * BINS) % BINS;
+}
+
+static Histogram histogram(ConstIterator first, ConstIterator last, Histogram bins)
+{
+    for(; first != last; ++first)
+    {
+        ++bins[bin(*first)];
+    }
+    return bins;
+}
+
+int main(int, const char* [])
+{
+    std::vector<float> x(DATA_SIZE);
+    std::vector<float> y(DATA_SIZE);
+    std::srand(42);
+    for(size_t i = 0; i < DATA_SIZE; ++i)
+    {
+        x[i] = static_cast<float>(std::rand()) / RAND_MAX;
+        y[i] = static_cast<float>(std::rand()) / RAND_MAX;
+    }
+
+    const float a = 2.5f;
+    volatile double sink = 0;
+
+    ThreadPool thread_pool;
+
+    std::cout << "Benchmark parallel algorithms on " << DATA_SIZE
+              << " floats" << std::endl;
+
+    std::cout << "sum" << std::endl;
+    measure("serial", [&]()
+    {
+        sink = std::accumulate(x.begin(), x.end(), 0.0);
+    });
+    measure("parallelReduce", [&]()
+    {
+        sink = parallelReduce(thread_pool, x.cbegin(), x.cend(), 0, 0.0,
+            [](ConstIterator first, ConstIterator last, double init)
+            {
+                return std::accumulate(first, last, init);
+            },
+            [](double l, double r) { return l + r; });
+    });
+#ifdef WITH_OPENMP
+    measure("openmp", [&]()
+    {
+        double sum = 0;
+        #pragma omp parallel for reduction(+:sum)
+        for(long i = 0; i < static_cast<long>(DATA_SIZE); ++i)
+        {
+            sum += x[i];
+        }
+        sink = sum;
+    });
+#endif
+
+    std::cout << "saxpy" << std::endl;
+    measure("serial", [&]()
+    {
+        for(size_t i = 0; i < DATA_SIZE; ++i)
+        {
+            y[i] = a * x[i] + y[i];
+        }
+    });
+    measure("parallelFor", [&]()
+    {
+        parallelFor(thread_pool, size_t(0), DATA_SIZE, 0, [&](size_t i)
+        {
+            y[i] = a * x[i] + y[i];
+        });
+    });
+#ifdef WITH_OPENMP
+    measure("openmp", [&]()
+    {
+        #pragma omp parallel for
+        for(long i = 0; i < static_cast<long>(DATA_SIZE); ++i)
+        {
+            y[i] = a * x[i] + y[i];
+        }
+    });
+#endif
+
+    std::cout << "histogram" << std::endl;
+    measure("serial", [&]()
+    {
+        sink = histogram(x.cbegin(), x.cend(), Histogram(BINS))[0];
+    });
+    measure("parallelReduce", [&]()
+    {
+        sink = parallelReduce(thread_pool, x.cbegin(), x.cend(), 0,
+            Histogram(BINS), histogram,
+            [](Histogram l, const Histogram& r)
+            {
+                for(size_t i = 0; i < BINS; ++i)
+                {
+                    l[i] += r[i];
+                }
+                return l;
+            })[0];
+    });
+#ifdef WITH_OPENMP
+    measure("openmp", [&]()
+    {
+        Histogram bins(BINS);
+        #pragma omp parallel
+        {
+            Histogram local(BINS);
+            #pragma omp for nowait
+            for(long i = 0; i < static_cast<long>(DATA_SIZE); ++i)
+            {
+                ++local[bin(x[i])];
+            }
+            #pragma omp critical
+            for(size_t i = 0; i < BINS; ++i)
+            {
+                bins[i] += local[i];
+            }
+        }
+        sink = bins[0];
+    });
+#endif
+
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include <thread_pool.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <iostream>
+#include <vector>
+
+using namespace tp;
+
+static const size_t PAIRS = 64;
+static const size_t MESSAGE_SIZE = 16 * 1024 / sizeof(uint64_t);
+static const size_t ROUND_TRIPS = 20000;
+
+typedef std::chrono::steady_clock Clock;
+
+struct Pair
+{
+    std::vector<uint64_t> message;
+    std::promise<void> done;
+};
+
+// Every pair passes its message back and forth, each side reads the whole
+// message and answers by posting the other side from the worker thread.
+// The answer finds the message in cache if it runs next on the same core.
+struct Player
+{
+    ThreadPool* thread_pool;
+    Pair* pair;
+    size_t remaining;
+
+    void operator()()
+    {
+        uint64_t sum = 0;
+        for(uint64_t& word : pair->message)
+        {
+            sum += word;
+            word = sum;
+        }
+
+        if(--remaining == 0)
+        {
+            pair->done.set_value();
+            return;
+        }
+        thread_pool->post(Player{thread_pool, pair, remaining});
+    }
+};
+
+static void run(size_t threads, size_t lifo_slot_limit)
+{
+    ThreadPoolOptions options;
+    options.setThreadCount(threads);
+    options.setLifoSlotLimit(lifo_slot_limit);
+    ThreadPool thread_pool(options);
+
+    std::vector<Pair> pairs(PAIRS);
+    for(Pair& pair : pairs)
+    {
+        pair.message.assign(MESSAGE_SIZE, 1);
+    }
+
+    const auto begin = Clock::now();
+    for(Pair& pair : pairs)
+    {
+        thread_pool.post(Player{&thread_pool, &pair, 2 * ROUND_TRIPS});
+    }
+    for(Pair& pair : pairs)
+    {
+        pair.done.get_future().wait();
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now() - begin).count();
+    const size_t messages = PAIRS * 2 * ROUND_TRIPS;
+
+    std::cout << "  " << threads << " workers, "
+              << (lifo_slot_limit ? "LIFO slot:    " : "no LIFO slot: ")
+              << (elapsed ? messages * 1000000 / elapsed : 0)
+              << " messages per second" << std::endl;
+}
+
+int main(int, const char* [])
+{
+    const size_t thread_counts[] = {1, 4, 16};
+
+    std::cout << "***" << PAIRS << " ping-pong pairs, "
+              << MESSAGE_SIZE * sizeof(uint64_t) / 1024
+              << " KB messages***" << std::endl;
+    for(size_t threads : thread_counts)
+    {
+        run(threads, 0);
+        run(threads, ThreadPoolOptions().lifoSlotLimit());
+    }
+
+    return 0;
+}
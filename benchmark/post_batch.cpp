@@ -0,0 +1,80 @@
+#include <thread_pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace tp;
+
+static const size_t TASKS_COUNT = 1024 * 1024;
+
+struct CountJob
+{
+    std::atomic<size_t>* counter;
+    std::promise<void>* done;
+
+    void operator()()
+    {
+        if(TASKS_COUNT == counter->fetch_add(1) + 1)
+        {
+            done->set_value();
+        }
+    }
+};
+
+static void run(size_t batch_size)
+{
+    ThreadPoolOptions options;
+    options.setQueueSize(4096);
+    ThreadPool thread_pool(options);
+
+    std::atomic<size_t> counter(0);
+    std::promise<void> done;
+    std::vector<CountJob> batch(batch_size, CountJob{&counter, &done});
+
+    const auto begin = std::chrono::steady_clock::now();
+
+    for(size_t posted = 0; posted < TASKS_COUNT; posted += batch_size)
+    {
+        auto first = batch.begin();
+        while(first != batch.end())
+        {
+            const size_t accepted = batch_size == 1
+                ? (thread_pool.tryPost(*first) ? 1 : 0)
+                : thread_pool.tryPostBatch(first, batch.end());
+            if(accepted == 0)
+            {
+                std::this_thread::yield();
+            }
+            first += accepted;
+        }
+    }
+
+    done.get_future().wait();
+
+    const auto end = std::chrono::steady_clock::now();
+    const double ms =
+        std::chrono::duration<double, std::milli>(end - begin).count();
+
+    std::cout << "batch size " << batch_size << ": " << TASKS_COUNT
+              << " tasks in " << ms << " ms, "
+              << TASKS_COUNT / ms / 1000 << " M tasks/s" << std::endl;
+}
+
+int main(int, const char* [])
+{
+    std::cout << "Benchmark batched posting" << std::endl;
+
+    for(int i = 0; i < 3; ++i)
+    {
+        run(1);
+        run(8);
+        run(64);
+        run(512);
+    }
+
+    return 0;
+}
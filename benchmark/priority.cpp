@@ -0,0 +1,110 @@
+#include <thread_pool.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace tp;
+
+static const size_t SAMPLES = 2000;
+static const auto SAMPLE_INTERVAL = std::chrono::microseconds(200);
+static const auto FLOOD_TASK_TIME = std::chrono::microseconds(2);
+
+typedef std::chrono::steady_clock Clock;
+
+static void busyWait(Clock::duration duration)
+{
+    const auto end = Clock::now() + duration;
+    while(Clock::now() < end)
+    {
+    }
+}
+
+struct Probe
+{
+    Clock::time_point posted;
+    Clock::duration* latency;
+    std::atomic<size_t>* finished;
+
+    void operator()()
+    {
+        *latency = Clock::now() - posted;
+        finished->fetch_add(1);
+    }
+};
+
+static void run(const std::string& name, size_t levels, size_t flood_priority)
+{
+    ThreadPoolOptions options;
+    options.setPriorityLevels(levels);
+    ThreadPool thread_pool(options);
+
+    // Keep all queues saturated with background jobs.
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> producers;
+    for(size_t i = 0; i < 2; ++i)
+    {
+        producers.emplace_back([&thread_pool, &stop, flood_priority]()
+        {
+            while(!stop.load(std::memory_order_relaxed))
+            {
+                if(!thread_pool.tryPost([]() { busyWait(FLOOD_TASK_TIME); },
+                                        flood_priority))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::vector<Clock::duration> latencies(SAMPLES);
+    std::atomic<size_t> finished(0);
+    for(size_t i = 0; i < SAMPLES; ++i)
+    {
+        std::this_thread::sleep_for(SAMPLE_INTERVAL);
+        while(!thread_pool.tryPost(Probe{Clock::now(), &latencies[i], &finished}, 0))
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    while(finished.load() != SAMPLES)
+    {
+        std::this_thread::yield();
+    }
+
+    stop = true;
+    for(auto& producer : producers)
+    {
+        producer.join();
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto us = [&latencies](double fraction)
+    {
+        const size_t index = std::min(SAMPLES - 1, size_t(fraction * SAMPLES));
+        return std::chrono::duration<double, std::micro>(latencies[index]).count();
+    };
+
+    std::cout << name << ": high priority latency p50 " << us(0.5)
+              << " us, p99 " << us(0.99) << " us, max " << us(1.0) << " us"
+              << std::endl;
+}
+
+int main(int, const char* [])
+{
+    std::cout << "Benchmark high priority latency under low priority flood"
+              << std::endl;
+
+    for(int i = 0; i < 2; ++i)
+    {
+        run("single level", 1, 0);
+        run("3 levels, flood at level 2", 3, 2);
+    }
+
+    return 0;
+}
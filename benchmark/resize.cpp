@@ -0,0 +1,91 @@
+#include <thread_pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace tp;
+
+static const size_t TASKS = 1024 * 1024;
+static const size_t RESIZE_PERIOD_US = 500;
+
+typedef std::chrono::steady_clock Clock;
+
+enum class Mode
+{
+    Fixed,
+    Resizable,
+    Resizing
+};
+
+static void run(const std::string& name, size_t threads, Mode mode)
+{
+    ThreadPoolOptions options;
+    options.setThreadCount(threads);
+    if(mode != Mode::Fixed)
+    {
+        options.setMaxThreadCount(threads * 2);
+    }
+    ThreadPool thread_pool(options);
+
+    std::atomic<size_t> counter(0);
+    std::atomic<bool> posting(true);
+    size_t resizes = 0;
+
+    // Counts swing between one and the maximum while tasks are posted.
+    std::thread resizer([&]()
+    {
+        if(mode != Mode::Resizing)
+        {
+            return;
+        }
+
+        while(posting.load())
+        {
+            thread_pool.resize(1 + resizes % (threads * 2));
+            ++resizes;
+            std::this_thread::sleep_for(
+                std::chrono::microseconds(RESIZE_PERIOD_US));
+        }
+    });
+
+    const auto begin = Clock::now();
+
+    for(size_t i = 0; i < TASKS; ++i)
+    {
+        thread_pool.postWait([&counter]() { ++counter; });
+    }
+    thread_pool.waitIdle();
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now() - begin).count();
+
+    posting = false;
+    resizer.join();
+
+    std::cout << "  " << name << ": "
+              << (elapsed ? TASKS * 1000000 / elapsed : 0)
+              << " tasks per second";
+    if(mode == Mode::Resizing)
+    {
+        std::cout << ", " << resizes << " resizes";
+    }
+    std::cout << std::endl;
+}
+
+int main(int, const char* [])
+{
+    const size_t thread_counts[] = {1, 4, 16};
+
+    for(size_t threads : thread_counts)
+    {
+        std::cout << "***" << threads << " workers***" << std::endl;
+        run("fixed             ", threads, Mode::Fixed);
+        run("resizable         ", threads, Mode::Resizable);
+        run("resized under load", threads, Mode::Resizing);
+    }
+
+    return 0;
+}
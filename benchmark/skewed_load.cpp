@@ -0,0 +1,79 @@
+#include <thread_pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <thread>
+
+using namespace tp;
+
+static const size_t TASKS_COUNT = 16384;
+static const size_t TASK_WORK = 20000;
+
+static void busyWork()
+{
+    volatile size_t sink = 0;
+    for(size_t i = 0; i < TASK_WORK; ++i)
+    {
+        sink += i;
+    }
+}
+
+static void run(size_t steal_attempts)
+{
+    ThreadPoolOptions options;
+    options.setQueueSize(TASKS_COUNT);
+    options.setStealAttempts(steal_attempts);
+    ThreadPool thread_pool(options);
+
+    std::atomic<size_t> remaining(TASKS_COUNT);
+    std::promise<void> done;
+
+    const auto begin = std::chrono::steady_clock::now();
+
+    // Tasks posted from a worker thread land in its own queue, so the
+    // whole load is initially owned by a single worker.
+    thread_pool.post([&]()
+        {
+            for(size_t i = 0; i < TASKS_COUNT; ++i)
+            {
+                thread_pool.post([&]()
+                    {
+                        busyWork();
+                        if(1 == remaining.fetch_sub(1))
+                        {
+                            done.set_value();
+                        }
+                    });
+            }
+        });
+
+    done.get_future().wait();
+
+    const auto end = std::chrono::steady_clock::now();
+
+    std::cout << "steal attempts " << steal_attempts << ": "
+              << TASKS_COUNT << " tasks in "
+              << std::chrono::duration<double, std::milli>(end - begin).count()
+              << " ms" << std::endl;
+}
+
+int main(int, const char* [])
+{
+    std::cout << "Benchmark skewed load" << std::endl;
+
+    const size_t workers_count =
+        std::max<size_t>(1u, std::thread::hardware_concurrency());
+
+    for(int i = 0; i < 3; ++i)
+    {
+        // A single probed victim per idle step is the closest analogue of
+        // the former fixed ring neighbour.
+        run(1);
+        run(ThreadPoolOptions().stealAttempts());
+        run(workers_count);
+    }
+
+    return 0;
+}
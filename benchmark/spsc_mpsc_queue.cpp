@@ -0,0 +1,137 @@
+#include <thread_pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace tp;
+
+static const size_t OPERATIONS = 4 * 1024 * 1024;
+static const size_t POOL_TASKS = 1024 * 1024;
+static const size_t QUEUE_SIZE = 1024;
+
+typedef FixedFunction<void(), 128> Task;
+
+template <template<typename> class Queue>
+static void runQueue(const std::string& name, size_t producers)
+{
+    Queue<Task> queue(QUEUE_SIZE);
+    const size_t per_thread = OPERATIONS / producers;
+
+    std::atomic<bool> start(false);
+    std::vector<std::thread> threads;
+
+    for(size_t i = 0; i < producers; ++i)
+    {
+        threads.emplace_back([&]()
+        {
+            while(!start.load())
+            {
+                std::this_thread::yield();
+            }
+
+            for(size_t j = 0; j < per_thread; ++j)
+            {
+                Task task([j]() { (void)j; });
+                while(!queue.push(std::move(task)))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    threads.emplace_back([&]()
+    {
+        while(!start.load())
+        {
+            std::this_thread::yield();
+        }
+
+        Task task;
+        for(size_t j = 0; j < per_thread * producers; ++j)
+        {
+            while(!queue.pop(task))
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    const auto begin = std::chrono::steady_clock::now();
+    start = true;
+
+    for(auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    const double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - begin).count();
+
+    std::cout << "  " << name << " " << producers << "P1C: "
+              << per_thread * producers / ms / 1000 << " M ops/s"
+              << std::endl;
+}
+
+template <template<typename> class Queue>
+static void runPool(const std::string& name, size_t threads)
+{
+    ThreadPoolOptions options;
+    options.setThreadCount(threads);
+    options.setQueueSize(QUEUE_SIZE);
+    ThreadPoolImpl<Task, Queue> thread_pool(options);
+
+    std::atomic<size_t> counter(0);
+
+    // A single producer thread posts all tasks, so every worker queue has
+    // one producer.
+    const auto begin = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < POOL_TASKS; ++i)
+    {
+        thread_pool.postWait([&counter]()
+        {
+            counter.fetch_add(1, std::memory_order_relaxed);
+        });
+    }
+
+    while(counter.load() != POOL_TASKS)
+    {
+        std::this_thread::yield();
+    }
+
+    const double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - begin).count();
+
+    std::cout << "  " << name << " " << threads << " workers: "
+              << POOL_TASKS / ms / 1000 << " M tasks/s" << std::endl;
+}
+
+int main(int, const char* [])
+{
+    std::cout << "Benchmark single consumer queues" << std::endl;
+
+    runQueue<MPMCBoundedQueue>("MPMCBoundedQueue", 1);
+    runQueue<MPSCBoundedQueue>("MPSCBoundedQueue", 1);
+    runQueue<SPSCBoundedQueue>("SPSCBoundedQueue", 1);
+
+    for(size_t producers : {4, 16})
+    {
+        runQueue<MPMCBoundedQueue>("MPMCBoundedQueue", producers);
+        runQueue<MPSCBoundedQueue>("MPSCBoundedQueue", producers);
+    }
+
+    std::cout << "Benchmark thread pool with single producer" << std::endl;
+
+    for(size_t threads : {1, 4, 16})
+    {
+        runPool<MPMCBoundedQueue>("MPMCBoundedQueue", threads);
+        runPool<MPSCBoundedQueue>("MPSCBoundedQueue", threads);
+        runPool<SPSCBoundedQueue>("SPSCBoundedQueue", threads);
+    }
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include <thread_pool.hpp>
+
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <string>
+
+using namespace tp;
+
+static const size_t CONCURRENCY = 16;
+static const size_t REPOST_COUNT = 1000000;
+
+using StatisticsThreadPool = ThreadPoolImpl<FixedFunction<void(), 128>,
+                                            MPMCBoundedQueue,
+                                            AtomicStatistics>;
+
+template <typename Clock>
+using LatencyThreadPool = ThreadPoolImpl<FixedFunction<void(), 128>,
+                                         MPMCBoundedQueue,
+                                         LatencyStatistics<Clock>>;
+
+static void printLatency(const std::string& name,
+                         const LatencyDistribution& distribution)
+{
+    std::cout << "  " << name << " p50 " << distribution.percentile(0.5)
+              << " ns, p99 " << distribution.percentile(0.99)
+              << " ns, p999 " << distribution.percentile(0.999)
+              << " ns, max " << distribution.max() << " ns" << std::endl;
+}
+
+template <typename Pool>
+struct RepostJob
+{
+    Pool* thread_pool;
+    size_t counter;
+    std::promise<void>* waiter;
+
+    void operator()()
+    {
+        if(++counter < REPOST_COUNT)
+        {
+            thread_pool->post(*this);
+        }
+        else
+        {
+            waiter->set_value();
+        }
+    }
+};
+
+template <typename Pool>
+static void run(const std::string& name)
+{
+    Pool thread_pool;
+
+    std::promise<void> waiters[CONCURRENCY];
+
+    const auto begin = std::chrono::steady_clock::now();
+    for(auto& waiter : waiters)
+    {
+        thread_pool.post(RepostJob<Pool>{&thread_pool, 0, &waiter});
+    }
+
+    for(auto& waiter : waiters)
+    {
+        waiter.get_future().wait();
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    const double ms = std::chrono::duration<double, std::milli>(end - begin).count();
+    std::cout << name << ": reposted " << CONCURRENCY << "x" << REPOST_COUNT
+              << " in " << ms << " ms, "
+              << ms * 1000000 / (CONCURRENCY * REPOST_COUNT) << " ns per task"
+              << std::endl;
+
+    const ThreadPoolStatistics stats = thread_pool.stats();
+    if(stats.total.tasks_executed != 0)
+    {
+        std::cout << "  executed " << stats.total.tasks_executed
+                  << ", local pops " << stats.total.local_pops
+                  << ", steals " << stats.total.steals
+                  << ", failed steals " << stats.total.failed_steals
+                  << ", idle sleeps " << stats.total.idle_sleeps
+                  << ", busy " << stats.total.busy_ns / 1000000 << " ms"
+                  << ", idle " << stats.total.idle_ns / 1000000 << " ms"
+                  << std::endl;
+    }
+
+    if(stats.total.run_time.count() != 0)
+    {
+        printLatency("queue wait", stats.total.queue_wait);
+        printLatency("run time", stats.total.run_time);
+    }
+}
+
+int main(int, const char* [])
+{
+    std::cout << "Benchmark statistics overhead on job reposting" << std::endl;
+
+    for(int i = 0; i < 3; ++i)
+    {
+        run<ThreadPool>("NoStatistics");
+        run<StatisticsThreadPool>("AtomicStatistics");
+        run<LatencyThreadPool<SteadyClock>>("LatencyStatistics<SteadyClock>");
+        run<LatencyThreadPool<CoarseClock>>("LatencyStatistics<CoarseClock>");
+        run<LatencyThreadPool<TscClock>>("LatencyStatistics<TscClock>");
+    }
+
+    return 0;
+}
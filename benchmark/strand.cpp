@@ -0,0 +1,92 @@
+#include <thread_pool.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <vector>
+
+using namespace tp;
+
+static const size_t SESSIONS = 10000;
+static const size_t TASKS = 4 * 1024 * 1024;
+static const size_t WAVE = 16 * 1024;
+
+typedef std::chrono::steady_clock Clock;
+
+struct Session
+{
+    std::mutex mutex;
+    uint64_t value = 0;
+};
+
+static void run(size_t threads, bool strands)
+{
+    ThreadPoolOptions options;
+    options.setThreadCount(threads);
+    options.setQueueSize(64 * 1024);
+    ThreadPool thread_pool(options);
+
+    std::vector<Session> sessions(SESSIONS);
+    std::vector<std::unique_ptr<Strand<ThreadPool>>> session_strands;
+    for(size_t i = 0; strands && i < SESSIONS; ++i)
+    {
+        session_strands.emplace_back(new Strand<ThreadPool>(thread_pool));
+    }
+
+    // Tasks of a few hot sessions mixed with the rest. Posted in waves to
+    // bound the backlog, strands have no backpressure.
+    std::mt19937 random(42);
+    std::uniform_int_distribution<size_t> hot(0, 15);
+    std::uniform_int_distribution<size_t> any(0, SESSIONS - 1);
+
+    const auto begin = Clock::now();
+    for(size_t i = 0; i < TASKS; ++i)
+    {
+        Session* session = &sessions[i % 2 ? hot(random) : any(random)];
+        if(strands)
+        {
+            session_strands[session - sessions.data()]->post([session]()
+            {
+                ++session->value;
+            });
+        }
+        else
+        {
+            thread_pool.post([session]()
+            {
+                std::lock_guard<std::mutex> lock(session->mutex);
+                ++session->value;
+            });
+        }
+
+        if((i + 1) % WAVE == 0)
+        {
+            thread_pool.waitIdle();
+        }
+    }
+    thread_pool.waitIdle();
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now() - begin).count();
+
+    std::cout << "  " << threads << " workers, "
+              << (strands ? "strand per session: " : "mutex per session:  ")
+              << (elapsed ? TASKS * 1000000 / elapsed : 0)
+              << " tasks per second" << std::endl;
+}
+
+int main(int, const char* [])
+{
+    const size_t thread_counts[] = {1, 4, 16};
+
+    std::cout << "***" << SESSIONS << " sessions***" << std::endl;
+    for(size_t threads : thread_counts)
+    {
+        run(threads, false);
+        run(threads, true);
+    }
+
+    return 0;
+}
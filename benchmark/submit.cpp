@@ -0,0 +1,110 @@
+#include <thread_pool.hpp>
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace tp;
+
+static const size_t TASKS_COUNT = 1000000;
+static const size_t WINDOW = 1000;
+
+static int tinyTask(int i)
+{
+    return i + 1;
+}
+
+static void report(const std::string& name, size_t count,
+                   std::chrono::steady_clock::time_point begin)
+{
+    const auto end = std::chrono::steady_clock::now();
+    const double ns =
+        std::chrono::duration<double, std::nano>(end - begin).count();
+    std::cout << name << ": " << count << " tasks in " << ns / 1000000
+              << " ms, " << ns / count << " ns per task" << std::endl;
+}
+
+static void benchmarkSubmit(ThreadPool& thread_pool)
+{
+    std::vector<Future<int>> futures(WINDOW);
+    long long sum = 0;
+
+    const auto begin = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < TASKS_COUNT; i += WINDOW)
+    {
+        for(size_t j = 0; j < WINDOW; ++j)
+        {
+            futures[j] = thread_pool.submit(tinyTask, static_cast<int>(j));
+        }
+        for(auto& future : futures)
+        {
+            sum += future.get();
+        }
+    }
+    report("tp::ThreadPool::submit", TASKS_COUNT, begin);
+}
+
+static void benchmarkPackagedTask(ThreadPool& thread_pool)
+{
+    std::vector<std::future<int>> futures(WINDOW);
+    long long sum = 0;
+
+    const auto begin = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < TASKS_COUNT; i += WINDOW)
+    {
+        for(size_t j = 0; j < WINDOW; ++j)
+        {
+            std::packaged_task<int()> task(
+                std::bind(tinyTask, static_cast<int>(j)));
+            futures[j] = task.get_future();
+            thread_pool.post(std::move(task));
+        }
+        for(auto& future : futures)
+        {
+            sum += future.get();
+        }
+    }
+    report("std::packaged_task on tp::ThreadPool", TASKS_COUNT, begin);
+}
+
+static void benchmarkAsync()
+{
+    // std::async may spawn a thread per task, so run fewer of them.
+    const size_t count = 20 * WINDOW;
+    std::vector<std::future<int>> futures(WINDOW);
+    long long sum = 0;
+
+    const auto begin = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < count; i += WINDOW)
+    {
+        for(size_t j = 0; j < WINDOW; ++j)
+        {
+            futures[j] = std::async(std::launch::async, tinyTask,
+                                    static_cast<int>(j));
+        }
+        for(auto& future : futures)
+        {
+            sum += future.get();
+        }
+    }
+    report("std::async", count, begin);
+}
+
+int main(int, const char* [])
+{
+    std::cout << "Benchmark future returning tasks" << std::endl;
+
+    ThreadPool thread_pool;
+
+    for(int i = 0; i < 3; ++i)
+    {
+        benchmarkSubmit(thread_pool);
+        benchmarkPackagedTask(thread_pool);
+        benchmarkAsync();
+    }
+
+    return 0;
+}
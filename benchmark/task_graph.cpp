@@ -0,0 +1,112 @@
+#include <thread_pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+
+using namespace tp;
+
+static const size_t NODES = 100000;
+static const size_t RUNS = 10;
+static const size_t MAX_PREDECESSORS = 4;
+
+typedef std::chrono::steady_clock Clock;
+
+static std::atomic<size_t> counter(0);
+
+static void work()
+{
+    counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+// One root, NODES - 2 nodes depending on it and one node depending on all.
+static void fanOut(TaskGraph& graph)
+{
+    const size_t root = graph.addNode(&work);
+    const size_t sink = graph.addNode(&work);
+    for(size_t i = 2; i < NODES; ++i)
+    {
+        const size_t node = graph.addNode(&work);
+        graph.addEdge(root, node);
+        graph.addEdge(node, sink);
+    }
+}
+
+static void chain(TaskGraph& graph)
+{
+    graph.addNode(&work);
+    for(size_t i = 1; i < NODES; ++i)
+    {
+        graph.addEdge(i - 1, graph.addNode(&work));
+    }
+}
+
+// Every node depends on up to MAX_PREDECESSORS random earlier nodes.
+static void randomDag(TaskGraph& graph)
+{
+    std::mt19937 random(42);
+    graph.addNode(&work);
+    for(size_t i = 1; i < NODES; ++i)
+    {
+        const size_t node = graph.addNode(&work);
+        std::uniform_int_distribution<size_t> predecessor(0, i - 1);
+        const size_t count = random() % (MAX_PREDECESSORS + 1);
+        for(size_t j = 0; j < count; ++j)
+        {
+            graph.addEdge(predecessor(random), node);
+        }
+    }
+}
+
+static void run(const std::string& name, void (*build)(TaskGraph&),
+                size_t threads)
+{
+    ThreadPoolOptions options;
+    options.setThreadCount(threads);
+    options.setQueueSize(64 * 1024);
+    ThreadPool thread_pool(options);
+
+    TaskGraph graph;
+    build(graph);
+
+    // The first run compiles the graph.
+    auto begin = Clock::now();
+    graph.run(thread_pool);
+    const auto first = Clock::now() - begin;
+
+    begin = Clock::now();
+    for(size_t i = 0; i < RUNS; ++i)
+    {
+        graph.run(thread_pool);
+    }
+    const auto rerun = (Clock::now() - begin) / RUNS;
+
+    auto rate = [](Clock::duration elapsed)
+    {
+        const auto us =
+            std::chrono::duration_cast<std::chrono::microseconds>(elapsed)
+                .count();
+        return us ? NODES * 1000000 / us : 0;
+    };
+
+    std::cout << "  " << name << ", " << threads << " workers: "
+              << rate(first) << " nodes per second first run, "
+              << rate(rerun) << " nodes per second rerun" << std::endl;
+}
+
+int main(int, const char* [])
+{
+    const size_t thread_counts[] = {1, 4, 16};
+
+    std::cout << "***" << NODES << " nodes***" << std::endl;
+    for(size_t threads : thread_counts)
+    {
+        run("fan-out   ", &fanOut, threads);
+        run("chain     ", &chain, threads);
+        run("random DAG", &randomDag, threads);
+    }
+
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include <thread_pool.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+
+using namespace tp;
+
+static const size_t TASKS = 256 * 1024;
+
+// Bytes allocated by operator new and not freed yet.
+static std::atomic<size_t> g_live_bytes(0);
+
+void* operator new(size_t size)
+{
+    // Two words keep the block aligned to std::max_align_t.
+    size_t* block =
+        static_cast<size_t*>(std::malloc(size + 2 * sizeof(size_t)));
+    if(!block)
+    {
+        throw std::bad_alloc();
+    }
+    block[0] = size;
+    g_live_bytes += size;
+    return block + 2;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    if(!ptr)
+    {
+        return;
+    }
+    size_t* block = static_cast<size_t*>(ptr) - 2;
+    g_live_bytes -= block[0];
+    std::free(block);
+}
+
+// Tasks capture a pointer only.
+struct PostSmall
+{
+    template <typename Pool>
+    void operator()(Pool& pool, std::atomic<size_t>* counter) const
+    {
+        for(size_t i = 0; i < TASKS; ++i)
+        {
+            pool.postWait([counter]() { ++*counter; });
+        }
+    }
+};
+
+// Every 8th task captures 200 bytes, the rest capture a pointer.
+struct PostMixed
+{
+    template <typename Pool>
+    void operator()(Pool& pool, std::atomic<size_t>* counter) const
+    {
+        std::array<char, 200> payload = {{}};
+        for(size_t i = 0; i < TASKS; ++i)
+        {
+            if(i % 8 == 0)
+            {
+                pool.postWait([counter, payload]() { ++*counter; });
+            }
+            else
+            {
+                pool.postWait([counter]() { ++*counter; });
+            }
+        }
+    }
+};
+
+template <typename Pool, typename PostTasks>
+static void run(const std::string& name, size_t threads, PostTasks post)
+{
+    ThreadPoolOptions options;
+    options.setThreadCount(threads);
+
+    const size_t bytes_before = g_live_bytes.load();
+    Pool pool(options);
+    const size_t footprint = g_live_bytes.load() - bytes_before;
+
+    std::atomic<size_t> counter(0);
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    post(pool, &counter);
+
+    while(counter.load() != TASKS)
+    {
+        std::this_thread::yield();
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - start).count();
+
+    std::cout << "  " << name << ": " << footprint / threads / 1024
+              << " KiB per worker, "
+              << (elapsed ? TASKS * 1000000 / elapsed : 0)
+              << " tasks per second" << std::endl;
+}
+
+int main(int, const char* [])
+{
+    const size_t thread_counts[] = {1, 8, 64};
+
+    for(size_t threads : thread_counts)
+    {
+        std::cout << "***" << threads << " workers, pointer tasks***"
+                  << std::endl;
+        run<ThreadPool32>("ThreadPool32       ", threads, PostSmall());
+        run<ThreadPool64>("ThreadPool64       ", threads, PostSmall());
+        run<ThreadPool>("ThreadPool         ", threads, PostSmall());
+        run<ThreadPool256>("ThreadPool256      ", threads, PostSmall());
+        run<AutoSizedThreadPool>("AutoSizedThreadPool", threads,
+                                 PostSmall());
+    }
+
+    for(size_t threads : thread_counts)
+    {
+        std::cout << "***" << threads
+                  << " workers, every 8th task is 200 bytes***" << std::endl;
+        run<ThreadPool256>("ThreadPool256      ", threads, PostMixed());
+        run<AutoSizedThreadPool>("AutoSizedThreadPool", threads,
+                                 PostMixed());
+    }
+
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include <thread_pool.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace tp;
+
+static const size_t PENDING_TIMERS = 10 * 1000 * 1000;
+static const size_t JITTER_TIMERS = 10000;
+
+typedef std::chrono::steady_clock Clock;
+
+static uint64_t rate(size_t count, Clock::duration elapsed)
+{
+    const auto us =
+        std::chrono::duration_cast<std::chrono::microseconds>(elapsed)
+            .count();
+    return us ? count * 1000000 / us : 0;
+}
+
+static void insertCancel(size_t threads)
+{
+    ThreadPoolOptions options;
+    options.setThreadCount(threads);
+    ThreadPool32 thread_pool(options);
+
+    std::vector<TimerHandle> handles;
+    handles.reserve(PENDING_TIMERS);
+
+    // Deadlines far in the future keep all the timers pending.
+    auto begin = Clock::now();
+    for(size_t i = 0; i < PENDING_TIMERS; ++i)
+    {
+        handles.push_back(thread_pool.postAfter(
+            std::chrono::seconds(3600 + i % 3600), []() {}));
+    }
+    const auto inserted = Clock::now() - begin;
+
+    begin = Clock::now();
+    for(auto& handle : handles)
+    {
+        handle.cancel();
+    }
+    const auto canceled = Clock::now() - begin;
+
+    std::cout << "  " << threads << " workers: " << rate(PENDING_TIMERS, inserted)
+              << " inserts per second, " << rate(PENDING_TIMERS, canceled)
+              << " cancels per second" << std::endl;
+}
+
+static void jitter(size_t threads, bool loaded)
+{
+    ThreadPoolOptions options;
+    options.setThreadCount(threads);
+    options.setQueueSize(64 * 1024);
+    ThreadPool thread_pool(options);
+
+    std::vector<Clock::duration> lateness(JITTER_TIMERS);
+    std::atomic<size_t> fired(0);
+    std::atomic<bool> loading(loaded);
+
+    // Keeps workers busy with short tasks while timers expire.
+    std::thread producer([&]()
+    {
+        while(loading.load())
+        {
+            if(!thread_pool.tryPost([]()
+                {
+                    volatile int sink = 0;
+                    for(int i = 0; i < 100; ++i)
+                    {
+                        sink = sink + i;
+                    }
+                }))
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> delay_us(1000, 100000);
+    for(size_t i = 0; i < JITTER_TIMERS; ++i)
+    {
+        const Clock::time_point deadline =
+            Clock::now() + std::chrono::microseconds(delay_us(random));
+        thread_pool.postAt(deadline, [&lateness, &fired, deadline, i]()
+        {
+            lateness[i] = Clock::now() - deadline;
+            ++fired;
+        });
+    }
+
+    while(fired.load() != JITTER_TIMERS)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    loading = false;
+    producer.join();
+
+    std::sort(lateness.begin(), lateness.end());
+    auto us = [&lateness](double fraction)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            lateness[static_cast<size_t>(fraction * (JITTER_TIMERS - 1))])
+            .count();
+    };
+
+    std::cout << "  " << threads << " workers" << (loaded ? ", loaded" : "")
+              << ": late by " << us(0.5) << " us p50, " << us(0.99)
+              << " us p99, " << us(1.0) << " us max" << std::endl;
+}
+
+int main(int, const char* [])
+{
+    std::cout << "***" << PENDING_TIMERS
+              << " pending timers, insert and cancel***" << std::endl;
+    insertCancel(1);
+    insertCancel(4);
+
+    std::cout << "***" << JITTER_TIMERS
+              << " timers of 1-100 ms, fire jitter***" << std::endl;
+    jitter(1, false);
+    jitter(4, false);
+    jitter(1, true);
+    jitter(4, true);
+
+    return 0;
+}
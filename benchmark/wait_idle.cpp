@@ -0,0 +1,104 @@
+#include <thread_pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace tp;
+
+static const size_t PHASES = 200;
+static const size_t TASKS_PER_PHASE = 1000;
+
+typedef std::chrono::steady_clock Clock;
+
+enum class Barrier
+{
+    WaitIdle,
+    PollSleep,
+    PollYield
+};
+
+static void wait(ThreadPool& thread_pool, Barrier barrier,
+                 const std::atomic<size_t>& counter, size_t target)
+{
+    switch(barrier)
+    {
+    case Barrier::WaitIdle:
+        thread_pool.waitIdle();
+        break;
+
+    case Barrier::PollSleep:
+        while(counter.load() != target)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        break;
+
+    case Barrier::PollYield:
+        while(counter.load() != target)
+        {
+            std::this_thread::yield();
+        }
+        break;
+    }
+}
+
+static void run(const std::string& name, Barrier barrier)
+{
+    ThreadPool thread_pool;
+
+    std::atomic<size_t> counter(0);
+    std::atomic<Clock::rep> last_done(0);
+    Clock::duration latency(0);
+
+    const auto begin = Clock::now();
+
+    for(size_t phase = 1; phase <= PHASES; ++phase)
+    {
+        const size_t target = phase * TASKS_PER_PHASE;
+        for(size_t i = 0; i < TASKS_PER_PHASE; ++i)
+        {
+            thread_pool.post([&counter, &last_done, target]()
+            {
+                if(counter.fetch_add(1) + 1 == target)
+                {
+                    last_done.store(Clock::now().time_since_epoch().count());
+                }
+            });
+        }
+
+        wait(thread_pool, barrier, counter, target);
+
+        // The last task may still be storing the time with poll barriers.
+        while(counter.load() != target || last_done.load() == 0)
+        {
+            std::this_thread::yield();
+        }
+        latency += Clock::now().time_since_epoch() -
+                   Clock::duration(last_done.exchange(0));
+    }
+
+    const auto elapsed = Clock::now() - begin;
+
+    std::cout << name << ": "
+              << std::chrono::duration_cast<std::chrono::microseconds>(
+                     latency).count() / PHASES
+              << " us barrier latency, "
+              << std::chrono::duration_cast<std::chrono::microseconds>(
+                     elapsed).count() / PHASES
+              << " us per phase" << std::endl;
+}
+
+int main(int, const char* [])
+{
+    std::cout << "***" << PHASES << " phases of " << TASKS_PER_PHASE
+              << " tasks***" << std::endl;
+
+    run("waitIdle   ", Barrier::WaitIdle);
+    run("poll+sleep ", Barrier::PollSleep);
+    run("poll+yield ", Barrier::PollYield);
+
+    return 0;
+}
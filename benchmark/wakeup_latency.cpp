@@ -0,0 +1,77 @@
+#include <thread_pool.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace tp;
+
+using Clock = std::chrono::steady_clock;
+
+static const size_t SAMPLES = 1000;
+
+static void measure(ThreadPool& thread_pool, std::chrono::microseconds gap)
+{
+    std::vector<double> latencies;
+    latencies.reserve(SAMPLES);
+
+    for(size_t i = 0; i < SAMPLES; ++i)
+    {
+        // Let the pool go idle before posting.
+        std::this_thread::sleep_for(gap);
+
+        std::promise<Clock::time_point> started;
+        std::future<Clock::time_point> started_at = started.get_future();
+
+        const Clock::time_point posted_at = Clock::now();
+        thread_pool.post([&started]()
+            {
+                started.set_value(Clock::now());
+            });
+
+        latencies.push_back(std::chrono::duration<double, std::micro>(
+                                started_at.get() - posted_at).count());
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+
+    std::cout << "idle " << gap.count() << " us: "
+              << "p50 " << latencies[SAMPLES / 2] << " us, "
+              << "p99 " << latencies[SAMPLES * 99 / 100] << " us, "
+              << "max " << latencies.back() << " us" << std::endl;
+}
+
+static void run(const ThreadPoolOptions& options)
+{
+    ThreadPool thread_pool(options);
+
+    measure(thread_pool, std::chrono::microseconds(10));
+    measure(thread_pool, std::chrono::microseconds(100));
+    measure(thread_pool, std::chrono::microseconds(1000));
+}
+
+int main(int, const char* [])
+{
+    std::cout << "Benchmark idle-to-running latency" << std::endl;
+
+    {
+        std::cout << "***spin, yield, park***" << std::endl;
+
+        ThreadPoolOptions options;
+        run(options);
+    }
+
+    {
+        std::cout << "***park only***" << std::endl;
+
+        ThreadPoolOptions options;
+        options.setSpinCount(0);
+        options.setYieldCount(0);
+        run(options);
+    }
+
+    return 0;
+}
@@ -1,3 +1,7 @@
 #pragma once
 
+#include <thread_pool/coroutine.hpp>
+#include <thread_pool/parallel.hpp>
+#include <thread_pool/strand.hpp>
+#include <thread_pool/task_graph.hpp>
 #include <thread_pool/thread_pool.hpp>
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+namespace tp
+{
+
+namespace detail
+{
+
+/**
+ * @brief The Backpressure class parks producers until workers free queue
+ * slots.
+ * Workers call notify() for every task taken from a queue. It costs one
+ * relaxed load of a rarely written counter unless a producer is waiting.
+ * Waiting producers are woken up once a batch of slots is freed rather
+ * than per slot, which would cost a context switch per task. Workers call
+ * notifyIdle() before parking to hand over the remaining slots.
+ * A notification may be missed if the slot is freed while a producer is
+ * announcing itself. The worker sees the announcement when it takes the
+ * next task or when it is about to park, so a producer is never left
+ * waiting while workers sit idle.
+ * The pool parks threads waiting for it to become idle on another instance,
+ * notified by workers about to park only.
+ */
+class Backpressure
+{
+public:
+    /**
+     * @brief Backpressure Constructor.
+     * @param batch Number of freed slots to wake up producers at.
+     */
+    explicit Backpressure(size_t batch);
+
+    /**
+     * @brief batch Return number of freed slots to wake up producers at.
+     */
+    size_t batch() const;
+
+    /**
+     * @brief setBatch Set number of freed slots to wake up producers at.
+     * Must not be called while producers are waiting.
+     * @param batch Number of freed slots.
+     */
+    void setBatch(size_t batch);
+
+    /**
+     * @brief notify Account freed slot, wake up waiting producers if it
+     * completes the batch.
+     */
+    void notify();
+
+    /**
+     * @brief notifyIdle Wake up waiting producers if any.
+     */
+    void notifyIdle();
+
+    /**
+     * @brief waitUntil Block calling thread until try_post succeeds.
+     * @param try_post Callable returning true once the task is posted or
+     * the awaited condition holds.
+     * @param deadline Time to give up at, time_point::max() to never.
+     * @return Last result of try_post.
+     */
+    template <typename TryPost>
+    bool waitUntil(TryPost&& try_post,
+                   std::chrono::steady_clock::time_point deadline);
+
+private:
+    void wakeup();
+
+    size_t m_batch;
+    std::atomic<size_t> m_waiters;
+    std::atomic<size_t> m_freed;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+};
+
+
+/// Implementation
+
+inline Backpressure::Backpressure(size_t batch)
+    : m_batch(std::max<size_t>(1u, batch))
+    , m_waiters(0)
+    , m_freed(0)
+{
+}
+
+inline size_t Backpressure::batch() const
+{
+    return m_batch;
+}
+
+inline void Backpressure::setBatch(size_t batch)
+{
+    m_batch = std::max<size_t>(1u, batch);
+}
+
+inline void Backpressure::notify()
+{
+    if (m_waiters.load(std::memory_order_relaxed) == 0)
+    {
+        return;
+    }
+
+    if (m_freed.fetch_add(1, std::memory_order_relaxed) % m_batch ==
+        m_batch - 1)
+    {
+        wakeup();
+    }
+}
+
+inline void Backpressure::notifyIdle()
+{
+    if (m_waiters.load(std::memory_order_relaxed) != 0)
+    {
+        wakeup();
+    }
+}
+
+inline void Backpressure::wakeup()
+{
+    {
+        // Producers are either before their last try or waiting already.
+        std::lock_guard<std::mutex> lock(m_mutex);
+    }
+    m_cv.notify_all();
+}
+
+template <typename TryPost>
+inline bool Backpressure::waitUntil(
+    TryPost&& try_post, std::chrono::steady_clock::time_point deadline)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    m_waiters.fetch_add(1, std::memory_order_relaxed);
+    // Pairs with the fence in Worker::park: either the worker sees this
+    // producer waiting or the try below sees the freed slot.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    bool posted = try_post();
+    while (!posted)
+    {
+        if (deadline == std::chrono::steady_clock::time_point::max())
+        {
+            m_cv.wait(lock);
+        }
+        else if (m_cv.wait_until(lock, deadline) == std::cv_status::timeout)
+        {
+            posted = try_post();
+            break;
+        }
+
+        posted = try_post();
+    }
+
+    m_waiters.fetch_sub(1, std::memory_order_relaxed);
+    return posted;
+}
+
+}
+
+}
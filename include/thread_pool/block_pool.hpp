@@ -0,0 +1,240 @@
+#pragma once
+
+#include <thread_pool/slab_allocator.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace tp
+{
+
+namespace detail
+{
+
+/**
+ * @brief The BlockPool class allocates memory blocks of power of 2 size
+ * classes from 64 to 4096 bytes.
+ * Every thread keeps a cache of free blocks per size class, so a block freed
+ * by a thread is reused by its next allocation without synchronization.
+ * Cache misses and overflows go to process wide lock-free slabs, so blocks
+ * allocated by producer threads and freed by worker threads flow back
+ * through the slabs rather than through malloc. Larger blocks come from
+ * operator new.
+ */
+class BlockPool
+{
+public:
+    /// Handle of the block allocated by operator new.
+    static const uint32_t HEAP_HANDLE = 0xffffffffu;
+
+    /**
+     * @brief allocate Allocate block aligned to std::max_align_t.
+     * @param size Block size.
+     * @param handle Place to store block handle to be passed to deallocate.
+     * @return Pointer to the block.
+     * @throws std::bad_alloc if memory is exhausted.
+     */
+    static void* allocate(size_t size, uint32_t& handle);
+
+    /**
+     * @brief deallocate Return block to the pool. Can be called from any
+     * thread.
+     * @param block Pointer to the block.
+     * @param handle Block handle returned by allocate.
+     */
+    static void deallocate(void* block, uint32_t handle);
+
+private:
+    enum
+    {
+        MIN_BLOCK_BITS = 6,
+        CLASS_COUNT = 7,
+        CACHE_SIZE = 32,
+        CHUNK_SIZE = 64,
+        INDEX_BITS = 24
+    };
+
+    struct SlabOps
+    {
+        /// Returns nullptr if the slab is exhausted.
+        void* (*allocate)(uint32_t& index);
+        void (*deallocate)(uint32_t index);
+    };
+
+    struct CachedBlock
+    {
+        void* block;
+        uint32_t handle;
+    };
+
+    struct ThreadCache
+    {
+        CachedBlock blocks[CLASS_COUNT][CACHE_SIZE];
+        size_t counts[CLASS_COUNT];
+
+        ThreadCache();
+
+        /**
+         * @brief ~ThreadCache Return cached blocks to the slabs on thread
+         * exit.
+         */
+        ~ThreadCache();
+    };
+
+    template <size_t CLASS>
+    struct Slab
+    {
+        typedef SlabAllocator<(size_t(1) << (MIN_BLOCK_BITS + CLASS)),
+                              CHUNK_SIZE> type;
+    };
+
+    template <size_t CLASS>
+    static typename Slab<CLASS>::type& slab();
+
+    template <size_t CLASS>
+    static void* slabAllocate(uint32_t& index);
+
+    template <size_t CLASS>
+    static void slabDeallocate(uint32_t index);
+
+    static const SlabOps& ops(size_t size_class);
+
+    static ThreadCache& cache();
+
+    /**
+     * @brief release Return block to the slab of its size class.
+     */
+    static void release(uint32_t handle);
+};
+
+
+/// Implementation
+
+inline BlockPool::ThreadCache::ThreadCache()
+    : counts()
+{
+}
+
+inline BlockPool::ThreadCache::~ThreadCache()
+{
+    for (size_t size_class = 0; size_class < CLASS_COUNT; ++size_class)
+    {
+        for (size_t i = 0; i < counts[size_class]; ++i)
+        {
+            release(blocks[size_class][i].handle);
+        }
+    }
+}
+
+template <size_t CLASS>
+inline typename BlockPool::Slab<CLASS>::type& BlockPool::slab()
+{
+    // Never destroyed: thread caches return blocks on thread exit, which
+    // may happen after static destructors have run.
+    static typename Slab<CLASS>::type* instance =
+        new typename Slab<CLASS>::type();
+    return *instance;
+}
+
+template <size_t CLASS>
+inline void* BlockPool::slabAllocate(uint32_t& index)
+{
+    return slab<CLASS>().tryAllocate(index);
+}
+
+template <size_t CLASS>
+inline void BlockPool::slabDeallocate(uint32_t index)
+{
+    slab<CLASS>().deallocate(index);
+}
+
+inline const BlockPool::SlabOps& BlockPool::ops(size_t size_class)
+{
+    static const SlabOps table[CLASS_COUNT] = {
+        {&slabAllocate<0>, &slabDeallocate<0>},
+        {&slabAllocate<1>, &slabDeallocate<1>},
+        {&slabAllocate<2>, &slabDeallocate<2>},
+        {&slabAllocate<3>, &slabDeallocate<3>},
+        {&slabAllocate<4>, &slabDeallocate<4>},
+        {&slabAllocate<5>, &slabDeallocate<5>},
+        {&slabAllocate<6>, &slabDeallocate<6>},
+    };
+    return table[size_class];
+}
+
+inline BlockPool::ThreadCache& BlockPool::cache()
+{
+    static thread_local ThreadCache tss_cache;
+    return tss_cache;
+}
+
+inline void BlockPool::release(uint32_t handle)
+{
+    ops(handle >> INDEX_BITS).deallocate(handle & ((1u << INDEX_BITS) - 1));
+}
+
+inline void* BlockPool::allocate(size_t size, uint32_t& handle)
+{
+    size_t size_class = 0;
+    while (size_class < CLASS_COUNT &&
+           (size_t(1) << (MIN_BLOCK_BITS + size_class)) < size)
+    {
+        ++size_class;
+    }
+
+    if (size_class < CLASS_COUNT)
+    {
+        ThreadCache& thread_cache = cache();
+        size_t& count = thread_cache.counts[size_class];
+        if (count != 0)
+        {
+            const CachedBlock& cached =
+                thread_cache.blocks[size_class][--count];
+            handle = cached.handle;
+            return cached.block;
+        }
+
+        // An exhausted slab falls back to the heap.
+        uint32_t index;
+        void* block = ops(size_class).allocate(index);
+        if (block)
+        {
+            handle = static_cast<uint32_t>(size_class << INDEX_BITS) | index;
+            return block;
+        }
+    }
+
+    handle = HEAP_HANDLE;
+    return ::operator new(size);
+}
+
+inline void BlockPool::deallocate(void* block, uint32_t handle)
+{
+    if (handle == HEAP_HANDLE)
+    {
+        ::operator delete(block);
+        return;
+    }
+
+    ThreadCache& thread_cache = cache();
+    const size_t size_class = handle >> INDEX_BITS;
+    size_t& count = thread_cache.counts[size_class];
+    CachedBlock* blocks = thread_cache.blocks[size_class];
+    if (count == CACHE_SIZE)
+    {
+        // Keep a half to absorb alternating allocations and releases.
+        for (; count > CACHE_SIZE / 2; --count)
+        {
+            release(blocks[count - 1].handle);
+        }
+    }
+
+    blocks[count].block = block;
+    blocks[count].handle = handle;
+    ++count;
+}
+
+}
+
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Cache line size the data layout is tuned for. Define TP_CACHE_LINE_SIZE
+ * to override it, e.g. 128 for Apple M-series or POWER CPUs.
+ * std::hardware_destructive_interference_size isn't used since it requires
+ * C++17 and may differ between translation units compiled for different
+ * targets.
+ */
+#if !defined(TP_CACHE_LINE_SIZE)
+#define TP_CACHE_LINE_SIZE 64
+#endif
+
+namespace tp
+{
+
+namespace detail
+{
+    /// Cache line size.
+    const size_t CACHE_LINE_SIZE = TP_CACHE_LINE_SIZE;
+
+    /// Distance between data written by different threads. Adjacent line
+    /// prefetchers of x86 CPUs fetch cache lines in pairs, so data written
+    /// by different threads false share within two lines.
+    const size_t FALSE_SHARING_RANGE = 2 * CACHE_LINE_SIZE;
+
+    /**
+     * @brief The AlignedArray class owns array of default constructed
+     * elements allocated with the alignment of T, even if it is greater
+     * than the alignment of operator new.
+     */
+    template <typename T>
+    class AlignedArray
+    {
+    public:
+        /**
+         * @brief AlignedArray Construct empty array.
+         */
+        AlignedArray();
+
+        /**
+         * @brief AlignedArray Construct array of default constructed
+         * elements.
+         * @param size Number of elements.
+         */
+        explicit AlignedArray(size_t size);
+
+        /**
+         * @brief Move ctor implementation.
+         */
+        AlignedArray(AlignedArray&& rhs) noexcept;
+
+        /**
+         * @brief Move assignment implementaion.
+         */
+        AlignedArray& operator=(AlignedArray&& rhs) noexcept;
+
+        /**
+         * @brief ~AlignedArray Destroy elements and release memory.
+         */
+        ~AlignedArray();
+
+        T& operator[](size_t index);
+
+        const T& operator[](size_t index) const;
+
+        size_t size() const;
+
+    private:
+        AlignedArray(const AlignedArray&) = delete;
+        AlignedArray& operator=(const AlignedArray&) = delete;
+
+        void destroy(size_t count);
+
+        char* m_storage;
+        T* m_data;
+        size_t m_size;
+    };
+
+
+    /// Implementation
+
+    template <typename T>
+    inline AlignedArray<T>::AlignedArray()
+        : m_storage(nullptr)
+        , m_data(nullptr)
+        , m_size(0)
+    {
+    }
+
+    template <typename T>
+    inline AlignedArray<T>::AlignedArray(size_t size)
+        : m_storage(new char[size * sizeof(T) +
+                             std::alignment_of<T>::value - 1])
+        , m_data(nullptr)
+        , m_size(size)
+    {
+        const size_t alignment = std::alignment_of<T>::value;
+        const uintptr_t address = reinterpret_cast<uintptr_t>(m_storage);
+        m_data = reinterpret_cast<T*>(
+            (address + alignment - 1) / alignment * alignment);
+
+        size_t constructed = 0;
+        try
+        {
+            for (; constructed < size; ++constructed)
+            {
+                new (m_data + constructed) T();
+            }
+        }
+        catch(...)
+        {
+            destroy(constructed);
+            throw;
+        }
+    }
+
+    template <typename T>
+    inline AlignedArray<T>::AlignedArray(AlignedArray&& rhs) noexcept
+        : AlignedArray()
+    {
+        *this = std::move(rhs);
+    }
+
+    template <typename T>
+    inline AlignedArray<T>& AlignedArray<T>::operator=(
+                                                AlignedArray&& rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            destroy(m_size);
+            m_storage = rhs.m_storage;
+            m_data = rhs.m_data;
+            m_size = rhs.m_size;
+            rhs.m_storage = nullptr;
+            rhs.m_data = nullptr;
+            rhs.m_size = 0;
+        }
+        return *this;
+    }
+
+    template <typename T>
+    inline AlignedArray<T>::~AlignedArray()
+    {
+        destroy(m_size);
+    }
+
+    template <typename T>
+    inline T& AlignedArray<T>::operator[](size_t index)
+    {
+        return m_data[index];
+    }
+
+    template <typename T>
+    inline const T& AlignedArray<T>::operator[](size_t index) const
+    {
+        return m_data[index];
+    }
+
+    template <typename T>
+    inline size_t AlignedArray<T>::size() const
+    {
+        return m_size;
+    }
+
+    template <typename T>
+    inline void AlignedArray<T>::destroy(size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            m_data[i].~T();
+        }
+        delete[] m_storage;
+        m_storage = nullptr;
+        m_data = nullptr;
+        m_size = 0;
+    }
+}
+
+}
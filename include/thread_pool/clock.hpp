@@ -0,0 +1,138 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined(__linux__)
+#include <time.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define TP_HAS_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TP_HAS_RDTSC
+#endif
+
+namespace tp
+{
+
+/**
+ * Clocks for task latency measurement. Every clock provides:
+ *  - 'static uint64_t now()' to read current time in ticks;
+ *  - 'static double nanosecondsPerTick()' to convert ticks to nanoseconds.
+ * Only differences between two 'now()' values taken on the same machine are
+ * meaningful.
+ */
+
+/**
+ * @brief The SteadyClock class reads std::chrono::steady_clock. Portable,
+ * precise, but may cost tens of nanoseconds per read.
+ */
+class SteadyClock
+{
+public:
+    static uint64_t now();
+    static double nanosecondsPerTick();
+};
+
+/**
+ * @brief The CoarseClock class reads CLOCK_MONOTONIC_COARSE on Linux. It is
+ * the cheapest kernel clock, but its resolution is one scheduler tick
+ * (1-4 ms), so it fits for queue wait of loaded pools only. Falls back to
+ * SteadyClock on other platforms.
+ */
+class CoarseClock
+{
+public:
+    static uint64_t now();
+    static double nanosecondsPerTick();
+};
+
+/**
+ * @brief The TscClock class reads the CPU time stamp counter. It costs a few
+ * nanoseconds per read. Tick length is calibrated against SteadyClock on the
+ * first conversion, which takes 10 ms. Requires invariant TSC synchronized
+ * between cores. Falls back to SteadyClock on non-x86 platforms.
+ */
+class TscClock
+{
+public:
+    static uint64_t now();
+    static double nanosecondsPerTick();
+
+private:
+    static double calibrate();
+};
+
+
+/// Implementation
+
+inline uint64_t SteadyClock::now()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<
+        std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+inline double SteadyClock::nanosecondsPerTick()
+{
+    return 1.0;
+}
+
+inline uint64_t CoarseClock::now()
+{
+#if defined(__linux__) && defined(CLOCK_MONOTONIC_COARSE)
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000u +
+           static_cast<uint64_t>(ts.tv_nsec);
+#else
+    return SteadyClock::now();
+#endif
+}
+
+inline double CoarseClock::nanosecondsPerTick()
+{
+    return 1.0;
+}
+
+inline uint64_t TscClock::now()
+{
+#if defined(TP_HAS_RDTSC)
+    return __rdtsc();
+#else
+    return SteadyClock::now();
+#endif
+}
+
+inline double TscClock::nanosecondsPerTick()
+{
+    static const double ns_per_tick = calibrate();
+    return ns_per_tick;
+}
+
+inline double TscClock::calibrate()
+{
+#if defined(TP_HAS_RDTSC)
+    const uint64_t steady_begin = SteadyClock::now();
+    const uint64_t tsc_begin = now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    const uint64_t steady_end = SteadyClock::now();
+    const uint64_t tsc_end = now();
+
+    if (tsc_end <= tsc_begin)
+    {
+        return 1.0;
+    }
+
+    return static_cast<double>(steady_end - steady_begin) /
+           static_cast<double>(tsc_end - tsc_begin);
+#else
+    return 1.0;
+#endif
+}
+
+}
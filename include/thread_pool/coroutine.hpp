@@ -0,0 +1,747 @@
+#pragma once
+
+#include <thread_pool/thread_pool.hpp>
+
+// Coroutine support is compiled only if the compiler enables C++20
+// coroutines, the rest of the library stays C++11.
+#if defined(__cpp_impl_coroutine)
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace tp
+{
+
+/**
+ * Coroutines on top of ThreadPool.
+ * A coroutine moves to a pool worker by awaiting scheduleOn(pool). The
+ * coroutine handle is posted as an ordinary task of pointer size, so it is
+ * stored inline and relocated by copying. Awaited from a worker of the
+ * pool, the coroutine is resumed from the local queue of the worker.
+ * Coroutines posted to a pool which drops pending tasks are never resumed.
+ */
+
+template <typename T = void>
+class CoTask;
+
+namespace detail
+{
+    /**
+     * @brief The ResumeTask class is a pool task resuming a coroutine.
+     */
+    class ResumeTask
+    {
+    public:
+        explicit ResumeTask(std::coroutine_handle<> handle) noexcept;
+
+        void operator()() const;
+
+    private:
+        std::coroutine_handle<> m_handle;
+    };
+
+    /**
+     * @brief The CoTaskPromiseBase class holds the continuation and the
+     * exception of a CoTask coroutine.
+     */
+    class CoTaskPromiseBase
+    {
+    public:
+        /**
+         * @brief The FinalAwaiter struct resumes the continuation of a
+         * finished coroutine by symmetric transfer, so chains of awaiting
+         * coroutines don't grow the stack.
+         */
+        struct FinalAwaiter
+        {
+            bool await_ready() const noexcept;
+
+            template <typename Promise>
+            std::coroutine_handle<> await_suspend(
+                std::coroutine_handle<Promise> handle) const noexcept;
+
+            void await_resume() const noexcept;
+        };
+
+        std::suspend_always initial_suspend() const noexcept;
+
+        FinalAwaiter final_suspend() const noexcept;
+
+        void unhandled_exception() noexcept;
+
+        void setContinuation(std::coroutine_handle<> continuation) noexcept;
+
+    protected:
+        void rethrowIfFailed() const;
+
+    private:
+        std::coroutine_handle<> m_continuation = std::noop_coroutine();
+        std::exception_ptr m_exception;
+    };
+
+    template <typename T>
+    class CoTaskPromise : public CoTaskPromiseBase
+    {
+    public:
+        CoTask<T> get_return_object() noexcept;
+
+        template <typename U>
+        void return_value(U&& value);
+
+        T result();
+
+    private:
+        std::optional<T> m_value;
+    };
+
+    template <>
+    class CoTaskPromise<void> : public CoTaskPromiseBase
+    {
+    public:
+        CoTask<void> get_return_object() noexcept;
+
+        void return_void() const noexcept;
+
+        void result();
+    };
+
+    /**
+     * @brief The CoTaskAwaiter class starts an awaited CoTask and resumes
+     * the awaiting coroutine once it is finished.
+     */
+    template <typename T>
+    class CoTaskAwaiter
+    {
+    public:
+        explicit CoTaskAwaiter(
+            std::coroutine_handle<CoTaskPromise<T>> handle) noexcept;
+
+        bool await_ready() const noexcept;
+
+        std::coroutine_handle<> await_suspend(
+            std::coroutine_handle<> continuation) const noexcept;
+
+        T await_resume() const;
+
+    protected:
+        std::coroutine_handle<CoTaskPromise<T>> m_handle;
+    };
+
+    /**
+     * @brief The ReadyAwaiter class awaits CoTask completion leaving its
+     * result or exception in the task.
+     */
+    template <typename T>
+    class ReadyAwaiter : public CoTaskAwaiter<T>
+    {
+    public:
+        using CoTaskAwaiter<T>::CoTaskAwaiter;
+
+        void await_resume() const noexcept;
+    };
+}
+
+/**
+ * @brief The CoTask class is a lazily started coroutine returning T. It
+ * starts when awaited and resumes the awaiting coroutine when finished.
+ * A coroutine moves to a thread pool by awaiting scheduleOn(pool).
+ */
+template <typename T>
+class CoTask
+{
+public:
+    using promise_type = detail::CoTaskPromise<T>;
+
+    /**
+     * @brief CoTask Construct empty task.
+     */
+    CoTask() noexcept = default;
+
+    explicit CoTask(std::coroutine_handle<promise_type> handle) noexcept;
+
+    CoTask(CoTask&& rhs) noexcept;
+
+    CoTask& operator=(CoTask&& rhs) noexcept;
+
+    /**
+     * @brief ~CoTask Destroy the coroutine. It must not be running.
+     */
+    ~CoTask();
+
+    /**
+     * @brief valid Return true if the task holds a coroutine.
+     */
+    bool valid() const noexcept;
+
+    /**
+     * @brief done Return true if the coroutine is finished.
+     */
+    bool done() const noexcept;
+
+    /**
+     * @brief result Return the result of a finished coroutine or rethrow
+     * its exception. The result is moved out.
+     */
+    T result();
+
+    /**
+     * @brief whenReady Return awaitable for the coroutine to finish which
+     * doesn't take the result or rethrow the exception.
+     */
+    detail::ReadyAwaiter<T> whenReady() const noexcept;
+
+    /**
+     * @brief operator co_await Start the coroutine and return its result
+     * once it finishes.
+     */
+    detail::CoTaskAwaiter<T> operator co_await() && noexcept;
+
+private:
+    CoTask(const CoTask&) = delete;
+    CoTask& operator=(const CoTask&) = delete;
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+/**
+ * @brief The ScheduleAwaiter class suspends the awaiting coroutine and
+ * posts it to the thread pool to be resumed by a worker.
+ */
+template <typename Pool>
+class ScheduleAwaiter
+{
+public:
+    explicit ScheduleAwaiter(Pool& pool) noexcept;
+
+    bool await_ready() const noexcept;
+
+    /**
+     * @throw std::runtime_error if the pool queue is full and the overflow
+     * policy is OverflowPolicy::Reject. The coroutine continues with the
+     * exception.
+     */
+    void await_suspend(std::coroutine_handle<> handle) const;
+
+    void await_resume() const noexcept;
+
+private:
+    Pool& m_pool;
+};
+
+/**
+ * @brief scheduleOn Return awaitable resuming the coroutine on a worker
+ * thread of the pool.
+ * @param pool Thread pool to resume the coroutine.
+ */
+template <typename Task, template<typename> class Queue, typename Stats>
+ScheduleAwaiter<ThreadPoolImpl<Task, Queue, Stats>>
+scheduleOn(ThreadPoolImpl<Task, Queue, Stats>& pool) noexcept;
+
+/**
+ * @brief whenAll Start all tasks and finish when all of them are finished.
+ * Tasks run concurrently once they move to a pool by scheduleOn().
+ * @param tasks Tasks to await.
+ * @return Task returning results in the order of tasks.
+ * @throw The first exception of the tasks, after all of them finished.
+ */
+template <typename T>
+CoTask<std::vector<T>> whenAll(std::vector<CoTask<T>> tasks);
+
+CoTask<void> whenAll(std::vector<CoTask<void>> tasks);
+
+/**
+ * @brief syncWait Start the task and block the calling thread until it
+ * finishes.
+ * @param task Task to await.
+ * @return Result of the task.
+ * @throw Exception of the task.
+ * @note Blocks the worker if called from a pool worker thread, so the
+ * task must not need that worker to finish.
+ */
+template <typename T>
+T syncWait(CoTask<T> task);
+
+namespace detail
+{
+    /**
+     * @brief The NotifyTask class is a coroutine awaiting a task and
+     * notifying the latch when finished. The latch resumes the coroutine
+     * waiting for all tasks, see WhenAllLatch and SyncWaitLatch.
+     */
+    template <typename Latch>
+    class NotifyTask
+    {
+    public:
+        class promise_type
+        {
+        public:
+            struct FinalAwaiter
+            {
+                bool await_ready() const noexcept
+                {
+                    return false;
+                }
+
+                std::coroutine_handle<> await_suspend(
+                    std::coroutine_handle<promise_type> handle)
+                    const noexcept
+                {
+                    return handle.promise().m_latch->notify();
+                }
+
+                void await_resume() const noexcept
+                {
+                }
+            };
+
+            NotifyTask get_return_object() noexcept
+            {
+                return NotifyTask(
+                    std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+
+            std::suspend_always initial_suspend() const noexcept
+            {
+                return {};
+            }
+
+            FinalAwaiter final_suspend() const noexcept
+            {
+                return {};
+            }
+
+            void return_void() const noexcept
+            {
+            }
+
+            // Exceptions stay in the awaited task.
+            void unhandled_exception() const noexcept
+            {
+                std::terminate();
+            }
+
+            Latch* m_latch = nullptr;
+        };
+
+        explicit NotifyTask(
+            std::coroutine_handle<promise_type> handle) noexcept
+            : m_handle(handle)
+        {
+        }
+
+        NotifyTask(NotifyTask&& rhs) noexcept
+            : m_handle(std::exchange(rhs.m_handle, nullptr))
+        {
+        }
+
+        ~NotifyTask()
+        {
+            if (m_handle)
+            {
+                m_handle.destroy();
+            }
+        }
+
+        void start(Latch& latch)
+        {
+            m_handle.promise().m_latch = &latch;
+            m_handle.resume();
+        }
+
+    private:
+        NotifyTask(const NotifyTask&) = delete;
+        NotifyTask& operator=(const NotifyTask&) = delete;
+        NotifyTask& operator=(NotifyTask&&) = delete;
+
+        std::coroutine_handle<promise_type> m_handle;
+    };
+
+    template <typename Latch, typename T>
+    NotifyTask<Latch> notifyWhenReady(CoTask<T>& task)
+    {
+        co_await task.whenReady();
+    }
+
+    /**
+     * @brief The WhenAllLatch class resumes the coroutine awaiting it
+     * once all tasks notify it. The awaiting coroutine counts as one more
+     * task, so it is resumed by the last one to arrive.
+     */
+    class WhenAllLatch
+    {
+    public:
+        explicit WhenAllLatch(size_t count) noexcept;
+
+        std::coroutine_handle<> notify() noexcept;
+
+        bool await_ready() const noexcept;
+
+        bool await_suspend(std::coroutine_handle<> continuation) noexcept;
+
+        void await_resume() const noexcept;
+
+    private:
+        std::atomic<size_t> m_count;
+        std::coroutine_handle<> m_continuation;
+    };
+
+    /**
+     * @brief The SyncWaitLatch class wakes up the thread waiting for a
+     * task.
+     */
+    class SyncWaitLatch
+    {
+    public:
+        std::coroutine_handle<> notify() noexcept;
+
+        void wait();
+
+    private:
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        bool m_ready = false;
+    };
+
+    template <typename T>
+    CoTask<void> whenAllReady(std::vector<CoTask<T>>& tasks)
+    {
+        std::vector<NotifyTask<WhenAllLatch>> notifiers;
+        notifiers.reserve(tasks.size());
+        for (auto& task : tasks)
+        {
+            notifiers.push_back(notifyWhenReady<WhenAllLatch>(task));
+        }
+
+        WhenAllLatch latch(tasks.size());
+        for (auto& notifier : notifiers)
+        {
+            notifier.start(latch);
+        }
+        co_await latch;
+    }
+}
+
+/// Implementation
+
+namespace detail
+{
+    inline ResumeTask::ResumeTask(std::coroutine_handle<> handle) noexcept
+        : m_handle(handle)
+    {
+    }
+
+    inline void ResumeTask::operator()() const
+    {
+        m_handle.resume();
+    }
+
+    inline bool CoTaskPromiseBase::FinalAwaiter::await_ready() const noexcept
+    {
+        return false;
+    }
+
+    template <typename Promise>
+    inline std::coroutine_handle<>
+    CoTaskPromiseBase::FinalAwaiter::await_suspend(
+        std::coroutine_handle<Promise> handle) const noexcept
+    {
+        return handle.promise().m_continuation;
+    }
+
+    inline void CoTaskPromiseBase::FinalAwaiter::await_resume() const noexcept
+    {
+    }
+
+    inline std::suspend_always
+    CoTaskPromiseBase::initial_suspend() const noexcept
+    {
+        return {};
+    }
+
+    inline CoTaskPromiseBase::FinalAwaiter
+    CoTaskPromiseBase::final_suspend() const noexcept
+    {
+        return {};
+    }
+
+    inline void CoTaskPromiseBase::unhandled_exception() noexcept
+    {
+        m_exception = std::current_exception();
+    }
+
+    inline void CoTaskPromiseBase::setContinuation(
+        std::coroutine_handle<> continuation) noexcept
+    {
+        m_continuation = continuation;
+    }
+
+    inline void CoTaskPromiseBase::rethrowIfFailed() const
+    {
+        if (m_exception)
+        {
+            std::rethrow_exception(m_exception);
+        }
+    }
+
+    template <typename T>
+    inline CoTask<T> CoTaskPromise<T>::get_return_object() noexcept
+    {
+        return CoTask<T>(
+            std::coroutine_handle<CoTaskPromise>::from_promise(*this));
+    }
+
+    template <typename T>
+    template <typename U>
+    inline void CoTaskPromise<T>::return_value(U&& value)
+    {
+        m_value.emplace(std::forward<U>(value));
+    }
+
+    template <typename T>
+    inline T CoTaskPromise<T>::result()
+    {
+        rethrowIfFailed();
+        return std::move(*m_value);
+    }
+
+    inline CoTask<void> CoTaskPromise<void>::get_return_object() noexcept
+    {
+        return CoTask<void>(
+            std::coroutine_handle<CoTaskPromise>::from_promise(*this));
+    }
+
+    inline void CoTaskPromise<void>::return_void() const noexcept
+    {
+    }
+
+    inline void CoTaskPromise<void>::result()
+    {
+        rethrowIfFailed();
+    }
+
+    template <typename T>
+    inline CoTaskAwaiter<T>::CoTaskAwaiter(
+        std::coroutine_handle<CoTaskPromise<T>> handle) noexcept
+        : m_handle(handle)
+    {
+    }
+
+    template <typename T>
+    inline bool CoTaskAwaiter<T>::await_ready() const noexcept
+    {
+        return m_handle.done();
+    }
+
+    template <typename T>
+    inline std::coroutine_handle<> CoTaskAwaiter<T>::await_suspend(
+        std::coroutine_handle<> continuation) const noexcept
+    {
+        m_handle.promise().setContinuation(continuation);
+        return m_handle;
+    }
+
+    template <typename T>
+    inline T CoTaskAwaiter<T>::await_resume() const
+    {
+        return m_handle.promise().result();
+    }
+
+    template <typename T>
+    inline void ReadyAwaiter<T>::await_resume() const noexcept
+    {
+    }
+
+    inline WhenAllLatch::WhenAllLatch(size_t count) noexcept
+        : m_count(count + 1)
+    {
+    }
+
+    inline std::coroutine_handle<> WhenAllLatch::notify() noexcept
+    {
+        if (m_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            return m_continuation;
+        }
+        return std::noop_coroutine();
+    }
+
+    inline bool WhenAllLatch::await_ready() const noexcept
+    {
+        return m_count.load(std::memory_order_acquire) == 1;
+    }
+
+    inline bool WhenAllLatch::await_suspend(
+        std::coroutine_handle<> continuation) noexcept
+    {
+        // The continuation is published by the decrement. Once it is done
+        // the coroutine may be resumed, so the latch is not touched again.
+        m_continuation = continuation;
+        return m_count.fetch_sub(1, std::memory_order_acq_rel) != 1;
+    }
+
+    inline void WhenAllLatch::await_resume() const noexcept
+    {
+    }
+
+    inline std::coroutine_handle<> SyncWaitLatch::notify() noexcept
+    {
+        // Notified under the lock, the waiter can't destroy the latch
+        // before the notification is done.
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_ready = true;
+        m_cv.notify_one();
+        return std::noop_coroutine();
+    }
+
+    inline void SyncWaitLatch::wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this]()
+            {
+                return m_ready;
+            });
+    }
+}
+
+template <typename T>
+inline CoTask<T>::CoTask(std::coroutine_handle<promise_type> handle) noexcept
+    : m_handle(handle)
+{
+}
+
+template <typename T>
+inline CoTask<T>::CoTask(CoTask&& rhs) noexcept
+    : m_handle(std::exchange(rhs.m_handle, nullptr))
+{
+}
+
+template <typename T>
+inline CoTask<T>& CoTask<T>::operator=(CoTask&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        if (m_handle)
+        {
+            m_handle.destroy();
+        }
+        m_handle = std::exchange(rhs.m_handle, nullptr);
+    }
+    return *this;
+}
+
+template <typename T>
+inline CoTask<T>::~CoTask()
+{
+    if (m_handle)
+    {
+        m_handle.destroy();
+    }
+}
+
+template <typename T>
+inline bool CoTask<T>::valid() const noexcept
+{
+    return static_cast<bool>(m_handle);
+}
+
+template <typename T>
+inline bool CoTask<T>::done() const noexcept
+{
+    return m_handle.done();
+}
+
+template <typename T>
+inline T CoTask<T>::result()
+{
+    return m_handle.promise().result();
+}
+
+template <typename T>
+inline detail::ReadyAwaiter<T> CoTask<T>::whenReady() const noexcept
+{
+    return detail::ReadyAwaiter<T>(m_handle);
+}
+
+template <typename T>
+inline detail::CoTaskAwaiter<T> CoTask<T>::operator co_await() && noexcept
+{
+    return detail::CoTaskAwaiter<T>(m_handle);
+}
+
+template <typename Pool>
+inline ScheduleAwaiter<Pool>::ScheduleAwaiter(Pool& pool) noexcept
+    : m_pool(pool)
+{
+}
+
+template <typename Pool>
+inline bool ScheduleAwaiter<Pool>::await_ready() const noexcept
+{
+    return false;
+}
+
+template <typename Pool>
+inline void ScheduleAwaiter<Pool>::await_suspend(
+    std::coroutine_handle<> handle) const
+{
+    m_pool.post(detail::ResumeTask(handle));
+}
+
+template <typename Pool>
+inline void ScheduleAwaiter<Pool>::await_resume() const noexcept
+{
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline ScheduleAwaiter<ThreadPoolImpl<Task, Queue, Stats>>
+scheduleOn(ThreadPoolImpl<Task, Queue, Stats>& pool) noexcept
+{
+    return ScheduleAwaiter<ThreadPoolImpl<Task, Queue, Stats>>(pool);
+}
+
+template <typename T>
+inline CoTask<std::vector<T>> whenAll(std::vector<CoTask<T>> tasks)
+{
+    co_await detail::whenAllReady(tasks);
+
+    std::vector<T> results;
+    results.reserve(tasks.size());
+    for (auto& task : tasks)
+    {
+        results.push_back(task.result());
+    }
+    co_return results;
+}
+
+inline CoTask<void> whenAll(std::vector<CoTask<void>> tasks)
+{
+    co_await detail::whenAllReady(tasks);
+
+    for (auto& task : tasks)
+    {
+        task.result();
+    }
+}
+
+template <typename T>
+inline T syncWait(CoTask<T> task)
+{
+    detail::SyncWaitLatch latch;
+    detail::NotifyTask<detail::SyncWaitLatch> notifier =
+        detail::notifyWhenReady<detail::SyncWaitLatch>(task);
+    notifier.start(latch);
+    latch.wait();
+
+    return task.result();
+}
+
+}
+
+#endif
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <thread_pool/block_pool.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <type_traits>
 #include <cstring>
 #include <stdexcept>
@@ -13,151 +18,384 @@ namespace tp
  * functional object.
  * This function is analog of 'std::function' with limited capabilities:
  *  - It supports only move semantics.
- *  - The size of functional objects is limited to storage size.
+ *  - The size of functional objects is limited to storage size unless
+ *    HEAP_FALLBACK is set. Larger objects are placed to blocks of the
+ *    per-thread cached BlockPool then, and moving the function moves the
+ *    block pointer only.
  * Due to limitations above it is much faster on creation and copying than
  * std::function.
+ * Assigning a functional object constructs it in place, so storing a
+ * handler to a queue cell moves it once.
  */
-template <typename SIGNATURE, size_t STORAGE_SIZE = 128>
+template <typename SIGNATURE, size_t STORAGE_SIZE = 128,
+          bool HEAP_FALLBACK = false>
 class FixedFunction;
 
-template <typename R, typename... ARGS, size_t STORAGE_SIZE>
-class FixedFunction<R(ARGS...), STORAGE_SIZE>
+namespace detail
+{
+
+/**
+ * @brief The FunctionVTable struct holds operations of the type stored in
+ * FixedFunction. Tables are shared by functions of all storage sizes with
+ * the same signature, so a function can be relocated to a larger one.
+ * Null relocate means the object is moved by copying SMALL_SIZE bytes or
+ * less if the storage is smaller, null destroy means nothing is to be done.
+ */
+template <typename SIGNATURE>
+struct FunctionVTable;
+
+template <typename R, typename... ARGS>
+struct FunctionVTable<R(ARGS...)>
 {
+    enum { SMALL_SIZE = 2 * sizeof(size_t) };
+
+    /// Storage content for objects placed to pooled blocks.
+    struct HeapObject
+    {
+        void* object;
+        uint32_t handle;
+    };
+
+    R (*call)(void* object_ptr, ARGS... args);
+    /// Move constructs object to the storage and destroys the source.
+    void (*relocate)(void* storage_ptr, void* object_ptr);
+    void (*destroy)(void* object_ptr);
+
+    static const FunctionVTable& empty();
+
+    template <typename T>
+    static const FunctionVTable& inlineObject();
+
+    template <typename T>
+    static const FunctionVTable& heapObject();
+
+    static R callEmpty(void*, ARGS...);
+
+    template <typename T>
+    static R callInline(void* object_ptr, ARGS... args);
+
+    template <typename T>
+    static void relocateInline(void* storage_ptr, void* object_ptr);
+
+    template <typename T>
+    static void relocateTrivial(void* storage_ptr, void* object_ptr);
+
+    template <typename T>
+    static void destroyInline(void* object_ptr);
+
+    template <typename T>
+    static R callHeap(void* object_ptr, ARGS... args);
+
+    template <typename T>
+    static void destroyHeap(void* object_ptr);
+};
+
+/**
+ * @brief The is_relocatable_function struct tells if FUNC is a FixedFunction
+ * of SIGNATURE the object of which fits into STORAGE_SIZE.
+ */
+template <typename FUNC, typename SIGNATURE, size_t STORAGE_SIZE>
+struct is_relocatable_function : std::false_type
+{
+};
+
+template <typename SIGNATURE, size_t OTHER_SIZE, bool HEAP_FALLBACK,
+          size_t STORAGE_SIZE>
+struct is_relocatable_function<
+    FixedFunction<SIGNATURE, OTHER_SIZE, HEAP_FALLBACK>, SIGNATURE,
+    STORAGE_SIZE> : std::integral_constant<bool, (OTHER_SIZE <= STORAGE_SIZE)>
+{
+};
 
-    typedef R (*func_ptr_type)(ARGS...);
+}
 
+template <typename R, typename... ARGS, size_t STORAGE_SIZE,
+          bool HEAP_FALLBACK>
+class FixedFunction<R(ARGS...), STORAGE_SIZE, HEAP_FALLBACK>
+{
 public:
     FixedFunction()
-        : m_function_ptr(nullptr), m_method_ptr(nullptr),
-          m_alloc_ptr(nullptr)
+        : m_vtable(&VTable::empty())
     {
     }
 
     /**
-     * @brief FixedFunction Constructor from functional object.
+     * @brief FixedFunction Constructor from functional object, free
+     * function or static member.
      * @param object Functor object will be stored in the internal storage
      * using move constructor. Unmovable objects are prohibited explicitly.
      */
-    template <typename FUNC>
+    template <typename FUNC, typename = typename std::enable_if<
+        !detail::is_relocatable_function<typename std::decay<FUNC>::type,
+            R(ARGS...), STORAGE_SIZE>::value>::type>
     FixedFunction(FUNC&& object)
         : FixedFunction()
     {
-        typedef typename std::remove_reference<FUNC>::type unref_type;
-
-        static_assert(sizeof(unref_type) < STORAGE_SIZE,
-            "functional object doesn't fit into internal storage");
-        static_assert(std::is_move_constructible<unref_type>::value,
-            "Should be of movable type");
-
-        m_method_ptr = [](
-            void* object_ptr, func_ptr_type, ARGS... args) -> R
-        {
-            return static_cast<unref_type*>(object_ptr)
-                ->
-                operator()(args...);
-        };
+        emplace(std::forward<FUNC>(object));
+    }
 
-        m_alloc_ptr = [](void* storage_ptr, void* object_ptr)
-        {
-            if(object_ptr)
-            {
-                unref_type* x_object = static_cast<unref_type*>(object_ptr);
-                new(storage_ptr) unref_type(std::move(*x_object));
-            }
-            else
-            {
-                static_cast<unref_type*>(storage_ptr)->~unref_type();
-            }
-        };
-
-        m_alloc_ptr(&m_storage, &object);
+    FixedFunction(FixedFunction&& o) : FixedFunction()
+    {
+        moveFromOther(o);
     }
 
     /**
-     * @brief FixedFunction Constructor from free function or static member.
+     * @brief FixedFunction Move constructor from function of the same
+     * signature with smaller or equal storage. The stored object is
+     * relocated, not wrapped.
      */
-    template <typename RET, typename... PARAMS>
-    FixedFunction(RET (*func_ptr)(PARAMS...))
+    template <size_t OTHER_SIZE, bool OTHER_HEAP_FALLBACK,
+              typename = typename std::enable_if<(OTHER_SIZE < STORAGE_SIZE ||
+                  (OTHER_SIZE == STORAGE_SIZE &&
+                   OTHER_HEAP_FALLBACK != HEAP_FALLBACK))>::type>
+    FixedFunction(
+        FixedFunction<R(ARGS...), OTHER_SIZE, OTHER_HEAP_FALLBACK>&& o)
         : FixedFunction()
     {
-        m_function_ptr = func_ptr;
-        m_method_ptr = [](void*, func_ptr_type f_ptr, ARGS... args) -> R
-        {
-            return static_cast<RET (*)(PARAMS...)>(f_ptr)(args...);
-        };
+        moveFromOther(o);
     }
 
-    FixedFunction(FixedFunction&& o) : FixedFunction()
+    FixedFunction& operator=(FixedFunction&& o)
     {
         moveFromOther(o);
+        return *this;
     }
 
-    FixedFunction& operator=(FixedFunction&& o)
+    template <size_t OTHER_SIZE, bool OTHER_HEAP_FALLBACK,
+              typename = typename std::enable_if<(OTHER_SIZE < STORAGE_SIZE ||
+                  (OTHER_SIZE == STORAGE_SIZE &&
+                   OTHER_HEAP_FALLBACK != HEAP_FALLBACK))>::type>
+    FixedFunction& operator=(
+        FixedFunction<R(ARGS...), OTHER_SIZE, OTHER_HEAP_FALLBACK>&& o)
     {
         moveFromOther(o);
         return *this;
     }
 
+    /**
+     * @brief operator = Replace stored functional object with the one
+     * constructed in place, see emplace().
+     */
+    template <typename FUNC, typename = typename std::enable_if<
+        !detail::is_relocatable_function<typename std::decay<FUNC>::type,
+            R(ARGS...), STORAGE_SIZE>::value>::type>
+    FixedFunction& operator=(FUNC&& object)
+    {
+        emplace(std::forward<FUNC>(object));
+        return *this;
+    }
+
+    /**
+     * @brief emplace Replace stored functional object with the one move
+     * constructed from object directly in the internal storage, or in a
+     * pooled block if it doesn't fit and HEAP_FALLBACK is set.
+     * @param object Functor object or function pointer.
+     */
+    template <typename FUNC>
+    void emplace(FUNC&& object)
+    {
+        typedef typename std::decay<FUNC>::type object_type;
+
+        static_assert(std::is_move_constructible<object_type>::value,
+            "Should be of movable type");
+
+        reset();
+        store<object_type>(object, std::integral_constant<bool,
+            (sizeof(object_type) < STORAGE_SIZE)>());
+    }
+
     ~FixedFunction()
     {
-        if(m_alloc_ptr) m_alloc_ptr(&m_storage, nullptr);
+        if(m_vtable->destroy) m_vtable->destroy(&m_storage);
     }
 
     /**
-     * @brief operator () Execute stored functional object.
+     * @brief operator () Execute stored functional object. Empty function
+     * dispatches to the thrower, so no check is done on the call path.
      * @throws std::runtime_error if no functional object is stored.
      */
     R operator()(ARGS... args)
     {
-        if(!m_method_ptr) throw std::runtime_error("call of empty functor");
-        return m_method_ptr(&m_storage, m_function_ptr, args...);
+        return m_vtable->call(&m_storage, std::forward<ARGS>(args)...);
     }
 
 private:
     FixedFunction& operator=(const FixedFunction&) = delete;
     FixedFunction(const FixedFunction&) = delete;
 
-    union
-    {
-        typename std::aligned_storage<STORAGE_SIZE, sizeof(size_t)>::type
-            m_storage;
-        func_ptr_type m_function_ptr;
-    };
+    typedef typename std::aligned_storage<STORAGE_SIZE, sizeof(size_t)>::type
+        Storage;
 
-    typedef R (*method_type)(
-        void* object_ptr, func_ptr_type free_func_ptr, ARGS... args);
-    method_type m_method_ptr;
+    typedef detail::FunctionVTable<R(ARGS...)> VTable;
+    typedef typename VTable::HeapObject HeapObject;
 
-    typedef void (*alloc_type)(void* storage_ptr, void* object_ptr);
-    alloc_type m_alloc_ptr;
+    template <typename, size_t, bool>
+    friend class FixedFunction;
 
-    void moveFromOther(FixedFunction& o)
+    template <typename T, typename U>
+    void store(U& object, std::true_type /* fits */)
     {
-        if(this == &o) return;
+        new(&m_storage) T(std::move(object));
+        m_vtable = &VTable::template inlineObject<T>();
+    }
 
-        if(m_alloc_ptr)
+    template <typename T, typename U>
+    void store(U& object, std::false_type /* fits */)
+    {
+        static_assert(HEAP_FALLBACK,
+            "functional object doesn't fit into internal storage");
+        static_assert(sizeof(HeapObject) <= STORAGE_SIZE,
+            "storage is too small for the heap block reference");
+        static_assert(std::alignment_of<T>::value <=
+                      std::alignment_of<std::max_align_t>::value,
+            "functional object is over-aligned");
+
+        HeapObject heap;
+        heap.object = detail::BlockPool::allocate(sizeof(T), heap.handle);
+        try
         {
-            m_alloc_ptr(&m_storage, nullptr);
-            m_alloc_ptr = nullptr;
+            new(heap.object) T(std::move(object));
         }
-        else
+        catch(...)
         {
-            m_function_ptr = nullptr;
+            detail::BlockPool::deallocate(heap.object, heap.handle);
+            throw;
         }
+        new(&m_storage) HeapObject(heap);
+        m_vtable = &VTable::template heapObject<T>();
+    }
 
-        m_method_ptr = o.m_method_ptr;
-        o.m_method_ptr = nullptr;
+    void reset()
+    {
+        if(m_vtable->destroy) m_vtable->destroy(&m_storage);
+        m_vtable = &VTable::empty();
+    }
 
-        if(o.m_alloc_ptr)
+    template <typename OTHER>
+    void moveFromOther(OTHER& o)
+    {
+        if(static_cast<void*>(this) == &o) return;
+
+        reset();
+
+        if(o.m_vtable->relocate)
         {
-            m_alloc_ptr = o.m_alloc_ptr;
-            m_alloc_ptr(&m_storage, &o.m_storage);
+            o.m_vtable->relocate(&m_storage, &o.m_storage);
         }
         else
         {
-            m_function_ptr = o.m_function_ptr;
+            // Constant size copy is inlined.
+            const size_t small_size = VTable::SMALL_SIZE;
+            std::memcpy(&m_storage, &o.m_storage,
+                        std::min(sizeof(o.m_storage), small_size));
         }
+
+        m_vtable = o.m_vtable;
+        o.m_vtable = &VTable::empty();
     }
+
+    Storage m_storage;
+    const VTable* m_vtable;
 };
 
+
+/// Implementation
+
+namespace detail
+{
+
+template <typename R, typename... ARGS>
+inline const FunctionVTable<R(ARGS...)>& FunctionVTable<R(ARGS...)>::empty()
+{
+    static const FunctionVTable vtable = {&callEmpty, nullptr, nullptr};
+    return vtable;
+}
+
+template <typename R, typename... ARGS>
+template <typename T>
+inline const FunctionVTable<R(ARGS...)>&
+FunctionVTable<R(ARGS...)>::inlineObject()
+{
+    static const FunctionVTable vtable = {
+        &callInline<T>,
+        !std::is_trivially_copyable<T>::value ? &relocateInline<T>
+            : sizeof(T) > SMALL_SIZE ? &relocateTrivial<T>
+            : nullptr,
+        std::is_trivially_destructible<T>::value ? nullptr
+                                                 : &destroyInline<T>};
+    return vtable;
+}
+
+template <typename R, typename... ARGS>
+template <typename T>
+inline const FunctionVTable<R(ARGS...)>&
+FunctionVTable<R(ARGS...)>::heapObject()
+{
+    static_assert(sizeof(HeapObject) <= SMALL_SIZE,
+        "heap block reference is expected to be copied");
+
+    // Moving the block reference is a copy.
+    static const FunctionVTable vtable = {
+        &callHeap<T>, nullptr, &destroyHeap<T>};
+    return vtable;
+}
+
+template <typename R, typename... ARGS>
+inline R FunctionVTable<R(ARGS...)>::callEmpty(void*, ARGS...)
+{
+    throw std::runtime_error("call of empty functor");
+}
+
+template <typename R, typename... ARGS>
+template <typename T>
+inline R FunctionVTable<R(ARGS...)>::callInline(void* object_ptr,
+                                                ARGS... args)
+{
+    return (*static_cast<T*>(object_ptr))(std::forward<ARGS>(args)...);
+}
+
+template <typename R, typename... ARGS>
+template <typename T>
+inline void FunctionVTable<R(ARGS...)>::relocateInline(void* storage_ptr,
+                                                       void* object_ptr)
+{
+    T* x_object = static_cast<T*>(object_ptr);
+    new(storage_ptr) T(std::move(*x_object));
+    x_object->~T();
+}
+
+template <typename R, typename... ARGS>
+template <typename T>
+inline void FunctionVTable<R(ARGS...)>::relocateTrivial(void* storage_ptr,
+                                                        void* object_ptr)
+{
+    std::memcpy(storage_ptr, object_ptr, sizeof(T));
+}
+
+template <typename R, typename... ARGS>
+template <typename T>
+inline void FunctionVTable<R(ARGS...)>::destroyInline(void* object_ptr)
+{
+    static_cast<T*>(object_ptr)->~T();
+}
+
+template <typename R, typename... ARGS>
+template <typename T>
+inline R FunctionVTable<R(ARGS...)>::callHeap(void* object_ptr, ARGS... args)
+{
+    return (*static_cast<T*>(static_cast<HeapObject*>(object_ptr)->object))(
+        std::forward<ARGS>(args)...);
+}
+
+template <typename R, typename... ARGS>
+template <typename T>
+inline void FunctionVTable<R(ARGS...)>::destroyHeap(void* object_ptr)
+{
+    HeapObject* heap = static_cast<HeapObject*>(object_ptr);
+    static_cast<T*>(heap->object)->~T();
+    BlockPool::deallocate(heap->object, heap->handle);
+}
+
+}
+
 }
@@ -0,0 +1,697 @@
+#pragma once
+
+#include <thread_pool/idle_strategy.hpp>
+#include <thread_pool/slab_allocator.hpp>
+#include <thread_pool/worker.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace tp
+{
+
+template <typename R>
+class Future;
+
+namespace detail
+{
+
+/**
+ * @brief The FutureContext struct holds resources shared by all futures
+ * created by one thread pool: the slab their states are allocated from and
+ * the condition variable blocked waiters sleep on.
+ */
+struct FutureContext
+{
+    enum { STATE_SIZE = 128 };
+
+    FutureContext(size_t spin_count, size_t yield_count)
+        : spin_count(spin_count)
+        , yield_count(yield_count)
+    {
+    }
+
+    SlabAllocator<STATE_SIZE> slab;
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t spin_count;
+    size_t yield_count;
+};
+
+/**
+ * @brief The FutureStateBase class implements result independent part of
+ * the state shared between a Future and the task producing its result.
+ */
+class FutureStateBase
+{
+public:
+    explicit FutureStateBase(FutureContext* context);
+
+    virtual ~FutureStateBase();
+
+    void addRef();
+
+    void release();
+
+    bool isReady() const;
+
+    void setException(std::exception_ptr exception);
+
+    /**
+     * @brief waitUntil Wait for the result. Pool workers execute pending
+     * tasks while waiting, so nested waits don't deadlock.
+     * @param deadline Time point to stop waiting at.
+     * @return true if the result is ready.
+     */
+    template <typename Clock, typename Duration>
+    bool waitUntil(const std::chrono::time_point<Clock, Duration>& deadline);
+
+    void wait();
+
+protected:
+    /**
+     * @brief markReady Publish the result and notify blocked waiters.
+     */
+    void markReady();
+
+    void rethrowIfFailed();
+
+private:
+    FutureStateBase(const FutureStateBase&) = delete;
+    FutureStateBase& operator=(const FutureStateBase&) = delete;
+
+    template <typename R>
+    friend class FutureState;
+
+    static const uint32_t HEAP_INDEX = ~uint32_t(0);
+
+    std::atomic<uint32_t> m_refs;
+    std::atomic<bool> m_ready;
+    std::atomic<bool> m_waiting;
+    uint32_t m_slab_index;
+    FutureContext* m_context;
+    std::exception_ptr m_exception;
+};
+
+/**
+ * @brief The FutureState class stores a result of type R.
+ */
+template <typename R>
+class FutureState : public FutureStateBase
+{
+public:
+    explicit FutureState(FutureContext* context);
+
+    ~FutureState();
+
+    /**
+     * @brief create Allocate state from the context slab, or from heap if
+     * it doesn't fit the slab block or the slab is exhausted.
+     * @return State referenced once.
+     */
+    static FutureState* create(FutureContext* context);
+
+    template <typename U>
+    void setValue(U&& value);
+
+    R get();
+
+private:
+    typename std::aligned_storage<sizeof(R),
+        std::alignment_of<R>::value>::type m_storage;
+    bool m_has_value;
+};
+
+template <>
+class FutureState<void> : public FutureStateBase
+{
+public:
+    explicit FutureState(FutureContext* context);
+
+    static FutureState* create(FutureContext* context);
+
+    void setValue();
+
+    void get();
+};
+
+struct FutureStateReleaser
+{
+    void operator()(FutureStateBase* state) const
+    {
+        state->release();
+    }
+};
+
+template <size_t... I>
+struct IndexSequence
+{
+};
+
+template <size_t N, size_t... I>
+struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, I...>
+{
+};
+
+template <size_t... I>
+struct MakeIndexSequence<0, I...>
+{
+    typedef IndexSequence<I...> type;
+};
+
+/**
+ * @brief The SubmitTask class is a task which invokes a handler with bound
+ * arguments and stores the result or exception into the future state.
+ * Destroying a task which was never executed breaks the promise.
+ */
+template <typename R, typename Handler, typename... Args>
+class SubmitTask
+{
+public:
+    template <typename H, typename... A>
+    explicit SubmitTask(FutureState<R>* state, H&& handler, A&&... args);
+
+    SubmitTask(SubmitTask&& rhs) noexcept;
+
+    ~SubmitTask();
+
+    void operator()();
+
+private:
+    SubmitTask(const SubmitTask&) = delete;
+    SubmitTask& operator=(const SubmitTask&) = delete;
+
+    template <size_t... I>
+    void invoke(IndexSequence<I...>, std::true_type);
+
+    template <size_t... I>
+    void invoke(IndexSequence<I...>, std::false_type);
+
+    FutureState<R>* m_state;
+    Handler m_handler;
+    std::tuple<Args...> m_args;
+};
+
+template <typename Handler, typename... Args>
+struct SubmitResult
+{
+    // std::result_of is deprecated in C++17 and removed in C++20.
+    typedef decltype(std::declval<typename std::decay<Handler>::type>()(
+        std::declval<typename std::decay<Args>::type>()...)) type;
+};
+
+}
+
+/**
+ * @brief The Future class provides access to the result of a task submitted
+ * to ThreadPool. Unlike std::future its shared state is allocated from the
+ * slab owned by the thread pool, so a Future must not outlive the pool.
+ */
+template <typename R>
+class Future
+{
+    static_assert(!std::is_reference<R>::value,
+        "Reference results are not supported");
+
+public:
+    /**
+     * @brief Future Construct future without shared state.
+     */
+    Future() noexcept;
+
+    /**
+     * @brief Future Construct future referencing the shared state.
+     * @param state State referenced once on behalf of this future.
+     */
+    explicit Future(detail::FutureState<R>* state) noexcept;
+
+    /**
+     * @brief Move ctor implementation.
+     */
+    Future(Future&& rhs) noexcept;
+
+    /**
+     * @brief Move assignment implementaion.
+     */
+    Future& operator=(Future&& rhs) noexcept;
+
+    ~Future();
+
+    /**
+     * @brief valid Return true if future refers to a shared state.
+     */
+    bool valid() const;
+
+    /**
+     * @brief isReady Return true if result is available.
+     */
+    bool isReady() const;
+
+    /**
+     * @brief wait Block until result is available. Pool worker threads
+     * execute pending tasks while waiting.
+     * @throws std::future_error if future has no shared state.
+     */
+    void wait() const;
+
+    /**
+     * @brief waitFor Block until result is available or timeout expires.
+     * @param timeout Maximum time to wait.
+     * @return std::future_status::ready or std::future_status::timeout.
+     * @throws std::future_error if future has no shared state.
+     */
+    template <typename Rep, typename Period>
+    std::future_status waitFor(
+        const std::chrono::duration<Rep, Period>& timeout) const;
+
+    /**
+     * @brief waitUntil Block until result is available or deadline passes.
+     * @param deadline Time point to stop waiting at.
+     * @return std::future_status::ready or std::future_status::timeout.
+     * @throws std::future_error if future has no shared state.
+     */
+    template <typename Clock, typename Duration>
+    std::future_status waitUntil(
+        const std::chrono::time_point<Clock, Duration>& deadline) const;
+
+    /**
+     * @brief get Wait for the result and return it. Releases the shared
+     * state, so the future becomes invalid.
+     * @throws Exception thrown by the task.
+     * @throws std::future_error if future has no shared state or the task
+     * was destroyed without being executed.
+     */
+    R get();
+
+private:
+    Future(const Future&) = delete;
+    Future& operator=(const Future&) = delete;
+
+    /**
+     * @brief state Return shared state.
+     * @throws std::future_error if future has no shared state.
+     */
+    detail::FutureState<R>* state() const;
+
+    detail::FutureState<R>* m_state;
+};
+
+
+/// Implementation
+
+namespace detail
+{
+
+inline FutureStateBase::FutureStateBase(FutureContext* context)
+    : m_refs(1)
+    , m_ready(false)
+    , m_waiting(false)
+    , m_slab_index(HEAP_INDEX)
+    , m_context(context)
+{
+}
+
+inline FutureStateBase::~FutureStateBase()
+{
+}
+
+inline void FutureStateBase::addRef()
+{
+    m_refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void FutureStateBase::release()
+{
+    if (m_refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+    {
+        return;
+    }
+
+    if (m_slab_index == HEAP_INDEX)
+    {
+        delete this;
+        return;
+    }
+
+    FutureContext* context = m_context;
+    const uint32_t index = m_slab_index;
+    this->~FutureStateBase();
+    context->slab.deallocate(index);
+}
+
+inline bool FutureStateBase::isReady() const
+{
+    return m_ready.load(std::memory_order_acquire);
+}
+
+inline void FutureStateBase::setException(std::exception_ptr exception)
+{
+    m_exception = std::move(exception);
+    markReady();
+}
+
+inline void FutureStateBase::markReady()
+{
+    m_ready.store(true, std::memory_order_release);
+
+    // Pairs with the fence in waitUntil: either the waiter sees the result
+    // or this thread sees the waiter.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (m_waiting.load(std::memory_order_relaxed))
+    {
+        std::lock_guard<std::mutex> lock(m_context->mutex);
+        m_context->cv.notify_all();
+    }
+}
+
+template <typename Clock, typename Duration>
+inline bool FutureStateBase::waitUntil(
+    const std::chrono::time_point<Clock, Duration>& deadline)
+{
+    IdleStrategy idle_strategy(m_context->spin_count, m_context->yield_count);
+
+    while (!isReady())
+    {
+        if (run_pending_task())
+        {
+            idle_strategy.reset();
+            continue;
+        }
+
+        if (Clock::now() >= deadline)
+        {
+            return false;
+        }
+
+        if (idle_strategy.idle())
+        {
+            continue;
+        }
+
+        m_waiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        std::unique_lock<std::mutex> lock(m_context->mutex);
+        if (isReady())
+        {
+            break;
+        }
+
+        // Workers wake up periodically to help with tasks posted to their
+        // queues meanwhile.
+        const auto slice = Clock::now() + std::chrono::milliseconds(1);
+        if (*thread_worker() && slice < deadline)
+        {
+            m_context->cv.wait_until(lock, slice);
+        }
+        else
+        {
+            m_context->cv.wait_until(lock, deadline);
+        }
+    }
+
+    return true;
+}
+
+inline void FutureStateBase::wait()
+{
+    // Finite deadline to not overflow clock arithmetic.
+    while (!waitUntil(std::chrono::steady_clock::now() + std::chrono::hours(24)))
+    {
+    }
+}
+
+inline void FutureStateBase::rethrowIfFailed()
+{
+    if (m_exception)
+    {
+        std::rethrow_exception(m_exception);
+    }
+}
+
+template <typename R>
+inline FutureState<R>::FutureState(FutureContext* context)
+    : FutureStateBase(context)
+    , m_has_value(false)
+{
+}
+
+template <typename R>
+inline FutureState<R>::~FutureState()
+{
+    if (m_has_value)
+    {
+        reinterpret_cast<R*>(&m_storage)->~R();
+    }
+}
+
+template <typename R>
+inline FutureState<R>* FutureState<R>::create(FutureContext* context)
+{
+    if (sizeof(FutureState) > FutureContext::STATE_SIZE ||
+        std::alignment_of<FutureState>::value >
+            std::alignment_of<std::max_align_t>::value)
+    {
+        return new FutureState(context);
+    }
+
+    // An exhausted slab falls back to the heap.
+    uint32_t index;
+    void* block = context->slab.tryAllocate(index);
+    if (!block)
+    {
+        return new FutureState(context);
+    }
+
+    FutureState* state = new (block) FutureState(context);
+    state->m_slab_index = index;
+    return state;
+}
+
+template <typename R>
+template <typename U>
+inline void FutureState<R>::setValue(U&& value)
+{
+    new (&m_storage) R(std::forward<U>(value));
+    m_has_value = true;
+    markReady();
+}
+
+template <typename R>
+inline R FutureState<R>::get()
+{
+    wait();
+    rethrowIfFailed();
+    return std::move(*reinterpret_cast<R*>(&m_storage));
+}
+
+inline FutureState<void>::FutureState(FutureContext* context)
+    : FutureStateBase(context)
+{
+}
+
+inline FutureState<void>* FutureState<void>::create(FutureContext* context)
+{
+    // An exhausted slab falls back to the heap.
+    uint32_t index;
+    void* block = context->slab.tryAllocate(index);
+    if (!block)
+    {
+        return new FutureState(context);
+    }
+
+    FutureState* state = new (block) FutureState(context);
+    state->m_slab_index = index;
+    return state;
+}
+
+inline void FutureState<void>::setValue()
+{
+    markReady();
+}
+
+inline void FutureState<void>::get()
+{
+    wait();
+    rethrowIfFailed();
+}
+
+template <typename R, typename Handler, typename... Args>
+template <typename H, typename... A>
+inline SubmitTask<R, Handler, Args...>::SubmitTask(FutureState<R>* state,
+                                                   H&& handler, A&&... args)
+    : m_state(state)
+    , m_handler(std::forward<H>(handler))
+    , m_args(std::forward<A>(args)...)
+{
+    m_state->addRef();
+}
+
+template <typename R, typename Handler, typename... Args>
+inline SubmitTask<R, Handler, Args...>::SubmitTask(SubmitTask&& rhs) noexcept
+    : m_state(rhs.m_state)
+    , m_handler(std::move(rhs.m_handler))
+    , m_args(std::move(rhs.m_args))
+{
+    rhs.m_state = nullptr;
+}
+
+template <typename R, typename Handler, typename... Args>
+inline SubmitTask<R, Handler, Args...>::~SubmitTask()
+{
+    if (!m_state)
+    {
+        return;
+    }
+
+    if (!m_state->isReady())
+    {
+        m_state->setException(std::make_exception_ptr(
+            std::future_error(std::future_errc::broken_promise)));
+    }
+
+    m_state->release();
+}
+
+template <typename R, typename Handler, typename... Args>
+inline void SubmitTask<R, Handler, Args...>::operator()()
+{
+    try
+    {
+        invoke(typename MakeIndexSequence<sizeof...(Args)>::type(),
+               typename std::is_void<R>::type());
+    }
+    catch(...)
+    {
+        m_state->setException(std::current_exception());
+    }
+}
+
+template <typename R, typename Handler, typename... Args>
+template <size_t... I>
+inline void SubmitTask<R, Handler, Args...>::invoke(IndexSequence<I...>,
+                                                    std::true_type)
+{
+    m_handler(std::move(std::get<I>(m_args))...);
+    m_state->setValue();
+}
+
+template <typename R, typename Handler, typename... Args>
+template <size_t... I>
+inline void SubmitTask<R, Handler, Args...>::invoke(IndexSequence<I...>,
+                                                    std::false_type)
+{
+    m_state->setValue(m_handler(std::move(std::get<I>(m_args))...));
+}
+
+}
+
+template <typename R>
+inline Future<R>::Future() noexcept
+    : m_state(nullptr)
+{
+}
+
+template <typename R>
+inline Future<R>::Future(detail::FutureState<R>* state) noexcept
+    : m_state(state)
+{
+}
+
+template <typename R>
+inline Future<R>::Future(Future&& rhs) noexcept
+    : m_state(rhs.m_state)
+{
+    rhs.m_state = nullptr;
+}
+
+template <typename R>
+inline Future<R>& Future<R>::operator=(Future&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        if (m_state)
+        {
+            m_state->release();
+        }
+        m_state = rhs.m_state;
+        rhs.m_state = nullptr;
+    }
+    return *this;
+}
+
+template <typename R>
+inline Future<R>::~Future()
+{
+    if (m_state)
+    {
+        m_state->release();
+    }
+}
+
+template <typename R>
+inline bool Future<R>::valid() const
+{
+    return m_state != nullptr;
+}
+
+template <typename R>
+inline bool Future<R>::isReady() const
+{
+    return state()->isReady();
+}
+
+template <typename R>
+inline void Future<R>::wait() const
+{
+    state()->wait();
+}
+
+template <typename R>
+template <typename Rep, typename Period>
+inline std::future_status Future<R>::waitFor(
+    const std::chrono::duration<Rep, Period>& timeout) const
+{
+    return waitUntil(std::chrono::steady_clock::now() + timeout);
+}
+
+template <typename R>
+template <typename Clock, typename Duration>
+inline std::future_status Future<R>::waitUntil(
+    const std::chrono::time_point<Clock, Duration>& deadline) const
+{
+    return state()->waitUntil(deadline) ? std::future_status::ready
+                                        : std::future_status::timeout;
+}
+
+template <typename R>
+inline R Future<R>::get()
+{
+    std::unique_ptr<detail::FutureState<R>, detail::FutureStateReleaser>
+        released(state());
+    m_state = nullptr;
+    return released->get();
+}
+
+template <typename R>
+inline detail::FutureState<R>* Future<R>::state() const
+{
+    if (!m_state)
+    {
+        throw std::future_error(std::future_errc::no_state);
+    }
+    return m_state;
+}
+
+}
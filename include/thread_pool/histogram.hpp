@@ -0,0 +1,251 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tp
+{
+
+class LatencyHistogram;
+
+/**
+ * @brief The LatencyDistribution class is a snapshot of LatencyHistogram.
+ * Snapshots of different workers can be merged with operator+=.
+ */
+class LatencyDistribution
+{
+public:
+    LatencyDistribution();
+
+    /**
+     * @brief count Return number of recorded values.
+     */
+    uint64_t count() const;
+
+    /**
+     * @brief percentile Return value in nanoseconds which is not exceeded
+     * by the given fraction of recorded values.
+     * @param fraction Fraction in range [0, 1], e.g. 0.99 for p99.
+     * @return Upper bound of the histogram bucket containing the percentile,
+     * so the result is overestimated by 1/16 at most. Zero if empty.
+     */
+    uint64_t percentile(double fraction) const;
+
+    /**
+     * @brief max Return upper bound of the largest recorded value in
+     * nanoseconds.
+     */
+    uint64_t max() const;
+
+    /**
+     * @brief operator+= Merge distribution recorded with the same clock.
+     */
+    LatencyDistribution& operator+=(const LatencyDistribution& rhs);
+
+private:
+    friend class LatencyHistogram;
+
+    std::vector<uint64_t> m_counts;
+    uint64_t m_count;
+    double m_ns_per_tick;
+};
+
+/**
+ * @brief The LatencyHistogram class implements log-linear (HDR-style)
+ * histogram of clock tick counts.
+ * Every power of two range is split into 16 linear buckets, so relative
+ * error is 1/16 at most over the whole 64 bit range with 976 buckets.
+ * Values are recorded by one thread without read-modify-write operations,
+ * snapshots can be taken from any thread concurrently.
+ */
+class LatencyHistogram
+{
+public:
+    enum
+    {
+        SUB_BUCKET_BITS = 4,
+        SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS,
+        BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT
+    };
+
+    LatencyHistogram();
+
+    /**
+     * @brief record Record value.
+     * @param value Value in clock ticks.
+     * @note Must be called from one thread only.
+     */
+    void record(uint64_t value);
+
+    /**
+     * @brief snapshot Store current distribution.
+     * @param distribution Place for the distribution to be stored.
+     * @param ns_per_tick Clock tick length in nanoseconds.
+     */
+    void snapshot(LatencyDistribution& distribution, double ns_per_tick) const;
+
+    /**
+     * @brief bucketIndex Return index of the bucket value belongs to.
+     */
+    static size_t bucketIndex(uint64_t value);
+
+    /**
+     * @brief bucketUpperBound Return the largest value of the bucket.
+     */
+    static uint64_t bucketUpperBound(size_t index);
+
+private:
+    std::atomic<uint64_t> m_counts[BUCKET_COUNT];
+};
+
+
+/// Implementation
+
+namespace detail
+{
+    inline unsigned most_significant_bit(uint64_t value)
+    {
+#if defined(__GNUC__)
+        return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#else
+        unsigned msb = 0;
+        while (value >>= 1)
+        {
+            ++msb;
+        }
+        return msb;
+#endif
+    }
+}
+
+inline LatencyDistribution::LatencyDistribution()
+    : m_count(0)
+    , m_ns_per_tick(1.0)
+{
+}
+
+inline uint64_t LatencyDistribution::count() const
+{
+    return m_count;
+}
+
+inline uint64_t LatencyDistribution::percentile(double fraction) const
+{
+    if (m_count == 0)
+    {
+        return 0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(std::ceil(fraction * m_count));
+    if (rank == 0)
+    {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < m_counts.size(); ++i)
+    {
+        seen += m_counts[i];
+        if (seen >= rank)
+        {
+            return static_cast<uint64_t>(
+                LatencyHistogram::bucketUpperBound(i) * m_ns_per_tick);
+        }
+    }
+
+    return max();
+}
+
+inline uint64_t LatencyDistribution::max() const
+{
+    for (size_t i = m_counts.size(); i != 0; --i)
+    {
+        if (m_counts[i - 1] != 0)
+        {
+            return static_cast<uint64_t>(
+                LatencyHistogram::bucketUpperBound(i - 1) * m_ns_per_tick);
+        }
+    }
+    return 0;
+}
+
+inline LatencyDistribution& LatencyDistribution::operator+=(
+                                            const LatencyDistribution& rhs)
+{
+    if (rhs.m_counts.empty())
+    {
+        return *this;
+    }
+
+    if (m_counts.empty())
+    {
+        *this = rhs;
+        return *this;
+    }
+
+    for (size_t i = 0; i < m_counts.size(); ++i)
+    {
+        m_counts[i] += rhs.m_counts[i];
+    }
+    m_count += rhs.m_count;
+    return *this;
+}
+
+inline LatencyHistogram::LatencyHistogram()
+{
+    for (auto& counter : m_counts)
+    {
+        counter.store(0, std::memory_order_relaxed);
+    }
+}
+
+inline size_t LatencyHistogram::bucketIndex(uint64_t value)
+{
+    if (value < 2 * SUB_BUCKET_COUNT)
+    {
+        return static_cast<size_t>(value);
+    }
+
+    // Keep the highest SUB_BUCKET_BITS + 1 bits of the value.
+    const unsigned shift = detail::most_significant_bit(value) -
+                           SUB_BUCKET_BITS;
+    return shift * SUB_BUCKET_COUNT + static_cast<size_t>(value >> shift);
+}
+
+inline uint64_t LatencyHistogram::bucketUpperBound(size_t index)
+{
+    if (index < 2 * SUB_BUCKET_COUNT)
+    {
+        return index;
+    }
+
+    const unsigned shift = static_cast<unsigned>(index / SUB_BUCKET_COUNT) - 1;
+    const uint64_t mantissa = index - shift * SUB_BUCKET_COUNT;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+inline void LatencyHistogram::record(uint64_t value)
+{
+    std::atomic<uint64_t>& counter = m_counts[bucketIndex(value)];
+    counter.store(counter.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_relaxed);
+}
+
+inline void LatencyHistogram::snapshot(LatencyDistribution& distribution,
+                                       double ns_per_tick) const
+{
+    distribution.m_counts.resize(BUCKET_COUNT);
+    distribution.m_count = 0;
+    distribution.m_ns_per_tick = ns_per_tick;
+
+    for (size_t i = 0; i < BUCKET_COUNT; ++i)
+    {
+        distribution.m_counts[i] = m_counts[i].load(std::memory_order_relaxed);
+        distribution.m_count += distribution.m_counts[i];
+    }
+}
+
+}
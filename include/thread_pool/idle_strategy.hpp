@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <emmintrin.h>
+#endif
+
+namespace tp
+{
+
+namespace detail
+{
+    /**
+     * @brief cpuRelax Hint the CPU that the caller is busy waiting.
+     */
+    inline void cpuRelax()
+    {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+        _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        asm volatile("yield" ::: "memory");
+#endif
+    }
+}
+
+/**
+ * @brief The IdleStrategy class implements progressive backoff for a thread
+ * which has no work to do. At first it spins with pause instructions, then
+ * yields the CPU to other threads and finally reports that the budget is
+ * exhausted and the caller should park itself.
+ */
+class IdleStrategy
+{
+public:
+    /**
+     * @brief IdleStrategy Constructor.
+     * @param spin_count Number of busy spinning steps.
+     * @param yield_count Number of yielding steps after spinning.
+     */
+    IdleStrategy(size_t spin_count, size_t yield_count);
+
+    /**
+     * @brief idle Perform next backoff step.
+     * @return false if spin and yield budgets are exhausted and the caller
+     * should park.
+     */
+    bool idle();
+
+    /**
+     * @brief reset Restart backoff from the spinning phase.
+     */
+    void reset();
+
+private:
+    size_t m_spin_count;
+    size_t m_yield_count;
+    size_t m_step;
+};
+
+/// Implementation
+
+inline IdleStrategy::IdleStrategy(size_t spin_count, size_t yield_count)
+    : m_spin_count(spin_count)
+    , m_yield_count(yield_count)
+    , m_step(0)
+{
+}
+
+inline bool IdleStrategy::idle()
+{
+    if (m_step < m_spin_count)
+    {
+        // Pause bursts grow exponentially to reduce pressure on polled
+        // cache lines while keeping reaction time low.
+        const size_t pauses = size_t(1) << std::min<size_t>(m_step, 5);
+        for (size_t i = 0; i < pauses; ++i)
+        {
+            detail::cpuRelax();
+        }
+        ++m_step;
+        return true;
+    }
+
+    if (m_step < m_spin_count + m_yield_count)
+    {
+        std::this_thread::yield();
+        ++m_step;
+        return true;
+    }
+
+    return false;
+}
+
+inline void IdleStrategy::reset()
+{
+    m_step = 0;
+}
+
+}
@@ -36,44 +36,69 @@
 
 #pragma once
 
+#include <thread_pool/cache_line.hpp>
+
+#include <algorithm>
 #include <atomic>
+#include <iterator>
 #include <type_traits>
-#include <vector>
 #include <stdexcept>
 
 namespace tp
 {
 
 /**
- * @brief The MPMCBoundedQueue class implements bounded
+ * @brief The CellLayout enum defines how cells of BasicMPMCBoundedQueue are
+ * placed in memory. Producer of position N and consumer of position N-1
+ * write neighbour cells concurrently, so the cells shouldn't share cache
+ * lines.
+ */
+enum class CellLayout
+{
+    /// Every cell is aligned to the cache line and padded to a multiple of
+    /// it. Costs up to a cache line per cell.
+    Padded,
+    /// Cells are packed densely, neighbour cells share cache lines.
+    Packed,
+    /// Cells are packed densely, but consecutive positions are mapped to
+    /// cells two cache lines apart by swapping the low bits of the position
+    /// with the next ones. Fits small elements. At most a half of the
+    /// position bits are swapped, so short queues are scrambled partially.
+    Scrambled
+};
+
+/**
+ * @brief The BasicMPMCBoundedQueue class implements bounded
  * multi-producers/multi-consumers lock-free queue.
+ * Enqueue and dequeue positions are kept two cache lines apart from each
+ * other and from the cells to defeat adjacent line prefetch.
  * Doesn't accept non-movable types as T.
  * Inspired by Dmitry Vyukov's mpmc queue.
  * http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
  */
-template <typename T>
-class MPMCBoundedQueue
+template <typename T, CellLayout LAYOUT>
+class BasicMPMCBoundedQueue
 {
     static_assert(
         std::is_move_constructible<T>::value, "Should be of movable type");
 
 public:
     /**
-     * @brief MPMCBoundedQueue Constructor.
+     * @brief BasicMPMCBoundedQueue Constructor.
      * @param size Power of 2 number - queue length.
      * @throws std::invalid_argument if size is bad.
      */
-    explicit MPMCBoundedQueue(size_t size);
+    explicit BasicMPMCBoundedQueue(size_t size);
 
     /**
      * @brief Move ctor implementation.
      */
-    MPMCBoundedQueue(MPMCBoundedQueue&& rhs) noexcept;
+    BasicMPMCBoundedQueue(BasicMPMCBoundedQueue&& rhs) noexcept;
 
     /**
      * @brief Move assignment implementaion.
      */
-    MPMCBoundedQueue& operator=(MPMCBoundedQueue&& rhs) noexcept;
+    BasicMPMCBoundedQueue& operator=(BasicMPMCBoundedQueue&& rhs) noexcept;
 
     /**
      * @brief push Push data to queue.
@@ -90,51 +115,74 @@ public:
      */
     bool pop(T& data);
 
+    /**
+     * @brief pushBatch Push range of data to queue reserving cells with a
+     * single CAS.
+     * @param first Beginning of the range. Elements are assigned from
+     * '*first', use std::move_iterator to move them. FixedFunction elements
+     * move even from lvalue callables, so pushed ones are consumed anyway.
+     * @param last End of the range.
+     * @return Number of elements pushed from the beginning of the range.
+     */
+    template <typename Iterator>
+    size_t pushBatch(Iterator first, Iterator last);
+
+    /**
+     * @brief popBatch Pop several elements from queue claiming cells with a
+     * single CAS.
+     * @param out Beginning of the place to store popped data.
+     * @param max_count Maximum number of elements to pop.
+     * @return Number of popped elements.
+     */
+    template <typename OutputIterator>
+    size_t popBatch(OutputIterator out, size_t max_count);
+
 private:
-    struct Cell
+    struct PackedCell
     {
         std::atomic<size_t> sequence;
         T data;
+    };
 
-        Cell() = default;
-
-        Cell(const Cell&) = delete;
-        Cell& operator=(const Cell&) = delete;
-
-        Cell(Cell&& rhs)
-            : sequence(rhs.sequence.load()), data(std::move(rhs.data))
-        {
-        }
+    struct alignas(detail::CACHE_LINE_SIZE) PaddedCell : PackedCell
+    {
+    };
 
-        Cell& operator=(Cell&& rhs)
-        {
-            sequence = rhs.sequence.load();
-            data = std::move(rhs.data);
+    typedef typename std::conditional<LAYOUT == CellLayout::Padded,
+                                      PaddedCell, PackedCell>::type Cell;
 
-            return *this;
-        }
-    };
+    /**
+     * @brief cellAt Return cell of the position.
+     */
+    Cell& cellAt(size_t pos);
 
 private:
-    typedef char Cacheline[64];
+    typedef char Padding[detail::FALSE_SHARING_RANGE];
 
-    Cacheline pad0;
-    std::vector<Cell> m_buffer;
+    Padding pad0;
+    detail::AlignedArray<Cell> m_buffer;
     /* const */ size_t m_buffer_mask;
-    Cacheline pad1;
+    /* const */ size_t m_scramble_bits;
+    Padding pad1;
     std::atomic<size_t> m_enqueue_pos;
-    Cacheline pad2;
+    Padding pad2;
     std::atomic<size_t> m_dequeue_pos;
-    Cacheline pad3;
+    Padding pad3;
 };
 
+/**
+ * @brief MPMCBoundedQueue is the queue with padded cells.
+ */
+template <typename T>
+using MPMCBoundedQueue = BasicMPMCBoundedQueue<T, CellLayout::Padded>;
+
 
 /// Implementation
 
-template <typename T>
-inline MPMCBoundedQueue<T>::MPMCBoundedQueue(size_t size)
-    : m_buffer(size), m_buffer_mask(size - 1), m_enqueue_pos(0),
-      m_dequeue_pos(0)
+template <typename T, CellLayout LAYOUT>
+inline BasicMPMCBoundedQueue<T, LAYOUT>::BasicMPMCBoundedQueue(size_t size)
+    : m_buffer(size), m_buffer_mask(size - 1), m_scramble_bits(0),
+      m_enqueue_pos(0), m_dequeue_pos(0)
 {
     bool size_is_power_of_2 = (size >= 2) && ((size & (size - 1)) == 0);
     if(!size_is_power_of_2)
@@ -142,40 +190,80 @@ inline MPMCBoundedQueue<T>::MPMCBoundedQueue(size_t size)
         throw std::invalid_argument("buffer size should be a power of 2");
     }
 
+    if(LAYOUT == CellLayout::Scrambled)
+    {
+        // Enough bits to skip the false sharing range, but no more than a
+        // half of the index bits to swap them with.
+        size_t index_bits = 0;
+        while((size_t(1) << index_bits) < size)
+        {
+            ++index_bits;
+        }
+        while((sizeof(Cell) << m_scramble_bits) < detail::FALSE_SHARING_RANGE
+              && 2 * (m_scramble_bits + 1) <= index_bits)
+        {
+            ++m_scramble_bits;
+        }
+    }
+
     for(size_t i = 0; i < size; ++i)
     {
-        m_buffer[i].sequence = i;
+        cellAt(i).sequence = i;
     }
 }
 
-template <typename T>
-inline MPMCBoundedQueue<T>::MPMCBoundedQueue(MPMCBoundedQueue&& rhs) noexcept
+template <typename T, CellLayout LAYOUT>
+inline BasicMPMCBoundedQueue<T, LAYOUT>::BasicMPMCBoundedQueue(
+                                    BasicMPMCBoundedQueue&& rhs) noexcept
 {
     *this = rhs;
 }
 
-template <typename T>
-inline MPMCBoundedQueue<T>& MPMCBoundedQueue<T>::operator=(MPMCBoundedQueue&& rhs) noexcept
+template <typename T, CellLayout LAYOUT>
+inline BasicMPMCBoundedQueue<T, LAYOUT>&
+BasicMPMCBoundedQueue<T, LAYOUT>::operator=(
+                                    BasicMPMCBoundedQueue&& rhs) noexcept
 {
     if (this != &rhs)
     {
         m_buffer = std::move(rhs.m_buffer);
         m_buffer_mask = std::move(rhs.m_buffer_mask);
+        m_scramble_bits = rhs.m_scramble_bits;
         m_enqueue_pos = rhs.m_enqueue_pos.load();
         m_dequeue_pos = rhs.m_dequeue_pos.load();
     }
     return *this;
 }
 
-template <typename T>
+template <typename T, CellLayout LAYOUT>
+inline typename BasicMPMCBoundedQueue<T, LAYOUT>::Cell&
+BasicMPMCBoundedQueue<T, LAYOUT>::cellAt(size_t pos)
+{
+    const size_t index = pos & m_buffer_mask;
+    if(LAYOUT != CellLayout::Scrambled)
+    {
+        return m_buffer[index];
+    }
+
+    // Swap the lowest bits with the next ones, so consecutive positions
+    // are 2^bits cells apart.
+    const size_t bits = m_scramble_bits;
+    const size_t low_mask = (size_t(1) << bits) - 1;
+    const size_t swapped = (index & ~(low_mask | (low_mask << bits))) |
+                           ((index & low_mask) << bits) |
+                           ((index >> bits) & low_mask);
+    return m_buffer[swapped];
+}
+
+template <typename T, CellLayout LAYOUT>
 template <typename U>
-inline bool MPMCBoundedQueue<T>::push(U&& data)
+inline bool BasicMPMCBoundedQueue<T, LAYOUT>::push(U&& data)
 {
     Cell* cell;
     size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
     for(;;)
     {
-        cell = &m_buffer[pos & m_buffer_mask];
+        cell = &cellAt(pos);
         size_t seq = cell->sequence.load(std::memory_order_acquire);
         intptr_t dif = (intptr_t)seq - (intptr_t)pos;
         if(dif == 0)
@@ -203,14 +291,14 @@ inline bool MPMCBoundedQueue<T>::push(U&& data)
     return true;
 }
 
-template <typename T>
-inline bool MPMCBoundedQueue<T>::pop(T& data)
+template <typename T, CellLayout LAYOUT>
+inline bool BasicMPMCBoundedQueue<T, LAYOUT>::pop(T& data)
 {
     Cell* cell;
     size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
     for(;;)
     {
-        cell = &m_buffer[pos & m_buffer_mask];
+        cell = &cellAt(pos);
         size_t seq = cell->sequence.load(std::memory_order_acquire);
         intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
         if(dif == 0)
@@ -239,4 +327,122 @@ inline bool MPMCBoundedQueue<T>::pop(T& data)
     return true;
 }
 
+template <typename T, CellLayout LAYOUT>
+template <typename Iterator>
+inline size_t BasicMPMCBoundedQueue<T, LAYOUT>::pushBatch(Iterator first,
+                                                          Iterator last)
+{
+    const size_t count = std::min<size_t>(std::distance(first, last),
+                                          m_buffer_mask + 1);
+    if(count == 0)
+    {
+        return 0;
+    }
+
+    size_t reserved;
+    size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+    for(;;)
+    {
+        // Reserve the longest run of free cells, cells may be released by
+        // consumers out of order.
+        reserved = 0;
+        intptr_t dif = 0;
+        for(; reserved < count; ++reserved)
+        {
+            const size_t seq = cellAt(pos + reserved)
+                                   .sequence.load(std::memory_order_acquire);
+            dif = (intptr_t)seq - (intptr_t)(pos + reserved);
+            if(dif != 0)
+            {
+                break;
+            }
+        }
+
+        if(reserved != 0)
+        {
+            if(m_enqueue_pos.compare_exchange_weak(
+                   pos, pos + reserved, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if(dif < 0)
+        {
+            return 0;
+        }
+        else
+        {
+            pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    for(size_t i = 0; i < reserved; ++i, ++first)
+    {
+        Cell& cell = cellAt(pos + i);
+        cell.data = *first;
+        cell.sequence.store(pos + i + 1, std::memory_order_release);
+    }
+
+    return reserved;
+}
+
+template <typename T, CellLayout LAYOUT>
+template <typename OutputIterator>
+inline size_t BasicMPMCBoundedQueue<T, LAYOUT>::popBatch(OutputIterator out,
+                                                         size_t max_count)
+{
+    const size_t count = std::min<size_t>(max_count, m_buffer_mask + 1);
+    if(count == 0)
+    {
+        return 0;
+    }
+
+    size_t claimed;
+    size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+    for(;;)
+    {
+        // Claim the longest run of filled cells, cells may be filled by
+        // producers out of order.
+        claimed = 0;
+        intptr_t dif = 0;
+        for(; claimed < count; ++claimed)
+        {
+            const size_t seq = cellAt(pos + claimed)
+                                   .sequence.load(std::memory_order_acquire);
+            dif = (intptr_t)seq - (intptr_t)(pos + claimed + 1);
+            if(dif != 0)
+            {
+                break;
+            }
+        }
+
+        if(claimed != 0)
+        {
+            if(m_dequeue_pos.compare_exchange_weak(
+                   pos, pos + claimed, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if(dif < 0)
+        {
+            return 0;
+        }
+        else
+        {
+            pos = m_dequeue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    for(size_t i = 0; i < claimed; ++i, ++out)
+    {
+        Cell& cell = cellAt(pos + i);
+        *out = std::move(cell.data);
+        cell.sequence.store(
+            pos + i + m_buffer_mask + 1, std::memory_order_release);
+    }
+
+    return claimed;
+}
+
 }
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <thread_pool/cache_line.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+namespace tp
+{
+
+/**
+ * @brief The MPSCBoundedQueue class implements bounded
+ * multi-producers/single-consumer lock-free queue.
+ * Producers reserve cells with a CAS like in MPMCBoundedQueue, while the
+ * only consumer owns the dequeue position and takes cells without CAS.
+ * Cells are padded to the cache line.
+ * Worker never lets thieves touch a queue declaring SINGLE_CONSUMER, see
+ * queue_traits.hpp.
+ * Doesn't accept non-movable types as T.
+ */
+template <typename T>
+class MPSCBoundedQueue
+{
+    static_assert(
+        std::is_move_constructible<T>::value, "Should be of movable type");
+
+public:
+    enum { SINGLE_CONSUMER = 1 };
+
+    /**
+     * @brief MPSCBoundedQueue Constructor.
+     * @param size Power of 2 number - queue length.
+     * @throws std::invalid_argument if size is bad.
+     */
+    explicit MPSCBoundedQueue(size_t size);
+
+    /**
+     * @brief Move ctor implementation.
+     */
+    MPSCBoundedQueue(MPSCBoundedQueue&& rhs) noexcept;
+
+    /**
+     * @brief Move assignment implementaion.
+     */
+    MPSCBoundedQueue& operator=(MPSCBoundedQueue&& rhs) noexcept;
+
+    /**
+     * @brief push Push data to queue. Can be called from any thread.
+     * @param data Data to be pushed.
+     * @return true on success.
+     */
+    template <typename U>
+    bool push(U&& data);
+
+    /**
+     * @brief pop Pop data from queue.
+     * @param data Place to store popped data.
+     * @return true on sucess.
+     * @note Must be called from the consumer thread only.
+     */
+    bool pop(T& data);
+
+private:
+    struct alignas(detail::CACHE_LINE_SIZE) Cell
+    {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    typedef char Padding[detail::FALSE_SHARING_RANGE];
+
+    Padding pad0;
+    detail::AlignedArray<Cell> m_buffer;
+    /* const */ size_t m_buffer_mask;
+    Padding pad1;
+    std::atomic<size_t> m_enqueue_pos;
+    Padding pad2;
+    size_t m_dequeue_pos;
+    Padding pad3;
+};
+
+
+/// Implementation
+
+template <typename T>
+inline MPSCBoundedQueue<T>::MPSCBoundedQueue(size_t size)
+    : m_buffer(size), m_buffer_mask(size - 1), m_enqueue_pos(0),
+      m_dequeue_pos(0)
+{
+    bool size_is_power_of_2 = (size >= 2) && ((size & (size - 1)) == 0);
+    if (!size_is_power_of_2)
+    {
+        throw std::invalid_argument("buffer size should be a power of 2");
+    }
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        m_buffer[i].sequence = i;
+    }
+}
+
+template <typename T>
+inline MPSCBoundedQueue<T>::MPSCBoundedQueue(MPSCBoundedQueue&& rhs) noexcept
+{
+    *this = std::move(rhs);
+}
+
+template <typename T>
+inline MPSCBoundedQueue<T>& MPSCBoundedQueue<T>::operator=(
+                                            MPSCBoundedQueue&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        m_buffer = std::move(rhs.m_buffer);
+        m_buffer_mask = rhs.m_buffer_mask;
+        m_enqueue_pos = rhs.m_enqueue_pos.load();
+        m_dequeue_pos = rhs.m_dequeue_pos;
+    }
+    return *this;
+}
+
+template <typename T>
+template <typename U>
+inline bool MPSCBoundedQueue<T>::push(U&& data)
+{
+    Cell* cell;
+    size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        cell = &m_buffer[pos & m_buffer_mask];
+        const size_t seq = cell->sequence.load(std::memory_order_acquire);
+        const intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+        if (dif == 0)
+        {
+            if (m_enqueue_pos.compare_exchange_weak(
+                    pos, pos + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (dif < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->data = std::forward<U>(data);
+
+    cell->sequence.store(pos + 1, std::memory_order_release);
+
+    return true;
+}
+
+template <typename T>
+inline bool MPSCBoundedQueue<T>::pop(T& data)
+{
+    Cell& cell = m_buffer[m_dequeue_pos & m_buffer_mask];
+    if (cell.sequence.load(std::memory_order_acquire) != m_dequeue_pos + 1)
+    {
+        return false;
+    }
+
+    data = std::move(cell.data);
+
+    cell.sequence.store(m_dequeue_pos + m_buffer_mask + 1,
+                        std::memory_order_release);
+    ++m_dequeue_pos;
+
+    return true;
+}
+
+}
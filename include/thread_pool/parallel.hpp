@@ -0,0 +1,314 @@
+#pragma once
+
+#include <thread_pool/future.hpp>
+#include <thread_pool/thread_pool.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+
+namespace tp
+{
+
+/**
+ * Parallel algorithms on top of ThreadPool.
+ * A range is split recursively in halves down to the grain size. The right
+ * half is submitted to the pool where idle workers can steal it, the left
+ * half is processed inline by the calling thread. Joining waits for the
+ * submitted half, so pool workers execute pending tasks instead of blocking.
+ * Index can be an integer or a random access iterator. Grain size 0 selects
+ * it automatically to make about 8 chunks per worker thread.
+ * Subranges which don't fit into the full pool queue are processed inline.
+ * Exceptions thrown by bodies are propagated to the caller after all
+ * submitted subranges are finished.
+ */
+
+/**
+ * @brief parallelFor Call 'body(i)' for every 'i' in [first, last).
+ * @param pool Thread pool to execute subranges.
+ * @param first Beginning of the range.
+ * @param last End of the range.
+ * @param grain Maximum subrange length processed sequentially.
+ * @param body Functional object to be called for each index.
+ */
+template <typename Task, template<typename> class Queue, typename Stats,
+          typename Index, typename Body>
+void parallelFor(ThreadPoolImpl<Task, Queue, Stats>& pool, Index first,
+                 Index last, size_t grain, Body&& body);
+
+/**
+ * @brief parallelReduce Reduce [first, last) range.
+ * @param pool Thread pool to execute subranges.
+ * @param first Beginning of the range.
+ * @param last End of the range.
+ * @param grain Maximum subrange length processed sequentially.
+ * @param identity Initial value for every subrange.
+ * @param body Functional object called as 'body(first, last, identity)' to
+ * reduce subrange sequentially.
+ * @param combine Functional object called as 'combine(left, right)' to
+ * merge results of adjacent subranges.
+ * @return Reduced value.
+ */
+template <typename Task, template<typename> class Queue, typename Stats,
+          typename Index, typename T, typename Body, typename Combine>
+T parallelReduce(ThreadPoolImpl<Task, Queue, Stats>& pool, Index first,
+                 Index last, size_t grain, const T& identity, Body&& body,
+                 Combine&& combine);
+
+/**
+ * @brief parallelTransform Store 'op(*it)' for every 'it' in [first, last)
+ * into the range beginning at d_first.
+ * @param pool Thread pool to execute subranges.
+ * @param first Beginning of the source range.
+ * @param last End of the source range.
+ * @param d_first Beginning of the destination range.
+ * @param grain Maximum subrange length processed sequentially.
+ * @param op Unary operation.
+ */
+template <typename Task, template<typename> class Queue, typename Stats,
+          typename InputIterator, typename OutputIterator, typename Operation>
+void parallelTransform(ThreadPoolImpl<Task, Queue, Stats>& pool,
+                       InputIterator first, InputIterator last,
+                       OutputIterator d_first, size_t grain, Operation&& op);
+
+/**
+ * @brief parallelInvoke Call every functional object concurrently. The first
+ * one is called inline.
+ * @param pool Thread pool to execute functional objects.
+ * @param functions Functional objects to be called as 'function()'.
+ */
+template <typename Task, template<typename> class Queue, typename Stats,
+          typename... Functions>
+void parallelInvoke(ThreadPoolImpl<Task, Queue, Stats>& pool,
+                    Functions&&... functions);
+
+
+/// Implementation
+
+namespace detail
+{
+    template <typename Pool>
+    inline size_t auto_grain(const Pool& pool, size_t count, size_t grain)
+    {
+        if (grain != 0)
+        {
+            return grain;
+        }
+        return std::max<size_t>(1u, count / (pool.threadCount() * 8));
+    }
+
+    /**
+     * @brief spawn Submit function to the pool.
+     * @return Future for the function result or future without shared state
+     * if the pool queue is full and the caller should run it inline.
+     */
+    template <typename Pool, typename Function>
+    inline Future<typename SubmitResult<Function&>::type>
+    spawn(Pool& pool, Function& function)
+    {
+        try
+        {
+            return pool.submit(function);
+        }
+        catch(const std::runtime_error&)
+        {
+            return Future<typename SubmitResult<Function&>::type>();
+        }
+    }
+
+    template <typename Pool, typename Index, typename Leaf>
+    inline void for_range(Pool& pool, Index first, Index last, size_t grain,
+                          Leaf& leaf)
+    {
+        if (static_cast<size_t>(last - first) <= grain)
+        {
+            leaf(first, last);
+            return;
+        }
+
+        const Index middle = first + (last - first) / 2;
+        auto right_half = [&pool, middle, last, grain, &leaf]()
+        {
+            for_range(pool, middle, last, grain, leaf);
+        };
+        Future<void> right = spawn(pool, right_half);
+
+        try
+        {
+            for_range(pool, first, middle, grain, leaf);
+        }
+        catch(...)
+        {
+            // Right half references this frame.
+            if (right.valid())
+            {
+                right.wait();
+            }
+            throw;
+        }
+
+        if (right.valid())
+        {
+            right.get();
+        }
+        else
+        {
+            right_half();
+        }
+    }
+
+    template <typename Pool, typename Index, typename T, typename Body,
+              typename Combine>
+    inline T reduce_range(Pool& pool, Index first, Index last, size_t grain,
+                          const T& identity, Body& body, Combine& combine)
+    {
+        if (static_cast<size_t>(last - first) <= grain)
+        {
+            return body(first, last, identity);
+        }
+
+        const Index middle = first + (last - first) / 2;
+        auto right_half = [&, middle, last]()
+        {
+            return reduce_range(pool, middle, last, grain, identity, body,
+                                combine);
+        };
+        Future<T> right = spawn(pool, right_half);
+        const bool inline_right = !right.valid();
+
+        try
+        {
+            T left = reduce_range(pool, first, middle, grain, identity, body,
+                                  combine);
+            return combine(std::move(left),
+                           inline_right ? right_half() : right.get());
+        }
+        catch(...)
+        {
+            if (right.valid())
+            {
+                right.wait();
+            }
+            throw;
+        }
+    }
+
+    template <typename Pool>
+    inline void invoke_all(Pool&)
+    {
+    }
+
+    template <typename Pool, typename Function>
+    inline void invoke_all(Pool&, Function& function)
+    {
+        function();
+    }
+
+    template <typename Pool, typename Function, typename... Functions>
+    inline void invoke_all(Pool& pool, Function& function,
+                           Functions&... functions)
+    {
+        auto invoke_rest = [&]()
+        {
+            invoke_all(pool, functions...);
+        };
+        Future<void> rest = spawn(pool, invoke_rest);
+
+        try
+        {
+            function();
+        }
+        catch(...)
+        {
+            if (rest.valid())
+            {
+                rest.wait();
+            }
+            throw;
+        }
+
+        if (rest.valid())
+        {
+            rest.get();
+        }
+        else
+        {
+            invoke_rest();
+        }
+    }
+}
+
+template <typename Task, template<typename> class Queue, typename Stats,
+          typename Index, typename Body>
+inline void parallelFor(ThreadPoolImpl<Task, Queue, Stats>& pool, Index first,
+                        Index last, size_t grain, Body&& body)
+{
+    if (!(first < last))
+    {
+        return;
+    }
+
+    auto leaf = [&body](Index leaf_first, Index leaf_last)
+    {
+        for (; leaf_first != leaf_last; ++leaf_first)
+        {
+            body(leaf_first);
+        }
+    };
+
+    detail::for_range(pool, first, last,
+                      detail::auto_grain(pool, last - first, grain), leaf);
+}
+
+template <typename Task, template<typename> class Queue, typename Stats,
+          typename Index, typename T, typename Body, typename Combine>
+inline T parallelReduce(ThreadPoolImpl<Task, Queue, Stats>& pool, Index first,
+                        Index last, size_t grain, const T& identity,
+                        Body&& body, Combine&& combine)
+{
+    if (!(first < last))
+    {
+        return identity;
+    }
+
+    return detail::reduce_range(pool, first, last,
+                                detail::auto_grain(pool, last - first, grain),
+                                identity, body, combine);
+}
+
+template <typename Task, template<typename> class Queue, typename Stats,
+          typename InputIterator, typename OutputIterator, typename Operation>
+inline void parallelTransform(ThreadPoolImpl<Task, Queue, Stats>& pool,
+                              InputIterator first, InputIterator last,
+                              OutputIterator d_first, size_t grain,
+                              Operation&& op)
+{
+    if (!(first < last))
+    {
+        return;
+    }
+
+    auto leaf = [first, d_first, &op](InputIterator leaf_first,
+                                      InputIterator leaf_last)
+    {
+        OutputIterator out = d_first + (leaf_first - first);
+        for (; leaf_first != leaf_last; ++leaf_first, ++out)
+        {
+            *out = op(*leaf_first);
+        }
+    };
+
+    detail::for_range(pool, first, last,
+                      detail::auto_grain(pool, last - first, grain), leaf);
+}
+
+template <typename Task, template<typename> class Queue, typename Stats,
+          typename... Functions>
+inline void parallelInvoke(ThreadPoolImpl<Task, Queue, Stats>& pool,
+                           Functions&&... functions)
+{
+    detail::invoke_all(pool, functions...);
+}
+
+}
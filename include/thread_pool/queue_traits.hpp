@@ -0,0 +1,222 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+
+namespace tp
+{
+
+/**
+ * Queue policy adapters used by Worker.
+ * Every queue has to provide 'push(data)' and 'pop(data)' which are safe to
+ * call from any thread. A queue may additionally provide owner-only
+ * 'pushLocal(data)' and 'popLocal(data)', a thief-side 'steal(data)' and
+ * batched 'pushBatch(first, last)' and 'popBatch(out, max_count)'; the
+ * adapters fall back to 'push' and 'pop' otherwise.
+ * A queue declaring SINGLE_CONSUMER member constant is popped by its owner
+ * only, thieves take tasks the owner publishes to a separate queue. A queue
+ * declaring SINGLE_PRODUCER member constant is also never pushed by the
+ * owner or by sibling workers.
+ */
+namespace detail
+{
+    template <typename Queue, typename U>
+    inline auto push_local(Queue& queue, U&& data, int)
+        -> decltype(queue.pushLocal(std::forward<U>(data)))
+    {
+        return queue.pushLocal(std::forward<U>(data));
+    }
+
+    template <typename Queue, typename U>
+    inline bool push_local(Queue& queue, U&& data, long)
+    {
+        return queue.push(std::forward<U>(data));
+    }
+
+    template <typename Queue, typename T>
+    inline auto pop_local(Queue& queue, T& data, int)
+        -> decltype(queue.popLocal(data))
+    {
+        return queue.popLocal(data);
+    }
+
+    template <typename Queue, typename T>
+    inline bool pop_local(Queue& queue, T& data, long)
+    {
+        return queue.pop(data);
+    }
+
+    template <typename Queue, typename T>
+    inline auto steal(Queue& queue, T& data, int)
+        -> decltype(queue.steal(data))
+    {
+        return queue.steal(data);
+    }
+
+    template <typename Queue, typename T>
+    inline bool steal(Queue& queue, T& data, long)
+    {
+        return queue.pop(data);
+    }
+
+    template <typename Queue, typename Iterator>
+    inline auto push_batch(Queue& queue, Iterator first, Iterator last, int)
+        -> decltype(queue.pushBatch(first, last))
+    {
+        return queue.pushBatch(first, last);
+    }
+
+    template <typename Queue, typename Iterator>
+    inline size_t push_batch(Queue& queue, Iterator first, Iterator last, long)
+    {
+        size_t count = 0;
+        for (; first != last && queue.push(*first); ++first)
+        {
+            ++count;
+        }
+        return count;
+    }
+
+    template <typename Queue, typename Iterator>
+    inline auto push_local_batch(Queue& queue, Iterator first, Iterator last,
+                                 int)
+        -> decltype(queue.pushLocal(*first), size_t())
+    {
+        size_t count = 0;
+        for (; first != last && queue.pushLocal(*first); ++first)
+        {
+            ++count;
+        }
+        return count;
+    }
+
+    template <typename Queue, typename Iterator>
+    inline size_t push_local_batch(Queue& queue, Iterator first, Iterator last,
+                                   long)
+    {
+        return push_batch(queue, first, last, 0);
+    }
+
+    template <typename Queue, typename OutputIterator>
+    inline auto steal_batch(Queue& queue, OutputIterator out, size_t max_count,
+                            int)
+        -> decltype(queue.popBatch(out, max_count))
+    {
+        return queue.popBatch(out, max_count);
+    }
+
+    template <typename Queue, typename OutputIterator>
+    inline size_t steal_batch(Queue& queue, OutputIterator out,
+                              size_t max_count, long)
+    {
+        return max_count != 0 && steal(queue, *out, 0) ? 1 : 0;
+    }
+
+    template <typename Queue>
+    constexpr auto single_producer(int)
+        -> decltype(Queue::SINGLE_PRODUCER, bool())
+    {
+        return Queue::SINGLE_PRODUCER != 0;
+    }
+
+    template <typename Queue>
+    constexpr bool single_producer(long)
+    {
+        return false;
+    }
+
+    template <typename Queue>
+    constexpr auto single_consumer(int)
+        -> decltype(Queue::SINGLE_CONSUMER, bool())
+    {
+        return Queue::SINGLE_CONSUMER != 0;
+    }
+
+    template <typename Queue>
+    constexpr bool single_consumer(long)
+    {
+        return false;
+    }
+
+    /**
+     * @brief push_local Push data to queue from its owner thread.
+     */
+    template <typename Queue, typename U>
+    inline bool push_local(Queue& queue, U&& data)
+    {
+        return push_local(queue, std::forward<U>(data), 0);
+    }
+
+    /**
+     * @brief pop_local Pop data from queue in its owner thread.
+     */
+    template <typename Queue, typename T>
+    inline bool pop_local(Queue& queue, T& data)
+    {
+        return pop_local(queue, data, 0);
+    }
+
+    /**
+     * @brief steal Pop data from queue in a thief thread.
+     */
+    template <typename Queue, typename T>
+    inline bool steal(Queue& queue, T& data)
+    {
+        return steal(queue, data, 0);
+    }
+
+    /**
+     * @brief push_batch Push range of data to queue from any thread.
+     * @return Number of elements pushed from the beginning of the range.
+     */
+    template <typename Queue, typename Iterator>
+    inline size_t push_batch(Queue& queue, Iterator first, Iterator last)
+    {
+        return push_batch(queue, first, last, 0);
+    }
+
+    /**
+     * @brief push_local_batch Push range of data to queue from its owner
+     * thread.
+     * @return Number of elements pushed from the beginning of the range.
+     */
+    template <typename Queue, typename Iterator>
+    inline size_t push_local_batch(Queue& queue, Iterator first,
+                                   Iterator last)
+    {
+        return push_local_batch(queue, first, last, 0);
+    }
+
+    /**
+     * @brief steal_batch Pop several elements from queue in a thief thread.
+     * @return Number of popped elements.
+     */
+    template <typename Queue, typename OutputIterator>
+    inline size_t steal_batch(Queue& queue, OutputIterator out,
+                              size_t max_count)
+    {
+        return steal_batch(queue, out, max_count, 0);
+    }
+
+    /**
+     * @brief single_producer Return true if queue may be pushed by one
+     * thread only.
+     */
+    template <typename Queue>
+    constexpr bool single_producer()
+    {
+        return single_producer<Queue>(0);
+    }
+
+    /**
+     * @brief single_consumer Return true if queue may be popped by one
+     * thread only.
+     */
+    template <typename Queue>
+    constexpr bool single_consumer()
+    {
+        return single_consumer<Queue>(0);
+    }
+}
+
+}
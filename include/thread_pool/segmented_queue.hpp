@@ -0,0 +1,315 @@
+#pragma once
+
+#include <thread_pool/cache_line.hpp>
+#include <thread_pool/slab_allocator.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace tp
+{
+
+/**
+ * @brief The SegmentedQueue class implements unbounded
+ * multi-producers/single-consumer lock-free queue.
+ * Elements are stored in a linked list of fixed size segments. Producers
+ * claim cells of the tail segment with a single fetch_add and link a new
+ * segment when it is exhausted. Consumed segments are recycled through the
+ * free list of a SlabAllocator, so steady overload doesn't hit the heap.
+ * Segments beyond the slab capacity come from operator new.
+ * A segment is recycled once no producer which could have seen it is still
+ * running: producers announce themselves in one of two counters selected by
+ * the epoch, the consumer flips the epoch and waits for the previous counter
+ * to drain.
+ * Doesn't accept non-movable types as T.
+ */
+template <typename T, size_t SEGMENT_SIZE = 32>
+class SegmentedQueue
+{
+    static_assert(
+        std::is_move_constructible<T>::value, "Should be of movable type");
+
+public:
+    /**
+     * @brief SegmentedQueue Constructor. Allocates the first segment.
+     */
+    SegmentedQueue();
+
+    /**
+     * @brief ~SegmentedQueue Destroy remaining elements and release all
+     * segments.
+     */
+    ~SegmentedQueue();
+
+    /**
+     * @brief push Push data to queue. Can be called from any thread.
+     * @param data Data to be pushed.
+     * @throws std::bad_alloc if memory is exhausted.
+     */
+    template <typename U>
+    void push(U&& data);
+
+    /**
+     * @brief pop Pop data from queue.
+     * @param data Place to store popped data.
+     * @return true on success, false if queue is empty or the oldest element
+     * is still being written.
+     * @note Must be called from the consumer thread only.
+     */
+    bool pop(T& data);
+
+private:
+    SegmentedQueue(const SegmentedQueue&) = delete;
+    SegmentedQueue& operator=(const SegmentedQueue&) = delete;
+
+    struct Cell
+    {
+        std::atomic<bool> ready;
+        T data;
+
+        Cell() : ready(false)
+        {
+        }
+    };
+
+    struct Segment
+    {
+        Cell cells[SEGMENT_SIZE];
+        std::atomic<size_t> enqueue_index;
+        std::atomic<Segment*> next;
+        // Consumer-owned link of retired segments.
+        Segment* retired_next;
+        uint32_t block;
+
+        Segment() : enqueue_index(0), next(nullptr), retired_next(nullptr)
+        {
+        }
+    };
+
+    static_assert(std::alignment_of<Segment>::value <=
+                  std::alignment_of<std::max_align_t>::value,
+                  "Segment is over-aligned");
+
+    typedef detail::SlabAllocator<sizeof(Segment), 16> Slab;
+
+    /// Block of the segment allocated by operator new.
+    static const uint32_t HEAP_BLOCK = 0xffffffffu;
+
+    Segment* allocate();
+
+    void release(Segment* segment);
+
+    void releaseList(Segment* segment);
+
+    /**
+     * @brief retire Exclude exhausted head segment from the queue and
+     * recycle segments retired earlier if it is safe.
+     */
+    void retire(Segment* segment);
+
+    Slab m_slab;
+    char m_pad0[detail::FALSE_SHARING_RANGE];
+    std::atomic<Segment*> m_tail;
+    char m_pad1[detail::FALSE_SHARING_RANGE];
+    std::atomic<size_t> m_epoch;
+    std::atomic<size_t> m_producers[2];
+    char m_pad2[detail::FALSE_SHARING_RANGE];
+    Segment* m_head;
+    size_t m_dequeue_index;
+    // Retired in the current epoch.
+    Segment* m_retired;
+    // Retired before the epoch was flipped, waiting for producers to leave.
+    Segment* m_draining;
+};
+
+
+/// Implementation
+
+template <typename T, size_t SEGMENT_SIZE>
+inline SegmentedQueue<T, SEGMENT_SIZE>::SegmentedQueue()
+    : m_tail(nullptr)
+    , m_epoch(0)
+    , m_head(nullptr)
+    , m_dequeue_index(0)
+    , m_retired(nullptr)
+    , m_draining(nullptr)
+{
+    m_producers[0] = 0;
+    m_producers[1] = 0;
+
+    m_head = allocate();
+    m_tail = m_head;
+}
+
+template <typename T, size_t SEGMENT_SIZE>
+inline SegmentedQueue<T, SEGMENT_SIZE>::~SegmentedQueue()
+{
+    releaseList(m_retired);
+    releaseList(m_draining);
+
+    while (m_head)
+    {
+        Segment* next = m_head->next.load(std::memory_order_relaxed);
+        release(m_head);
+        m_head = next;
+    }
+}
+
+template <typename T, size_t SEGMENT_SIZE>
+template <typename U>
+inline void SegmentedQueue<T, SEGMENT_SIZE>::push(U&& data)
+{
+    // Announcement has to be ordered before the tail is read, pairs with
+    // the epoch flip in retire().
+    const size_t slot = m_epoch.load(std::memory_order_seq_cst) & 1;
+    m_producers[slot].fetch_add(1, std::memory_order_seq_cst);
+
+    try
+    {
+        for (;;)
+        {
+            Segment* segment = m_tail.load(std::memory_order_seq_cst);
+            const size_t index = segment->enqueue_index.fetch_add(
+                1, std::memory_order_relaxed);
+            if (index < SEGMENT_SIZE)
+            {
+                Cell& cell = segment->cells[index];
+                cell.data = std::forward<U>(data);
+                cell.ready.store(true, std::memory_order_release);
+                break;
+            }
+
+            // Segment is exhausted, link the next one and help to move tail.
+            Segment* next = segment->next.load(std::memory_order_acquire);
+            if (!next)
+            {
+                Segment* fresh = allocate();
+                if (segment->next.compare_exchange_strong(
+                        next, fresh, std::memory_order_acq_rel,
+                        std::memory_order_acquire))
+                {
+                    next = fresh;
+                }
+                else
+                {
+                    release(fresh);
+                }
+            }
+
+            m_tail.compare_exchange_strong(segment, next,
+                                           std::memory_order_seq_cst);
+        }
+    }
+    catch(...)
+    {
+        m_producers[slot].fetch_sub(1, std::memory_order_release);
+        throw;
+    }
+
+    m_producers[slot].fetch_sub(1, std::memory_order_release);
+}
+
+template <typename T, size_t SEGMENT_SIZE>
+inline bool SegmentedQueue<T, SEGMENT_SIZE>::pop(T& data)
+{
+    for (;;)
+    {
+        if (m_dequeue_index < SEGMENT_SIZE)
+        {
+            Cell& cell = m_head->cells[m_dequeue_index];
+            if (!cell.ready.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+
+            data = std::move(cell.data);
+            ++m_dequeue_index;
+            return true;
+        }
+
+        // All cells of exhausted segment are consumed, so the next one is
+        // linked or about to be.
+        Segment* next = m_head->next.load(std::memory_order_acquire);
+        if (!next)
+        {
+            return false;
+        }
+
+        Segment* head = m_head;
+        m_head = next;
+        m_dequeue_index = 0;
+        retire(head);
+    }
+}
+
+template <typename T, size_t SEGMENT_SIZE>
+inline typename SegmentedQueue<T, SEGMENT_SIZE>::Segment*
+SegmentedQueue<T, SEGMENT_SIZE>::allocate()
+{
+    uint32_t block;
+    void* memory = m_slab.tryAllocate(block);
+    if (!memory)
+    {
+        memory = ::operator new(sizeof(Segment));
+        block = HEAP_BLOCK;
+    }
+
+    Segment* segment = new (memory) Segment();
+    segment->block = block;
+    return segment;
+}
+
+template <typename T, size_t SEGMENT_SIZE>
+inline void SegmentedQueue<T, SEGMENT_SIZE>::release(Segment* segment)
+{
+    const uint32_t block = segment->block;
+    segment->~Segment();
+    if (block == HEAP_BLOCK)
+    {
+        ::operator delete(segment);
+        return;
+    }
+    m_slab.deallocate(block);
+}
+
+template <typename T, size_t SEGMENT_SIZE>
+inline void SegmentedQueue<T, SEGMENT_SIZE>::releaseList(Segment* segment)
+{
+    while (segment)
+    {
+        Segment* next = segment->retired_next;
+        release(segment);
+        segment = next;
+    }
+}
+
+template <typename T, size_t SEGMENT_SIZE>
+inline void SegmentedQueue<T, SEGMENT_SIZE>::retire(Segment* segment)
+{
+    // New producers must not reach the segment through the tail.
+    Segment* expected = segment;
+    m_tail.compare_exchange_strong(expected, m_head,
+                                   std::memory_order_seq_cst);
+
+    segment->retired_next = m_retired;
+    m_retired = segment;
+
+    // Producers announced before the previous flip might still hold
+    // pointers to draining segments and to the ones retired since then.
+    const size_t epoch = m_epoch.load(std::memory_order_relaxed);
+    if (m_producers[(epoch - 1) & 1].load(std::memory_order_seq_cst) != 0)
+    {
+        return;
+    }
+
+    releaseList(m_draining);
+    m_draining = m_retired;
+    m_retired = nullptr;
+    m_epoch.store(epoch + 1, std::memory_order_seq_cst);
+}
+
+}
@@ -0,0 +1,295 @@
+#pragma once
+
+#include <thread_pool/fixed_function.hpp>
+#include <thread_pool/queue_traits.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace tp
+{
+
+namespace detail
+{
+    /**
+     * @brief resize_function<Function, STORAGE_SIZE>::type FixedFunction of
+     * the same signature as Function with another storage size.
+     */
+    template <typename Function, size_t STORAGE_SIZE>
+    struct resize_function;
+
+    template <typename SIGNATURE, size_t SIZE, bool HEAP_FALLBACK,
+              size_t STORAGE_SIZE>
+    struct resize_function<FixedFunction<SIGNATURE, SIZE, HEAP_FALLBACK>,
+                           STORAGE_SIZE>
+    {
+        typedef FixedFunction<SIGNATURE, STORAGE_SIZE, HEAP_FALLBACK> type;
+    };
+
+    /**
+     * @brief required_storage<T>::value Minimal FixedFunction storage size
+     * to hold T without heap fallback.
+     */
+    template <typename T>
+    struct required_storage
+        : std::integral_constant<size_t, sizeof(T) + 1>
+    {
+    };
+
+    template <typename SIGNATURE, size_t SIZE, bool HEAP_FALLBACK>
+    struct required_storage<FixedFunction<SIGNATURE, SIZE, HEAP_FALLBACK>>
+        : std::integral_constant<size_t, SIZE>
+    {
+    };
+
+    /**
+     * @brief size_class<STORAGE_SIZES...>::index Return index of the first
+     * storage size not less than required one, or the last index if there
+     * is no such size.
+     */
+    template <size_t... STORAGE_SIZES>
+    struct size_class;
+
+    template <size_t STORAGE_SIZE>
+    struct size_class<STORAGE_SIZE>
+    {
+        static constexpr size_t first()
+        {
+            return STORAGE_SIZE;
+        }
+
+        static constexpr size_t index(size_t)
+        {
+            return 0;
+        }
+    };
+
+    template <size_t STORAGE_SIZE, size_t... STORAGE_SIZES>
+    struct size_class<STORAGE_SIZE, STORAGE_SIZES...>
+    {
+        static_assert(STORAGE_SIZE < size_class<STORAGE_SIZES...>::first(),
+            "storage sizes should be ascending");
+
+        static constexpr size_t first()
+        {
+            return STORAGE_SIZE;
+        }
+
+        static constexpr size_t index(size_t required)
+        {
+            return required <= STORAGE_SIZE
+                ? 0 : 1 + size_class<STORAGE_SIZES...>::index(required);
+        }
+    };
+
+    template <size_t STORAGE_SIZE>
+    constexpr size_t last_storage_size()
+    {
+        return STORAGE_SIZE;
+    }
+
+    template <size_t STORAGE_SIZE, size_t NEXT_SIZE, size_t... STORAGE_SIZES>
+    constexpr size_t last_storage_size()
+    {
+        return last_storage_size<NEXT_SIZE, STORAGE_SIZES...>();
+    }
+
+    /**
+     * @brief The SizeClassList class holds queues of FixedFunctions of the
+     * Task signature, one per storage size. The size of every next queue is
+     * a half of the previous one.
+     */
+    template <typename Task, template<typename> class Queue,
+              size_t... STORAGE_SIZES>
+    class SizeClassList;
+
+    template <typename Task, template<typename> class Queue>
+    class SizeClassList<Task, Queue>
+    {
+    public:
+        explicit SizeClassList(size_t)
+        {
+        }
+
+        bool pop(size_t, Task&)
+        {
+            return false;
+        }
+    };
+
+    template <typename Task, template<typename> class Queue,
+              size_t STORAGE_SIZE, size_t... STORAGE_SIZES>
+    class SizeClassList<Task, Queue, STORAGE_SIZE, STORAGE_SIZES...>
+    {
+    public:
+        typedef typename resize_function<Task, STORAGE_SIZE>::type Function;
+
+        explicit SizeClassList(size_t size)
+            : m_queue(size)
+            , m_rest(std::max<size_t>(size / 2, 2))
+        {
+        }
+
+        template <typename U>
+        bool push(std::integral_constant<size_t, 0>, U&& data)
+        {
+            return m_queue.push(std::forward<U>(data));
+        }
+
+        template <size_t INDEX, typename U>
+        bool push(std::integral_constant<size_t, INDEX>, U&& data)
+        {
+            return m_rest.push(std::integral_constant<size_t, INDEX - 1>(),
+                               std::forward<U>(data));
+        }
+
+        bool pop(size_t index, Task& data)
+        {
+            return index == 0 ? popTo(m_queue, data)
+                              : m_rest.pop(index - 1, data);
+        }
+
+    private:
+        static bool popTo(Queue<Task>& queue, Task& data)
+        {
+            return queue.pop(data);
+        }
+
+        template <typename SizedFunction>
+        static bool popTo(Queue<SizedFunction>& queue, Task& data)
+        {
+            SizedFunction function;
+            if (!queue.pop(function))
+            {
+                return false;
+            }
+
+            data = std::move(function);
+            return true;
+        }
+
+        Queue<Function> m_queue;
+        SizeClassList<Task, Queue, STORAGE_SIZES...> m_rest;
+    };
+}
+
+/**
+ * @brief The SizeClassQueue class implements queue of FixedFunction tasks
+ * segregated by the size of stored callable.
+ * Every storage size has its own Queue of FixedFunctions of that size. The
+ * smallest one holding the pushed callable is chosen at compile time, so a
+ * task capturing a pointer takes a small cell even if Task storage is large.
+ * Tasks pushed as Task or as FixedFunction of unknown content go to the
+ * queue of their storage size. Popped tasks are relocated to Task without
+ * wrapping. The pop starts from the queue next to the last one popped, so
+ * no size class starves.
+ * The queue of the smallest size class is of the requested length, every
+ * next one is a half of the previous one: large tasks are expected to be
+ * rare. The largest storage size has to be the one of Task.
+ * Use SizeClasses<Queue, STORAGE_SIZES...>::queue as Queue template
+ * parameter of ThreadPoolImpl.
+ */
+template <typename Task, template<typename> class Queue,
+          size_t... STORAGE_SIZES>
+class SizeClassQueue
+{
+    static_assert(std::is_same<typename detail::resize_function<Task,
+                      detail::last_storage_size<STORAGE_SIZES...>()>::type,
+                  Task>::value,
+        "the largest storage size should be the one of Task");
+
+public:
+    enum
+    {
+        SINGLE_PRODUCER = detail::single_producer<Queue<Task>>(),
+        SINGLE_CONSUMER = detail::single_consumer<Queue<Task>>(),
+        CLASS_COUNT = sizeof...(STORAGE_SIZES)
+    };
+
+    /**
+     * @brief SizeClassQueue Constructor.
+     * @param size Power of 2 number - length of the queue of the smallest
+     * size class.
+     * @throws std::invalid_argument if size is bad.
+     */
+    explicit SizeClassQueue(size_t size);
+
+    /**
+     * @brief push Push data to the queue of the smallest size class
+     * holding it.
+     * @param data Data to be pushed.
+     * @return true on success.
+     */
+    template <typename U>
+    bool push(U&& data);
+
+    /**
+     * @brief pop Pop data from queues in turns.
+     * @param data Place to store popped data.
+     * @return true on sucess.
+     */
+    bool pop(Task& data);
+
+private:
+    detail::SizeClassList<Task, Queue, STORAGE_SIZES...> m_classes;
+    std::atomic<size_t> m_pop_turn;
+};
+
+/**
+ * @brief The SizeClasses struct binds queue and storage sizes for
+ * SizeClassQueue to be passed as template template parameter.
+ */
+template <template<typename> class Queue, size_t... STORAGE_SIZES>
+struct SizeClasses
+{
+    template <typename Task>
+    using queue = SizeClassQueue<Task, Queue, STORAGE_SIZES...>;
+};
+
+
+/// Implementation
+
+template <typename Task, template<typename> class Queue,
+          size_t... STORAGE_SIZES>
+inline SizeClassQueue<Task, Queue, STORAGE_SIZES...>::SizeClassQueue(
+                                                                size_t size)
+    : m_classes(size)
+    , m_pop_turn(0)
+{
+}
+
+template <typename Task, template<typename> class Queue,
+          size_t... STORAGE_SIZES>
+template <typename U>
+inline bool SizeClassQueue<Task, Queue, STORAGE_SIZES...>::push(U&& data)
+{
+    typedef std::integral_constant<size_t,
+        detail::size_class<STORAGE_SIZES...>::index(detail::required_storage<
+            typename std::decay<U>::type>::value)> index;
+
+    return m_classes.push(index(), std::forward<U>(data));
+}
+
+template <typename Task, template<typename> class Queue,
+          size_t... STORAGE_SIZES>
+inline bool SizeClassQueue<Task, Queue, STORAGE_SIZES...>::pop(Task& data)
+{
+    // Consumers race on the turn harmlessly, it is a hint only.
+    const size_t turn = m_pop_turn.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < CLASS_COUNT; ++i)
+    {
+        const size_t index = (turn + i) % CLASS_COUNT;
+        if (m_classes.pop(index, data))
+        {
+            m_pop_turn.store(index + 1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <type_traits>
+
+namespace tp
+{
+
+namespace detail
+{
+
+/**
+ * @brief The SlabAllocator class implements lock-free allocator of fixed
+ * size memory blocks.
+ * Blocks are carved from chunks allocated on demand and released only in
+ * destructor, so free list traversal never touches unmapped memory. Free
+ * list head is tagged to avoid ABA problem.
+ */
+template <size_t BLOCK_SIZE, size_t CHUNK_SIZE = 1024>
+class SlabAllocator
+{
+public:
+    /**
+     * @brief SlabAllocator Constructor. No memory is allocated until the
+     * first block is requested.
+     */
+    SlabAllocator();
+
+    /**
+     * @brief ~SlabAllocator Release all chunks.
+     */
+    ~SlabAllocator();
+
+    /**
+     * @brief allocate Allocate one block.
+     * @param index Place to store block index to be passed to deallocate.
+     * @return Pointer to the block.
+     * @throws std::bad_alloc if the slab is exhausted.
+     */
+    void* allocate(uint32_t& index);
+
+    /**
+     * @brief tryAllocate Allocate one block if the slab isn't exhausted.
+     * @param index Place to store block index to be passed to deallocate.
+     * @return Pointer to the block or nullptr if the slab is exhausted.
+     */
+    void* tryAllocate(uint32_t& index);
+
+    /**
+     * @brief deallocate Return block to the slab.
+     * @param index Block index returned by allocate.
+     */
+    void deallocate(uint32_t index);
+
+private:
+    SlabAllocator(const SlabAllocator&) = delete;
+    SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+    struct Chunk
+    {
+        typename std::aligned_storage<BLOCK_SIZE,
+            std::alignment_of<std::max_align_t>::value>::type blocks[CHUNK_SIZE];
+        std::atomic<uint32_t> next[CHUNK_SIZE];
+    };
+
+    enum { MAX_CHUNKS = 1024 };
+
+    std::atomic<uint32_t>& next(uint32_t index);
+
+    void push(uint32_t first, uint32_t last);
+
+    /**
+     * @brief grow Add chunk of free blocks unless some are free already.
+     * @return false if the slab is exhausted.
+     */
+    bool grow();
+
+    // Tag in the upper half, index of the first free block plus one in the
+    // lower half, zero means empty list.
+    std::atomic<uint64_t> m_free_head;
+    Chunk* m_chunks[MAX_CHUNKS];
+    size_t m_chunk_count;
+    std::mutex m_grow_mutex;
+};
+
+
+/// Implementation
+
+template <size_t BLOCK_SIZE, size_t CHUNK_SIZE>
+inline SlabAllocator<BLOCK_SIZE, CHUNK_SIZE>::SlabAllocator()
+    : m_free_head(0)
+    , m_chunk_count(0)
+{
+}
+
+template <size_t BLOCK_SIZE, size_t CHUNK_SIZE>
+inline SlabAllocator<BLOCK_SIZE, CHUNK_SIZE>::~SlabAllocator()
+{
+    for (size_t i = 0; i < m_chunk_count; ++i)
+    {
+        delete m_chunks[i];
+    }
+}
+
+template <size_t BLOCK_SIZE, size_t CHUNK_SIZE>
+inline void* SlabAllocator<BLOCK_SIZE, CHUNK_SIZE>::allocate(uint32_t& index)
+{
+    void* block = tryAllocate(index);
+    if (!block)
+    {
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+template <size_t BLOCK_SIZE, size_t CHUNK_SIZE>
+inline void* SlabAllocator<BLOCK_SIZE, CHUNK_SIZE>::tryAllocate(
+    uint32_t& index)
+{
+    uint64_t head = m_free_head.load(std::memory_order_acquire);
+    for (;;)
+    {
+        const uint32_t first = static_cast<uint32_t>(head);
+        if (first == 0)
+        {
+            if (!grow())
+            {
+                return nullptr;
+            }
+            head = m_free_head.load(std::memory_order_acquire);
+            continue;
+        }
+
+        const uint64_t new_head = (((head >> 32) + 1) << 32) |
+                                  next(first - 1).load(std::memory_order_relaxed);
+        if (m_free_head.compare_exchange_weak(head, new_head,
+                                              std::memory_order_acquire,
+                                              std::memory_order_acquire))
+        {
+            index = first - 1;
+            return &m_chunks[index / CHUNK_SIZE]->blocks[index % CHUNK_SIZE];
+        }
+    }
+}
+
+template <size_t BLOCK_SIZE, size_t CHUNK_SIZE>
+inline void SlabAllocator<BLOCK_SIZE, CHUNK_SIZE>::deallocate(uint32_t index)
+{
+    push(index, index);
+}
+
+template <size_t BLOCK_SIZE, size_t CHUNK_SIZE>
+inline std::atomic<uint32_t>&
+SlabAllocator<BLOCK_SIZE, CHUNK_SIZE>::next(uint32_t index)
+{
+    return m_chunks[index / CHUNK_SIZE]->next[index % CHUNK_SIZE];
+}
+
+template <size_t BLOCK_SIZE, size_t CHUNK_SIZE>
+inline void SlabAllocator<BLOCK_SIZE, CHUNK_SIZE>::push(uint32_t first,
+                                                        uint32_t last)
+{
+    uint64_t head = m_free_head.load(std::memory_order_relaxed);
+    uint64_t new_head;
+    do
+    {
+        next(last).store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+        new_head = (((head >> 32) + 1) << 32) | (first + 1);
+    }
+    while (!m_free_head.compare_exchange_weak(head, new_head,
+                                              std::memory_order_release,
+                                              std::memory_order_relaxed));
+}
+
+template <size_t BLOCK_SIZE, size_t CHUNK_SIZE>
+inline bool SlabAllocator<BLOCK_SIZE, CHUNK_SIZE>::grow()
+{
+    std::lock_guard<std::mutex> lock(m_grow_mutex);
+
+    if (static_cast<uint32_t>(m_free_head.load(std::memory_order_acquire)) != 0)
+    {
+        // Somebody has released blocks or grown the slab meanwhile.
+        return true;
+    }
+
+    if (m_chunk_count == MAX_CHUNKS)
+    {
+        return false;
+    }
+
+    Chunk* chunk = new Chunk;
+    const uint32_t first = static_cast<uint32_t>(m_chunk_count * CHUNK_SIZE);
+    m_chunks[m_chunk_count++] = chunk;
+
+    for (uint32_t i = 0; i + 1 < CHUNK_SIZE; ++i)
+    {
+        chunk->next[i].store(first + i + 2, std::memory_order_relaxed);
+    }
+
+    push(first, first + CHUNK_SIZE - 1);
+    return true;
+}
+
+}
+
+}
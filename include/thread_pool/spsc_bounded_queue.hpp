@@ -0,0 +1,240 @@
+#pragma once
+
+#include <thread_pool/cache_line.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace tp
+{
+
+/**
+ * @brief The SPSCBoundedQueue class implements bounded
+ * single-producer/single-consumer wait-free queue.
+ * It is Lamport's ring buffer with cached indices: the producer keeps the
+ * last seen dequeue position and the consumer keeps the last seen enqueue
+ * position, so the position written by the other side is read only when the
+ * cached one shows the queue full or empty. Positions of the producer and of
+ * the consumer are kept two cache lines apart.
+ * Worker never lets thieves or sibling workers touch a queue declaring
+ * SINGLE_PRODUCER and SINGLE_CONSUMER, see queue_traits.hpp. The pool still
+ * posts to every worker from each producer thread, so with this queue only
+ * one thread besides the workers may post to the pool.
+ * Doesn't accept non-movable types as T.
+ */
+template <typename T>
+class SPSCBoundedQueue
+{
+    static_assert(
+        std::is_move_constructible<T>::value, "Should be of movable type");
+
+public:
+    enum { SINGLE_PRODUCER = 1, SINGLE_CONSUMER = 1 };
+
+    /**
+     * @brief SPSCBoundedQueue Constructor.
+     * @param size Power of 2 number - queue length.
+     * @throws std::invalid_argument if size is bad.
+     */
+    explicit SPSCBoundedQueue(size_t size);
+
+    /**
+     * @brief Move ctor implementation.
+     */
+    SPSCBoundedQueue(SPSCBoundedQueue&& rhs) noexcept;
+
+    /**
+     * @brief Move assignment implementaion.
+     */
+    SPSCBoundedQueue& operator=(SPSCBoundedQueue&& rhs) noexcept;
+
+    /**
+     * @brief push Push data to queue.
+     * @param data Data to be pushed.
+     * @return true on success.
+     * @note Must be called from the producer thread only.
+     */
+    template <typename U>
+    bool push(U&& data);
+
+    /**
+     * @brief pop Pop data from queue.
+     * @param data Place to store popped data.
+     * @return true on sucess.
+     * @note Must be called from the consumer thread only.
+     */
+    bool pop(T& data);
+
+    /**
+     * @brief pushBatch Push range of data to queue publishing it at once.
+     * @param first Beginning of the range. Elements are assigned from
+     * '*first', use std::move_iterator to move them. FixedFunction elements
+     * move even from lvalue callables, so pushed ones are consumed anyway.
+     * @param last End of the range.
+     * @return Number of elements pushed from the beginning of the range.
+     * @note Must be called from the producer thread only.
+     */
+    template <typename Iterator>
+    size_t pushBatch(Iterator first, Iterator last);
+
+    /**
+     * @brief popBatch Pop several elements from queue releasing their cells
+     * at once.
+     * @param out Beginning of the place to store popped data.
+     * @param max_count Maximum number of elements to pop.
+     * @return Number of popped elements.
+     * @note Must be called from the consumer thread only.
+     */
+    template <typename OutputIterator>
+    size_t popBatch(OutputIterator out, size_t max_count);
+
+private:
+    typedef char Padding[detail::FALSE_SHARING_RANGE];
+
+    Padding pad0;
+    std::vector<T> m_buffer;
+    /* const */ size_t m_buffer_mask;
+    Padding pad1;
+    std::atomic<size_t> m_enqueue_pos;
+    size_t m_cached_dequeue_pos;
+    Padding pad2;
+    std::atomic<size_t> m_dequeue_pos;
+    size_t m_cached_enqueue_pos;
+    Padding pad3;
+};
+
+
+/// Implementation
+
+template <typename T>
+inline SPSCBoundedQueue<T>::SPSCBoundedQueue(size_t size)
+    : m_buffer(size), m_buffer_mask(size - 1), m_enqueue_pos(0),
+      m_cached_dequeue_pos(0), m_dequeue_pos(0), m_cached_enqueue_pos(0)
+{
+    bool size_is_power_of_2 = (size >= 2) && ((size & (size - 1)) == 0);
+    if (!size_is_power_of_2)
+    {
+        throw std::invalid_argument("buffer size should be a power of 2");
+    }
+}
+
+template <typename T>
+inline SPSCBoundedQueue<T>::SPSCBoundedQueue(SPSCBoundedQueue&& rhs) noexcept
+{
+    *this = std::move(rhs);
+}
+
+template <typename T>
+inline SPSCBoundedQueue<T>& SPSCBoundedQueue<T>::operator=(
+                                            SPSCBoundedQueue&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        m_buffer = std::move(rhs.m_buffer);
+        m_buffer_mask = rhs.m_buffer_mask;
+        m_enqueue_pos = rhs.m_enqueue_pos.load();
+        m_cached_dequeue_pos = rhs.m_cached_dequeue_pos;
+        m_dequeue_pos = rhs.m_dequeue_pos.load();
+        m_cached_enqueue_pos = rhs.m_cached_enqueue_pos;
+    }
+    return *this;
+}
+
+template <typename T>
+template <typename U>
+inline bool SPSCBoundedQueue<T>::push(U&& data)
+{
+    const size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+    if (pos - m_cached_dequeue_pos > m_buffer_mask)
+    {
+        // Acquire pairs with the consumer moving data out of the cell.
+        m_cached_dequeue_pos = m_dequeue_pos.load(std::memory_order_acquire);
+        if (pos - m_cached_dequeue_pos > m_buffer_mask)
+        {
+            return false;
+        }
+    }
+
+    m_buffer[pos & m_buffer_mask] = std::forward<U>(data);
+    m_enqueue_pos.store(pos + 1, std::memory_order_release);
+
+    return true;
+}
+
+template <typename T>
+inline bool SPSCBoundedQueue<T>::pop(T& data)
+{
+    const size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+    if (pos == m_cached_enqueue_pos)
+    {
+        m_cached_enqueue_pos = m_enqueue_pos.load(std::memory_order_acquire);
+        if (pos == m_cached_enqueue_pos)
+        {
+            return false;
+        }
+    }
+
+    data = std::move(m_buffer[pos & m_buffer_mask]);
+    m_dequeue_pos.store(pos + 1, std::memory_order_release);
+
+    return true;
+}
+
+template <typename T>
+template <typename Iterator>
+inline size_t SPSCBoundedQueue<T>::pushBatch(Iterator first, Iterator last)
+{
+    const size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+    size_t count = std::distance(first, last);
+    if (count > m_buffer_mask + 1 - (pos - m_cached_dequeue_pos))
+    {
+        m_cached_dequeue_pos = m_dequeue_pos.load(std::memory_order_acquire);
+        count = std::min(count,
+                         m_buffer_mask + 1 - (pos - m_cached_dequeue_pos));
+    }
+
+    for (size_t i = 0; i < count; ++i, ++first)
+    {
+        m_buffer[(pos + i) & m_buffer_mask] = *first;
+    }
+
+    if (count != 0)
+    {
+        m_enqueue_pos.store(pos + count, std::memory_order_release);
+    }
+
+    return count;
+}
+
+template <typename T>
+template <typename OutputIterator>
+inline size_t SPSCBoundedQueue<T>::popBatch(OutputIterator out,
+                                            size_t max_count)
+{
+    const size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+    size_t count = max_count;
+    if (count > m_cached_enqueue_pos - pos)
+    {
+        m_cached_enqueue_pos = m_enqueue_pos.load(std::memory_order_acquire);
+        count = std::min(count, m_cached_enqueue_pos - pos);
+    }
+
+    for (size_t i = 0; i < count; ++i, ++out)
+    {
+        *out = std::move(m_buffer[(pos + i) & m_buffer_mask]);
+    }
+
+    if (count != 0)
+    {
+        m_dequeue_pos.store(pos + count, std::memory_order_release);
+    }
+
+    return count;
+}
+
+}
@@ -0,0 +1,509 @@
+#pragma once
+
+#include <thread_pool/cache_line.hpp>
+#include <thread_pool/clock.hpp>
+#include <thread_pool/histogram.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tp
+{
+
+/**
+ * @brief The WorkerStatistics struct is a snapshot of one worker counters.
+ */
+struct WorkerStatistics
+{
+    /// Tasks executed by the worker thread.
+    uint64_t tasks_executed = 0;
+    /// Tasks popped from own queue.
+    uint64_t local_pops = 0;
+    /// Successful steal rounds, each one may take a batch of tasks.
+    uint64_t steals = 0;
+    /// Steal rounds which found all probed siblings empty.
+    uint64_t failed_steals = 0;
+    /// Posts rejected because the worker queue was full.
+    uint64_t rejected_posts = 0;
+    /// Posts spilled to the overflow queue because all queues were full.
+    uint64_t spilled_posts = 0;
+    /// Times the worker thread was parked.
+    uint64_t idle_sleeps = 0;
+    /// Time spent executing and looking for tasks between idle periods.
+    uint64_t busy_ns = 0;
+    /// Time spent spinning, yielding and parked.
+    uint64_t idle_ns = 0;
+    /// Time tasks spent in the queue. Empty unless latency is measured.
+    LatencyDistribution queue_wait;
+    /// Time tasks were running. Empty unless latency is measured.
+    LatencyDistribution run_time;
+
+    WorkerStatistics& operator+=(const WorkerStatistics& rhs);
+};
+
+/**
+ * @brief The ThreadPoolStatistics struct is a snapshot of thread pool
+ * counters.
+ */
+struct ThreadPoolStatistics
+{
+    /// Sum of all workers counters.
+    WorkerStatistics total;
+    /// Counters of every worker in order of worker IDs.
+    std::vector<WorkerStatistics> workers;
+};
+
+/**
+ * @brief The NoStatistics class is a statistics policy which collects
+ * nothing. All hooks are empty and optimized away, so the pool pays nothing.
+ */
+class NoStatistics
+{
+public:
+    template <typename Handler>
+    static Handler&& wrap(Handler&& handler)
+    {
+        return std::forward<Handler>(handler);
+    }
+
+    void onThreadStart() {}
+    void onLocalPop() {}
+    void onSteal() {}
+    void onFailedSteal() {}
+    void onTaskExecuted() {}
+    void onRejectedPost() {}
+    void onSpilledPost() {}
+    void onIdleSleep() {}
+    void onBusy() {}
+    void onIdle() {}
+    void snapshot(WorkerStatistics&) const {}
+};
+
+/**
+ * @brief The AtomicStatistics class is a statistics policy which keeps
+ * per-worker counters.
+ * Counters updated by the worker thread have a single writer, so they are
+ * incremented by relaxed load and store without read-modify-write. They
+ * share one cache line isolated from the rest of the worker. Counters of
+ * rejected and spilled posts are written by posting threads and live on
+ * their own cache line. Busy and idle time is accounted on transitions
+ * between the two states only, not per task.
+ * Snapshots can be taken from any thread without stopping the worker. Time
+ * of the current busy or idle period is not included until it is finished.
+ */
+class AtomicStatistics
+{
+public:
+    AtomicStatistics();
+
+    /**
+     * @brief wrap Return handler to be posted instead of the given one.
+     */
+    template <typename Handler>
+    static Handler&& wrap(Handler&& handler);
+
+    /**
+     * @brief onThreadStart Worker thread started.
+     */
+    void onThreadStart();
+
+    /**
+     * @brief onLocalPop Task was popped from own queue.
+     */
+    void onLocalPop();
+
+    /**
+     * @brief onSteal Tasks were stolen from a sibling worker.
+     */
+    void onSteal();
+
+    /**
+     * @brief onFailedSteal No task was found at sibling workers.
+     */
+    void onFailedSteal();
+
+    /**
+     * @brief onTaskExecuted Task was executed.
+     */
+    void onTaskExecuted();
+
+    /**
+     * @brief onRejectedPost Post was rejected by full queue.
+     * @note Can be called from any thread.
+     */
+    void onRejectedPost();
+
+    /**
+     * @brief onSpilledPost Post was spilled to the overflow queue.
+     * @note Can be called from any thread.
+     */
+    void onSpilledPost();
+
+    /**
+     * @brief onIdleSleep Worker thread is going to park.
+     */
+    void onIdleSleep();
+
+    /**
+     * @brief onBusy Worker thread finished idle period.
+     */
+    void onBusy();
+
+    /**
+     * @brief onIdle Worker thread finished busy period.
+     */
+    void onIdle();
+
+    /**
+     * @brief snapshot Store current counters.
+     * @param stats Place for counters to be stored.
+     * @note Can be called from any thread.
+     */
+    void snapshot(WorkerStatistics& stats) const;
+
+private:
+    static void increment(std::atomic<uint64_t>& counter, uint64_t value = 1);
+
+    uint64_t elapsed();
+
+    char m_pad0[detail::FALSE_SHARING_RANGE];
+    std::atomic<uint64_t> m_tasks_executed;
+    std::atomic<uint64_t> m_local_pops;
+    std::atomic<uint64_t> m_steals;
+    std::atomic<uint64_t> m_failed_steals;
+    std::atomic<uint64_t> m_idle_sleeps;
+    std::atomic<uint64_t> m_busy_ns;
+    std::atomic<uint64_t> m_idle_ns;
+    uint64_t m_last_switch;
+    char m_pad1[detail::FALSE_SHARING_RANGE];
+    std::atomic<uint64_t> m_rejected_posts;
+    std::atomic<uint64_t> m_spilled_posts;
+    char m_pad2[detail::FALSE_SHARING_RANGE];
+};
+
+/**
+ * @brief The LatencyStatistics class is a statistics policy which keeps
+ * AtomicStatistics counters and histograms of task queue wait and run time.
+ * Posted handlers are wrapped to carry the enqueue timestamp. The wrapper
+ * records both times to histograms of the worker executing it, so each
+ * histogram has a single writer. Three Clock reads are taken per task, choose
+ * TscClock or CoarseClock if SteadyClock is too expensive.
+ */
+template <typename Clock = SteadyClock>
+class LatencyStatistics : public AtomicStatistics
+{
+public:
+    template <typename Handler>
+    class TimestampedTask;
+
+    /**
+     * @brief wrap Wrap handler to the task carrying enqueue timestamp.
+     */
+    template <typename Handler>
+    static TimestampedTask<typename std::decay<Handler>::type>
+    wrap(Handler&& handler);
+
+    /**
+     * @brief onThreadStart Make this instance the recipient of latencies
+     * measured in the calling worker thread.
+     */
+    void onThreadStart();
+
+    /**
+     * @brief snapshot Store current counters and histograms.
+     * @param stats Place for counters to be stored.
+     * @note Can be called from any thread.
+     */
+    void snapshot(WorkerStatistics& stats) const;
+
+private:
+    static LatencyStatistics*& current();
+
+    LatencyHistogram m_queue_wait;
+    LatencyHistogram m_run_time;
+};
+
+template <typename Clock>
+template <typename Handler>
+class LatencyStatistics<Clock>::TimestampedTask
+{
+public:
+    template <typename H>
+    TimestampedTask(H&& handler, uint64_t timestamp)
+        : m_handler(std::forward<H>(handler))
+        , m_timestamp(timestamp)
+    {
+    }
+
+    void operator()()
+    {
+        const uint64_t start = Clock::now();
+        LatencyStatistics* stats = current();
+
+        try
+        {
+            m_handler();
+        }
+        catch(...)
+        {
+            record(stats, start);
+            throw;
+        }
+
+        record(stats, start);
+    }
+
+private:
+    void record(LatencyStatistics* stats, uint64_t start)
+    {
+        if (!stats)
+        {
+            return;
+        }
+
+        const uint64_t end = Clock::now();
+        // Unsynchronized clocks of different cores may go backwards.
+        stats->m_queue_wait.record(
+            start > m_timestamp ? start - m_timestamp : 0);
+        stats->m_run_time.record(end > start ? end - start : 0);
+    }
+
+    Handler m_handler;
+    uint64_t m_timestamp;
+};
+
+namespace detail
+{
+    /**
+     * @brief The WrappingIterator class adapts range of handlers to be
+     * posted so that every handler is wrapped by Stats policy when it is
+     * dereferenced.
+     */
+    template <typename Stats, typename Iterator>
+    class WrappingIterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef decltype(Stats::wrap(*std::declval<Iterator>())) reference;
+        typedef typename std::decay<reference>::type value_type;
+        typedef typename std::iterator_traits<Iterator>::difference_type
+            difference_type;
+        typedef value_type* pointer;
+
+        explicit WrappingIterator(Iterator it) : m_it(it)
+        {
+        }
+
+        reference operator*() const
+        {
+            return Stats::wrap(*m_it);
+        }
+
+        WrappingIterator& operator++()
+        {
+            ++m_it;
+            return *this;
+        }
+
+        WrappingIterator operator++(int)
+        {
+            WrappingIterator tmp(*this);
+            ++m_it;
+            return tmp;
+        }
+
+        bool operator==(const WrappingIterator& rhs) const
+        {
+            return m_it == rhs.m_it;
+        }
+
+        bool operator!=(const WrappingIterator& rhs) const
+        {
+            return m_it != rhs.m_it;
+        }
+
+    private:
+        Iterator m_it;
+    };
+
+    template <typename Stats, typename Iterator>
+    struct wraps_handlers : std::integral_constant<bool,
+        !std::is_same<decltype(Stats::wrap(*std::declval<Iterator>())),
+                      decltype(*std::declval<Iterator>())>::value>
+    {
+    };
+
+    /**
+     * @brief wrap_iterator Return iterator wrapping handlers by Stats
+     * policy, or the iterator itself if the policy doesn't wrap them.
+     */
+    template <typename Stats, typename Iterator>
+    inline typename std::enable_if<!wraps_handlers<Stats, Iterator>::value,
+                                   Iterator>::type
+    wrap_iterator(Iterator it)
+    {
+        return it;
+    }
+
+    template <typename Stats, typename Iterator>
+    inline typename std::enable_if<wraps_handlers<Stats, Iterator>::value,
+                                   WrappingIterator<Stats, Iterator>>::type
+    wrap_iterator(Iterator it)
+    {
+        return WrappingIterator<Stats, Iterator>(it);
+    }
+}
+
+
+/// Implementation
+
+inline WorkerStatistics& WorkerStatistics::operator+=(
+                                                const WorkerStatistics& rhs)
+{
+    tasks_executed += rhs.tasks_executed;
+    local_pops += rhs.local_pops;
+    steals += rhs.steals;
+    failed_steals += rhs.failed_steals;
+    rejected_posts += rhs.rejected_posts;
+    spilled_posts += rhs.spilled_posts;
+    idle_sleeps += rhs.idle_sleeps;
+    busy_ns += rhs.busy_ns;
+    idle_ns += rhs.idle_ns;
+    queue_wait += rhs.queue_wait;
+    run_time += rhs.run_time;
+    return *this;
+}
+
+inline AtomicStatistics::AtomicStatistics()
+    : m_tasks_executed(0)
+    , m_local_pops(0)
+    , m_steals(0)
+    , m_failed_steals(0)
+    , m_idle_sleeps(0)
+    , m_busy_ns(0)
+    , m_idle_ns(0)
+    , m_last_switch(SteadyClock::now())
+    , m_rejected_posts(0)
+    , m_spilled_posts(0)
+{
+}
+
+template <typename Handler>
+inline Handler&& AtomicStatistics::wrap(Handler&& handler)
+{
+    return std::forward<Handler>(handler);
+}
+
+inline void AtomicStatistics::onThreadStart()
+{
+}
+
+inline void AtomicStatistics::increment(std::atomic<uint64_t>& counter,
+                                        uint64_t value)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value,
+                  std::memory_order_relaxed);
+}
+
+inline uint64_t AtomicStatistics::elapsed()
+{
+    const uint64_t now = SteadyClock::now();
+    const uint64_t ns = now - m_last_switch;
+    m_last_switch = now;
+    return ns;
+}
+
+inline void AtomicStatistics::onLocalPop()
+{
+    increment(m_local_pops);
+}
+
+inline void AtomicStatistics::onSteal()
+{
+    increment(m_steals);
+}
+
+inline void AtomicStatistics::onFailedSteal()
+{
+    increment(m_failed_steals);
+}
+
+inline void AtomicStatistics::onTaskExecuted()
+{
+    increment(m_tasks_executed);
+}
+
+inline void AtomicStatistics::onRejectedPost()
+{
+    m_rejected_posts.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void AtomicStatistics::onSpilledPost()
+{
+    m_spilled_posts.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void AtomicStatistics::onIdleSleep()
+{
+    increment(m_idle_sleeps);
+}
+
+inline void AtomicStatistics::onBusy()
+{
+    increment(m_idle_ns, elapsed());
+}
+
+inline void AtomicStatistics::onIdle()
+{
+    increment(m_busy_ns, elapsed());
+}
+
+inline void AtomicStatistics::snapshot(WorkerStatistics& stats) const
+{
+    stats.tasks_executed = m_tasks_executed.load(std::memory_order_relaxed);
+    stats.local_pops = m_local_pops.load(std::memory_order_relaxed);
+    stats.steals = m_steals.load(std::memory_order_relaxed);
+    stats.failed_steals = m_failed_steals.load(std::memory_order_relaxed);
+    stats.rejected_posts = m_rejected_posts.load(std::memory_order_relaxed);
+    stats.spilled_posts = m_spilled_posts.load(std::memory_order_relaxed);
+    stats.idle_sleeps = m_idle_sleeps.load(std::memory_order_relaxed);
+    stats.busy_ns = m_busy_ns.load(std::memory_order_relaxed);
+    stats.idle_ns = m_idle_ns.load(std::memory_order_relaxed);
+}
+
+template <typename Clock>
+template <typename Handler>
+inline typename LatencyStatistics<Clock>::template TimestampedTask<
+    typename std::decay<Handler>::type>
+LatencyStatistics<Clock>::wrap(Handler&& handler)
+{
+    return TimestampedTask<typename std::decay<Handler>::type>(
+        std::forward<Handler>(handler), Clock::now());
+}
+
+template <typename Clock>
+inline void LatencyStatistics<Clock>::onThreadStart()
+{
+    current() = this;
+}
+
+template <typename Clock>
+inline void LatencyStatistics<Clock>::snapshot(WorkerStatistics& stats) const
+{
+    AtomicStatistics::snapshot(stats);
+    m_queue_wait.snapshot(stats.queue_wait, Clock::nanosecondsPerTick());
+    m_run_time.snapshot(stats.run_time, Clock::nanosecondsPerTick());
+}
+
+template <typename Clock>
+inline LatencyStatistics<Clock>*& LatencyStatistics<Clock>::current()
+{
+    static thread_local LatencyStatistics* tss_stats = nullptr;
+    return tss_stats;
+}
+
+}
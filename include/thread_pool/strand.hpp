@@ -0,0 +1,298 @@
+#pragma once
+
+#include <thread_pool/block_pool.hpp>
+#include <thread_pool/fixed_function.hpp>
+#include <thread_pool/idle_strategy.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace tp
+{
+
+/**
+ * @brief The Strand class executes tasks posted to it one at a time in FIFO
+ * order on the workers of a thread pool, while tasks of different strands
+ * run in parallel. No locks are taken and no worker blocks.
+ * Tasks are pushed into an intrusive lock-free MPSC queue. The count of
+ * pending tasks doubles as the scheduled flag: the post which raises it
+ * from zero posts a runner task to the pool, so only one runner per strand
+ * is in flight. The runner executes pending tasks back-to-back on its
+ * worker, up to BATCH_SIZE of them, then reposts itself to let other tasks
+ * of the pool run.
+ * Runners which don't fit into the full pool queue are executed inline.
+ * Queue nodes come from BlockPool, so nodes freed by workers are reused by
+ * posting threads. Default task storage keeps a node within 128 bytes.
+ * @note The strand must outlive its pending tasks.
+ */
+template <typename Pool, typename Task = FixedFunction<void(), 64>>
+class Strand
+{
+public:
+    /// Maximum number of tasks executed by one runner task.
+    enum : size_t { BATCH_SIZE = 64 };
+
+    /**
+     * @brief Strand Construct strand executing tasks on the pool.
+     * @param pool Thread pool to execute tasks.
+     */
+    explicit Strand(Pool& pool);
+
+    /**
+     * @brief ~Strand Destroy tasks which were never executed, e.g. if the
+     * pool has dropped the runner at shutdown.
+     */
+    ~Strand();
+
+    /**
+     * @brief post Post job to the strand. Never blocks.
+     * @param handler Handler to be called from a pool worker thread after
+     * all jobs posted to the strand before.
+     * @throw std::bad_alloc if memory is exhausted.
+     */
+    template <typename Handler>
+    void post(Handler&& handler);
+
+    /**
+     * @brief runningInThisThread Return true if the current thread executes
+     * a task of the strand.
+     */
+    bool runningInThisThread() const;
+
+private:
+    struct NodeBase
+    {
+        std::atomic<NodeBase*> next;
+    };
+
+    struct Node : NodeBase
+    {
+        template <typename Handler>
+        explicit Node(Handler&& handler);
+
+        Task task;
+        uint32_t block;
+    };
+
+    /**
+     * @brief The Runner struct is the pool task executing strand tasks.
+     */
+    struct Runner
+    {
+        Strand* strand;
+
+        void operator()() const
+        {
+            strand->run();
+        }
+    };
+
+    Strand(const Strand&) = delete;
+    Strand& operator=(const Strand&) = delete;
+
+    /**
+     * @brief run Execute pending tasks until there are none left or the
+     * batch is done.
+     */
+    void run();
+
+    /**
+     * @brief schedule Post runner to the pool, or run it inline if the
+     * pool queue is full.
+     */
+    void schedule();
+
+    /**
+     * @brief pop Take the next task node, waiting for a post which has
+     * counted its task but not linked its node yet.
+     */
+    Node* pop();
+
+    /**
+     * @brief destroyNode Destroy node and return its block to BlockPool.
+     */
+    static void destroyNode(Node* node);
+
+    /**
+     * @brief current Return pointer to the strand executed by the current
+     * thread.
+     */
+    static const Strand*& current();
+
+    Pool& m_pool;
+
+    // The last executed node, or the stub, whose successor is the next
+    // task. Not padded from the producer side: the count is written by
+    // both sides anyway, and applications keep thousands of strands.
+    NodeBase m_stub;
+    NodeBase* m_head;
+
+    std::atomic<NodeBase*> m_tail;
+    std::atomic<size_t> m_count;
+};
+
+/// Implementation
+
+template <typename Pool, typename Task>
+template <typename Handler>
+inline Strand<Pool, Task>::Node::Node(Handler&& handler)
+    : task(std::forward<Handler>(handler))
+    , block(0)
+{
+    this->next.store(nullptr, std::memory_order_relaxed);
+}
+
+template <typename Pool, typename Task>
+inline Strand<Pool, Task>::Strand(Pool& pool)
+    : m_pool(pool)
+    , m_head(&m_stub)
+    , m_tail(&m_stub)
+    , m_count(0)
+{
+    m_stub.next.store(nullptr, std::memory_order_relaxed);
+}
+
+template <typename Pool, typename Task>
+inline Strand<Pool, Task>::~Strand()
+{
+    NodeBase* node = m_head->next.load(std::memory_order_acquire);
+    while (node)
+    {
+        NodeBase* next = node->next.load(std::memory_order_acquire);
+        destroyNode(static_cast<Node*>(node));
+        node = next;
+    }
+
+    if (m_head != &m_stub)
+    {
+        destroyNode(static_cast<Node*>(m_head));
+    }
+}
+
+template <typename Pool, typename Task>
+template <typename Handler>
+inline void Strand<Pool, Task>::post(Handler&& handler)
+{
+    uint32_t block;
+    void* memory = detail::BlockPool::allocate(sizeof(Node), block);
+
+    Node* node;
+    try
+    {
+        node = new (memory) Node(std::forward<Handler>(handler));
+    }
+    catch(...)
+    {
+        detail::BlockPool::deallocate(memory, block);
+        throw;
+    }
+    node->block = block;
+
+    // The node is visible to the runner once linked to the previous tail.
+    NodeBase* prev = m_tail.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+
+    if (m_count.fetch_add(1, std::memory_order_acq_rel) == 0)
+    {
+        schedule();
+    }
+}
+
+template <typename Pool, typename Task>
+inline bool Strand<Pool, Task>::runningInThisThread() const
+{
+    return current() == this;
+}
+
+template <typename Pool, typename Task>
+inline void Strand<Pool, Task>::run()
+{
+    const Strand* const outer = current();
+    current() = this;
+
+    for (;;)
+    {
+        for (size_t i = 0; i < BATCH_SIZE; ++i)
+        {
+            Node* node = pop();
+
+            // The task is destroyed right away, the node stays as the head
+            // until the next one is taken.
+            try
+            {
+                node->task();
+            }
+            catch(...)
+            {
+                // suppress all exceptions, as workers do
+            }
+            node->task = Task();
+
+            // Once the count drops to zero the strand may be destroyed or
+            // run by the runner of the next post, so it isn't touched.
+            if (m_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                current() = outer;
+                return;
+            }
+        }
+
+        // Reposted to let other tasks run. The runner goes on inline if
+        // the queue is full.
+        if (m_pool.tryPost(Runner{this}))
+        {
+            current() = outer;
+            return;
+        }
+    }
+}
+
+template <typename Pool, typename Task>
+inline void Strand<Pool, Task>::schedule()
+{
+    if (!m_pool.tryPost(Runner{this}))
+    {
+        run();
+    }
+}
+
+template <typename Pool, typename Task>
+inline typename Strand<Pool, Task>::Node* Strand<Pool, Task>::pop()
+{
+    NodeBase* next = m_head->next.load(std::memory_order_acquire);
+
+    // The post has exchanged the tail and is about to link the node.
+    while (next == nullptr)
+    {
+        detail::cpuRelax();
+        next = m_head->next.load(std::memory_order_acquire);
+    }
+
+    if (m_head != &m_stub)
+    {
+        destroyNode(static_cast<Node*>(m_head));
+    }
+    m_head = next;
+
+    return static_cast<Node*>(next);
+}
+
+template <typename Pool, typename Task>
+inline void Strand<Pool, Task>::destroyNode(Node* node)
+{
+    const uint32_t block = node->block;
+    node->~Node();
+    detail::BlockPool::deallocate(node, block);
+}
+
+template <typename Pool, typename Task>
+inline const Strand<Pool, Task>*& Strand<Pool, Task>::current()
+{
+    static thread_local const Strand* strand = nullptr;
+    return strand;
+}
+
+}
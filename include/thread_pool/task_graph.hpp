@@ -0,0 +1,392 @@
+#pragma once
+
+#include <thread_pool/fixed_function.hpp>
+#include <thread_pool/idle_strategy.hpp>
+#include <thread_pool/thread_pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace tp
+{
+
+/**
+ * @brief The TaskGraph class executes tasks ordered by dependencies on a
+ * thread pool. Nodes are callables, an edge makes one node run after
+ * another.
+ * Every node has an atomic counter of unfinished predecessors. A finished
+ * node executes its first ready successor inline on the same thread to
+ * keep caches warm and posts the other ready ones to the pool.
+ * A graph can be run any number of times. Its structure is compiled into
+ * flat arrays once it changes, so runs don't allocate memory.
+ * Successors which don't fit into the full pool queue are executed inline.
+ */
+class TaskGraph
+{
+public:
+    typedef FixedFunction<void(), 64> Function;
+
+    TaskGraph();
+
+    /**
+     * @brief addNode Add node calling handler.
+     * @param handler Functional object to be called when the node runs.
+     * @return ID of the node.
+     */
+    template <typename Handler>
+    size_t addNode(Handler&& handler);
+
+    /**
+     * @brief addEdge Make one node run after another has finished.
+     * @param from ID of the node to finish first.
+     * @param to ID of the node to run after it.
+     * @throw std::out_of_range if any ID is unknown.
+     */
+    void addEdge(size_t from, size_t to);
+
+    /**
+     * @brief size Return number of nodes.
+     */
+    size_t size() const;
+
+    /**
+     * @brief clear Remove all nodes and edges.
+     */
+    void clear();
+
+    /**
+     * @brief run Execute all nodes on the pool and wait until they are
+     * finished. Called from a pool worker, pending tasks are executed while
+     * waiting.
+     * @param pool Thread pool to execute nodes.
+     * @throw std::logic_error if the graph has a cycle or is running
+     * already.
+     * @throw The first exception thrown by a node. Nodes not started yet
+     * are skipped once a node has thrown.
+     */
+    template <typename Task, template<typename> class Queue, typename Stats>
+    void run(ThreadPoolImpl<Task, Queue, Stats>& pool);
+
+private:
+    enum : size_t { NO_NODE = ~size_t(0) };
+
+    /**
+     * @brief The NodeTask struct is the pool task running a node. It is
+     * trivially copyable and stored inline by the pool task.
+     */
+    template <typename Pool>
+    struct NodeTask
+    {
+        TaskGraph* graph;
+        Pool* pool;
+        size_t node;
+
+        void operator()() const
+        {
+            graph->execute(*pool, node);
+        }
+    };
+
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+
+    /**
+     * @brief compile Build successor lists and find roots, checking the
+     * graph for cycles.
+     */
+    void compile();
+
+    /**
+     * @brief execute Run node and the chain of its first ready successors.
+     */
+    template <typename Pool>
+    void execute(Pool& pool, size_t node);
+
+    /**
+     * @brief spawn Post node to the pool or execute it inline if the pool
+     * queue is full.
+     */
+    template <typename Pool>
+    void spawn(Pool& pool, size_t node);
+
+    /**
+     * @brief wait Block until all nodes are finished.
+     */
+    void wait();
+
+    std::vector<Function> m_functions;
+    std::vector<std::pair<size_t, size_t>> m_edges;
+
+    // Compiled structure: successors of node i are
+    // m_successors[m_offsets[i], m_offsets[i + 1]).
+    bool m_compiled;
+    std::vector<size_t> m_offsets;
+    std::vector<size_t> m_successors;
+    std::vector<size_t> m_predecessor_counts;
+    std::vector<size_t> m_roots;
+    std::unique_ptr<std::atomic<size_t>[]> m_pending;
+
+    std::atomic<size_t> m_remaining;
+    std::atomic<bool> m_failed;
+    std::exception_ptr m_exception;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_finished;
+};
+
+/// Implementation
+
+inline TaskGraph::TaskGraph()
+    : m_compiled(true)
+    , m_remaining(0)
+    , m_failed(false)
+    , m_finished(true)
+{
+}
+
+template <typename Handler>
+inline size_t TaskGraph::addNode(Handler&& handler)
+{
+    m_functions.emplace_back(std::forward<Handler>(handler));
+    m_compiled = false;
+    return m_functions.size() - 1;
+}
+
+inline void TaskGraph::addEdge(size_t from, size_t to)
+{
+    if (from >= m_functions.size() || to >= m_functions.size())
+    {
+        throw std::out_of_range("task graph node doesn't exist");
+    }
+
+    m_edges.emplace_back(from, to);
+    m_compiled = false;
+}
+
+inline size_t TaskGraph::size() const
+{
+    return m_functions.size();
+}
+
+inline void TaskGraph::clear()
+{
+    m_functions.clear();
+    m_edges.clear();
+    m_compiled = false;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline void TaskGraph::run(ThreadPoolImpl<Task, Queue, Stats>& pool)
+{
+    if (m_remaining.load(std::memory_order_acquire) != 0)
+    {
+        throw std::logic_error("task graph is running already");
+    }
+
+    if (!m_compiled)
+    {
+        compile();
+    }
+
+    const size_t count = m_functions.size();
+    if (count == 0)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        m_pending[i].store(m_predecessor_counts[i], std::memory_order_relaxed);
+    }
+    m_failed.store(false, std::memory_order_relaxed);
+    m_exception = nullptr;
+    m_finished = false;
+
+    // Published to the workers by posting the roots.
+    m_remaining.store(count, std::memory_order_relaxed);
+    for (size_t root : m_roots)
+    {
+        spawn(pool, root);
+    }
+
+    wait();
+
+    if (m_exception)
+    {
+        std::rethrow_exception(m_exception);
+    }
+}
+
+inline void TaskGraph::compile()
+{
+    const size_t count = m_functions.size();
+
+    m_offsets.assign(count + 1, 0);
+    m_predecessor_counts.assign(count, 0);
+    for (const auto& edge : m_edges)
+    {
+        ++m_offsets[edge.first + 1];
+        ++m_predecessor_counts[edge.second];
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        m_offsets[i + 1] += m_offsets[i];
+    }
+
+    m_successors.resize(m_edges.size());
+    std::vector<size_t> positions(m_offsets.begin(), m_offsets.end() - 1);
+    for (const auto& edge : m_edges)
+    {
+        m_successors[positions[edge.first]++] = edge.second;
+    }
+
+    m_roots.clear();
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (m_predecessor_counts[i] == 0)
+        {
+            m_roots.push_back(i);
+        }
+    }
+
+    // Nodes on a cycle never become ready, so they are not reached by
+    // walking the graph from the roots in topological order.
+    std::vector<size_t> pending(m_predecessor_counts);
+    std::vector<size_t> ready(m_roots);
+    size_t reached = 0;
+    while (!ready.empty())
+    {
+        const size_t node = ready.back();
+        ready.pop_back();
+        ++reached;
+        for (size_t i = m_offsets[node]; i < m_offsets[node + 1]; ++i)
+        {
+            if (--pending[m_successors[i]] == 0)
+            {
+                ready.push_back(m_successors[i]);
+            }
+        }
+    }
+    if (reached != count)
+    {
+        throw std::logic_error("task graph has a cycle");
+    }
+
+    m_pending.reset(new std::atomic<size_t>[count]);
+    m_compiled = true;
+}
+
+template <typename Pool>
+inline void TaskGraph::execute(Pool& pool, size_t node)
+{
+    while (node != NO_NODE)
+    {
+        if (!m_failed.load(std::memory_order_relaxed))
+        {
+            try
+            {
+                m_functions[node]();
+            }
+            catch(...)
+            {
+                if (!m_failed.exchange(true, std::memory_order_relaxed))
+                {
+                    m_exception = std::current_exception();
+                }
+            }
+        }
+
+        size_t next = NO_NODE;
+        for (size_t i = m_offsets[node]; i < m_offsets[node + 1]; ++i)
+        {
+            const size_t successor = m_successors[i];
+            if (m_pending[successor].fetch_sub(
+                    1, std::memory_order_acq_rel) != 1)
+            {
+                continue;
+            }
+
+            if (next == NO_NODE)
+            {
+                next = successor;
+            }
+            else
+            {
+                spawn(pool, successor);
+            }
+        }
+
+        // The graph may be destroyed by the waiter once the last node is
+        // counted, the successor taken above keeps it alive.
+        if (m_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_finished = true;
+            m_cv.notify_all();
+        }
+
+        node = next;
+    }
+}
+
+template <typename Pool>
+inline void TaskGraph::spawn(Pool& pool, size_t node)
+{
+    // Executed inline rather than blocking the worker which has to pop
+    // the full queue.
+    if (!pool.tryPost(NodeTask<Pool>{this, &pool, node}))
+    {
+        execute(pool, node);
+    }
+}
+
+inline void TaskGraph::wait()
+{
+    // Short graphs are likely to finish soon, so poll for a while first.
+    IdleStrategy idle_strategy(0, 64);
+    while (m_remaining.load(std::memory_order_acquire) != 0)
+    {
+        if (detail::run_pending_task())
+        {
+            idle_strategy.reset();
+            continue;
+        }
+
+        if (!idle_strategy.idle())
+        {
+            break;
+        }
+    }
+
+    // The flag is set by the last node under the lock, so once it is seen
+    // no node touches the graph.
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_finished)
+    {
+        if (*detail::thread_worker() == nullptr)
+        {
+            m_cv.wait(lock);
+            continue;
+        }
+
+        // Workers wake up periodically to help with tasks posted to their
+        // queues meanwhile.
+        m_cv.wait_for(lock, std::chrono::milliseconds(1));
+        lock.unlock();
+        while (detail::run_pending_task())
+        {
+        }
+        lock.lock();
+    }
+}
+
+}
@@ -1,22 +1,97 @@
 #pragma once
 
+#include <thread_pool/backpressure.hpp>
 #include <thread_pool/fixed_function.hpp>
+#include <thread_pool/future.hpp>
 #include <thread_pool/mpmc_bounded_queue.hpp>
+#include <thread_pool/mpsc_bounded_queue.hpp>
+#include <thread_pool/size_class_queue.hpp>
+#include <thread_pool/spsc_bounded_queue.hpp>
+#include <thread_pool/statistics.hpp>
 #include <thread_pool/thread_pool_options.hpp>
+#include <thread_pool/timer_wheel.hpp>
+#include <thread_pool/topology.hpp>
+#include <thread_pool/work_stealing_queue.hpp>
 #include <thread_pool/worker.hpp>
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <iterator>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
 #include <vector>
 
 namespace tp
 {
 
-template <typename Task, template<typename> class Queue>
+namespace detail
+{
+    /**
+     * @brief jump_consistent_hash Map key to one of buckets. Changing the
+     * number of buckets from n to n + 1 moves only 1/(n + 1) of the keys,
+     * see "A Fast, Minimal Memory, Consistent Hash Algorithm" by Lamping
+     * and Veach.
+     */
+    inline size_t jump_consistent_hash(uint64_t key, size_t buckets)
+    {
+        int64_t bucket = -1;
+        int64_t next = 0;
+        while (next < static_cast<int64_t>(buckets))
+        {
+            bucket = next;
+            key = key * 2862933555777941757ULL + 1;
+            next = static_cast<int64_t>(
+                (bucket + 1) * (double(int64_t(1) << 31) /
+                                double((key >> 33) + 1)));
+        }
+        return static_cast<size_t>(bucket);
+    }
+}
+
+/**
+ * @brief The DrainPolicy enum defines what happens to tasks pending at
+ * thread pool shutdown.
+ */
+enum class DrainPolicy
+{
+    /// Pending tasks and tasks they post are executed.
+    Drain,
+    /// Pending tasks are destroyed, running ones are finished.
+    Drop
+};
+
+template <typename Task, template<typename> class Queue,
+          typename Stats = NoStatistics>
 class ThreadPoolImpl;
 using ThreadPool = ThreadPoolImpl<FixedFunction<void(), 128>,
                                   MPMCBoundedQueue>;
+using WorkStealingThreadPool = ThreadPoolImpl<FixedFunction<void(), 128>,
+                                              WorkStealingQueue>;
+using MPSCThreadPool = ThreadPoolImpl<FixedFunction<void(), 128>,
+                                      MPSCBoundedQueue>;
+using SPSCThreadPool = ThreadPoolImpl<FixedFunction<void(), 128>,
+                                      SPSCBoundedQueue>;
+
+/// Pools of tasks with smaller or larger storage than ThreadPool has. Queue
+/// cells are padded to the cache line.
+using ThreadPool32 = ThreadPoolImpl<FixedFunction<void(), 32>,
+                                    MPMCBoundedQueue>;
+using ThreadPool64 = ThreadPoolImpl<FixedFunction<void(), 64>,
+                                    MPMCBoundedQueue>;
+using ThreadPool256 = ThreadPoolImpl<FixedFunction<void(), 256>,
+                                     MPMCBoundedQueue>;
+
+/// Pool placing every task to the queue of the smallest storage size
+/// holding it, see SizeClassQueue.
+using AutoSizedThreadPool = ThreadPoolImpl<FixedFunction<void(), 256>,
+    SizeClasses<MPMCBoundedQueue, 32, 64, 128, 256>::queue>;
 
 /**
  * @brief The ThreadPool class implements thread pool pattern.
@@ -25,8 +100,22 @@ using ThreadPool = ThreadPoolImpl<FixedFunction<void(), 128>,
  * It implements both work-stealing and work-distribution balancing
  * startegies.
  * It implements cooperative scheduling strategy for tasks.
+ * Runtime statistics are collected if Stats policy is AtomicStatistics.
+ * A job is posted to the next worker in turn, or to any other one if its
+ * queue is full. OverflowPolicy defines what happens if all queues are full.
+ * With a single-producer Queue such as SPSCBoundedQueue only one thread
+ * besides the workers may post to the pool.
+ * Tasks pending at destruction are dropped, call shutdown() to drain them.
+ * The pool can be resized up to ThreadPoolOptions::maxThreadCount() threads
+ * at run time, explicitly or by auto-scaling. Worker slots are allocated
+ * upfront, so posting never synchronizes with resizing.
+ * Delayed and periodic tasks are kept in timer wheels of the workers and
+ * fired by the worker threads, there is no timer thread.
+ * Jobs can be posted to a chosen worker or to the worker owning a key, to
+ * keep the data they touch in the cache of one core. Such jobs are stolen
+ * as others unless ThreadPoolOptions::stealKeyedTasks() is disabled.
  */
-template <typename Task, template<typename> class Queue>
+template <typename Task, template<typename> class Queue, typename Stats>
 class ThreadPoolImpl {
 public:
     /**
@@ -37,125 +126,1271 @@ public:
         const ThreadPoolOptions& options = ThreadPoolOptions());
 
     /**
-     * @brief Move ctor implementation.
+     * @brief Move ctor implementation. Workers hold pointers to their pool,
+     * so workers of rhs are stopped, rebound and restarted. Running tasks
+     * are waited for, queued tasks and timers are kept, rhs is left
+     * stopped. Neither pool may be used by other threads meanwhile.
      */
     ThreadPoolImpl(ThreadPoolImpl&& rhs) noexcept;
 
     /**
-     * @brief ~ThreadPool Stop all workers and destroy thread pool.
+     * @brief ~ThreadPool Stop all workers and destroy thread pool. Pending
+     * tasks are dropped.
      */
     ~ThreadPoolImpl();
 
     /**
-     * @brief Move assignment implementaion.
+     * @brief Move assignment implementaion. Pending tasks of this pool are
+     * dropped, then workers of rhs are moved as by the move ctor.
      */
     ThreadPoolImpl& operator=(ThreadPoolImpl&& rhs) noexcept;
 
     /**
-     * @brief post Try post job to thread pool.
+     * @brief post Try post job to thread pool. Never blocks.
      * @param handler Handler to be called from thread pool worker. It has
      * to be callable as 'handler()'.
-     * @return 'true' on success, false otherwise.
+     * @param priority Priority level, 0 is the highest. Levels beyond
+     * ThreadPoolOptions::priorityLevels() are clamped to the lowest one.
+     * @return 'true' on success, false if queues of all workers are full
+     * and the overflow policy isn't OverflowPolicy::Spill.
      * @note All exceptions thrown by handler will be suppressed.
      */
     template <typename Handler>
-    bool tryPost(Handler&& handler);
+    bool tryPost(Handler&& handler, size_t priority = 0);
 
     /**
      * @brief post Post job to thread pool.
      * @param handler Handler to be called from thread pool worker. It has
      * to be callable as 'handler()'.
-     * @throw std::overflow_error if worker's queue is full.
+     * @param priority Priority level, 0 is the highest.
+     * @throw std::runtime_error if queues of all workers are full and the
+     * overflow policy is OverflowPolicy::Reject. Waits for a free slot with
+     * OverflowPolicy::Block instead.
+     * @note All exceptions thrown by handler will be suppressed.
+     */
+    template <typename Handler>
+    void post(Handler&& handler, size_t priority = 0);
+
+    /**
+     * @brief postWait Post job to thread pool, waiting while queues of all
+     * workers are full. The overflow policy is ignored, so the job is never
+     * spilled. Producer threads are parked and woken up by workers taking
+     * tasks; worker threads run pending tasks instead.
+     * @param handler Handler to be called from thread pool worker. It has
+     * to be callable as 'handler()'.
+     * @param priority Priority level, 0 is the highest.
+     * @note All exceptions thrown by handler will be suppressed.
+     */
+    template <typename Handler>
+    void postWait(Handler&& handler, size_t priority = 0);
+
+    /**
+     * @brief postWaitFor Post job to thread pool, waiting while queues of
+     * all workers are full, but no longer than timeout.
+     * @param handler Handler to be called from thread pool worker. It has
+     * to be callable as 'handler()'.
+     * @param timeout Maximum time to wait.
+     * @param priority Priority level, 0 is the highest.
+     * @return true if the job was posted before timeout.
      * @note All exceptions thrown by handler will be suppressed.
      */
+    template <typename Handler, typename Rep, typename Period>
+    bool postWaitFor(Handler&& handler,
+                     const std::chrono::duration<Rep, Period>& timeout,
+                     size_t priority = 0);
+
+    /**
+     * @brief tryPostBatch Try post range of jobs to thread pool. Jobs are
+     * split into chunks spread over the workers in one pass, every chunk is
+     * reserved in the worker's queue at once. Jobs get the highest priority.
+     * Jobs which don't fit are spilled with OverflowPolicy::Spill.
+     * @param first Beginning of the range of handlers. Posted handlers may
+     * be consumed: FixedFunction tasks move from '*first' even if it is an
+     * lvalue, so copy the range to keep it.
+     * @param last End of the range of handlers.
+     * @return Number of jobs posted from the beginning of the range.
+     * @note All exceptions thrown by handlers will be suppressed.
+     */
+    template <typename Iterator>
+    size_t tryPostBatch(Iterator first, Iterator last);
+
+    /**
+     * @brief postBatch Post range of jobs to thread pool.
+     * @param first Beginning of the range of handlers, see tryPostBatch().
+     * @param last End of the range of handlers.
+     * @throw std::runtime_error if workers' queues are full and the
+     * overflow policy is OverflowPolicy::Reject. Jobs from the beginning of
+     * the range may be posted anyway. Waits for free slots with
+     * OverflowPolicy::Block instead.
+     * @note All exceptions thrown by handlers will be suppressed.
+     */
+    template <typename Iterator>
+    void postBatch(Iterator first, Iterator last);
+
+    /**
+     * @brief postTo Post job to the queue of the worker, or of the next one
+     * with a free slot if it is full. If keyed tasks can't be stolen, the
+     * job is pinned to the worker's unbounded queue instead. Otherwise the
+     * overflow policy applies as in post().
+     * @param id Worker index, less than threadCount(). The job goes to a
+     * remaining worker if the pool shrinks meanwhile.
+     * @param handler Handler to be called from thread pool worker. It has
+     * to be callable as 'handler()'.
+     * @param priority Priority level, 0 is the highest.
+     * @throws std::out_of_range if id isn't less than threadCount().
+     * @throws std::runtime_error if queues of all workers are full and the
+     * overflow policy is OverflowPolicy::Reject.
+     */
     template <typename Handler>
-    void post(Handler&& handler);
+    void postTo(size_t id, Handler&& handler, size_t priority = 0);
+
+    /**
+     * @brief postKeyed Post job to the worker owning the key, see postTo().
+     * Keys are mapped to workers by jump consistent hash of 'std::hash',
+     * so resizing the pool from n to n + 1 threads moves 1/(n + 1) of the
+     * keys to other workers.
+     * @param key Key to choose the worker by.
+     * @param handler Handler to be called from thread pool worker. It has
+     * to be callable as 'handler()'.
+     * @param priority Priority level, 0 is the highest.
+     * @throws std::runtime_error if queues of all workers are full and the
+     * overflow policy is OverflowPolicy::Reject.
+     */
+    template <typename Key, typename Handler>
+    void postKeyed(const Key& key, Handler&& handler, size_t priority = 0);
+
+    /**
+     * @brief submit Post job to thread pool and return future for its
+     * result.
+     * @param handler Handler to be called from thread pool worker. It has
+     * to be callable as 'handler(args...)'.
+     * @param args Arguments to be moved into the handler call.
+     * @return Future which receives handler's result or exception.
+     * @throw std::runtime_error if queues of all workers are full and the
+     * overflow policy is OverflowPolicy::Reject. Waits for a free slot with
+     * OverflowPolicy::Block instead.
+     * @throw std::bad_alloc if the slab of future states is exhausted and
+     * so is memory.
+     * @note The future must not outlive the thread pool. Tasks are
+     * type-erased by value, so Task has to accept move-only callables.
+     */
+    template <typename Handler, typename... Args>
+    Future<typename detail::SubmitResult<Handler, Args...>::type>
+    submit(Handler&& handler, Args&&... args);
+
+    /**
+     * @brief postAfter Post job to be executed once the delay passes.
+     * @param delay Delay from now.
+     * @param handler Handler to be called from thread pool worker. It has
+     * to be callable as 'handler()'.
+     * @return Handle to cancel the timer.
+     * @throw std::bad_alloc if memory is exhausted.
+     * @note The timer is not a pending task until it fires. Timers left at
+     * shutdown are dropped.
+     */
+    template <typename Handler, typename Rep, typename Period>
+    TimerHandle postAfter(const std::chrono::duration<Rep, Period>& delay,
+                          Handler&& handler);
+
+    /**
+     * @brief postAt Post job to be executed at the time point.
+     * @param time Time point of any clock, converted to steady clock now.
+     * @param handler Handler to be called from thread pool worker. It has
+     * to be callable as 'handler()'.
+     * @return Handle to cancel the timer.
+     * @throw std::bad_alloc if memory is exhausted.
+     */
+    template <typename Handler, typename Clock, typename Duration>
+    TimerHandle postAt(const std::chrono::time_point<Clock, Duration>& time,
+                       Handler&& handler);
+
+    /**
+     * @brief postEvery Post job to be executed every period, starting one
+     * period from now. Periods missed by a busy worker are skipped.
+     * @param period Period of repeating.
+     * @param handler Handler to be called from thread pool worker. It has
+     * to be callable as 'handler()' repeatedly.
+     * @return Handle to cancel the timer.
+     * @throw std::bad_alloc if memory is exhausted.
+     */
+    template <typename Handler, typename Rep, typename Period>
+    TimerHandle postEvery(const std::chrono::duration<Rep, Period>& period,
+                          Handler&& handler);
+
+    /**
+     * @brief threadCount Return number of active worker threads.
+     */
+    size_t threadCount() const;
+
+    /**
+     * @brief resize Change number of active worker threads. Growing
+     * restarts retired workers, shrinking retires the last ones: they
+     * execute tasks left in their queues and exit, tasks posted to them
+     * meanwhile are stolen by active workers. Does nothing after shutdown.
+     * @param count New number of threads, clamped to the range from 1 to
+     * ThreadPoolOptions::maxThreadCount().
+     * @throw std::logic_error if called from a worker thread of the pool,
+     * or if the pool is shrunk while Queue is single-consumer: tasks left
+     * in a retired queue couldn't be stolen.
+     */
+    void resize(size_t count);
+
+    /**
+     * @brief stats Return snapshot of runtime statistics. Workers are not
+     * stopped, so counters of different workers are taken at slightly
+     * different moments.
+     * @return Per-worker and aggregated counters. All zeroes unless Stats
+     * policy collects them.
+     */
+    ThreadPoolStatistics stats() const;
+
+    /**
+     * @brief pendingTasks Return number of tasks posted and not completed
+     * yet, including the running ones. Sums per-worker counters, so the
+     * result is approximate while tasks are being posted.
+     */
+    size_t pendingTasks() const;
+
+    /**
+     * @brief waitIdle Block until all posted tasks, including the ones
+     * posted by tasks, are completed. Calling thread yields for a while,
+     * then it is parked and woken up by workers going idle.
+     * @throw std::logic_error if called from a worker thread of the pool.
+     * @note Tasks posted concurrently by other threads may be waited for
+     * or not. Returns at once if the pool is shut down, since tasks posted
+     * after shutdown are never executed.
+     */
+    void waitIdle();
+
+    /**
+     * @brief waitIdleFor Block until all posted tasks are completed, but
+     * no longer than timeout.
+     * @param timeout Maximum time to wait.
+     * @return true if the pool became idle before timeout. If the pool is
+     * shut down, whether it is idle now.
+     * @throw std::logic_error if called from a worker thread of the pool.
+     */
+    template <typename Rep, typename Period>
+    bool waitIdleFor(const std::chrono::duration<Rep, Period>& timeout);
+
+    /**
+     * @brief shutdown Stop all workers. Running tasks are finished anyway.
+     * Calling it again only drops tasks posted after the first call.
+     * @param policy Whether pending tasks are executed or dropped.
+     * @throw std::logic_error if called from a worker thread of the pool.
+     * @note Tasks posted after shutdown are never executed.
+     */
+    void shutdown(DrainPolicy policy = DrainPolicy::Drain);
+
+    /**
+     * @brief shutdownFor Execute pending tasks, but no longer than timeout,
+     * then drop the rest and stop all workers.
+     * @param timeout Maximum time to drain the tasks.
+     * @return true if all tasks were executed.
+     * @throw std::logic_error if called from a worker thread of the pool.
+     */
+    template <typename Rep, typename Period>
+    bool shutdownFor(const std::chrono::duration<Rep, Period>& timeout);
 
 private:
-    Worker<Task, Queue>& getWorker();
+    size_t getWorkerId();
+
+    /**
+     * @brief getPinnedWorkerId Return ID of the worker to spill a task or
+     * add a timer to: the current worker, or the next active one in turn.
+     * Must be called once the post is announced in m_pinned_posts.
+     */
+    size_t getPinnedWorkerId();
+
+    /**
+     * @brief postTimer Add timer to the wheel of the worker chosen by
+     * getPinnedWorkerId().
+     * @return Handle to cancel the timer.
+     */
+    template <typename Handler>
+    TimerHandle postTimer(std::chrono::steady_clock::time_point deadline,
+                          std::chrono::steady_clock::duration period,
+                          Handler&& handler);
+
+    /**
+     * @brief isWorkerThread Return true if current thread is a worker
+     * thread of this pool.
+     */
+    bool isWorkerThread() const;
+
+    /**
+     * @brief isStopped Return true if the pool is shut down.
+     */
+    bool isStopped();
 
-    std::vector<std::unique_ptr<Worker<Task, Queue>>> m_workers;
+    /**
+     * @brief isIdle Return true if all posted tasks are completed.
+     */
+    bool isIdle() const;
+
+    /**
+     * @brief waitIdleUntil Block until all posted tasks are completed or
+     * deadline passes.
+     * @return true if the pool became idle.
+     */
+    bool waitIdleUntil(std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * @brief postSelected Post job to the worker chosen among active ones
+     * by 'select(count)'.
+     */
+    template <typename Select, typename Handler>
+    void postSelected(Select select, Handler&& handler, size_t priority);
+
+    /**
+     * @brief postToQueues Post task already wrapped by Stats policy to the
+     * worker with specified ID or any other one with a free slot.
+     * @return true on success.
+     */
+    template <typename WrappedTask>
+    bool postToQueues(WrappedTask&& task, size_t priority, size_t id);
+
+    /**
+     * @brief postTask Post task already wrapped by Stats policy to queues
+     * starting with the worker with specified ID, then spill it if allowed.
+     * @return true on success.
+     */
+    template <typename WrappedTask>
+    bool postTask(WrappedTask&& task, size_t priority, size_t id);
+
+    /**
+     * @brief waitUntil Call try_post until it succeeds or deadline passes.
+     * Worker threads run pending tasks in between, since the slot they wait
+     * for may be freed by their own queue only. Other threads are parked.
+     * @return Last result of try_post.
+     */
+    template <typename TryPost>
+    bool waitUntil(TryPost try_post,
+                   std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * @brief wakeupWorker Wake up one parked worker able to execute a task
+     * just posted to the worker with specified ID.
+     * @param id ID of the worker task was posted to.
+     */
+    void wakeupWorker(size_t id);
+
+    /**
+     * @brief scale Resize the pool every interval according to load until
+     * stopScaling() is called. Grows by one thread while no worker is
+     * parked and tasks are queued, shrinks by one thread after
+     * SCALE_DOWN_INTERVALS intervals with parked workers. Pools of
+     * single-consumer queues only grow.
+     */
+    void scale(std::chrono::milliseconds interval, size_t min_count);
+
+    /**
+     * @brief stopScaling Stop auto-scaling thread if it is running.
+     */
+    void stopScaling();
+
+    enum { SCALE_DOWN_INTERVALS = 8 };
+
+    // Declared before workers to outlive tasks left in their queues.
+    std::unique_ptr<detail::FutureContext> m_future_context;
+    std::vector<std::unique_ptr<Worker<Task, Queue, Stats>>> m_workers;
+    std::atomic<size_t> m_active_count;
     std::atomic<size_t> m_next_worker;
+    std::atomic<size_t> m_parked_count;
+    std::atomic<size_t> m_pinned_posts;
+    OverflowPolicy m_overflow_policy;
+    bool m_steal_keyed_tasks;
+    detail::Backpressure m_backpressure;
+    detail::Backpressure m_idle_waiters;
+    std::mutex m_resize_mutex;
+    bool m_stopped;
+    std::mutex m_scaling_mutex;
+    std::condition_variable m_scaling_cv;
+    bool m_scaling_stopped;
+    std::chrono::milliseconds m_scaling_interval;
+    size_t m_min_thread_count;
+    std::thread m_scaling_thread;
 };
 
 
 /// Implementation
 
-template <typename Task, template<typename> class Queue>
-inline ThreadPoolImpl<Task, Queue>::ThreadPoolImpl(
+template <typename Task, template<typename> class Queue, typename Stats>
+inline ThreadPoolImpl<Task, Queue, Stats>::ThreadPoolImpl(
                                             const ThreadPoolOptions& options)
-    : m_workers(options.threadCount())
+    : m_future_context(new detail::FutureContext(options.spinCount(),
+                                                 options.yieldCount()))
+    , m_workers(options.maxThreadCount())
+    , m_active_count(options.threadCount())
     , m_next_worker(0)
+    , m_parked_count(0)
+    , m_pinned_posts(0)
+    , m_overflow_policy(options.overflowPolicy())
+    , m_steal_keyed_tasks(options.stealKeyedTasks())
+    , m_backpressure(options.queueSize() / 4)
+    , m_idle_waiters(1)
+    , m_stopped(false)
+    , m_scaling_stopped(false)
+    , m_scaling_interval(options.scalingInterval())
+    , m_min_thread_count(options.minThreadCount())
 {
     for(auto& worker_ptr : m_workers)
     {
-        worker_ptr.reset(new Worker<Task, Queue>(options.queueSize()));
+        worker_ptr.reset(new Worker<Task, Queue, Stats>(options));
     }
 
+    // Unpinned workers don't need the topology read from sysfs.
+    const bool pinned = options.affinity() != AffinityPolicy::None &&
+                        (options.affinity() != AffinityPolicy::Explicit ||
+                         !options.cpuList().empty());
+    const std::vector<WorkerPlacement> placements =
+        (pinned ? Topology::detect() : Topology(std::vector<CpuInfo>()))
+            .placeWorkers(options);
+
     for(size_t i = 0; i < m_workers.size(); ++i)
     {
-        Worker<Task, Queue>* steal_donor =
-                                m_workers[(i + 1) % m_workers.size()].get();
-        m_workers[i]->start(i, steal_donor);
+        m_workers[i]->attach(i, &m_workers, &m_active_count, placements,
+                             &m_parked_count, &m_backpressure,
+                             &m_idle_waiters);
+    }
+
+    std::promise<void> go;
+    std::shared_future<void> go_future = go.get_future().share();
+    for(size_t i = 0; i < options.threadCount(); ++i)
+    {
+        m_workers[i]->start(go_future);
+    }
+    go.set_value();
+
+    if (m_scaling_interval.count() > 0 &&
+        m_workers.size() > m_min_thread_count)
+    {
+        m_scaling_thread = std::thread(&ThreadPoolImpl::scale, this,
+                                       m_scaling_interval,
+                                       m_min_thread_count);
     }
 }
 
-template <typename Task, template<typename> class Queue>
-inline ThreadPoolImpl<Task, Queue>::ThreadPoolImpl(ThreadPoolImpl<Task, Queue>&& rhs) noexcept
+template <typename Task, template<typename> class Queue, typename Stats>
+inline ThreadPoolImpl<Task, Queue, Stats>::ThreadPoolImpl(ThreadPoolImpl<Task, Queue, Stats>&& rhs) noexcept
+    : m_active_count(0)
+    , m_next_worker(0)
+    , m_parked_count(0)
+    , m_pinned_posts(0)
+    , m_overflow_policy(OverflowPolicy::Reject)
+    , m_steal_keyed_tasks(true)
+    , m_backpressure(1)
+    , m_idle_waiters(1)
+    , m_stopped(true)
+    , m_scaling_stopped(false)
+    , m_scaling_interval(0)
+    , m_min_thread_count(1)
 {
-    *this = rhs;
+    *this = std::move(rhs);
 }
 
-template <typename Task, template<typename> class Queue>
-inline ThreadPoolImpl<Task, Queue>::~ThreadPoolImpl()
+template <typename Task, template<typename> class Queue, typename Stats>
+inline ThreadPoolImpl<Task, Queue, Stats>::~ThreadPoolImpl()
 {
+    shutdown(DrainPolicy::Drop);
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline ThreadPoolImpl<Task, Queue, Stats>&
+ThreadPoolImpl<Task, Queue, Stats>::operator=(ThreadPoolImpl<Task, Queue, Stats>&& rhs) noexcept
+{
+    if (this == &rhs)
+    {
+        return *this;
+    }
+
+    shutdown(DrainPolicy::Drop);
+
+    rhs.stopScaling();
+    {
+        std::lock_guard<std::mutex> lock(rhs.m_resize_mutex);
+        for (auto& worker_ptr : rhs.m_workers)
+        {
+            worker_ptr->stop();
+        }
+    }
+
+    // Workers are stopped, so none is parked and no post is in flight.
+    m_future_context = std::move(rhs.m_future_context);
+    m_workers = std::move(rhs.m_workers);
+    m_active_count = rhs.m_active_count.load();
+    m_next_worker = rhs.m_next_worker.load();
+    m_parked_count = 0;
+    m_pinned_posts = 0;
+    m_overflow_policy = rhs.m_overflow_policy;
+    m_steal_keyed_tasks = rhs.m_steal_keyed_tasks;
+    m_backpressure.setBatch(rhs.m_backpressure.batch());
+    m_stopped = rhs.m_stopped;
+    m_scaling_stopped = false;
+    m_scaling_interval = rhs.m_scaling_interval;
+    m_min_thread_count = rhs.m_min_thread_count;
+
+    rhs.m_workers.clear();
+    rhs.m_active_count = 0;
+    rhs.m_stopped = true;
+
     for (auto& worker_ptr : m_workers)
     {
-        worker_ptr->stop();
+        worker_ptr->rebind(&m_workers, &m_active_count, &m_parked_count,
+                           &m_backpressure, &m_idle_waiters);
     }
-}
 
-template <typename Task, template<typename> class Queue>
-inline ThreadPoolImpl<Task, Queue>&
-ThreadPoolImpl<Task, Queue>::operator=(ThreadPoolImpl<Task, Queue>&& rhs) noexcept
-{
-    if (this != &rhs)
+    if (m_stopped)
+    {
+        return *this;
+    }
+
+    std::promise<void> go;
+    std::shared_future<void> go_future = go.get_future().share();
+    for (size_t i = 0; i < m_active_count.load(); ++i)
+    {
+        m_workers[i]->start(go_future);
+    }
+    go.set_value();
+
+    if (m_scaling_interval.count() > 0 &&
+        m_workers.size() > m_min_thread_count)
     {
-        m_workers = std::move(rhs.m_workers);
-        m_next_worker = rhs.m_next_worker.load();
+        m_scaling_thread = std::thread(&ThreadPoolImpl::scale, this,
+                                       m_scaling_interval,
+                                       m_min_thread_count);
     }
+
     return *this;
 }
 
-template <typename Task, template<typename> class Queue>
+template <typename Task, template<typename> class Queue, typename Stats>
 template <typename Handler>
-inline bool ThreadPoolImpl<Task, Queue>::tryPost(Handler&& handler)
+inline bool ThreadPoolImpl<Task, Queue, Stats>::tryPost(Handler&& handler,
+                                                       size_t priority)
 {
-    return getWorker().post(std::forward<Handler>(handler));
+    // Stats policy may wrap handler to measure its latency.
+    return postTask(Stats::wrap(std::forward<Handler>(handler)), priority,
+                    getWorkerId());
 }
 
-template <typename Task, template<typename> class Queue>
+template <typename Task, template<typename> class Queue, typename Stats>
 template <typename Handler>
-inline void ThreadPoolImpl<Task, Queue>::post(Handler&& handler)
+inline void ThreadPoolImpl<Task, Queue, Stats>::post(Handler&& handler,
+                                                    size_t priority)
 {
-    const auto ok = tryPost(std::forward<Handler>(handler));
+    if (m_overflow_policy == OverflowPolicy::Block)
+    {
+        postWait(std::forward<Handler>(handler), priority);
+        return;
+    }
+
+    const auto ok = tryPost(std::forward<Handler>(handler), priority);
     if (!ok)
     {
         throw std::runtime_error("thread pool queue is full");
     }
 }
 
-template <typename Task, template<typename> class Queue>
-inline Worker<Task, Queue>& ThreadPoolImpl<Task, Queue>::getWorker()
+template <typename Task, template<typename> class Queue, typename Stats>
+template <typename Handler>
+inline void ThreadPoolImpl<Task, Queue, Stats>::postTo(size_t id,
+                                                      Handler&& handler,
+                                                      size_t priority)
+{
+    if (id >= threadCount())
+    {
+        throw std::out_of_range("thread pool worker doesn't exist");
+    }
+
+    postSelected([id](size_t count)
+        {
+            return id % count;
+        },
+        std::forward<Handler>(handler), priority);
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+template <typename Key, typename Handler>
+inline void ThreadPoolImpl<Task, Queue, Stats>::postKeyed(const Key& key,
+                                                         Handler&& handler,
+                                                         size_t priority)
+{
+    const uint64_t hash = std::hash<Key>()(key);
+    postSelected([hash](size_t count)
+        {
+            return detail::jump_consistent_hash(hash, count);
+        },
+        std::forward<Handler>(handler), priority);
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+template <typename Handler>
+inline void ThreadPoolImpl<Task, Queue, Stats>::postWait(Handler&& handler,
+                                                        size_t priority)
+{
+    auto&& task = Stats::wrap(std::forward<Handler>(handler));
+    waitUntil([&]()
+        {
+            return postToQueues(std::forward<decltype(task)>(task),
+                                priority, getWorkerId());
+        },
+        std::chrono::steady_clock::time_point::max());
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+template <typename Handler, typename Rep, typename Period>
+inline bool ThreadPoolImpl<Task, Queue, Stats>::postWaitFor(
+    Handler&& handler, const std::chrono::duration<Rep, Period>& timeout,
+    size_t priority)
 {
-    auto id = Worker<Task, Queue>::getWorkerIdForCurrentThread();
+    const auto deadline = std::chrono::steady_clock::now() +
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            timeout);
 
-    if (id > m_workers.size())
+    auto&& task = Stats::wrap(std::forward<Handler>(handler));
+    return waitUntil([&]()
+        {
+            return postToQueues(std::forward<decltype(task)>(task),
+                                priority, getWorkerId());
+        },
+        deadline);
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+template <typename Iterator>
+inline size_t ThreadPoolImpl<Task, Queue, Stats>::tryPostBatch(Iterator first,
+                                                               Iterator last)
+{
+    size_t remaining = std::distance(first, last);
+    size_t posted = 0;
+
+    const size_t start = getWorkerId();
+    const size_t count = m_active_count.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < count && remaining != 0; ++i)
+    {
+        const size_t id = (start + i) % count;
+
+        // Spread what is left evenly over not yet visited workers.
+        const size_t workers_left = count - i;
+        const size_t chunk = (remaining + workers_left - 1) / workers_left;
+        Iterator chunk_last = first;
+        std::advance(chunk_last, chunk);
+
+        m_workers[id]->countPosted(chunk);
+        const size_t pushed = m_workers[id]->postBatch(
+            detail::wrap_iterator<Stats>(first),
+            detail::wrap_iterator<Stats>(chunk_last));
+        if (pushed != chunk)
+        {
+            m_workers[id]->discountPosted(chunk - pushed);
+        }
+
+        if (pushed != 0)
+        {
+            std::advance(first, pushed);
+            remaining -= pushed;
+            posted += pushed;
+            wakeupWorker(id);
+        }
+    }
+
+    if (remaining != 0 && m_overflow_policy == OverflowPolicy::Spill)
+    {
+        m_pinned_posts.fetch_add(1, std::memory_order_seq_cst);
+        const size_t id = getPinnedWorkerId();
+        m_workers[id]->countPosted(remaining);
+        try
+        {
+            auto it = detail::wrap_iterator<Stats>(first);
+            for (; remaining != 0; --remaining, ++it)
+            {
+                m_workers[id]->spill(*it);
+                ++posted;
+            }
+        }
+        catch(...)
+        {
+            m_pinned_posts.fetch_sub(1, std::memory_order_release);
+            m_workers[id]->discountPosted(remaining);
+            wakeupWorker(id);
+            throw;
+        }
+        m_pinned_posts.fetch_sub(1, std::memory_order_release);
+        wakeupWorker(id);
+    }
+
+    return posted;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+template <typename Iterator>
+inline void ThreadPoolImpl<Task, Queue, Stats>::postBatch(Iterator first,
+                                                   Iterator last)
+{
+    std::advance(first, tryPostBatch(first, last));
+    if (first == last)
+    {
+        return;
+    }
+
+    if (m_overflow_policy != OverflowPolicy::Block)
+    {
+        throw std::runtime_error("thread pool queue is full");
+    }
+
+    waitUntil([&]()
+        {
+            std::advance(first, tryPostBatch(first, last));
+            return first == last;
+        },
+        std::chrono::steady_clock::time_point::max());
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+template <typename Handler, typename... Args>
+inline Future<typename detail::SubmitResult<Handler, Args...>::type>
+ThreadPoolImpl<Task, Queue, Stats>::submit(Handler&& handler, Args&&... args)
+{
+    typedef typename detail::SubmitResult<Handler, Args...>::type R;
+
+    detail::FutureState<R>* state =
+        detail::FutureState<R>::create(m_future_context.get());
+    Future<R> future(state);
+
+    post(detail::SubmitTask<R, typename std::decay<Handler>::type,
+                            typename std::decay<Args>::type...>(
+        state, std::forward<Handler>(handler), std::forward<Args>(args)...));
+
+    return future;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+template <typename Handler, typename Rep, typename Period>
+inline TimerHandle ThreadPoolImpl<Task, Queue, Stats>::postAfter(
+    const std::chrono::duration<Rep, Period>& delay, Handler&& handler)
+{
+    return postTimer(std::chrono::steady_clock::now() +
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            delay),
+        std::chrono::steady_clock::duration::zero(),
+        std::forward<Handler>(handler));
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+template <typename Handler, typename Clock, typename Duration>
+inline TimerHandle ThreadPoolImpl<Task, Queue, Stats>::postAt(
+    const std::chrono::time_point<Clock, Duration>& time, Handler&& handler)
+{
+    return postAfter(time - Clock::now(), std::forward<Handler>(handler));
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+template <typename Handler, typename Rep, typename Period>
+inline TimerHandle ThreadPoolImpl<Task, Queue, Stats>::postEvery(
+    const std::chrono::duration<Rep, Period>& period, Handler&& handler)
+{
+    const auto steady_period = std::max(
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            period),
+        std::chrono::steady_clock::duration(1));
+    return postTimer(std::chrono::steady_clock::now() + steady_period,
+                     steady_period, std::forward<Handler>(handler));
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline size_t ThreadPoolImpl<Task, Queue, Stats>::threadCount() const
+{
+    return m_active_count.load(std::memory_order_relaxed);
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline void ThreadPoolImpl<Task, Queue, Stats>::resize(size_t count)
+{
+    if (isWorkerThread())
+    {
+        throw std::logic_error("thread pool resize from its worker");
+    }
+
+    count = std::min(std::max<size_t>(1u, count), m_workers.size());
+
+    std::lock_guard<std::mutex> lock(m_resize_mutex);
+    const size_t active = m_active_count.load(std::memory_order_relaxed);
+    if (m_stopped || count == active)
+    {
+        return;
+    }
+
+    if (count > active)
+    {
+        std::promise<void> go;
+        std::shared_future<void> go_future = go.get_future().share();
+        for (size_t i = active; i < count; ++i)
+        {
+            m_workers[i]->start(go_future);
+        }
+        go.set_value();
+
+        // Posters are let in once the threads run. Tasks left in the
+        // queues since the retirement are executed by their owners again.
+        m_active_count.store(count, std::memory_order_release);
+        return;
+    }
+
+    if (detail::single_consumer<Queue<Task>>())
+    {
+        throw std::logic_error("thread pool of single-consumer queues "
+                               "can't shrink");
+    }
+
+    // Posters which read the previous count may still push to retired
+    // queues. Such tasks are stolen, so active workers are woken up.
+    m_active_count.store(count, std::memory_order_seq_cst);
+    for (size_t i = count; i < active; ++i)
+    {
+        m_workers[i]->retire();
+        wakeupWorker(i);
+    }
+
+    // Spills and timers which could have chosen a retired worker are
+    // posted now, they are handed over to the active ones.
+    while (m_pinned_posts.load(std::memory_order_acquire) != 0)
+    {
+        std::this_thread::yield();
+    }
+    for (size_t i = count; i < active; ++i)
+    {
+        m_workers[i]->handOverOverflow(*m_workers[i % count]);
+        m_workers[i]->handOverTimers(*m_workers[i % count]);
+        wakeupWorker(i % count);
+    }
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline ThreadPoolStatistics ThreadPoolImpl<Task, Queue, Stats>::stats() const
+{
+    ThreadPoolStatistics result;
+    result.workers.resize(m_workers.size());
+
+    for (size_t i = 0; i < m_workers.size(); ++i)
+    {
+        m_workers[i]->stats().snapshot(result.workers[i]);
+        result.total += result.workers[i];
+    }
+
+    return result;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline size_t ThreadPoolImpl<Task, Queue, Stats>::pendingTasks() const
+{
+    // Completed counters are read first, see isIdle().
+    size_t completed = 0;
+    for (const auto& worker_ptr : m_workers)
+    {
+        completed += worker_ptr->completedCount();
+    }
+
+    size_t posted = 0;
+    for (const auto& worker_ptr : m_workers)
+    {
+        posted += worker_ptr->postedCount();
+    }
+
+    return posted - completed;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline void ThreadPoolImpl<Task, Queue, Stats>::waitIdle()
+{
+    waitIdleUntil(std::chrono::steady_clock::time_point::max());
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+template <typename Rep, typename Period>
+inline bool ThreadPoolImpl<Task, Queue, Stats>::waitIdleFor(
+    const std::chrono::duration<Rep, Period>& timeout)
+{
+    return waitIdleUntil(std::chrono::steady_clock::now() +
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            timeout));
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline void ThreadPoolImpl<Task, Queue, Stats>::shutdown(DrainPolicy policy)
+{
+    if (isWorkerThread())
+    {
+        throw std::logic_error("thread pool shutdown from its worker");
+    }
+
+    stopScaling();
+
+    if (policy == DrainPolicy::Drain)
+    {
+        waitIdle();
+    }
+
+    std::lock_guard<std::mutex> lock(m_resize_mutex);
+    m_stopped = true;
+    for (auto& worker_ptr : m_workers)
+    {
+        worker_ptr->stop();
+    }
+
+    // Running tasks may post to any worker until all of them are stopped.
+    for (auto& worker_ptr : m_workers)
+    {
+        worker_ptr->dropPending();
+    }
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+template <typename Rep, typename Period>
+inline bool ThreadPoolImpl<Task, Queue, Stats>::shutdownFor(
+    const std::chrono::duration<Rep, Period>& timeout)
+{
+    const bool drained = waitIdleFor(timeout);
+    shutdown(DrainPolicy::Drop);
+    return drained;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline bool ThreadPoolImpl<Task, Queue, Stats>::isWorkerThread() const
+{
+    const size_t id = Worker<Task, Queue, Stats>::getWorkerIdForCurrentThread();
+    return id < m_workers.size() &&
+           m_workers[id].get() == *detail::thread_worker();
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline bool ThreadPoolImpl<Task, Queue, Stats>::isStopped()
+{
+    std::lock_guard<std::mutex> lock(m_resize_mutex);
+    return m_stopped;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline bool ThreadPoolImpl<Task, Queue, Stats>::isIdle() const
+{
+    // A task is counted as posted before a worker can complete it. So if
+    // the sum of completed counters read first is equal to the sum of
+    // posted ones read after, nothing was pending in between.
+    return pendingTasks() == 0;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline bool ThreadPoolImpl<Task, Queue, Stats>::waitIdleUntil(
+    std::chrono::steady_clock::time_point deadline)
+{
+    if (isWorkerThread())
+    {
+        throw std::logic_error("thread pool is waited for by its worker");
+    }
+
+    // Nothing completes tasks posted after shutdown.
+    if (isStopped())
+    {
+        return isIdle();
+    }
+
+    // The last task is likely to complete soon, so poll for a while before
+    // parking. Spinning is skipped to leave the CPU to workers.
+    IdleStrategy idle_strategy(0, m_future_context->yield_count);
+    while (!isIdle())
+    {
+        if (std::chrono::steady_clock::now() >= deadline)
+        {
+            return false;
+        }
+
+        if (!idle_strategy.idle())
+        {
+            break;
+        }
+    }
+
+    // Workers notify idle waiters before parking, the last one to go idle
+    // wakes the thread up.
+    return m_idle_waiters.waitUntil([this]()
+        {
+            return isIdle();
+        },
+        deadline);
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline size_t ThreadPoolImpl<Task, Queue, Stats>::getWorkerId()
+{
+    auto id = Worker<Task, Queue, Stats>::getWorkerIdForCurrentThread();
+
+    if (id >= m_workers.size())
     {
         id = m_next_worker.fetch_add(1, std::memory_order_relaxed) %
-             m_workers.size();
+             m_active_count.load(std::memory_order_relaxed);
+    }
+
+    return id;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline size_t ThreadPoolImpl<Task, Queue, Stats>::getPinnedWorkerId()
+{
+    // A running worker pops its overflow queues until it exits, even if it
+    // is being retired.
+    if (isWorkerThread())
+    {
+        return Worker<Task, Queue, Stats>::getWorkerIdForCurrentThread();
+    }
+
+    // Overflow queues and timer wheels can't be stolen from. The count is
+    // read after the post is announced, so resize() either sees the post in
+    // flight or this thread sees the retirement.
+    return m_next_worker.fetch_add(1, std::memory_order_relaxed) %
+           m_active_count.load(std::memory_order_seq_cst);
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+template <typename Handler>
+inline TimerHandle ThreadPoolImpl<Task, Queue, Stats>::postTimer(
+    std::chrono::steady_clock::time_point deadline,
+    std::chrono::steady_clock::duration period, Handler&& handler)
+{
+    detail::TimerTask<Task>* timer = detail::TimerTask<Task>::create(
+        std::forward<Handler>(handler), deadline, period);
+    TimerHandle handle(timer);
+
+    m_pinned_posts.fetch_add(1, std::memory_order_seq_cst);
+    m_workers[getPinnedWorkerId()]->postTimer(timer);
+    m_pinned_posts.fetch_sub(1, std::memory_order_release);
+
+    return handle;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+template <typename Select, typename Handler>
+inline void ThreadPoolImpl<Task, Queue, Stats>::postSelected(
+    Select select, Handler&& handler, size_t priority)
+{
+    auto&& task = Stats::wrap(std::forward<Handler>(handler));
+
+    if (!m_steal_keyed_tasks)
+    {
+        // Pinned like spilled tasks, see getPinnedWorkerId().
+        m_pinned_posts.fetch_add(1, std::memory_order_seq_cst);
+        const size_t id =
+            select(m_active_count.load(std::memory_order_seq_cst));
+        m_workers[id]->countPosted(1);
+        try
+        {
+            m_workers[id]->pin(std::forward<decltype(task)>(task), priority);
+        }
+        catch(...)
+        {
+            m_pinned_posts.fetch_sub(1, std::memory_order_release);
+            m_workers[id]->discountPosted(1);
+            throw;
+        }
+        m_pinned_posts.fetch_sub(1, std::memory_order_release);
+        wakeupWorker(id);
+        return;
+    }
+
+    const size_t id = select(m_active_count.load(std::memory_order_relaxed));
+    if (m_overflow_policy == OverflowPolicy::Block)
+    {
+        waitUntil([&]()
+            {
+                return postToQueues(std::forward<decltype(task)>(task),
+                                    priority, id);
+            },
+            std::chrono::steady_clock::time_point::max());
+        return;
+    }
+
+    if (!postTask(std::forward<decltype(task)>(task), priority, id))
+    {
+        throw std::runtime_error("thread pool queue is full");
+    }
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+template <typename WrappedTask>
+inline bool ThreadPoolImpl<Task, Queue, Stats>::postToQueues(
+    WrappedTask&& task, size_t priority, size_t id)
+{
+    // Counted before the task becomes visible to workers, so completed
+    // tasks never outnumber posted ones. The counter is sharded by worker.
+    m_workers[id]->countPosted(1);
+
+    // Failed post leaves the task untouched, so it can be offered to the
+    // next worker.
+    const size_t count = m_active_count.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const size_t target = (id + i) % count;
+        if (m_workers[target]->post(std::forward<WrappedTask>(task),
+                                    priority))
+        {
+            wakeupWorker(target);
+            return true;
+        }
+    }
+
+    m_workers[id]->discountPosted(1);
+    return false;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+template <typename WrappedTask>
+inline bool ThreadPoolImpl<Task, Queue, Stats>::postTask(WrappedTask&& task,
+                                                        size_t priority,
+                                                        size_t id)
+{
+    if (postToQueues(std::forward<WrappedTask>(task), priority, id))
+    {
+        return true;
     }
 
-    return *m_workers[id];
+    if (m_overflow_policy != OverflowPolicy::Spill)
+    {
+        return false;
+    }
+
+    m_pinned_posts.fetch_add(1, std::memory_order_seq_cst);
+    const size_t pinned_id = getPinnedWorkerId();
+    m_workers[pinned_id]->countPosted(1);
+    try
+    {
+        m_workers[pinned_id]->spill(std::forward<WrappedTask>(task), priority);
+    }
+    catch(...)
+    {
+        m_pinned_posts.fetch_sub(1, std::memory_order_release);
+        m_workers[pinned_id]->discountPosted(1);
+        throw;
+    }
+    m_pinned_posts.fetch_sub(1, std::memory_order_release);
+    wakeupWorker(pinned_id);
+    return true;
 }
+
+template <typename Task, template<typename> class Queue, typename Stats>
+template <typename TryPost>
+inline bool ThreadPoolImpl<Task, Queue, Stats>::waitUntil(
+    TryPost try_post, std::chrono::steady_clock::time_point deadline)
+{
+    if (try_post())
+    {
+        return true;
+    }
+
+    if (*detail::thread_worker() == nullptr)
+    {
+        return m_backpressure.waitUntil(try_post, deadline);
+    }
+
+    while (!try_post())
+    {
+        if (std::chrono::steady_clock::now() >= deadline)
+        {
+            return false;
+        }
+
+        if (!detail::run_pending_task())
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    return true;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline void ThreadPoolImpl<Task, Queue, Stats>::wakeupWorker(size_t id)
+{
+    // Pairs with the fence in Worker::park.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (m_parked_count.load(std::memory_order_relaxed) == 0)
+    {
+        return;
+    }
+
+    // Prefer the owner of the task, otherwise any parked sibling will
+    // steal it.
+    if (m_workers[id]->wakeup())
+    {
+        return;
+    }
+
+    // Workers beyond the active count are never parked. The owner may be
+    // a retired one, then every active worker is probed.
+    const size_t count = m_active_count.load(std::memory_order_relaxed);
+    for (size_t i = 1; i <= count; ++i)
+    {
+        const size_t sibling = (id + i) % count;
+        if (sibling != id && m_workers[sibling]->wakeup())
+        {
+            return;
+        }
+    }
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline void ThreadPoolImpl<Task, Queue, Stats>::scale(
+    std::chrono::milliseconds interval, size_t min_count)
+{
+    size_t idle_intervals = 0;
+
+    std::unique_lock<std::mutex> lock(m_scaling_mutex);
+    while (!m_scaling_cv.wait_for(lock, interval, [this]()
+        {
+            return m_scaling_stopped;
+        }))
+    {
+        lock.unlock();
+
+        const size_t count = threadCount();
+        if (m_parked_count.load(std::memory_order_relaxed) != 0)
+        {
+            // Shrink slowly: a short lull is cheaper to wait out than to
+            // pay for restarting the threads.
+            if (++idle_intervals >= SCALE_DOWN_INTERVALS &&
+                count > min_count &&
+                !detail::single_consumer<Queue<Task>>())
+            {
+                idle_intervals = 0;
+                resize(count - 1);
+            }
+        }
+        else
+        {
+            idle_intervals = 0;
+            if (pendingTasks() > count)
+            {
+                resize(count + 1);
+            }
+        }
+
+        lock.lock();
+    }
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline void ThreadPoolImpl<Task, Queue, Stats>::stopScaling()
+{
+    if (!m_scaling_thread.joinable())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_scaling_mutex);
+        m_scaling_stopped = true;
+    }
+    m_scaling_cv.notify_one();
+    m_scaling_thread.join();
+}
+
 }
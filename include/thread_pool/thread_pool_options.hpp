@@ -1,11 +1,47 @@
 #pragma once
 
 #include <algorithm>
+#include <chrono>
 #include <thread>
+#include <utility>
+#include <vector>
 
 namespace tp
 {
 
+/**
+ * @brief The AffinityPolicy enum defines how worker threads are pinned to
+ * CPUs. Only CPUs the process is allowed to run on are used.
+ */
+enum class AffinityPolicy
+{
+    /// Threads are not pinned, the OS migrates them freely.
+    None,
+    /// Workers fill hardware threads of one core, package and node after
+    /// another.
+    Compact,
+    /// Workers are spread over NUMA nodes round-robin.
+    Scatter,
+    /// One worker per physical core, hyper-threading siblings are skipped.
+    PhysicalCores,
+    /// Workers are pinned to CPUs from the explicit list.
+    Explicit
+};
+
+/**
+ * @brief The OverflowPolicy enum defines what happens to a task posted when
+ * queues of all workers are full.
+ */
+enum class OverflowPolicy
+{
+    /// tryPost() returns false, post() throws std::runtime_error.
+    Reject,
+    /// Task is spilled to unbounded overflow queue of the worker.
+    Spill,
+    /// tryPost() returns false, post() waits until a queue has room.
+    Block
+};
+
 /**
  * @brief The ThreadPoolOptions class provides creation options for
  * ThreadPool.
@@ -24,32 +60,240 @@ public:
      */
     void setThreadCount(size_t count);
 
+    /**
+     * @brief setMaxThreadCount Set maximum number of threads the pool can
+     * be resized to. Worker slots are allocated for all of them upfront.
+     * @param count Maximum number of threads, the initial thread count at
+     * least.
+     */
+    void setMaxThreadCount(size_t count);
+
+    /**
+     * @brief setMinThreadCount Set minimum number of threads auto-scaling
+     * can shrink the pool to.
+     * @param count Minimum number of threads, the initial thread count at
+     * most.
+     */
+    void setMinThreadCount(size_t count);
+
+    /**
+     * @brief setScalingInterval Set period of sampling queue depth and
+     * parked workers to resize the pool between minThreadCount() and
+     * maxThreadCount(). Zero disables auto-scaling.
+     * @param interval Sampling period.
+     */
+    void setScalingInterval(std::chrono::milliseconds interval);
+
     /**
      * @brief setQueueSize Set single worker queue size.
      * @param count Maximum length of queue of single worker.
      */
     void setQueueSize(size_t size);
 
+    /**
+     * @brief setSpinCount Set number of busy spinning steps an idle worker
+     * performs before it starts yielding.
+     * @param count Number of spinning steps.
+     */
+    void setSpinCount(size_t count);
+
+    /**
+     * @brief setYieldCount Set number of yielding steps an idle worker
+     * performs before it parks.
+     * @param count Number of yielding steps.
+     */
+    void setYieldCount(size_t count);
+
+    /**
+     * @brief setStealAttempts Set number of sibling workers an idle worker
+     * probes for a task to steal on each idle step.
+     * @param count Number of probed workers.
+     */
+    void setStealAttempts(size_t count);
+
+    /**
+     * @brief setStealBatchSize Set maximum number of tasks taken from a
+     * sibling worker by one steal.
+     * @param size Maximum number of stolen tasks.
+     */
+    void setStealBatchSize(size_t size);
+
+    /**
+     * @brief setPriorityLevels Set number of task priority levels. Every
+     * worker has a separate queue of queueSize() length for each level.
+     * @param count Number of priority levels.
+     */
+    void setPriorityLevels(size_t count);
+
+    /**
+     * @brief setOverflowPolicy Set what happens to a task posted when
+     * queues of all workers are full.
+     * @param policy Overflow policy.
+     */
+    void setOverflowPolicy(OverflowPolicy policy);
+
+    /**
+     * @brief setAffinity Set policy of pinning worker threads to CPUs.
+     * Pinned workers allocate their queues on the local NUMA node and steal
+     * from workers of the same node first.
+     * @param policy Affinity policy.
+     */
+    void setAffinity(AffinityPolicy policy);
+
+    /**
+     * @brief setCpuList Pin worker threads to listed CPUs round-robin and
+     * set affinity policy to AffinityPolicy::Explicit.
+     * @param cpus Logical CPU numbers.
+     */
+    void setCpuList(std::vector<size_t> cpus);
+
+    /**
+     * @brief setTimerResolution Set tick length of worker timer wheels.
+     * Timers fire up to one tick late.
+     * @param resolution Tick length.
+     */
+    void setTimerResolution(std::chrono::steady_clock::duration resolution);
+
+    /**
+     * @brief setStealKeyedTasks Set whether tasks posted to a chosen worker
+     * by ThreadPool::postTo() or postKeyed() may be stolen by other workers.
+     * Tasks which can't be stolen are kept in unbounded per-worker queues,
+     * so their worker alone touches the data they work on.
+     * @param steal true to let idle workers steal keyed tasks.
+     */
+    void setStealKeyedTasks(bool steal);
+
+    /**
+     * @brief setLifoSlotLimit Set how many tasks in a row a worker may take
+     * from its LIFO slot. The slot holds the latest highest priority task
+     * posted by the worker thread, which runs next while its data is still
+     * in cache. Then a task is taken from the queues, so they can't starve.
+     * @param limit Maximum number of slot tasks in a row, 0 to disable the
+     * slot.
+     */
+    void setLifoSlotLimit(size_t limit);
+
     /**
      * @brief threadCount Return thread count.
      */
     size_t threadCount() const;
 
+    /**
+     * @brief maxThreadCount Return maximum thread count.
+     */
+    size_t maxThreadCount() const;
+
+    /**
+     * @brief minThreadCount Return minimum thread count.
+     */
+    size_t minThreadCount() const;
+
+    /**
+     * @brief scalingInterval Return auto-scaling sampling period, zero if
+     * auto-scaling is disabled.
+     */
+    std::chrono::milliseconds scalingInterval() const;
+
     /**
      * @brief queueSize Return single worker queue size.
      */
     size_t queueSize() const;
 
+    /**
+     * @brief spinCount Return number of idle spinning steps.
+     */
+    size_t spinCount() const;
+
+    /**
+     * @brief yieldCount Return number of idle yielding steps.
+     */
+    size_t yieldCount() const;
+
+    /**
+     * @brief stealAttempts Return number of probed workers per idle step.
+     */
+    size_t stealAttempts() const;
+
+    /**
+     * @brief stealBatchSize Return maximum number of tasks stolen at once.
+     */
+    size_t stealBatchSize() const;
+
+    /**
+     * @brief priorityLevels Return number of task priority levels.
+     */
+    size_t priorityLevels() const;
+
+    /**
+     * @brief overflowPolicy Return what happens to a task posted when
+     * queues of all workers are full.
+     */
+    OverflowPolicy overflowPolicy() const;
+
+    /**
+     * @brief affinity Return policy of pinning worker threads to CPUs.
+     */
+    AffinityPolicy affinity() const;
+
+    /**
+     * @brief cpuList Return CPUs for AffinityPolicy::Explicit.
+     */
+    const std::vector<size_t>& cpuList() const;
+
+    /**
+     * @brief timerResolution Return tick length of worker timer wheels.
+     */
+    std::chrono::steady_clock::duration timerResolution() const;
+
+    /**
+     * @brief stealKeyedTasks Return whether tasks posted to a chosen worker
+     * may be stolen by other workers.
+     */
+    bool stealKeyedTasks() const;
+
+    /**
+     * @brief lifoSlotLimit Return how many tasks in a row a worker may take
+     * from its LIFO slot.
+     */
+    size_t lifoSlotLimit() const;
+
 private:
     size_t m_thread_count;
+    size_t m_max_thread_count;
+    size_t m_min_thread_count;
+    std::chrono::milliseconds m_scaling_interval;
     size_t m_queue_size;
+    size_t m_spin_count;
+    size_t m_yield_count;
+    size_t m_steal_attempts;
+    size_t m_steal_batch_size;
+    size_t m_priority_levels;
+    OverflowPolicy m_overflow_policy;
+    AffinityPolicy m_affinity;
+    std::vector<size_t> m_cpu_list;
+    std::chrono::steady_clock::duration m_timer_resolution;
+    bool m_steal_keyed_tasks;
+    size_t m_lifo_slot_limit;
 };
 
 /// Implementation
 
 inline ThreadPoolOptions::ThreadPoolOptions()
     : m_thread_count(std::max<size_t>(1u, std::thread::hardware_concurrency()))
+    , m_max_thread_count(0u)
+    , m_min_thread_count(1u)
+    , m_scaling_interval(0)
     , m_queue_size(1024u)
+    , m_spin_count(256u)
+    , m_yield_count(64u)
+    , m_steal_attempts(4u)
+    , m_steal_batch_size(4u)
+    , m_priority_levels(1u)
+    , m_overflow_policy(OverflowPolicy::Reject)
+    , m_affinity(AffinityPolicy::None)
+    , m_timer_resolution(std::chrono::milliseconds(1))
+    , m_steal_keyed_tasks(true)
+    , m_lifo_slot_limit(3u)
 {
 }
 
@@ -58,19 +302,164 @@ inline void ThreadPoolOptions::setThreadCount(size_t count)
     m_thread_count = std::max<size_t>(1u, count);
 }
 
+inline void ThreadPoolOptions::setMaxThreadCount(size_t count)
+{
+    m_max_thread_count = count;
+}
+
+inline void ThreadPoolOptions::setMinThreadCount(size_t count)
+{
+    m_min_thread_count = std::max<size_t>(1u, count);
+}
+
+inline void ThreadPoolOptions::setScalingInterval(
+    std::chrono::milliseconds interval)
+{
+    m_scaling_interval = interval;
+}
+
 inline void ThreadPoolOptions::setQueueSize(size_t size)
 {
     m_queue_size = std::max<size_t>(1u, size);
 }
 
+inline void ThreadPoolOptions::setSpinCount(size_t count)
+{
+    m_spin_count = count;
+}
+
+inline void ThreadPoolOptions::setYieldCount(size_t count)
+{
+    m_yield_count = count;
+}
+
+inline void ThreadPoolOptions::setStealAttempts(size_t count)
+{
+    m_steal_attempts = std::max<size_t>(1u, count);
+}
+
+inline void ThreadPoolOptions::setStealBatchSize(size_t size)
+{
+    m_steal_batch_size = std::max<size_t>(1u, size);
+}
+
+inline void ThreadPoolOptions::setPriorityLevels(size_t count)
+{
+    m_priority_levels = std::max<size_t>(1u, count);
+}
+
+inline void ThreadPoolOptions::setOverflowPolicy(OverflowPolicy policy)
+{
+    m_overflow_policy = policy;
+}
+
+inline void ThreadPoolOptions::setAffinity(AffinityPolicy policy)
+{
+    m_affinity = policy;
+}
+
+inline void ThreadPoolOptions::setCpuList(std::vector<size_t> cpus)
+{
+    m_cpu_list = std::move(cpus);
+    m_affinity = AffinityPolicy::Explicit;
+}
+
+inline void ThreadPoolOptions::setTimerResolution(
+    std::chrono::steady_clock::duration resolution)
+{
+    m_timer_resolution =
+        std::max(resolution, std::chrono::steady_clock::duration(1));
+}
+
+inline void ThreadPoolOptions::setStealKeyedTasks(bool steal)
+{
+    m_steal_keyed_tasks = steal;
+}
+
+inline void ThreadPoolOptions::setLifoSlotLimit(size_t limit)
+{
+    m_lifo_slot_limit = limit;
+}
+
 inline size_t ThreadPoolOptions::threadCount() const
 {
     return m_thread_count;
 }
 
+inline size_t ThreadPoolOptions::maxThreadCount() const
+{
+    return std::max(m_max_thread_count, m_thread_count);
+}
+
+inline size_t ThreadPoolOptions::minThreadCount() const
+{
+    return std::min(m_min_thread_count, m_thread_count);
+}
+
+inline std::chrono::milliseconds ThreadPoolOptions::scalingInterval() const
+{
+    return m_scaling_interval;
+}
+
 inline size_t ThreadPoolOptions::queueSize() const
 {
     return m_queue_size;
 }
 
+inline size_t ThreadPoolOptions::spinCount() const
+{
+    return m_spin_count;
+}
+
+inline size_t ThreadPoolOptions::yieldCount() const
+{
+    return m_yield_count;
+}
+
+inline size_t ThreadPoolOptions::stealAttempts() const
+{
+    return m_steal_attempts;
+}
+
+inline size_t ThreadPoolOptions::stealBatchSize() const
+{
+    return m_steal_batch_size;
+}
+
+inline size_t ThreadPoolOptions::priorityLevels() const
+{
+    return m_priority_levels;
+}
+
+inline OverflowPolicy ThreadPoolOptions::overflowPolicy() const
+{
+    return m_overflow_policy;
+}
+
+inline AffinityPolicy ThreadPoolOptions::affinity() const
+{
+    return m_affinity;
+}
+
+inline const std::vector<size_t>& ThreadPoolOptions::cpuList() const
+{
+    return m_cpu_list;
+}
+
+inline std::chrono::steady_clock::duration
+ThreadPoolOptions::timerResolution() const
+{
+    return m_timer_resolution;
+}
+
+inline bool ThreadPoolOptions::stealKeyedTasks() const
+{
+    return m_steal_keyed_tasks;
+}
+
+inline size_t ThreadPoolOptions::lifoSlotLimit() const
+{
+    return m_lifo_slot_limit;
+}
+
 }
@@ -0,0 +1,714 @@
+#pragma once
+
+#include <thread_pool/cache_line.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace tp
+{
+
+namespace detail
+{
+    /**
+     * @brief The TimerNode struct is the part of a timer shared by its
+     * handle and the wheel. The state word holds the canceled flag and the
+     * reference count, so canceling and releasing are single atomic
+     * operations.
+     */
+    struct TimerNode
+    {
+        enum : uint32_t { CANCELED = 1, REF = 2 };
+
+        TimerNode* next;
+        std::chrono::steady_clock::time_point deadline;
+        std::chrono::steady_clock::duration period;
+        std::atomic<uint32_t> state;
+        void (*destroy)(TimerNode* node);
+
+        /**
+         * @brief cancel Mark timer canceled.
+         * @return true if it wasn't canceled or fired before.
+         */
+        bool cancel();
+
+        /**
+         * @brief canceled Return true if timer is canceled or fired.
+         */
+        bool canceled() const;
+
+        /**
+         * @brief release Drop a reference, destroy the node with the last
+         * one.
+         */
+        void release();
+    };
+
+    /**
+     * @brief The TimerTask struct is a timer node holding the task. Nodes
+     * come from operator new rather than BlockPool: millions of pending
+     * timers would exhaust its slabs.
+     */
+    template <typename Task>
+    struct TimerTask : TimerNode
+    {
+        Task task;
+
+        /**
+         * @brief create Allocate timer referenced by the wheel and the
+         * handle.
+         * @param handler Handler to be called on expiry.
+         * @param deadline First expiry time.
+         * @param period Period of repeating, zero for one-shot timer.
+         * @throws std::bad_alloc if memory is exhausted.
+         */
+        template <typename Handler>
+        static TimerTask* create(Handler&& handler,
+                                 std::chrono::steady_clock::time_point deadline,
+                                 std::chrono::steady_clock::duration period);
+
+        static void destroyTask(TimerNode* node);
+
+        template <typename Handler>
+        explicit TimerTask(Handler&& handler);
+    };
+}
+
+/**
+ * @brief The TimerHandle class refers to a timer posted to the thread pool.
+ * Destroying the handle doesn't cancel the timer.
+ */
+class TimerHandle
+{
+public:
+    /**
+     * @brief TimerHandle Construct handle referring to no timer.
+     */
+    TimerHandle() noexcept;
+
+    /**
+     * @brief TimerHandle Take over a reference to the timer.
+     */
+    explicit TimerHandle(detail::TimerNode* node) noexcept;
+
+    TimerHandle(TimerHandle&& rhs) noexcept;
+
+    TimerHandle& operator=(TimerHandle&& rhs) noexcept;
+
+    ~TimerHandle();
+
+    /**
+     * @brief cancel Prevent the timer from firing. Never blocks. A running
+     * handler is not interrupted, a periodic timer doesn't fire again.
+     * The canceled timer is destroyed once the wheel reaches it.
+     * @return true if the timer wasn't fired or canceled before.
+     */
+    bool cancel();
+
+private:
+    TimerHandle(const TimerHandle&) = delete;
+    TimerHandle& operator=(const TimerHandle&) = delete;
+
+    detail::TimerNode* m_node;
+};
+
+/**
+ * @brief The TimerWheel class implements hierarchical hashed timer wheel
+ * owned by a single thread.
+ * Time is divided into ticks of the wheel resolution. Each of LEVEL_COUNT
+ * levels has SLOT_COUNT slots, a slot of level L spans SLOT_COUNT^L ticks.
+ * A timer is linked into the slot of the lowest level covering its
+ * deadline, which is O(1). When the current tick enters a slot of an upper
+ * level, its timers are cascaded to the lower levels, and timers of the
+ * level 0 slot are fired. Timers beyond the range of the wheel wait in the
+ * farthest slot of the top level and are cascaded again.
+ * Timers never fire before the deadline and are late by one tick at most
+ * when the owner advances the wheel in time. Canceled timers are dropped
+ * lazily once their slot is reached.
+ * Other threads push timers to the incoming lock-free stack, the owner
+ * links them into the wheel on the next advance.
+ */
+template <typename Task>
+class TimerWheel
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    enum
+    {
+        LEVEL_BITS = 6,
+        SLOT_COUNT = 1 << LEVEL_BITS,
+        LEVEL_COUNT = 4
+    };
+
+    /**
+     * @brief TimerWheel Constructor.
+     * @param resolution Tick length.
+     */
+    explicit TimerWheel(Clock::duration resolution);
+
+    /**
+     * @brief ~TimerWheel Release all timers left.
+     */
+    ~TimerWheel();
+
+    /**
+     * @brief push Push timer to be linked into the wheel by the owner. Can
+     * be called from any thread.
+     * @param timer Timer referenced by the wheel.
+     */
+    void push(detail::TimerTask<Task>* timer);
+
+    /**
+     * @brief insert Link timer into the wheel.
+     * @param timer Timer referenced by the wheel.
+     * @note Must be called from the owner thread only.
+     */
+    void insert(detail::TimerTask<Task>* timer);
+
+    /**
+     * @brief empty Return true if there is no timer linked or pushed.
+     * @note Must be called from the owner thread only.
+     */
+    bool empty() const;
+
+    /**
+     * @brief hasIncoming Return true if there are timers pushed and not
+     * linked yet.
+     */
+    bool hasIncoming() const;
+
+    /**
+     * @brief nextDeadline Return the earliest time advance() can fire a
+     * timer, Clock::time_point::max() if the wheel is empty. Lower bound
+     * only: cascading of upper levels is due then as well.
+     * @note Must be called from the owner thread only.
+     */
+    Clock::time_point nextDeadline() const;
+
+    /**
+     * @brief advance Link pushed timers, move the wheel to current time and
+     * fire expired timers. Periodic timers are linked again for the next
+     * period, missed periods are skipped.
+     * @param now Current time.
+     * @param fire Called as 'fire(task)' for every expired timer.
+     * @return Number of fired timers.
+     * @note Must be called from the owner thread only.
+     */
+    template <typename Fire>
+    size_t advance(Clock::time_point now, Fire fire);
+
+    /**
+     * @brief handOver Push all timers to another wheel.
+     * @param wheel Wheel to take the timers.
+     * @note Must be called from the owner thread, or once it's finished.
+     */
+    void handOver(TimerWheel& wheel);
+
+    /**
+     * @brief clear Release all timers.
+     * @note Must be called from the owner thread, or once it's finished.
+     */
+    void clear();
+
+private:
+    typedef detail::TimerTask<Task> Timer;
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    /**
+     * @brief toTick Return the first tick not earlier than time.
+     */
+    uint64_t toTick(Clock::time_point time) const;
+
+    /**
+     * @brief elapsedTicks Return number of ticks passed by time.
+     */
+    uint64_t elapsedTicks(Clock::time_point time) const;
+
+    /**
+     * @brief link Link timer into the slot covering its deadline, or into
+     * the due list if the deadline has passed.
+     */
+    void link(detail::TimerNode* node);
+
+    /**
+     * @brief linkIncoming Link all pushed timers.
+     */
+    void linkIncoming();
+
+    /**
+     * @brief detach Unlink and return list of the slot.
+     */
+    detail::TimerNode* detach(size_t level, size_t slot);
+
+    /**
+     * @brief detachDue Unlink and return the due list.
+     */
+    detail::TimerNode* detachDue();
+
+    /**
+     * @brief fireList Fire timers of the list, link periodic ones again.
+     * @return Number of fired timers.
+     */
+    template <typename Fire>
+    size_t fireList(detail::TimerNode* list, Clock::time_point now,
+                    Fire& fire);
+
+    /**
+     * @brief release Release all timers of the list.
+     */
+    static void release(detail::TimerNode* list);
+
+    Clock::time_point m_epoch;
+    Clock::duration m_resolution;
+    uint64_t m_current;
+    size_t m_count;
+    detail::TimerNode* m_due;
+    uint64_t m_occupied[LEVEL_COUNT];
+    detail::TimerNode* m_slots[LEVEL_COUNT][SLOT_COUNT];
+
+    // Written by other threads.
+    char m_pad0[detail::FALSE_SHARING_RANGE];
+    std::atomic<detail::TimerNode*> m_incoming;
+    char m_pad1[detail::FALSE_SHARING_RANGE];
+};
+
+
+/// Implementation
+
+namespace detail
+{
+    inline bool TimerNode::cancel()
+    {
+        return !(state.fetch_or(CANCELED, std::memory_order_acq_rel) &
+                 CANCELED);
+    }
+
+    inline bool TimerNode::canceled() const
+    {
+        return state.load(std::memory_order_acquire) & CANCELED;
+    }
+
+    inline void TimerNode::release()
+    {
+        if (state.fetch_sub(REF, std::memory_order_acq_rel) / REF == 1)
+        {
+            destroy(this);
+        }
+    }
+
+    template <typename Task>
+    template <typename Handler>
+    inline TimerTask<Task>::TimerTask(Handler&& handler)
+        : task(std::forward<Handler>(handler))
+    {
+    }
+
+    template <typename Task>
+    template <typename Handler>
+    inline TimerTask<Task>* TimerTask<Task>::create(
+        Handler&& handler, std::chrono::steady_clock::time_point deadline,
+        std::chrono::steady_clock::duration period)
+    {
+        TimerTask* timer = new TimerTask(std::forward<Handler>(handler));
+        timer->next = nullptr;
+        timer->deadline = deadline;
+        timer->period = period;
+        timer->state.store(2 * REF, std::memory_order_relaxed);
+        timer->destroy = &TimerTask::destroyTask;
+        return timer;
+    }
+
+    template <typename Task>
+    inline void TimerTask<Task>::destroyTask(TimerNode* node)
+    {
+        delete static_cast<TimerTask*>(node);
+    }
+}
+
+inline TimerHandle::TimerHandle() noexcept
+    : m_node(nullptr)
+{
+}
+
+inline TimerHandle::TimerHandle(detail::TimerNode* node) noexcept
+    : m_node(node)
+{
+}
+
+inline TimerHandle::TimerHandle(TimerHandle&& rhs) noexcept
+    : m_node(rhs.m_node)
+{
+    rhs.m_node = nullptr;
+}
+
+inline TimerHandle& TimerHandle::operator=(TimerHandle&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        if (m_node)
+        {
+            m_node->release();
+        }
+        m_node = rhs.m_node;
+        rhs.m_node = nullptr;
+    }
+    return *this;
+}
+
+inline TimerHandle::~TimerHandle()
+{
+    if (m_node)
+    {
+        m_node->release();
+    }
+}
+
+inline bool TimerHandle::cancel()
+{
+    return m_node && m_node->cancel();
+}
+
+template <typename Task>
+inline TimerWheel<Task>::TimerWheel(Clock::duration resolution)
+    : m_epoch(Clock::now())
+    , m_resolution(std::max(resolution, Clock::duration(1)))
+    , m_current(0)
+    , m_count(0)
+    , m_due(nullptr)
+    , m_occupied()
+    , m_slots()
+    , m_incoming(nullptr)
+{
+}
+
+template <typename Task>
+inline TimerWheel<Task>::~TimerWheel()
+{
+    clear();
+}
+
+template <typename Task>
+inline void TimerWheel<Task>::push(detail::TimerTask<Task>* timer)
+{
+    detail::TimerNode* head = m_incoming.load(std::memory_order_relaxed);
+    do
+    {
+        timer->next = head;
+    }
+    while (!m_incoming.compare_exchange_weak(head, timer,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed));
+}
+
+template <typename Task>
+inline void TimerWheel<Task>::insert(detail::TimerTask<Task>* timer)
+{
+    // The position isn't advanced while the wheel is empty.
+    if (m_count == 0)
+    {
+        m_current = std::max(m_current, elapsedTicks(Clock::now()));
+    }
+    link(timer);
+}
+
+template <typename Task>
+inline bool TimerWheel<Task>::empty() const
+{
+    return m_count == 0 && !hasIncoming();
+}
+
+template <typename Task>
+inline bool TimerWheel<Task>::hasIncoming() const
+{
+    return m_incoming.load(std::memory_order_relaxed) != nullptr;
+}
+
+template <typename Task>
+inline typename TimerWheel<Task>::Clock::time_point
+TimerWheel<Task>::nextDeadline() const
+{
+    if (m_due)
+    {
+        return m_epoch + m_resolution * static_cast<Clock::rep>(m_current);
+    }
+
+    // The nearest occupied slot of every level, in ticks when it is
+    // reached. A slot matching the current position is reached after a
+    // full turn.
+    uint64_t next = UINT64_MAX;
+    for (size_t level = 0; level < LEVEL_COUNT; ++level)
+    {
+        if (m_occupied[level] == 0)
+        {
+            continue;
+        }
+
+        const size_t shift = LEVEL_BITS * level;
+        const uint64_t position = m_current >> shift;
+        for (uint64_t distance = 1; distance <= SLOT_COUNT; ++distance)
+        {
+            const size_t slot = (position + distance) & (SLOT_COUNT - 1);
+            if (m_occupied[level] & (uint64_t(1) << slot))
+            {
+                next = std::min(next, (position + distance) << shift);
+                break;
+            }
+        }
+    }
+
+    if (next == UINT64_MAX)
+    {
+        return Clock::time_point::max();
+    }
+
+    return m_epoch + m_resolution * static_cast<Clock::rep>(next);
+}
+
+template <typename Task>
+template <typename Fire>
+inline size_t TimerWheel<Task>::advance(Clock::time_point now, Fire fire)
+{
+    const uint64_t target = elapsedTicks(now);
+    if (m_count == 0)
+    {
+        m_current = std::max(m_current, target);
+    }
+
+    linkIncoming();
+
+    size_t fired = fireList(detachDue(), now, fire);
+    while (m_current < target)
+    {
+        if (m_count == 0)
+        {
+            m_current = target;
+            break;
+        }
+
+        // Nothing is fired before the next cascade if level 0 is empty.
+        m_current = m_occupied[0] == 0
+            ? std::min(target, (m_current | (SLOT_COUNT - 1)) + 1)
+            : m_current + 1;
+
+        // Upper levels go first, so their timers reach the lower slots
+        // before those are processed.
+        size_t top = 0;
+        while (top + 1 < LEVEL_COUNT &&
+               (m_current & ((uint64_t(1) << (LEVEL_BITS * (top + 1))) - 1))
+                   == 0)
+        {
+            ++top;
+        }
+        for (size_t level = top; level > 0; --level)
+        {
+            detail::TimerNode* list = detach(level,
+                (m_current >> (LEVEL_BITS * level)) & (SLOT_COUNT - 1));
+            while (list)
+            {
+                detail::TimerNode* node = list;
+                list = list->next;
+                if (node->canceled())
+                {
+                    node->release();
+                }
+                else
+                {
+                    link(node);
+                }
+            }
+        }
+
+        fired += fireList(detach(0, m_current & (SLOT_COUNT - 1)), now,
+                          fire);
+        fired += fireList(detachDue(), now, fire);
+    }
+
+    return fired;
+}
+
+template <typename Task>
+inline void TimerWheel<Task>::handOver(TimerWheel& wheel)
+{
+    linkIncoming();
+
+    for (size_t i = 0; i <= LEVEL_COUNT * SLOT_COUNT; ++i)
+    {
+        detail::TimerNode* list = i == 0 ? detachDue()
+            : detach((i - 1) / SLOT_COUNT, (i - 1) % SLOT_COUNT);
+        while (list)
+        {
+            detail::TimerNode* node = list;
+            list = list->next;
+            wheel.push(static_cast<Timer*>(node));
+        }
+    }
+}
+
+template <typename Task>
+inline void TimerWheel<Task>::clear()
+{
+    release(m_incoming.exchange(nullptr, std::memory_order_acquire));
+    release(detachDue());
+    for (size_t level = 0; level < LEVEL_COUNT; ++level)
+    {
+        for (size_t slot = 0; slot < SLOT_COUNT; ++slot)
+        {
+            release(detach(level, slot));
+        }
+    }
+}
+
+template <typename Task>
+inline uint64_t TimerWheel<Task>::toTick(Clock::time_point time) const
+{
+    if (time <= m_epoch)
+    {
+        return 0;
+    }
+
+    // Rounded up, so the timer never fires early.
+    const Clock::duration elapsed = time - m_epoch;
+    return static_cast<uint64_t>(
+        (elapsed + m_resolution - Clock::duration(1)) / m_resolution);
+}
+
+template <typename Task>
+inline uint64_t TimerWheel<Task>::elapsedTicks(Clock::time_point time) const
+{
+    return time <= m_epoch ? 0 : static_cast<uint64_t>(
+        (time - m_epoch) / m_resolution);
+}
+
+template <typename Task>
+inline void TimerWheel<Task>::link(detail::TimerNode* node)
+{
+    uint64_t tick = toTick(node->deadline);
+    if (tick <= m_current)
+    {
+        node->next = m_due;
+        m_due = node;
+        ++m_count;
+        return;
+    }
+
+    const uint64_t range = uint64_t(1) << (LEVEL_BITS * LEVEL_COUNT);
+    tick = std::min(tick, m_current + range - 1);
+
+    const uint64_t delta = tick - m_current;
+    size_t level = 0;
+    while (level + 1 < LEVEL_COUNT &&
+           delta >= (uint64_t(1) << (LEVEL_BITS * (level + 1))))
+    {
+        ++level;
+    }
+
+    const size_t slot = (tick >> (LEVEL_BITS * level)) & (SLOT_COUNT - 1);
+    node->next = m_slots[level][slot];
+    m_slots[level][slot] = node;
+    m_occupied[level] |= uint64_t(1) << slot;
+    ++m_count;
+}
+
+template <typename Task>
+inline void TimerWheel<Task>::linkIncoming()
+{
+    if (!hasIncoming())
+    {
+        return;
+    }
+
+    detail::TimerNode* list =
+        m_incoming.exchange(nullptr, std::memory_order_acquire);
+    while (list)
+    {
+        detail::TimerNode* node = list;
+        list = list->next;
+        link(node);
+    }
+}
+
+template <typename Task>
+inline detail::TimerNode* TimerWheel<Task>::detach(size_t level, size_t slot)
+{
+    detail::TimerNode* list = m_slots[level][slot];
+    m_slots[level][slot] = nullptr;
+    m_occupied[level] &= ~(uint64_t(1) << slot);
+    for (detail::TimerNode* node = list; node; node = node->next)
+    {
+        --m_count;
+    }
+    return list;
+}
+
+template <typename Task>
+inline detail::TimerNode* TimerWheel<Task>::detachDue()
+{
+    detail::TimerNode* list = m_due;
+    m_due = nullptr;
+    for (detail::TimerNode* node = list; node; node = node->next)
+    {
+        --m_count;
+    }
+    return list;
+}
+
+template <typename Task>
+template <typename Fire>
+inline size_t TimerWheel<Task>::fireList(detail::TimerNode* list,
+                                         Clock::time_point now, Fire& fire)
+{
+    size_t fired = 0;
+    while (list)
+    {
+        detail::TimerNode* node = list;
+        list = list->next;
+
+        if (node->period == Clock::duration::zero())
+        {
+            // Marked first, so cancel() fails once the timer fires.
+            if (node->cancel())
+            {
+                fire(static_cast<Timer*>(node)->task);
+                ++fired;
+            }
+            node->release();
+            continue;
+        }
+
+        if (node->canceled())
+        {
+            node->release();
+            continue;
+        }
+
+        fire(static_cast<Timer*>(node)->task);
+        ++fired;
+
+        const Clock::duration late = now - node->deadline;
+        node->deadline += node->period *
+            (late < Clock::duration::zero() ? 1 : late / node->period + 1);
+        link(node);
+    }
+
+    return fired;
+}
+
+template <typename Task>
+inline void TimerWheel<Task>::release(detail::TimerNode* list)
+{
+    while (list)
+    {
+        detail::TimerNode* node = list;
+        list = list->next;
+        node->release();
+    }
+}
+
+}
@@ -0,0 +1,324 @@
+#pragma once
+
+#include <thread_pool/thread_pool_options.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace tp
+{
+
+/**
+ * @brief The CpuInfo struct describes one logical CPU.
+ */
+struct CpuInfo
+{
+    /// Logical CPU number used by the OS.
+    size_t id;
+    /// Physical core ID, unique within the package.
+    size_t core;
+    /// Physical package (socket) ID.
+    size_t package;
+    /// NUMA node ID.
+    size_t node;
+};
+
+/**
+ * @brief The WorkerPlacement struct describes where worker thread runs.
+ */
+struct WorkerPlacement
+{
+    enum : size_t { NO_CPU = size_t(-1) };
+
+    /// CPU the worker thread is pinned to or NO_CPU.
+    size_t cpu;
+    /// NUMA node of the CPU, zero if not pinned.
+    size_t node;
+};
+
+/**
+ * @brief The Topology class describes logical CPUs available to the process
+ * and places workers on them according to AffinityPolicy.
+ * On Linux CPUs are taken from the process affinity mask, so cpusets and
+ * taskset restrictions are respected, and their cores, packages and NUMA
+ * nodes are read from sysfs. Elsewhere every hardware thread is considered
+ * a separate core of a single node and threads are never pinned.
+ */
+class Topology
+{
+public:
+    /**
+     * @brief Topology Construct topology of given CPUs.
+     * @param cpus Logical CPUs.
+     */
+    explicit Topology(std::vector<CpuInfo> cpus);
+
+    /**
+     * @brief detect Return topology of CPUs the process may run on.
+     */
+    static Topology detect();
+
+    /**
+     * @brief cpus Return logical CPUs ordered by node, package, core and
+     * ID, so that hyper-threading siblings are adjacent.
+     */
+    const std::vector<CpuInfo>& cpus() const;
+
+    /**
+     * @brief nodeCount Return number of NUMA nodes having available CPUs.
+     */
+    size_t nodeCount() const;
+
+    /**
+     * @brief placeWorkers Choose CPU for every worker thread up to the
+     * maximum thread count. CPUs are reused round-robin if there are more
+     * workers than CPUs.
+     * @param options Thread pool options with maximum thread count,
+     * affinity policy and CPU list.
+     * @return Placement of every worker. All workers are unpinned if policy
+     * is AffinityPolicy::None or no listed CPU is available.
+     */
+    std::vector<WorkerPlacement> placeWorkers(
+        const ThreadPoolOptions& options) const;
+
+private:
+    std::vector<CpuInfo> m_cpus;
+    size_t m_node_count;
+};
+
+
+/// Implementation
+
+namespace detail
+{
+#if defined(__linux__)
+    inline size_t read_sysfs_number(const std::string& path, size_t fallback)
+    {
+        std::ifstream file(path.c_str());
+        long long value = -1;
+        if (file >> value && value >= 0)
+        {
+            return static_cast<size_t>(value);
+        }
+        return fallback;
+    }
+
+    inline size_t read_cpu_node(size_t cpu)
+    {
+        const std::string path =
+            "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+        DIR* dir = opendir(path.c_str());
+        if (!dir)
+        {
+            return 0;
+        }
+
+        size_t node = 0;
+        while (dirent* entry = readdir(dir))
+        {
+            const std::string name = entry->d_name;
+            if (name.size() > 4 && name.compare(0, 4, "node") == 0)
+            {
+                node = static_cast<size_t>(std::stoul(name.substr(4)));
+                break;
+            }
+        }
+
+        closedir(dir);
+        return node;
+    }
+#endif
+
+    /**
+     * @brief pin_current_thread Bind calling thread to CPU.
+     * @return true on success.
+     */
+    inline bool pin_current_thread(size_t cpu)
+    {
+#if defined(__linux__)
+        if (cpu >= CPU_SETSIZE)
+        {
+            return false;
+        }
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+        (void)cpu;
+        return false;
+#endif
+    }
+}
+
+inline Topology::Topology(std::vector<CpuInfo> cpus)
+    : m_cpus(std::move(cpus))
+    , m_node_count(0)
+{
+    std::sort(m_cpus.begin(), m_cpus.end(),
+              [](const CpuInfo& l, const CpuInfo& r)
+              {
+                  return std::tie(l.node, l.package, l.core, l.id) <
+                         std::tie(r.node, r.package, r.core, r.id);
+              });
+
+    for (size_t i = 0; i < m_cpus.size(); ++i)
+    {
+        if (i == 0 || m_cpus[i].node != m_cpus[i - 1].node)
+        {
+            ++m_node_count;
+        }
+    }
+}
+
+inline Topology Topology::detect()
+{
+    std::vector<CpuInfo> cpus;
+
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        for (size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (!CPU_ISSET(cpu, &set))
+            {
+                continue;
+            }
+
+            const std::string path = "/sys/devices/system/cpu/cpu" +
+                                     std::to_string(cpu) + "/topology/";
+            CpuInfo info;
+            info.id = cpu;
+            info.core = detail::read_sysfs_number(path + "core_id", cpu);
+            info.package =
+                detail::read_sysfs_number(path + "physical_package_id", 0);
+            info.node = detail::read_cpu_node(cpu);
+            cpus.push_back(info);
+        }
+    }
+#endif
+
+    if (cpus.empty())
+    {
+        const size_t count =
+            std::max<size_t>(1u, std::thread::hardware_concurrency());
+        for (size_t cpu = 0; cpu < count; ++cpu)
+        {
+            cpus.push_back(CpuInfo{cpu, cpu, 0, 0});
+        }
+    }
+
+    return Topology(std::move(cpus));
+}
+
+inline const std::vector<CpuInfo>& Topology::cpus() const
+{
+    return m_cpus;
+}
+
+inline size_t Topology::nodeCount() const
+{
+    return m_node_count;
+}
+
+inline std::vector<WorkerPlacement> Topology::placeWorkers(
+                                    const ThreadPoolOptions& options) const
+{
+    std::vector<CpuInfo> order;
+
+    switch (options.affinity())
+    {
+    case AffinityPolicy::None:
+        break;
+
+    case AffinityPolicy::Compact:
+        order = m_cpus;
+        break;
+
+    case AffinityPolicy::Scatter:
+    {
+        // Take CPUs from every node in turn.
+        std::vector<std::vector<CpuInfo>> nodes;
+        for (size_t i = 0; i < m_cpus.size(); ++i)
+        {
+            if (i == 0 || m_cpus[i].node != m_cpus[i - 1].node)
+            {
+                nodes.emplace_back();
+            }
+            nodes.back().push_back(m_cpus[i]);
+        }
+
+        for (size_t j = 0; order.size() < m_cpus.size(); ++j)
+        {
+            for (const auto& node : nodes)
+            {
+                if (j < node.size())
+                {
+                    order.push_back(node[j]);
+                }
+            }
+        }
+        break;
+    }
+
+    case AffinityPolicy::PhysicalCores:
+        // The first hardware thread of every core.
+        for (size_t i = 0; i < m_cpus.size(); ++i)
+        {
+            if (i == 0 || m_cpus[i].core != m_cpus[i - 1].core ||
+                m_cpus[i].package != m_cpus[i - 1].package)
+            {
+                order.push_back(m_cpus[i]);
+            }
+        }
+        break;
+
+    case AffinityPolicy::Explicit:
+        for (size_t id : options.cpuList())
+        {
+            auto it = std::find_if(m_cpus.begin(), m_cpus.end(),
+                                   [id](const CpuInfo& cpu)
+                                   {
+                                       return cpu.id == id;
+                                   });
+            if (it != m_cpus.end())
+            {
+                order.push_back(*it);
+            }
+        }
+        break;
+    }
+
+    std::vector<WorkerPlacement> placements(options.maxThreadCount());
+    for (size_t i = 0; i < placements.size(); ++i)
+    {
+        if (order.empty())
+        {
+            placements[i].cpu = WorkerPlacement::NO_CPU;
+            placements[i].node = 0;
+        }
+        else
+        {
+            placements[i].cpu = order[i % order.size()].id;
+            placements[i].node = order[i % order.size()].node;
+        }
+    }
+
+    return placements;
+}
+
+}
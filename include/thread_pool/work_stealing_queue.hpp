@@ -0,0 +1,258 @@
+#pragma once
+
+#include <thread_pool/cache_line.hpp>
+#include <thread_pool/mpmc_bounded_queue.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace tp
+{
+
+/**
+ * @brief The WorkStealingQueue class implements bounded work-stealing
+ * queue for the worker-local tasks.
+ * Tasks pushed by the owner thread go to a Chase-Lev deque: the owner pushes
+ * and pops them at the bottom in LIFO order without CAS in the common case,
+ * thieves steal them at the top in FIFO order. Tasks pushed by other threads
+ * go to a separate MPMC inbox.
+ * Memory orderings follow "Correct and Efficient Work-Stealing for Weak
+ * Memory Models" by N.M. Le, A. Pop, A. Cohen and F. Zappa Nardelli.
+ * Doesn't accept non-movable types as T.
+ */
+template <typename T>
+class WorkStealingQueue
+{
+    static_assert(
+        std::is_move_constructible<T>::value, "Should be of movable type");
+
+public:
+    /**
+     * @brief WorkStealingQueue Constructor.
+     * @param size Power of 2 number - deque and inbox length.
+     * @throws std::invalid_argument if size is bad.
+     */
+    explicit WorkStealingQueue(size_t size);
+
+    /**
+     * @brief Move ctor implementation.
+     */
+    WorkStealingQueue(WorkStealingQueue&& rhs) noexcept;
+
+    /**
+     * @brief Move assignment implementaion.
+     */
+    WorkStealingQueue& operator=(WorkStealingQueue&& rhs) noexcept;
+
+    /**
+     * @brief push Push data to the inbox. Can be called from any thread.
+     * @param data Data to be pushed.
+     * @return true on success.
+     */
+    template <typename U>
+    bool push(U&& data);
+
+    /**
+     * @brief pop Pop data as a thief. Can be called from any thread.
+     * @param data Place to store popped data.
+     * @return true on sucess.
+     */
+    bool pop(T& data);
+
+    /**
+     * @brief pushBatch Push range of data to the inbox. Can be called from
+     * any thread.
+     * @param first Beginning of the range.
+     * @param last End of the range.
+     * @return Number of elements pushed from the beginning of the range.
+     */
+    template <typename Iterator>
+    size_t pushBatch(Iterator first, Iterator last);
+
+    /**
+     * @brief pushLocal Push data to the bottom of the deque. Falls back to
+     * the inbox if the deque is full.
+     * @param data Data to be pushed.
+     * @return true on success.
+     * @note Must be called from the owner thread only.
+     */
+    template <typename U>
+    bool pushLocal(U&& data);
+
+    /**
+     * @brief popLocal Pop data from the bottom of the deque, then from the
+     * inbox.
+     * @param data Place to store popped data.
+     * @return true on sucess.
+     * @note Must be called from the owner thread only.
+     */
+    bool popLocal(T& data);
+
+    /**
+     * @brief steal Steal data from the top of the deque, then from the
+     * inbox. Can be called from any thread.
+     * @param data Place to store stolen data.
+     * @return true on sucess.
+     */
+    bool steal(T& data);
+
+private:
+    struct Cell
+    {
+        // Set by the owner on push, cleared by the consumer once data was
+        // moved out, so the owner never overwrites a cell being stolen.
+        std::atomic<bool> full;
+        T data;
+
+        Cell() : full(false)
+        {
+        }
+    };
+
+    typedef std::ptrdiff_t Index;
+    typedef char Padding[detail::FALSE_SHARING_RANGE];
+
+    Padding pad0;
+    std::vector<Cell> m_buffer;
+    /* const */ size_t m_buffer_mask;
+    Padding pad1;
+    std::atomic<Index> m_top;
+    Padding pad2;
+    std::atomic<Index> m_bottom;
+    Padding pad3;
+    MPMCBoundedQueue<T> m_inbox;
+};
+
+
+/// Implementation
+
+template <typename T>
+inline WorkStealingQueue<T>::WorkStealingQueue(size_t size)
+    : m_buffer(size), m_buffer_mask(size - 1), m_top(0), m_bottom(0),
+      m_inbox(size)
+{
+}
+
+template <typename T>
+inline WorkStealingQueue<T>::WorkStealingQueue(WorkStealingQueue&& rhs) noexcept
+{
+    *this = rhs;
+}
+
+template <typename T>
+inline WorkStealingQueue<T>& WorkStealingQueue<T>::operator=(WorkStealingQueue&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        m_buffer = std::move(rhs.m_buffer);
+        m_buffer_mask = std::move(rhs.m_buffer_mask);
+        m_top = rhs.m_top.load();
+        m_bottom = rhs.m_bottom.load();
+        m_inbox = std::move(rhs.m_inbox);
+    }
+    return *this;
+}
+
+template <typename T>
+template <typename U>
+inline bool WorkStealingQueue<T>::push(U&& data)
+{
+    return m_inbox.push(std::forward<U>(data));
+}
+
+template <typename T>
+template <typename Iterator>
+inline size_t WorkStealingQueue<T>::pushBatch(Iterator first, Iterator last)
+{
+    return m_inbox.pushBatch(first, last);
+}
+
+template <typename T>
+inline bool WorkStealingQueue<T>::pop(T& data)
+{
+    return steal(data);
+}
+
+template <typename T>
+template <typename U>
+inline bool WorkStealingQueue<T>::pushLocal(U&& data)
+{
+    const Index b = m_bottom.load(std::memory_order_relaxed);
+    const Index t = m_top.load(std::memory_order_acquire);
+
+    Cell& cell = m_buffer[b & m_buffer_mask];
+    if (b - t > static_cast<Index>(m_buffer_mask) ||
+        cell.full.load(std::memory_order_acquire))
+    {
+        return m_inbox.push(std::forward<U>(data));
+    }
+
+    cell.data = std::forward<U>(data);
+    cell.full.store(true, std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_release);
+    m_bottom.store(b + 1, std::memory_order_relaxed);
+
+    return true;
+}
+
+template <typename T>
+inline bool WorkStealingQueue<T>::popLocal(T& data)
+{
+    const Index b = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    Index t = m_top.load(std::memory_order_relaxed);
+
+    if (t > b)
+    {
+        // Deque is empty.
+        m_bottom.store(b + 1, std::memory_order_relaxed);
+        return m_inbox.pop(data);
+    }
+
+    if (t == b)
+    {
+        // Last task, race against thieves.
+        const bool won = m_top.compare_exchange_strong(
+            t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        m_bottom.store(b + 1, std::memory_order_relaxed);
+        if (!won)
+        {
+            return m_inbox.pop(data);
+        }
+    }
+
+    Cell& cell = m_buffer[b & m_buffer_mask];
+    data = std::move(cell.data);
+    cell.full.store(false, std::memory_order_release);
+
+    return true;
+}
+
+template <typename T>
+inline bool WorkStealingQueue<T>::steal(T& data)
+{
+    Index t = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const Index b = m_bottom.load(std::memory_order_acquire);
+
+    if (t < b)
+    {
+        if (m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                          std::memory_order_relaxed))
+        {
+            Cell& cell = m_buffer[t & m_buffer_mask];
+            data = std::move(cell.data);
+            cell.full.store(false, std::memory_order_release);
+            return true;
+        }
+    }
+
+    return m_inbox.pop(data);
+}
+
+}
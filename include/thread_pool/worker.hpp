@@ -1,7 +1,26 @@
 #pragma once
 
+#include <thread_pool/backpressure.hpp>
+#include <thread_pool/cache_line.hpp>
+#include <thread_pool/idle_strategy.hpp>
+#include <thread_pool/mpmc_bounded_queue.hpp>
+#include <thread_pool/queue_traits.hpp>
+#include <thread_pool/segmented_queue.hpp>
+#include <thread_pool/statistics.hpp>
+#include <thread_pool/thread_pool_options.hpp>
+#include <thread_pool/timer_wheel.hpp>
+#include <thread_pool/topology.hpp>
+
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 namespace tp
 {
@@ -9,18 +28,52 @@ namespace tp
 /**
  * @brief The Worker class owns task queue and executing thread.
  * In thread it tries to pop task from queue. If queue is empty then it tries
- * to steal task from the sibling worker. If steal was unsuccessful then spins
- * with one millisecond delay.
+ * to steal task from sibling workers probed in random order, workers on the
+ * same NUMA node are probed first. If steal was unsuccessful then it backs
+ * off by spinning and yielding and finally parks until a new task is posted.
+ * Every priority level has its own queue. Higher levels are served first,
+ * but level L is served first once per 8^L tasks, so lower levels can't be
+ * starved. Thieves take tasks from the highest non-empty level.
+ * With OverflowPolicy::Spill, or if keyed tasks can't be stolen, every level
+ * also has an unbounded overflow queue which is served by the worker thread
+ * only, in turns with the main queue of the level. Spilled and pinned tasks
+ * are pushed there.
+ * The latest highest priority task posted by the worker thread is kept in
+ * the LIFO slot and executed next, while the data it was handed is still in
+ * cache. Steals don't touch the slot, only a sibling about to park takes
+ * a slot task left there, in case the worker is blocked in a task waiting
+ * for it. After lifoSlotLimit() slot tasks in a row a task is taken from
+ * the queues, so request/response chains can't starve them. A task
+ * displaced from the slot by a newer one is pushed to the queue.
+ * Queues declaring SINGLE_CONSUMER are popped by the worker thread only.
+ * Every level then also has a shared MPMC queue which receives tasks posted
+ * from the worker thread and tasks published for thieves. A thief finding
+ * nothing there raises the steal request, and the worker moves a batch of
+ * tasks from its queue to the shared one on the next pop. Published tasks
+ * not yet stolen are served by the worker before its queue. Sibling workers
+ * never push to queues declaring SINGLE_PRODUCER.
+ * Every worker counts tasks posted through it and tasks it completed, so
+ * the pool sums the shards to tell whether it is idle. Posters count a task
+ * before it becomes visible to workers, the completion counter is written
+ * by the worker thread only.
+ * Every worker owns a timer wheel advanced by its thread between tasks.
+ * Fired timers are executed right there, a parked worker sleeps until the
+ * next deadline.
+ * Stats policy receives notifications about worker activity.
  */
-template <typename Task, template<typename> class Queue>
+template <typename Task, template<typename> class Queue,
+          typename Stats = NoStatistics>
 class Worker
 {
 public:
+    typedef std::vector<std::unique_ptr<Worker>> WorkerList;
+
     /**
      * @brief Worker Constructor.
-     * @param queue_size Length of undelaying task queue.
+     * @param options Thread pool options: queue length, idle and steal
+     * budgets.
      */
-    explicit Worker(size_t queue_size);
+    explicit Worker(const ThreadPoolOptions& options);
 
     /**
      * @brief Move ctor implementation.
@@ -33,33 +86,200 @@ public:
     Worker& operator=(Worker&& rhs) noexcept;
 
     /**
-     * @brief start Create the executing thread and start tasks execution.
+     * @brief attach Attach worker to the pool. Must be called before the
+     * worker is started or accessed by any other worker.
      * @param id Worker ID.
-     * @param steal_donor Sibling worker to steal task from it.
+     * @param workers All pool workers including this one to steal tasks
+     * from.
+     * @param active_count Pool wide number of active workers, which come
+     * first in the list.
+     * @param placements Placement of every worker thread.
+     * @param parked_count Pool wide counter of parked workers.
+     * @param backpressure Producers waiting for free queue slots.
+     * @param idle_waiters Threads waiting for the pool to become idle.
+     */
+    void attach(size_t id, const WorkerList* workers,
+                const std::atomic<size_t>* active_count,
+                const std::vector<WorkerPlacement>& placements,
+                std::atomic<size_t>* parked_count,
+                detail::Backpressure* backpressure,
+                detail::Backpressure* idle_waiters);
+
+    /**
+     * @brief rebind Point worker to the pool it was moved to. Must be
+     * called while the worker is stopped.
+     * @param workers All pool workers including this one to steal tasks
+     * from.
+     * @param active_count Pool wide number of active workers.
+     * @param parked_count Pool wide counter of parked workers.
+     * @param backpressure Producers waiting for free queue slots.
+     * @param idle_waiters Threads waiting for the pool to become idle.
+     */
+    void rebind(const WorkerList* workers,
+                const std::atomic<size_t>* active_count,
+                std::atomic<size_t>* parked_count,
+                detail::Backpressure* backpressure,
+                detail::Backpressure* idle_waiters);
+
+    /**
+     * @brief start Create the executing thread. Returns once the thread is
+     * pinned. On the first start its queues are reallocated on the local
+     * NUMA node as well, a restarted worker keeps queued tasks.
+     * @param go Future to become ready once all workers are started, tasks
+     * execution and stealing begin then.
      */
-    void start(size_t id, Worker* steal_donor);
+    void start(std::shared_future<void> go);
 
     /**
      * @brief stop Stop all worker's thread and stealing activity.
-     * Waits until the executing thread became finished.
+     * Waits until the executing thread became finished. Does nothing if
+     * the thread is stopped already.
      */
     void stop();
 
     /**
-     * @brief post Post task to queue.
+     * @brief retire Stop the executing thread once own queues are empty.
+     * Waits until the thread became finished. Tasks posted meanwhile are
+     * left for siblings to steal.
+     */
+    void retire();
+
+    /**
+     * @brief dropPending Destroy tasks left in queues, accounting them as
+     * completed. Must be called once the executing threads of all workers
+     * are stopped.
+     */
+    void dropPending();
+
+    /**
+     * @brief handOverOverflow Move tasks spilled to this worker to the
+     * overflow queues of another one. Must be called while the executing
+     * thread is stopped and no task is being spilled to this worker.
+     * @param worker Worker to take the tasks.
+     */
+    void handOverOverflow(Worker& worker);
+
+    /**
+     * @brief postTimer Add timer to the wheel of this worker. Wakes up the
+     * parked thread if the timer is due before it would wake up anyway.
+     * @param timer Timer referenced by the wheel.
+     */
+    void postTimer(detail::TimerTask<Task>* timer);
+
+    /**
+     * @brief handOverTimers Move timers of this worker to another one.
+     * Must be called while the executing thread is stopped and no timer is
+     * being posted to this worker.
+     * @param worker Worker to take the timers.
+     */
+    void handOverTimers(Worker& worker);
+
+    /**
+     * @brief countPosted Account tasks to be posted to the pool. Must be
+     * called before the tasks become visible to workers.
+     * @param count Number of tasks.
+     */
+    void countPosted(size_t count);
+
+    /**
+     * @brief discountPosted Withdraw tasks accounted by countPosted() but
+     * not posted.
+     * @param count Number of tasks.
+     */
+    void discountPosted(size_t count);
+
+    /**
+     * @brief postedCount Return number of tasks accounted by countPosted().
+     */
+    size_t postedCount() const;
+
+    /**
+     * @brief completedCount Return number of tasks executed or dropped by
+     * this worker.
+     */
+    size_t completedCount() const;
+
+    /**
+     * @brief post Post task to queue. Highest priority tasks posted from
+     * the executing thread go to the LIFO slot, others to the owner end of
+     * the queue if the queue has one.
      * @param handler Handler to be executed in executing thread.
+     * @param priority Priority level, 0 is the highest. Levels beyond the
+     * lowest one are clamped to it.
      * @return true on success.
      */
     template <typename Handler>
-    bool post(Handler&& handler);
+    bool post(Handler&& handler, size_t priority = 0);
+
+    /**
+     * @brief spill Push task to the overflow queue. Available with
+     * OverflowPolicy::Spill only.
+     * @param handler Handler to be executed in executing thread.
+     * @param priority Priority level, 0 is the highest.
+     * @throws std::bad_alloc if memory is exhausted.
+     */
+    template <typename Handler>
+    void spill(Handler&& handler, size_t priority = 0);
+
+    /**
+     * @brief pin Push task to the overflow queue, so no other worker can
+     * steal it. Available if keyed tasks can't be stolen.
+     * @param handler Handler to be executed in executing thread.
+     * @param priority Priority level, 0 is the highest.
+     * @throws std::bad_alloc if memory is exhausted.
+     */
+    template <typename Handler>
+    void pin(Handler&& handler, size_t priority = 0);
+
+    /**
+     * @brief postBatch Post range of tasks to the highest priority queue.
+     * @param first Beginning of the range of handlers.
+     * @param last End of the range of handlers.
+     * @return Number of tasks posted from the beginning of the range.
+     */
+    template <typename Iterator>
+    size_t postBatch(Iterator first, Iterator last);
 
     /**
-     * @brief steal Steal one task from this worker queue.
+     * @brief steal Steal one task of the highest available priority from
+     * this worker queues.
      * @param task Place for stealed task to be stored.
      * @return true on success.
      */
     bool steal(Task& task);
 
+    /**
+     * @brief stealBatch Steal several tasks of the highest available
+     * priority from this worker queues.
+     * @param tasks Place for stealed tasks to be stored.
+     * @param max_count Maximum number of tasks to steal.
+     * @param priority Place for priority level of stealed tasks.
+     * @return Number of stealed tasks.
+     */
+    size_t stealBatch(Task* tasks, size_t max_count, size_t& priority);
+
+    /**
+     * @brief popLifoSlot Take task from the LIFO slot of this worker.
+     * Siblings call it only when they are about to park.
+     * @param task Place for the task to be stored.
+     * @return true on success.
+     */
+    bool popLifoSlot(Task& task);
+
+    /**
+     * @brief runPendingTask Execute one task from own queue or stolen from
+     * a sibling worker.
+     * @return true if a task was executed.
+     * @note Must be called from the executing thread only.
+     */
+    bool runPendingTask();
+
+    /**
+     * @brief wakeup Wake up executing thread if it is parked.
+     * @return true if the thread was parked.
+     */
+    bool wakeup();
+
     /**
      * @brief getWorkerIdForCurrentThread Return worker ID associated with
      * current thread if exists.
@@ -67,17 +287,223 @@ public:
      */
     static size_t getWorkerIdForCurrentThread();
 
+    /**
+     * @brief stats Return worker statistics.
+     */
+    const Stats& stats() const;
+
 private:
+    enum { AGING_BITS = 3, AGING_MASK = (1 << AGING_BITS) - 1 };
+
+    /// States of the LIFO slot. The slot is locked while a task is moved.
+    enum { LIFO_EMPTY, LIFO_FULL, LIFO_LOCKED };
+
     /**
      * @brief threadFunc Executing thread function.
-     * @param id Worker ID to be associated with this thread.
-     * @param steal_donor Sibling worker to steal task from it.
+     * @param started Promise to be satisfied once the thread is set up.
+     * @param go Future to wait for before tasks execution.
+     */
+    void threadFunc(std::promise<void>* started, std::shared_future<void> go);
+
+    /**
+     * @brief runPendingTaskThunk Adapter of runPendingTask() to be
+     * installed as the thread's pending task runner.
+     */
+    static bool runPendingTaskThunk(void* worker);
+
+    /**
+     * @brief execute Execute task suppressing all exceptions.
+     */
+    void execute(Task& task);
+
+    /**
+     * @brief fireTimers Advance the timer wheel to current time and execute
+     * expired timers. Fired timers are accounted as posted tasks.
+     * @return Number of fired timers.
+     */
+    size_t fireTimers();
+
+    /**
+     * @brief pushLocal Push task posted from the executing thread to the
+     * queue of the priority level.
+     * @param level Priority level.
+     * @param handler Handler to be executed in executing thread.
+     * @return true on success.
+     */
+    template <typename Handler>
+    bool pushLocal(size_t level, Handler&& handler);
+
+    /**
+     * @brief popLocal Pop task from the LIFO slot or own queues. The slot
+     * goes first unless its limit of tasks in a row is reached.
+     * @param task Place for the task to be stored.
+     * @return true on success.
+     */
+    bool popLocal(Task& task);
+
+    /**
+     * @brief pushLifoSlot Put task posted from the executing thread to the
+     * LIFO slot, moving the previous one to the highest priority queue.
+     * @param handler Handler to be executed in executing thread.
+     * @return false if the previous task doesn't fit into the queue.
+     */
+    template <typename Handler>
+    bool pushLifoSlot(Handler&& handler);
+
+    /**
+     * @brief lockLifoSlot Wait until the LIFO slot is not locked by
+     * another thread and lock it.
+     * @return State of the slot before locking.
+     */
+    int lockLifoSlot();
+
+    /**
+     * @brief stealLifoSlots Take task from the LIFO slot of any sibling.
+     * @param task Place for the task to be stored.
+     * @return true on success.
+     */
+    bool stealLifoSlots(Task& task);
+
+    /**
+     * @brief popLevels Pop task from own queues. Level served first is
+     * rotated: level L goes first for every 8^L-th task, the others follow
+     * from the highest one.
+     * @param task Place for the task to be stored.
+     * @return true on success.
+     */
+    bool popLevels(Task& task);
+
+    /**
+     * @brief popLevel Pop task from own queues of the priority level.
+     * Publishes tasks to the shared queue if thieves requested it.
+     * @param level Priority level.
+     * @param task Place for the task to be stored.
+     * @return true on success.
+     */
+    bool popLevel(size_t level, Task& task);
+
+    /**
+     * @brief popQueues Pop task from the main and the overflow queues of
+     * the priority level.
+     * @param level Priority level.
+     * @param task Place for the task to be stored.
+     * @return true on success.
+     */
+    bool popQueues(size_t level, Task& task);
+
+    /**
+     * @brief publish Move the popped task and the following ones to the
+     * shared queue of the level for thieves to steal.
+     * @param level Priority level.
+     * @param task Task just popped from queues, replaced with the next one
+     * to be executed.
+     * @return true if a task to be executed is left.
+     */
+    bool publish(size_t level, Task& task);
+
+    /**
+     * @brief isSiblingThread Return true if current thread is the
+     * executing thread of another worker of the pool.
+     */
+    bool isSiblingThread() const;
+
+    /**
+     * @brief getTask Pop task from own queue or steal it from siblings.
+     * Wakes up a producer waiting for the freed slot.
+     * @param task Place for the task to be stored.
+     * @param steal_attempts Maximum number of sibling workers to probe.
+     * @return true on success.
+     */
+    bool getTask(Task& task, size_t steal_attempts);
+
+    /**
+     * @brief stealFromSiblings Try to steal tasks from sibling workers on
+     * the same NUMA node, then from the remote ones.
+     * @param task Place for stealed task to be stored.
+     * @param attempts Maximum number of sibling workers to probe on each
+     * node group.
+     * @return true on success.
+     */
+    bool stealFromSiblings(Task& task, size_t attempts);
+
+    /**
+     * @brief stealFrom Try to steal tasks from the listed workers starting
+     * from a randomly chosen one. All stolen tasks except the first one are
+     * moved to own queue.
+     * @param victims IDs of workers to steal from in ascending order.
+     * @param task Place for stealed task to be stored.
+     * @param attempts Maximum number of workers to probe. Only active
+     * workers are probed unless it covers all of them.
+     * @return true on success.
+     */
+    bool stealFrom(const std::vector<size_t>& victims, Task& task,
+                   size_t attempts);
+
+    /**
+     * @brief nextRandom Return next value of per-worker xorshift generator.
+     */
+    uint32_t nextRandom();
+
+    /**
+     * @brief park Block executing thread until wakeup() or stop() is called
+     * or the next timer deadline.
+     * @param task Place for the task found by the final queues check.
+     * @return true if a task was found instead of parking.
+     */
+    bool park(Task& task);
+
+    /**
+     * @brief cancelPark Withdraw the parking announcement.
+     */
+    void cancelPark();
+
+    /**
+     * @brief join Wake up the executing thread to see the changed running
+     * or retiring flag and wait until it is finished.
      */
-    void threadFunc(size_t id, Worker* steal_donor);
+    void join();
 
-    Queue<Task> m_queue;
+    std::vector<std::unique_ptr<Queue<Task>>> m_queues;
+    std::vector<std::unique_ptr<SegmentedQueue<Task>>> m_overflow;
+    bool m_spill_turn;
+    std::vector<std::unique_ptr<MPMCBoundedQueue<Task>>> m_shared;
+    std::atomic<bool> m_steal_requested;
+    size_t m_queue_size;
+    size_t m_pop_count;
+    Task m_lifo_slot;
+    std::atomic<int> m_lifo_state;
+    size_t m_lifo_streak;
+    size_t m_lifo_slot_limit;
     std::atomic<bool> m_running_flag;
+    std::atomic<bool> m_retiring_flag;
+    bool m_queues_placed;
+    std::atomic<bool> m_parked_flag;
+    std::atomic<std::chrono::steady_clock::rep> m_park_deadline;
+    std::atomic<size_t>* m_parked_count;
+    detail::Backpressure* m_backpressure;
+    detail::Backpressure* m_idle_waiters;
+    std::mutex m_park_mutex;
+    std::condition_variable m_park_cv;
+    size_t m_spin_count;
+    size_t m_yield_count;
+    size_t m_steal_attempts;
+    std::vector<Task> m_steal_buffer;
+    size_t m_id;
+    const WorkerList* m_workers;
+    const std::atomic<size_t>* m_active_count;
+    WorkerPlacement m_placement;
+    std::vector<size_t> m_near_victims;
+    std::vector<size_t> m_far_victims;
+    uint32_t m_random_state;
+    std::atomic<size_t> m_completed_count;
+    Stats m_stats;
     std::thread m_thread;
+    TimerWheel<Task> m_timers;
+
+    // Written by posters.
+    char m_pad0[detail::FALSE_SHARING_RANGE];
+    std::atomic<size_t> m_posted_count;
+    char m_pad1[detail::FALSE_SHARING_RANGE];
 };
 
 
@@ -90,90 +516,1076 @@ namespace detail
         static thread_local size_t tss_id = -1u;
         return &tss_id;
     }
+
+    inline void** thread_worker()
+    {
+        static thread_local void* tss_worker = nullptr;
+        return &tss_worker;
+    }
+
+    typedef bool (*PendingTaskRunner)(void* worker);
+
+    inline PendingTaskRunner* thread_pending_task_runner()
+    {
+        static thread_local PendingTaskRunner tss_runner = nullptr;
+        return &tss_runner;
+    }
+
+    /**
+     * @brief run_pending_task Execute one pending task of the worker owning
+     * current thread.
+     * @return false if there is no pending task or current thread is not a
+     * worker thread.
+     */
+    inline bool run_pending_task()
+    {
+        PendingTaskRunner runner = *thread_pending_task_runner();
+        return runner && runner(*thread_worker());
+    }
 }
 
-template <typename Task, template<typename> class Queue>
-inline Worker<Task, Queue>::Worker(size_t queue_size)
-    : m_queue(queue_size)
+template <typename Task, template<typename> class Queue, typename Stats>
+inline Worker<Task, Queue, Stats>::Worker(const ThreadPoolOptions& options)
+    : m_queues(options.priorityLevels())
+    , m_spill_turn(false)
+    , m_steal_requested(false)
+    , m_queue_size(options.queueSize())
+    , m_pop_count(0)
+    , m_lifo_state(LIFO_EMPTY)
+    , m_lifo_streak(0)
+    , m_lifo_slot_limit(options.lifoSlotLimit())
     , m_running_flag(true)
+    , m_retiring_flag(false)
+    , m_queues_placed(false)
+    , m_parked_flag(false)
+    , m_park_deadline(0)
+    , m_parked_count(nullptr)
+    , m_backpressure(nullptr)
+    , m_idle_waiters(nullptr)
+    , m_spin_count(options.spinCount())
+    , m_yield_count(options.yieldCount())
+    , m_steal_attempts(options.stealAttempts())
+    , m_steal_buffer(options.stealBatchSize())
+    , m_id(0)
+    , m_workers(nullptr)
+    , m_active_count(nullptr)
+    , m_random_state(1)
+    , m_completed_count(0)
+    , m_timers(options.timerResolution())
+    , m_posted_count(0)
 {
+    for (auto& queue : m_queues)
+    {
+        queue.reset(new Queue<Task>(m_queue_size));
+    }
+
+    if (options.overflowPolicy() == OverflowPolicy::Spill ||
+        !options.stealKeyedTasks())
+    {
+        m_overflow.resize(m_queues.size());
+        for (auto& queue : m_overflow)
+        {
+            queue.reset(new SegmentedQueue<Task>());
+        }
+    }
+
+    if (detail::single_consumer<Queue<Task>>())
+    {
+        m_shared.resize(m_queues.size());
+        for (auto& queue : m_shared)
+        {
+            queue.reset(new MPMCBoundedQueue<Task>(m_queue_size));
+        }
+    }
 }
 
-template <typename Task, template<typename> class Queue>
-inline Worker<Task, Queue>::Worker(Worker&& rhs) noexcept
+template <typename Task, template<typename> class Queue, typename Stats>
+inline Worker<Task, Queue, Stats>::Worker(Worker&& rhs) noexcept
 {
     *this = rhs;
 }
 
-template <typename Task, template<typename> class Queue>
-inline Worker<Task, Queue>& Worker<Task, Queue>::operator=(Worker&& rhs) noexcept
+template <typename Task, template<typename> class Queue, typename Stats>
+inline Worker<Task, Queue, Stats>& Worker<Task, Queue, Stats>::operator=(Worker&& rhs) noexcept
 {
     if (this != &rhs)
     {
-        m_queue = std::move(rhs.m_queue);
+        m_queues = std::move(rhs.m_queues);
+        m_overflow = std::move(rhs.m_overflow);
+        m_shared = std::move(rhs.m_shared);
+        m_steal_requested = rhs.m_steal_requested.load();
+        m_spill_turn = rhs.m_spill_turn;
+        m_queue_size = rhs.m_queue_size;
+        m_pop_count = rhs.m_pop_count;
+        m_lifo_slot = std::move(rhs.m_lifo_slot);
+        m_lifo_state = rhs.m_lifo_state.load();
+        m_lifo_streak = rhs.m_lifo_streak;
+        m_lifo_slot_limit = rhs.m_lifo_slot_limit;
         m_running_flag = rhs.m_running_flag.load();
+        m_retiring_flag = rhs.m_retiring_flag.load();
+        m_queues_placed = rhs.m_queues_placed;
+        m_parked_flag = rhs.m_parked_flag.load();
+        m_park_deadline = rhs.m_park_deadline.load();
+        m_parked_count = rhs.m_parked_count;
+        m_backpressure = rhs.m_backpressure;
+        m_idle_waiters = rhs.m_idle_waiters;
+        m_spin_count = rhs.m_spin_count;
+        m_yield_count = rhs.m_yield_count;
+        m_steal_attempts = rhs.m_steal_attempts;
+        m_steal_buffer = std::move(rhs.m_steal_buffer);
+        m_id = rhs.m_id;
+        m_workers = rhs.m_workers;
+        m_active_count = rhs.m_active_count;
+        m_placement = rhs.m_placement;
+        m_near_victims = std::move(rhs.m_near_victims);
+        m_far_victims = std::move(rhs.m_far_victims);
+        m_random_state = rhs.m_random_state;
+        m_completed_count = rhs.m_completed_count.load();
+        m_posted_count = rhs.m_posted_count.load();
         m_thread = std::move(rhs.m_thread);
     }
     return *this;
 }
 
-template <typename Task, template<typename> class Queue>
-inline void Worker<Task, Queue>::stop()
+template <typename Task, template<typename> class Queue, typename Stats>
+inline void Worker<Task, Queue, Stats>::stop()
 {
+    if (!m_thread.joinable())
+    {
+        return;
+    }
+
     m_running_flag.store(false, std::memory_order_relaxed);
+    join();
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline void Worker<Task, Queue, Stats>::retire()
+{
+    if (!m_thread.joinable())
+    {
+        return;
+    }
+
+    m_retiring_flag.store(true, std::memory_order_relaxed);
+    join();
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline void Worker<Task, Queue, Stats>::join()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_park_mutex);
+    }
+    m_park_cv.notify_one();
     m_thread.join();
 }
 
-template <typename Task, template<typename> class Queue>
-inline void Worker<Task, Queue>::start(size_t id, Worker* steal_donor)
+template <typename Task, template<typename> class Queue, typename Stats>
+inline void Worker<Task, Queue, Stats>::dropPending()
 {
-    m_thread = std::thread(&Worker<Task, Queue>::threadFunc, this, id, steal_donor);
+    // The executing thread is joined, so queues may be popped from here.
+    size_t dropped = 0;
+    Task task;
+    if (popLifoSlot(task))
+    {
+        task = Task();
+        ++dropped;
+    }
+    for (size_t level = 0; level < m_queues.size(); ++level)
+    {
+        while (popQueues(level, task) ||
+               (!m_shared.empty() && m_shared[level]->pop(task)))
+        {
+            task = Task();
+            ++dropped;
+        }
+    }
+
+    m_completed_count.store(
+        m_completed_count.load(std::memory_order_relaxed) + dropped,
+        std::memory_order_release);
+
+    // Timers are not pending tasks until they fire.
+    m_timers.clear();
 }
 
-template <typename Task, template<typename> class Queue>
-inline size_t Worker<Task, Queue>::getWorkerIdForCurrentThread()
+template <typename Task, template<typename> class Queue, typename Stats>
+inline void Worker<Task, Queue, Stats>::countPosted(size_t count)
 {
-    return *detail::thread_id();
+    // Posted tasks are published to workers by the queues with release
+    // semantics.
+    m_posted_count.fetch_add(count, std::memory_order_relaxed);
 }
 
-template <typename Task, template<typename> class Queue>
-template <typename Handler>
-inline bool Worker<Task, Queue>::post(Handler&& handler)
+template <typename Task, template<typename> class Queue, typename Stats>
+inline void Worker<Task, Queue, Stats>::discountPosted(size_t count)
 {
-    return m_queue.push(std::forward<Handler>(handler));
+    m_posted_count.fetch_sub(count, std::memory_order_relaxed);
+
+    // Pairs with the fence in Backpressure::waitUntil: either the idle
+    // waiter sees the withdrawn tasks or it is woken up here.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    m_idle_waiters->notifyIdle();
 }
 
-template <typename Task, template<typename> class Queue>
-inline bool Worker<Task, Queue>::steal(Task& task)
+template <typename Task, template<typename> class Queue, typename Stats>
+inline size_t Worker<Task, Queue, Stats>::postedCount() const
 {
-    return m_queue.pop(task);
+    return m_posted_count.load(std::memory_order_acquire);
 }
 
-template <typename Task, template<typename> class Queue>
-inline void Worker<Task, Queue>::threadFunc(size_t id, Worker* steal_donor)
+template <typename Task, template<typename> class Queue, typename Stats>
+inline size_t Worker<Task, Queue, Stats>::completedCount() const
 {
-    *detail::thread_id() = id;
+    return m_completed_count.load(std::memory_order_acquire);
+}
 
-    Task handler;
+template <typename Task, template<typename> class Queue, typename Stats>
+inline void Worker<Task, Queue, Stats>::attach(
+    size_t id, const WorkerList* workers,
+    const std::atomic<size_t>* active_count,
+    const std::vector<WorkerPlacement>& placements,
+    std::atomic<size_t>* parked_count, detail::Backpressure* backpressure,
+    detail::Backpressure* idle_waiters)
+{
+    m_id = id;
+    m_placement = placements[id];
+    rebind(workers, active_count, parked_count, backpressure, idle_waiters);
+    // Xorshift state must be non-zero.
+    m_random_state = static_cast<uint32_t>(id) * 2654435761u + 1u;
 
-    while (m_running_flag.load(std::memory_order_relaxed))
+    for (size_t i = 0; i < placements.size(); ++i)
     {
-        if (m_queue.pop(handler) || steal_donor->steal(handler))
+        if (i != id)
         {
-            try
-            {
-                handler();
-            }
-            catch(...)
-            {
-                // suppress all exceptions
-            }
+            (placements[i].node == m_placement.node ? m_near_victims
+                                                    : m_far_victims)
+                .push_back(i);
         }
-        else
+    }
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline void Worker<Task, Queue, Stats>::rebind(
+    const WorkerList* workers, const std::atomic<size_t>* active_count,
+    std::atomic<size_t>* parked_count, detail::Backpressure* backpressure,
+    detail::Backpressure* idle_waiters)
+{
+    m_workers = workers;
+    m_active_count = active_count;
+    m_parked_count = parked_count;
+    m_backpressure = backpressure;
+    m_idle_waiters = idle_waiters;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline void Worker<Task, Queue, Stats>::start(std::shared_future<void> go)
+{
+    m_running_flag.store(true, std::memory_order_relaxed);
+    m_retiring_flag.store(false, std::memory_order_relaxed);
+
+    std::promise<void> started;
+    m_thread = std::thread(&Worker<Task, Queue, Stats>::threadFunc, this,
+                           &started, std::move(go));
+    started.get_future().wait();
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline size_t Worker<Task, Queue, Stats>::getWorkerIdForCurrentThread()
+{
+    return *detail::thread_id();
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+template <typename Handler>
+inline bool Worker<Task, Queue, Stats>::post(Handler&& handler,
+                                             size_t priority)
+{
+    const size_t level = std::min(priority, m_queues.size() - 1);
+    Queue<Task>& queue = *m_queues[level];
+
+    bool ok;
+    if (*detail::thread_worker() == this && level == 0 &&
+        m_lifo_slot_limit != 0)
+    {
+        ok = pushLifoSlot(std::forward<Handler>(handler));
+    }
+    else if (*detail::thread_worker() == this)
+    {
+        ok = pushLocal(level, std::forward<Handler>(handler));
+    }
+    else
+    {
+        ok = !(detail::single_producer<Queue<Task>>() && isSiblingThread())
+            && queue.push(std::forward<Handler>(handler));
+    }
+
+    if (!ok)
+    {
+        m_stats.onRejectedPost();
+    }
+
+    return ok;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline void Worker<Task, Queue, Stats>::handOverOverflow(Worker& worker)
+{
+    Task task;
+    for (size_t level = 0; level < m_overflow.size(); ++level)
+    {
+        while (m_overflow[level]->pop(task))
         {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            worker.m_overflow[level]->push(std::move(task));
         }
     }
 }
 
+template <typename Task, template<typename> class Queue, typename Stats>
+inline void Worker<Task, Queue, Stats>::postTimer(
+    detail::TimerTask<Task>* timer)
+{
+    if (*detail::thread_worker() == this)
+    {
+        m_timers.insert(timer);
+        return;
+    }
+
+    m_timers.push(timer);
+
+    // Pairs with the fence in park: either the worker sees the timer
+    // before sleeping, or it is seen parked here with the deadline it
+    // sleeps until.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_parked_flag.load(std::memory_order_relaxed) &&
+        timer->deadline.time_since_epoch().count() <
+            m_park_deadline.load(std::memory_order_relaxed))
+    {
+        wakeup();
+    }
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline void Worker<Task, Queue, Stats>::handOverTimers(Worker& worker)
+{
+    m_timers.handOver(worker.m_timers);
+
+    // The taking worker may sleep until a later deadline.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    worker.wakeup();
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+template <typename Handler>
+inline void Worker<Task, Queue, Stats>::spill(Handler&& handler,
+                                              size_t priority)
+{
+    m_overflow[std::min(priority, m_overflow.size() - 1)]->push(
+        std::forward<Handler>(handler));
+    m_stats.onSpilledPost();
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+template <typename Handler>
+inline void Worker<Task, Queue, Stats>::pin(Handler&& handler,
+                                            size_t priority)
+{
+    m_overflow[std::min(priority, m_overflow.size() - 1)]->push(
+        std::forward<Handler>(handler));
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+template <typename Iterator>
+inline size_t Worker<Task, Queue, Stats>::postBatch(Iterator first, Iterator last)
+{
+    if (*detail::thread_worker() == this)
+    {
+        return m_shared.empty()
+            ? detail::push_local_batch(*m_queues[0], first, last)
+            : m_shared[0]->pushBatch(first, last);
+    }
+
+    if (detail::single_producer<Queue<Task>>() && isSiblingThread())
+    {
+        return 0;
+    }
+
+    return detail::push_batch(*m_queues[0], first, last);
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline bool Worker<Task, Queue, Stats>::steal(Task& task)
+{
+    size_t priority;
+    return stealBatch(&task, 1, priority) != 0;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline size_t Worker<Task, Queue, Stats>::stealBatch(Task* tasks,
+                                                     size_t max_count,
+                                                     size_t& priority)
+{
+    if (!m_shared.empty())
+    {
+        for (priority = 0; priority < m_shared.size(); ++priority)
+        {
+            const size_t stolen =
+                detail::steal_batch(*m_shared[priority], tasks, max_count);
+            if (stolen != 0)
+            {
+                return stolen;
+            }
+        }
+
+        // Avoid writing the line the owner reads on every pop while it
+        // hasn't served the request yet.
+        if (!m_steal_requested.load(std::memory_order_relaxed))
+        {
+            m_steal_requested.store(true, std::memory_order_relaxed);
+        }
+        return 0;
+    }
+
+    for (priority = 0; priority < m_queues.size(); ++priority)
+    {
+        const size_t stolen =
+            detail::steal_batch(*m_queues[priority], tasks, max_count);
+        if (stolen != 0)
+        {
+            return stolen;
+        }
+    }
+
+    return 0;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline bool Worker<Task, Queue, Stats>::runPendingTask()
+{
+    Task task;
+
+    if (getTask(task, m_steal_attempts))
+    {
+        execute(task);
+        return true;
+    }
+
+    return false;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline bool Worker<Task, Queue, Stats>::runPendingTaskThunk(void* worker)
+{
+    return static_cast<Worker*>(worker)->runPendingTask();
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline void Worker<Task, Queue, Stats>::execute(Task& task)
+{
+    try
+    {
+        task();
+    }
+    catch(...)
+    {
+        // suppress all exceptions
+    }
+
+    // Written by this thread only, the pool reads it to detect idleness.
+    m_completed_count.store(
+        m_completed_count.load(std::memory_order_relaxed) + 1,
+        std::memory_order_release);
+
+    m_stats.onTaskExecuted();
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+template <typename Handler>
+inline bool Worker<Task, Queue, Stats>::pushLocal(size_t level,
+                                                  Handler&& handler)
+{
+    return m_shared.empty()
+        ? detail::push_local(*m_queues[level], std::forward<Handler>(handler))
+        : m_shared[level]->push(std::forward<Handler>(handler));
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+template <typename Handler>
+inline bool Worker<Task, Queue, Stats>::pushLifoSlot(Handler&& handler)
+{
+    // The displaced task is queued first, so a full queue leaves both tasks
+    // where they are.
+    if (lockLifoSlot() == LIFO_FULL &&
+        !pushLocal(0, std::move(m_lifo_slot)))
+    {
+        m_lifo_state.store(LIFO_FULL, std::memory_order_release);
+        return false;
+    }
+
+    try
+    {
+        m_lifo_slot = Task(std::forward<Handler>(handler));
+    }
+    catch(...)
+    {
+        m_lifo_state.store(LIFO_EMPTY, std::memory_order_release);
+        throw;
+    }
+
+    m_lifo_state.store(LIFO_FULL, std::memory_order_release);
+    return true;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline int Worker<Task, Queue, Stats>::lockLifoSlot()
+{
+    // Siblings lock the slot for the time of a move only.
+    for (;;)
+    {
+        int state = m_lifo_state.load(std::memory_order_relaxed);
+        if (state != LIFO_LOCKED &&
+            m_lifo_state.compare_exchange_weak(state, LIFO_LOCKED,
+                                               std::memory_order_acquire,
+                                               std::memory_order_relaxed))
+        {
+            return state;
+        }
+        detail::cpuRelax();
+    }
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline bool Worker<Task, Queue, Stats>::popLifoSlot(Task& task)
+{
+    int state = LIFO_FULL;
+    if (m_lifo_state.load(std::memory_order_relaxed) != LIFO_FULL ||
+        !m_lifo_state.compare_exchange_strong(state, LIFO_LOCKED,
+                                              std::memory_order_acquire,
+                                              std::memory_order_relaxed))
+    {
+        return false;
+    }
+
+    task = std::move(m_lifo_slot);
+    m_lifo_slot = Task();
+    m_lifo_state.store(LIFO_EMPTY, std::memory_order_release);
+    return true;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline bool Worker<Task, Queue, Stats>::stealLifoSlots(Task& task)
+{
+    // Retired workers empty their slots before they exit.
+    const size_t active = m_active_count->load(std::memory_order_relaxed);
+    for (size_t id : m_near_victims)
+    {
+        if (id >= active)
+        {
+            break;
+        }
+        if ((*m_workers)[id]->popLifoSlot(task))
+        {
+            return true;
+        }
+    }
+    for (size_t id : m_far_victims)
+    {
+        if (id >= active)
+        {
+            break;
+        }
+        if ((*m_workers)[id]->popLifoSlot(task))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline bool Worker<Task, Queue, Stats>::popLocal(Task& task)
+{
+    if (m_lifo_streak < m_lifo_slot_limit && popLifoSlot(task))
+    {
+        ++m_lifo_streak;
+        return true;
+    }
+
+    // Either the slot is empty or its limit is reached, then it still goes
+    // if the queues are empty.
+    m_lifo_streak = 0;
+    if (popLevels(task))
+    {
+        return true;
+    }
+
+    if (popLifoSlot(task))
+    {
+        m_lifo_streak = 1;
+        return true;
+    }
+
+    return false;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline bool Worker<Task, Queue, Stats>::popLevels(Task& task)
+{
+    const size_t levels = m_queues.size();
+    if (levels == 1)
+    {
+        return popLevel(0, task);
+    }
+
+    // Number of trailing groups of AGING_BITS one bits selects the level
+    // to be served first.
+    size_t first = 0;
+    for (size_t count = m_pop_count;
+         (count & AGING_MASK) == AGING_MASK && first + 1 < levels;
+         count >>= AGING_BITS)
+    {
+        ++first;
+    }
+
+    bool found = popLevel(first, task);
+    for (size_t level = 0; !found && level < levels; ++level)
+    {
+        found = level != first && popLevel(level, task);
+    }
+
+    if (found)
+    {
+        ++m_pop_count;
+    }
+
+    return found;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline bool Worker<Task, Queue, Stats>::popLevel(size_t level, Task& task)
+{
+    if (m_shared.empty())
+    {
+        return popQueues(level, task);
+    }
+
+    if (m_shared[level]->pop(task))
+    {
+        return true;
+    }
+
+    if (!popQueues(level, task))
+    {
+        return false;
+    }
+
+    if (m_steal_requested.load(std::memory_order_relaxed) &&
+        m_steal_requested.exchange(false, std::memory_order_relaxed))
+    {
+        return publish(level, task);
+    }
+
+    return true;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline bool Worker<Task, Queue, Stats>::popQueues(size_t level, Task& task)
+{
+    Queue<Task>& queue = *m_queues[level];
+    if (m_overflow.empty())
+    {
+        return detail::pop_local(queue, task);
+    }
+
+    // New posts keep refilling the main queue under overload, so it is
+    // served in turns with the overflow queue to let neither of them
+    // starve.
+    SegmentedQueue<Task>& overflow = *m_overflow[level];
+    m_spill_turn = !m_spill_turn;
+    if (m_spill_turn)
+    {
+        return overflow.pop(task) || detail::pop_local(queue, task);
+    }
+
+    return detail::pop_local(queue, task) || overflow.pop(task);
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline bool Worker<Task, Queue, Stats>::publish(size_t level, Task& task)
+{
+    MPMCBoundedQueue<Task>& shared = *m_shared[level];
+
+    // Failed push leaves the task untouched, so it is executed here.
+    bool found = true;
+    for (size_t i = 0; i < m_steal_buffer.size(); ++i)
+    {
+        if (!shared.push(std::move(task)))
+        {
+            break;
+        }
+
+        if (!popQueues(level, task))
+        {
+            // Everything was published, take a task back unless it is
+            // stolen already.
+            found = shared.pop(task);
+            break;
+        }
+    }
+
+    // Thieves parked since the request are not woken up by posts to this
+    // worker.
+    if (m_parked_count->load(std::memory_order_relaxed) != 0)
+    {
+        const size_t active =
+            m_active_count->load(std::memory_order_relaxed);
+        for (size_t id : m_near_victims)
+        {
+            if (id >= active)
+            {
+                break;
+            }
+            if ((*m_workers)[id]->wakeup())
+            {
+                return found;
+            }
+        }
+        for (size_t id : m_far_victims)
+        {
+            if (id >= active)
+            {
+                break;
+            }
+            if ((*m_workers)[id]->wakeup())
+            {
+                return found;
+            }
+        }
+    }
+
+    return found;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline bool Worker<Task, Queue, Stats>::isSiblingThread() const
+{
+    const size_t id = *detail::thread_id();
+    return id < m_workers->size() &&
+           (*m_workers)[id].get() == *detail::thread_worker();
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline bool Worker<Task, Queue, Stats>::getTask(Task& task,
+                                                size_t steal_attempts)
+{
+    if (popLocal(task))
+    {
+        m_stats.onLocalPop();
+        m_backpressure->notify();
+        return true;
+    }
+
+    if (stealFromSiblings(task, steal_attempts))
+    {
+        m_stats.onSteal();
+        m_backpressure->notify();
+        return true;
+    }
+
+    m_stats.onFailedSteal();
+    return false;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline const Stats& Worker<Task, Queue, Stats>::stats() const
+{
+    return m_stats;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline bool Worker<Task, Queue, Stats>::wakeup()
+{
+    if (!m_parked_flag.load(std::memory_order_relaxed))
+    {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_park_mutex);
+        if (!m_parked_flag.exchange(false, std::memory_order_relaxed))
+        {
+            return false;
+        }
+    }
+
+    m_parked_count->fetch_sub(1, std::memory_order_relaxed);
+    m_park_cv.notify_one();
+    return true;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline void Worker<Task, Queue, Stats>::cancelPark()
+{
+    if (m_parked_flag.exchange(false, std::memory_order_relaxed))
+    {
+        m_parked_count->fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline uint32_t Worker<Task, Queue, Stats>::nextRandom()
+{
+    uint32_t x = m_random_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    m_random_state = x;
+    return x;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline bool Worker<Task, Queue, Stats>::stealFromSiblings(Task& task,
+                                                          size_t attempts)
+{
+    return stealFrom(m_near_victims, task, attempts) ||
+           stealFrom(m_far_victims, task, attempts);
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline bool Worker<Task, Queue, Stats>::stealFrom(
+    const std::vector<size_t>& victims, Task& task, size_t attempts)
+{
+    // Victims are sorted by ID, so active workers come first and probes
+    // are spread over them only. Probing every sibling also covers retired
+    // workers, which may still receive tasks from posters that have read
+    // the previous count.
+    size_t count = victims.size();
+    if (attempts < count)
+    {
+        count = std::lower_bound(victims.begin(), victims.end(),
+                                 m_active_count->load(
+                                     std::memory_order_relaxed)) -
+                victims.begin();
+    }
+    if (count == 0)
+    {
+        return false;
+    }
+
+    attempts = std::min(attempts, count);
+
+    size_t victim = nextRandom() % count;
+    for (size_t i = 0; i < attempts; ++i)
+    {
+        size_t priority;
+        const size_t stolen = (*m_workers)[victims[victim]]->stealBatch(
+            m_steal_buffer.data(), m_steal_buffer.size(), priority);
+        if (stolen != 0)
+        {
+            task = std::move(m_steal_buffer[0]);
+            for (size_t j = 1; j < stolen; ++j)
+            {
+                if (!detail::push_local(*m_queues[priority],
+                                        std::move(m_steal_buffer[j])))
+                {
+                    // The local queue is full: run the rest of the batch
+                    // in order right after the first task, returning the
+                    // last one.
+                    execute(task);
+                    for (; j + 1 < stolen; ++j)
+                    {
+                        execute(m_steal_buffer[j]);
+                    }
+                    task = std::move(m_steal_buffer[stolen - 1]);
+                    break;
+                }
+            }
+            return true;
+        }
+
+        if (++victim == count)
+        {
+            victim = 0;
+        }
+    }
+
+    return false;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline size_t Worker<Task, Queue, Stats>::fireTimers()
+{
+    return m_timers.advance(std::chrono::steady_clock::now(),
+        [this](Task& task)
+        {
+            countPosted(1);
+            execute(task);
+        });
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline bool Worker<Task, Queue, Stats>::park(Task& task)
+{
+    const std::chrono::steady_clock::time_point deadline =
+        m_timers.nextDeadline();
+    m_park_deadline.store(deadline.time_since_epoch().count(),
+                          std::memory_order_relaxed);
+    m_parked_flag.store(true, std::memory_order_relaxed);
+    m_parked_count->fetch_add(1, std::memory_order_relaxed);
+
+    // Pairs with the fence in ThreadPoolImpl::tryPost: either the poster
+    // sees this worker parked or the check below sees the posted task.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    // The same fence pairs with Backpressure::waitUntil: a producer which
+    // didn't see slots freed by this worker, or a thread waiting for the
+    // pool to become idle which didn't see tasks completed by it, is seen
+    // here.
+    m_backpressure->notifyIdle();
+    m_idle_waiters->notifyIdle();
+
+    // Probe every sibling to not leave stealable work behind while parked.
+    if (getTask(task, m_workers->size()))
+    {
+        cancelPark();
+        return true;
+    }
+
+    // Tasks left in LIFO slots are taken last, their workers may be blocked
+    // in tasks waiting for them.
+    if (stealLifoSlots(task))
+    {
+        m_stats.onSteal();
+        cancelPark();
+        return true;
+    }
+
+    // Timers pushed meanwhile are linked by the thread loop.
+    if (m_timers.hasIncoming())
+    {
+        cancelPark();
+        return false;
+    }
+
+    m_stats.onIdleSleep();
+
+    {
+        auto woken_up = [this]()
+        {
+            return !m_parked_flag.load(std::memory_order_relaxed) ||
+                   !m_running_flag.load(std::memory_order_relaxed) ||
+                   m_retiring_flag.load(std::memory_order_relaxed);
+        };
+
+        std::unique_lock<std::mutex> lock(m_park_mutex);
+        if (deadline == std::chrono::steady_clock::time_point::max())
+        {
+            m_park_cv.wait(lock, woken_up);
+        }
+        else
+        {
+            m_park_cv.wait_until(lock, deadline, woken_up);
+        }
+    }
+
+    cancelPark();
+    return false;
+}
+
+template <typename Task, template<typename> class Queue, typename Stats>
+inline void Worker<Task, Queue, Stats>::threadFunc(
+    std::promise<void>* started, std::shared_future<void> go)
+{
+    if (m_placement.cpu != WorkerPlacement::NO_CPU &&
+        detail::pin_current_thread(m_placement.cpu) && !m_queues_placed)
+    {
+        // Nobody accesses the queues until all workers are started. They
+        // are touched first by the pinned thread now, so the kernel places
+        // the pages on the local NUMA node.
+        m_queues_placed = true;
+        for (auto& queue : m_queues)
+        {
+            queue.reset(new Queue<Task>(m_queue_size));
+        }
+        for (auto& queue : m_shared)
+        {
+            queue.reset(new MPMCBoundedQueue<Task>(m_queue_size));
+        }
+    }
+    started->set_value();
+    go.wait();
+
+    *detail::thread_id() = m_id;
+    *detail::thread_worker() = this;
+    *detail::thread_pending_task_runner() = &Worker::runPendingTaskThunk;
+    m_stats.onThreadStart();
+
+    Task handler;
+    IdleStrategy idle_strategy(m_spin_count, m_yield_count);
+    bool busy = false;
+
+    while (m_running_flag.load(std::memory_order_relaxed))
+    {
+        if (!m_timers.empty() && fireTimers() != 0)
+        {
+            idle_strategy.reset();
+        }
+
+        if (m_retiring_flag.load(std::memory_order_relaxed))
+        {
+            // Stealing is over, tasks still posted here are taken by
+            // siblings once the queues are left.
+            if (!popLocal(handler))
+            {
+                break;
+            }
+            m_stats.onLocalPop();
+            m_backpressure->notify();
+        }
+        else if (getTask(handler, m_steal_attempts))
+        {
+            idle_strategy.reset();
+        }
+        else
+        {
+            if (busy)
+            {
+                m_stats.onIdle();
+                busy = false;
+            }
+
+            if (idle_strategy.idle())
+            {
+                continue;
+            }
+
+            idle_strategy.reset();
+            if (!park(handler))
+            {
+                continue;
+            }
+        }
+
+        if (!busy)
+        {
+            m_stats.onBusy();
+            busy = true;
+        }
+
+        execute(handler);
+    }
+
+    // Account the last period.
+    if (busy)
+    {
+        m_stats.onIdle();
+    }
+    else
+    {
+        m_stats.onBusy();
+    }
+}
+
 }
@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/coroutine.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    tp::CoTask<int> square(int value)
+    {
+        co_return value * value;
+    }
+
+    tp::CoTask<int> squareOn(tp::ThreadPool& pool, int value)
+    {
+        co_await tp::scheduleOn(pool);
+        co_return value * value;
+    }
+
+    tp::CoTask<void> fail()
+    {
+        throw std::runtime_error("failed");
+        co_return;
+    }
+}
+
+TEST(Coroutine, scheduleOn)
+{
+    tp::ThreadPool pool;
+
+    auto task = [](tp::ThreadPool& pool) -> tp::CoTask<std::thread::id>
+    {
+        co_await tp::scheduleOn(pool);
+        co_return std::this_thread::get_id();
+    };
+
+    ASSERT_NE(std::this_thread::get_id(), tp::syncWait(task(pool)));
+}
+
+TEST(Coroutine, scheduleOnFromWorker)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    tp::ThreadPool pool(options);
+
+    // Posted to the local queue of the single worker.
+    auto task = [](tp::ThreadPool& pool) -> tp::CoTask<bool>
+    {
+        co_await tp::scheduleOn(pool);
+        const std::thread::id worker = std::this_thread::get_id();
+        for (int i = 0; i < 100; ++i)
+        {
+            co_await tp::scheduleOn(pool);
+        }
+        co_return worker == std::this_thread::get_id();
+    };
+
+    ASSERT_TRUE(tp::syncWait(task(pool)));
+}
+
+TEST(Coroutine, result)
+{
+    auto task = []() -> tp::CoTask<int>
+    {
+        const int a = co_await square(3);
+        const int b = co_await square(4);
+        co_return a + b;
+    };
+
+    tp::CoTask<int> sum = task();
+    ASSERT_TRUE(sum.valid());
+    ASSERT_FALSE(sum.done());
+    ASSERT_EQ(25, tp::syncWait(std::move(sum)));
+
+    tp::CoTask<int> empty;
+    ASSERT_FALSE(empty.valid());
+}
+
+TEST(Coroutine, exception)
+{
+    auto task = []() -> tp::CoTask<int>
+    {
+        co_await fail();
+        co_return 1;
+    };
+
+    ASSERT_THROW(tp::syncWait(task()), std::runtime_error);
+}
+
+TEST(Coroutine, symmetricTransfer)
+{
+    // Finished tasks resume the awaiting coroutine by symmetric transfer,
+    // otherwise the loop would overflow the stack. Unoptimized GCC builds
+    // don't turn the transfer into a tail call, so fewer are made there.
+#ifdef __OPTIMIZE__
+    static const int COUNT = 1000000;
+#else
+    static const int COUNT = 10000;
+#endif
+
+    auto task = []() -> tp::CoTask<long>
+    {
+        long sum = 0;
+        for (int i = 0; i < COUNT; ++i)
+        {
+            sum += co_await square(1);
+        }
+        co_return sum;
+    };
+
+    ASSERT_EQ(COUNT, tp::syncWait(task()));
+}
+
+TEST(Coroutine, whenAll)
+{
+    tp::ThreadPool pool;
+
+    std::vector<tp::CoTask<int>> tasks;
+    for (int i = 0; i < 1000; ++i)
+    {
+        tasks.push_back(squareOn(pool, i));
+    }
+
+    const std::vector<int> results =
+        tp::syncWait(tp::whenAll(std::move(tasks)));
+    ASSERT_EQ(1000u, results.size());
+    for (int i = 0; i < 1000; ++i)
+    {
+        ASSERT_EQ(i * i, results[i]);
+    }
+
+    ASSERT_TRUE(tp::syncWait(tp::whenAll(std::vector<tp::CoTask<int>>()))
+                    .empty());
+}
+
+TEST(Coroutine, whenAllVoid)
+{
+    tp::ThreadPool pool;
+    std::atomic<int> counter(0);
+
+    auto increment = [](tp::ThreadPool& pool,
+                        std::atomic<int>& counter) -> tp::CoTask<void>
+    {
+        co_await tp::scheduleOn(pool);
+        ++counter;
+    };
+
+    std::vector<tp::CoTask<void>> tasks;
+    for (int i = 0; i < 1000; ++i)
+    {
+        tasks.push_back(increment(pool, counter));
+    }
+    tp::syncWait(tp::whenAll(std::move(tasks)));
+    ASSERT_EQ(1000, counter.load());
+
+    // All tasks finish before the exception is rethrown.
+    tasks.clear();
+    tasks.push_back(increment(pool, counter));
+    tasks.push_back(fail());
+    tasks.push_back(increment(pool, counter));
+    ASSERT_THROW(tp::syncWait(tp::whenAll(std::move(tasks))),
+                 std::runtime_error);
+    ASSERT_EQ(1002, counter.load());
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
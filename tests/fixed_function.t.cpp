@@ -2,9 +2,14 @@
 
 #include <thread_pool/fixed_function.hpp>
 
+#include <array>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include <functional>
+#include <vector>
 
 int test_free_func(int i)
 {
@@ -187,6 +192,136 @@ TEST(FixedFunction, lambda)
     ASSERT_EQ(s1, f1());
 }
 
+TEST(FixedFunction, movedFromIsEmpty)
+{
+    int value = 0;
+    tp::FixedFunction<void(int)> f([&value](int v)
+    {
+        value = v;
+    });
+    ASSERT_THROW(tp::FixedFunction<void(int)>()(1), std::runtime_error);
+
+    // Trivially copyable lambda is moved by memcpy.
+    tp::FixedFunction<void(int)> f1(std::move(f));
+    f1(42);
+    ASSERT_EQ(42, value);
+    ASSERT_THROW(f(1), std::runtime_error);
+}
+
+TEST(FixedFunction, relocateToLarger)
+{
+    std::shared_ptr<int> counter = std::make_shared<int>(0);
+    tp::FixedFunction<int(), 32> small([counter]()
+    {
+        return ++*counter;
+    });
+
+    // The object is relocated, not wrapped by the larger function.
+    tp::FixedFunction<int(), 128> large(std::move(small));
+    ASSERT_THROW(small(), std::runtime_error);
+    ASSERT_EQ(1, large());
+    ASSERT_EQ(2, counter.use_count());
+
+    tp::FixedFunction<int(), 256, true> heap;
+    heap = std::move(large);
+    ASSERT_EQ(2, heap());
+
+    heap = tp::FixedFunction<int(), 256, true>();
+    ASSERT_EQ(1, counter.use_count());
+}
+
+TEST(FixedFunction, emplace)
+{
+    static size_t mov = 0;
+    struct cnt {
+        std::string payload;
+        cnt() {}
+        cnt(cnt &&o) { payload = std::move(o.payload); mov++;}
+        std::string operator()() { return payload; }
+    };
+
+    tp::FixedFunction<std::string()> f(str_fun);
+
+    // Assigned object is constructed in place, no temporary function.
+    cnt c;
+    c.payload = "xyz";
+    f = std::move(c);
+    ASSERT_EQ(1u, mov);
+    ASSERT_EQ(std::string("xyz"), f());
+
+    const std::string s1 = "s1";
+    f.emplace([s1]()
+    {
+        return s1;
+    });
+    ASSERT_EQ(s1, f());
+}
+
+TEST(FixedFunction, heapFallback)
+{
+    std::shared_ptr<int> counter = std::make_shared<int>(0);
+    std::array<char, 200> big;
+    big.fill('x');
+
+    {
+        tp::FixedFunction<std::string(), 64, true> f([counter, big]()
+        {
+            return std::string(big.begin(), big.begin() + 3);
+        });
+        ASSERT_EQ(2, counter.use_count());
+
+        // Moving steals the block.
+        tp::FixedFunction<std::string(), 64, true> f1(std::move(f));
+        ASSERT_EQ(2, counter.use_count());
+        ASSERT_EQ(std::string("xxx"), f1());
+
+        // Small objects still go to the internal storage.
+        f = []()
+        {
+            return std::string("small");
+        };
+        ASSERT_EQ(std::string("small"), f());
+
+        f1 = std::move(f);
+        ASSERT_EQ(1, counter.use_count());
+        ASSERT_EQ(std::string("small"), f1());
+    }
+
+    ASSERT_EQ(1, counter.use_count());
+}
+
+TEST(FixedFunction, heapFallbackCrossThread)
+{
+    typedef tp::FixedFunction<int(), 32, true> Function;
+    std::array<int, 64> big;
+    big.fill(1);
+
+    // Blocks allocated by one thread and released by another return to
+    // the pool.
+    for (int round = 0; round < 10; ++round)
+    {
+        std::vector<Function> functions;
+        for (int i = 0; i < 100; ++i)
+        {
+            functions.emplace_back([big, i]()
+            {
+                return big[0] + i;
+            });
+        }
+
+        std::thread consumer([&functions]()
+        {
+            int i = 0;
+            for (auto& f : functions)
+            {
+                ASSERT_EQ(1 + i++, f());
+                f = Function();
+            }
+        });
+        consumer.join();
+    }
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
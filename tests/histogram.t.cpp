@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/histogram.hpp>
+
+#include <cstdint>
+
+TEST(LatencyHistogram, buckets)
+{
+    for (uint64_t value = 0; value < 32; ++value)
+    {
+        ASSERT_EQ(value, tp::LatencyHistogram::bucketIndex(value));
+        ASSERT_EQ(value, tp::LatencyHistogram::bucketUpperBound(value));
+    }
+
+    uint64_t values[] = {32, 33, 100, 1000, 12345, 1000000007,
+                         uint64_t(1) << 40, ~uint64_t(0)};
+    for (uint64_t value : values)
+    {
+        const size_t index = tp::LatencyHistogram::bucketIndex(value);
+        ASSERT_LT(index, size_t(tp::LatencyHistogram::BUCKET_COUNT));
+
+        const uint64_t upper = tp::LatencyHistogram::bucketUpperBound(index);
+        ASSERT_LE(value, upper);
+        ASSERT_LE(upper - value, value / 16);
+        ASSERT_GT(value, tp::LatencyHistogram::bucketUpperBound(index - 1));
+    }
+
+    ASSERT_EQ(size_t(tp::LatencyHistogram::BUCKET_COUNT - 1),
+              tp::LatencyHistogram::bucketIndex(~uint64_t(0)));
+}
+
+TEST(LatencyHistogram, percentiles)
+{
+    tp::LatencyHistogram histogram;
+    for (uint64_t value = 1; value <= 1000; ++value)
+    {
+        histogram.record(value);
+    }
+
+    tp::LatencyDistribution distribution;
+    histogram.snapshot(distribution, 2.0);
+
+    ASSERT_EQ(1000u, distribution.count());
+    ASSERT_LE(2 * 500u, distribution.percentile(0.5));
+    ASSERT_GE(2 * 500u + 2 * 500u / 16, distribution.percentile(0.5));
+    ASSERT_LE(2 * 990u, distribution.percentile(0.99));
+    ASSERT_GE(2 * 990u + 2 * 990u / 16, distribution.percentile(0.99));
+    ASSERT_LE(2 * 1000u, distribution.max());
+    ASSERT_EQ(2u, distribution.percentile(0.0));
+}
+
+TEST(LatencyHistogram, merge)
+{
+    tp::LatencyHistogram fast;
+    tp::LatencyHistogram slow;
+    for (int i = 0; i < 99; ++i)
+    {
+        fast.record(10);
+    }
+    slow.record(100000);
+
+    tp::LatencyDistribution total;
+    ASSERT_EQ(0u, total.count());
+    ASSERT_EQ(0u, total.percentile(0.5));
+
+    tp::LatencyDistribution distribution;
+    fast.snapshot(distribution, 1.0);
+    total += distribution;
+    slow.snapshot(distribution, 1.0);
+    total += distribution;
+
+    ASSERT_EQ(100u, total.count());
+    ASSERT_EQ(10u, total.percentile(0.5));
+    ASSERT_EQ(10u, total.percentile(0.99));
+    ASSERT_LE(100000u, total.percentile(0.999));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
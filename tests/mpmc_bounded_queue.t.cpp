@@ -0,0 +1,174 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/mpmc_bounded_queue.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST(MPMCBoundedQueue, ctor)
+{
+    ASSERT_THROW(tp::MPMCBoundedQueue<int>(3), std::invalid_argument);
+    ASSERT_NO_THROW(tp::MPMCBoundedQueue<int>(4));
+}
+
+TEST(MPMCBoundedQueue, pushPop)
+{
+    tp::MPMCBoundedQueue<int> queue(2);
+
+    ASSERT_TRUE(queue.push(1));
+    ASSERT_TRUE(queue.push(2));
+    ASSERT_FALSE(queue.push(3));
+
+    int value = 0;
+    ASSERT_TRUE(queue.pop(value));
+    ASSERT_EQ(1, value);
+    ASSERT_TRUE(queue.pop(value));
+    ASSERT_EQ(2, value);
+    ASSERT_FALSE(queue.pop(value));
+}
+
+TEST(MPMCBoundedQueue, batch)
+{
+    tp::MPMCBoundedQueue<int> queue(8);
+
+    const std::vector<int> input = {0, 1, 2, 3, 4, 5};
+    ASSERT_EQ(6u, queue.pushBatch(input.begin(), input.end()));
+    // Only two cells are left.
+    ASSERT_EQ(2u, queue.pushBatch(input.begin(), input.end()));
+    ASSERT_EQ(0u, queue.pushBatch(input.begin(), input.end()));
+
+    std::vector<int> output(16);
+    ASSERT_EQ(4u, queue.popBatch(output.begin(), 4));
+    ASSERT_EQ(4u, queue.popBatch(output.begin() + 4, 16));
+    ASSERT_EQ(0u, queue.popBatch(output.begin(), 16));
+
+    const std::vector<int> expected = {0, 1, 2, 3, 4, 5, 0, 1};
+    ASSERT_EQ(expected, std::vector<int>(output.begin(), output.begin() + 8));
+
+    // Wrap around the buffer end.
+    ASSERT_EQ(6u, queue.pushBatch(input.begin(), input.end()));
+    ASSERT_EQ(6u, queue.popBatch(output.begin(), 16));
+    ASSERT_EQ(input, std::vector<int>(output.begin(), output.begin() + 6));
+}
+
+template <tp::CellLayout LAYOUT>
+void checkFifo(size_t size)
+{
+    tp::BasicMPMCBoundedQueue<size_t, LAYOUT> queue(size);
+
+    // Several rounds to wrap around the buffer end.
+    size_t next_push = 0;
+    size_t next_pop = 0;
+    for (size_t round = 0; round < 4; ++round)
+    {
+        while (queue.push(next_push))
+        {
+            ++next_push;
+        }
+        ASSERT_EQ(next_pop + size, next_push);
+
+        for (size_t i = 0; i < std::min(size, size / 2 + round); ++i)
+        {
+            size_t value;
+            ASSERT_TRUE(queue.pop(value));
+            ASSERT_EQ(next_pop++, value);
+        }
+    }
+
+    size_t value;
+    while (queue.pop(value))
+    {
+        ASSERT_EQ(next_pop++, value);
+    }
+    ASSERT_EQ(next_push, next_pop);
+}
+
+TEST(MPMCBoundedQueue, layouts)
+{
+    for (size_t size = 2; size <= 1024; size *= 2)
+    {
+        checkFifo<tp::CellLayout::Padded>(size);
+        checkFifo<tp::CellLayout::Packed>(size);
+        checkFifo<tp::CellLayout::Scrambled>(size);
+    }
+}
+
+TEST(MPMCBoundedQueue, concurrentBatch)
+{
+    const int count = 100000;
+    tp::MPMCBoundedQueue<int> queue(64);
+
+    std::vector<std::atomic<int>> taken(count);
+    for (auto& t : taken)
+    {
+        t = 0;
+    }
+
+    std::atomic<int> consumed(0);
+    std::vector<std::thread> consumers;
+    for (int i = 0; i < 2; ++i)
+    {
+        consumers.emplace_back([&]()
+            {
+                int values[7];
+                while (consumed.load() < count)
+                {
+                    const size_t n = queue.popBatch(values, 7);
+                    if (n == 0)
+                    {
+                        std::this_thread::yield();
+                    }
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        ++taken[values[j]];
+                    }
+                    consumed += static_cast<int>(n);
+                }
+            });
+    }
+
+    std::vector<std::thread> producers;
+    for (int i = 0; i < 2; ++i)
+    {
+        producers.emplace_back([&, i]()
+            {
+                std::vector<int> values;
+                for (int v = i; v < count; v += 2)
+                {
+                    values.push_back(v);
+                }
+                auto first = values.begin();
+                while (first != values.end())
+                {
+                    auto last = first + std::min<ptrdiff_t>(5, values.end() - first);
+                    const size_t n = queue.pushBatch(first, last);
+                    if (n == 0)
+                    {
+                        std::this_thread::yield();
+                    }
+                    first += n;
+                }
+            });
+    }
+
+    for (auto& producer : producers)
+    {
+        producer.join();
+    }
+    for (auto& consumer : consumers)
+    {
+        consumer.join();
+    }
+
+    for (auto& t : taken)
+    {
+        ASSERT_EQ(1, t.load());
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/mpsc_bounded_queue.hpp>
+
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(MPSCBoundedQueue, badSize)
+{
+    ASSERT_THROW(tp::MPSCBoundedQueue<int>(0), std::invalid_argument);
+    ASSERT_THROW(tp::MPSCBoundedQueue<int>(1), std::invalid_argument);
+    ASSERT_THROW(tp::MPSCBoundedQueue<int>(6), std::invalid_argument);
+}
+
+TEST(MPSCBoundedQueue, pushPop)
+{
+    tp::MPSCBoundedQueue<std::unique_ptr<int>> queue(4);
+
+    std::unique_ptr<int> value;
+    ASSERT_FALSE(queue.pop(value));
+
+    for (int round = 0; round < 10; ++round)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            ASSERT_TRUE(queue.push(std::unique_ptr<int>(new int(i))));
+        }
+
+        // Failed push leaves the data untouched.
+        std::unique_ptr<int> rejected(new int(-1));
+        ASSERT_FALSE(queue.push(std::move(rejected)));
+        ASSERT_TRUE(rejected);
+
+        for (int i = 0; i < 4; ++i)
+        {
+            ASSERT_TRUE(queue.pop(value));
+            ASSERT_EQ(i, *value);
+        }
+        ASSERT_FALSE(queue.pop(value));
+    }
+}
+
+TEST(MPSCBoundedQueue, concurrentPush)
+{
+    const int count = 300000;
+    const int producer_count = 3;
+    tp::MPSCBoundedQueue<int> queue(64);
+
+    std::vector<std::thread> producers;
+    for (int i = 0; i < producer_count; ++i)
+    {
+        producers.emplace_back([&queue, i]()
+            {
+                for (int v = i; v < count; v += producer_count)
+                {
+                    while (!queue.push(v))
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+    }
+
+    // Values of every producer come in order.
+    std::vector<int> last(producer_count, -1);
+    for (int consumed = 0; consumed < count; ++consumed)
+    {
+        int value;
+        while (!queue.pop(value))
+        {
+            std::this_thread::yield();
+        }
+
+        ASSERT_LT(last[value % producer_count], value);
+        last[value % producer_count] = value;
+    }
+
+    for (auto& producer : producers)
+    {
+        producer.join();
+    }
+
+    int value;
+    ASSERT_FALSE(queue.pop(value));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/parallel.hpp>
+
+#include <atomic>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+TEST(Parallel, parallelFor)
+{
+    tp::ThreadPool pool;
+
+    std::vector<int> data(10000, 0);
+    tp::parallelFor(pool, size_t(0), data.size(), 0, [&data](size_t i)
+        {
+            data[i] = static_cast<int>(i);
+        });
+
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        ASSERT_EQ(static_cast<int>(i), data[i]);
+    }
+
+    // Iterators and explicit grain.
+    tp::parallelFor(pool, data.begin(), data.end(), 7,
+                    [](std::vector<int>::iterator it)
+        {
+            *it *= 2;
+        });
+    ASSERT_EQ(2 * 9999, data.back());
+
+    // Empty range.
+    tp::parallelFor(pool, 5, 5, 1, [](int)
+        {
+            FAIL();
+        });
+}
+
+TEST(Parallel, parallelReduce)
+{
+    tp::ThreadPool pool;
+
+    std::vector<long long> data(100000);
+    std::iota(data.begin(), data.end(), 1);
+
+    const long long sum = tp::parallelReduce(pool, data.begin(), data.end(),
+        100, 0ll,
+        [](std::vector<long long>::iterator first,
+           std::vector<long long>::iterator last, long long init)
+        {
+            return std::accumulate(first, last, init);
+        },
+        [](long long a, long long b)
+        {
+            return a + b;
+        });
+
+    ASSERT_EQ(100000ll * 100001 / 2, sum);
+}
+
+TEST(Parallel, parallelTransform)
+{
+    tp::ThreadPool pool;
+
+    std::vector<int> in(5000);
+    std::iota(in.begin(), in.end(), 0);
+    std::vector<int> out(in.size());
+
+    tp::parallelTransform(pool, in.begin(), in.end(), out.begin(), 0,
+                          [](int x)
+        {
+            return x * x;
+        });
+
+    for (size_t i = 0; i < in.size(); ++i)
+    {
+        ASSERT_EQ(in[i] * in[i], out[i]);
+    }
+}
+
+TEST(Parallel, parallelInvoke)
+{
+    tp::ThreadPool pool;
+
+    std::atomic<int> mask(0);
+    tp::parallelInvoke(pool,
+        [&mask]() { mask |= 1; },
+        [&mask]() { mask |= 2; },
+        [&mask]() { mask |= 4; });
+
+    ASSERT_EQ(7, mask.load());
+}
+
+TEST(Parallel, nested)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    tp::ThreadPool pool(options);
+
+    std::atomic<int> counter(0);
+
+    // Inner loops join inside worker threads.
+    tp::Future<void> r = pool.submit([&]()
+        {
+            tp::parallelFor(pool, 0, 100, 1, [&](int)
+                {
+                    tp::parallelFor(pool, 0, 100, 1, [&](int)
+                        {
+                            ++counter;
+                        });
+                });
+        });
+
+    ASSERT_EQ(std::future_status::ready, r.waitFor(std::chrono::seconds(10)));
+    r.get();
+    ASSERT_EQ(10000, counter.load());
+}
+
+TEST(Parallel, exception)
+{
+    tp::ThreadPool pool;
+
+    ASSERT_THROW(tp::parallelFor(pool, 0, 1000, 1, [](int i)
+        {
+            if (i == 777)
+            {
+                throw std::runtime_error("error");
+            }
+        }), std::runtime_error);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
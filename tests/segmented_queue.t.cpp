@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/segmented_queue.hpp>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST(SegmentedQueue, pushPop)
+{
+    tp::SegmentedQueue<int, 4> queue;
+
+    int value = 0;
+    ASSERT_FALSE(queue.pop(value));
+
+    // Spans several segments.
+    for (int i = 0; i < 10; ++i)
+    {
+        queue.push(i);
+    }
+
+    for (int i = 0; i < 10; ++i)
+    {
+        ASSERT_TRUE(queue.pop(value));
+        ASSERT_EQ(i, value);
+    }
+    ASSERT_FALSE(queue.pop(value));
+
+    // Recycled segments are reused.
+    for (int round = 0; round < 100; ++round)
+    {
+        for (int i = 0; i < 10; ++i)
+        {
+            queue.push(i);
+        }
+        for (int i = 0; i < 10; ++i)
+        {
+            ASSERT_TRUE(queue.pop(value));
+            ASSERT_EQ(i, value);
+        }
+    }
+    ASSERT_FALSE(queue.pop(value));
+}
+
+TEST(SegmentedQueue, destroyRemaining)
+{
+    std::shared_ptr<int> counter = std::make_shared<int>(0);
+    {
+        tp::SegmentedQueue<std::shared_ptr<int>, 4> queue;
+        for (int i = 0; i < 10; ++i)
+        {
+            queue.push(counter);
+        }
+
+        std::shared_ptr<int> value;
+        ASSERT_TRUE(queue.pop(value));
+        ASSERT_EQ(11, counter.use_count());
+    }
+
+    ASSERT_EQ(1, counter.use_count());
+}
+
+TEST(SegmentedQueue, beyondSlabCapacity)
+{
+    // The slab holds 1024 chunks of 16 segments, the rest comes from the
+    // heap.
+    const int count = 2 * 1024 * 16 * 32;
+    tp::SegmentedQueue<int> queue;
+
+    for (int i = 0; i < count; ++i)
+    {
+        queue.push(i);
+    }
+
+    int value;
+    for (int i = 0; i < count; ++i)
+    {
+        ASSERT_TRUE(queue.pop(value));
+        ASSERT_EQ(i, value);
+    }
+    ASSERT_FALSE(queue.pop(value));
+}
+
+TEST(SegmentedQueue, concurrentPush)
+{
+    const int count = 100000;
+    const int producer_count = 3;
+    tp::SegmentedQueue<int, 8> queue;
+
+    std::vector<std::thread> producers;
+    for (int i = 0; i < producer_count; ++i)
+    {
+        producers.emplace_back([&queue, i]()
+            {
+                for (int v = i; v < count; v += producer_count)
+                {
+                    queue.push(v);
+                }
+            });
+    }
+
+    // Values of every producer come in order.
+    std::vector<int> last(producer_count, -1);
+    int consumed = 0;
+    while (consumed < count)
+    {
+        int value;
+        if (!queue.pop(value))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        ASSERT_LT(last[value % producer_count], value);
+        last[value % producer_count] = value;
+        ++consumed;
+    }
+
+    for (auto& producer : producers)
+    {
+        producer.join();
+    }
+
+    int value;
+    ASSERT_FALSE(queue.pop(value));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
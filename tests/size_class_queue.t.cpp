@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/fixed_function.hpp>
+#include <thread_pool/mpmc_bounded_queue.hpp>
+#include <thread_pool/size_class_queue.hpp>
+
+#include <array>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+typedef tp::FixedFunction<void(), 128> Task;
+typedef tp::SizeClassQueue<Task, tp::MPMCBoundedQueue, 32, 64, 128> Queue;
+
+static_assert(tp::detail::size_class<32, 64, 128>::index(1) == 0, "");
+static_assert(tp::detail::size_class<32, 64, 128>::index(32) == 0, "");
+static_assert(tp::detail::size_class<32, 64, 128>::index(33) == 1, "");
+static_assert(tp::detail::size_class<32, 64, 128>::index(128) == 2, "");
+static_assert(tp::detail::size_class<32, 64, 128>::index(500) == 2, "");
+
+TEST(SizeClassQueue, badSize)
+{
+    ASSERT_THROW(Queue(0), std::invalid_argument);
+    ASSERT_THROW(Queue(6), std::invalid_argument);
+}
+
+TEST(SizeClassQueue, pushPop)
+{
+    Queue queue(4);
+
+    Task task;
+    ASSERT_FALSE(queue.pop(task));
+
+    std::vector<int> done;
+    std::array<char, 40> medium = {{}};
+    std::array<char, 100> large = {{}};
+
+    // Queues of larger classes are a half of the previous one.
+    for (int i = 0; i < 4; ++i)
+    {
+        ASSERT_TRUE(queue.push([&done, i]() { done.push_back(i); }));
+    }
+    ASSERT_FALSE(queue.push([&done]() { done.push_back(-1); }));
+
+    for (int i = 0; i < 2; ++i)
+    {
+        ASSERT_TRUE(queue.push([&done, medium]() { done.push_back(40); }));
+        ASSERT_TRUE(queue.push([&done, large]() { done.push_back(100); }));
+    }
+    ASSERT_FALSE(queue.push([&done, medium]() { done.push_back(-1); }));
+    ASSERT_FALSE(queue.push([&done, large]() { done.push_back(-1); }));
+
+    // Classes are served in turns.
+    while (queue.pop(task))
+    {
+        task();
+    }
+    ASSERT_EQ(std::vector<int>({0, 40, 100, 1, 40, 100, 2, 3}), done);
+}
+
+TEST(SizeClassQueue, pushFunction)
+{
+    Queue queue(2);
+
+    std::shared_ptr<int> counter = std::make_shared<int>(0);
+    tp::FixedFunction<void(), 32> small([counter]() { ++*counter; });
+
+    // Functions go to the class of their storage size.
+    ASSERT_TRUE(queue.push(std::move(small)));
+    ASSERT_TRUE(queue.push(Task([counter]() { ++*counter; })));
+    ASSERT_TRUE(queue.push(Task([counter]() { ++*counter; })));
+    ASSERT_FALSE(queue.push(Task([counter]() { ++*counter; })));
+
+    Task task;
+    for (int i = 0; i < 3; ++i)
+    {
+        ASSERT_TRUE(queue.pop(task));
+        task();
+    }
+    ASSERT_FALSE(queue.pop(task));
+    ASSERT_EQ(3, *counter);
+
+    task = Task();
+    ASSERT_EQ(1, counter.use_count());
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/spsc_bounded_queue.hpp>
+
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(SPSCBoundedQueue, badSize)
+{
+    ASSERT_THROW(tp::SPSCBoundedQueue<int>(0), std::invalid_argument);
+    ASSERT_THROW(tp::SPSCBoundedQueue<int>(1), std::invalid_argument);
+    ASSERT_THROW(tp::SPSCBoundedQueue<int>(6), std::invalid_argument);
+}
+
+TEST(SPSCBoundedQueue, pushPop)
+{
+    tp::SPSCBoundedQueue<int> queue(4);
+
+    int value = 0;
+    ASSERT_FALSE(queue.pop(value));
+
+    // Positions wrap around the buffer many times.
+    for (int round = 0; round < 10; ++round)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            ASSERT_TRUE(queue.push(round * 4 + i));
+        }
+        ASSERT_FALSE(queue.push(-1));
+
+        for (int i = 0; i < 4; ++i)
+        {
+            ASSERT_TRUE(queue.pop(value));
+            ASSERT_EQ(round * 4 + i, value);
+        }
+        ASSERT_FALSE(queue.pop(value));
+    }
+}
+
+TEST(SPSCBoundedQueue, batch)
+{
+    tp::SPSCBoundedQueue<int> queue(8);
+
+    std::vector<int> input = {0, 1, 2, 3, 4, 5};
+    ASSERT_EQ(6u, queue.pushBatch(input.begin(), input.end()));
+    // Only two cells are left.
+    ASSERT_EQ(2u, queue.pushBatch(input.begin(), input.end()));
+    ASSERT_EQ(0u, queue.pushBatch(input.begin(), input.end()));
+
+    std::vector<int> output(10, -1);
+    ASSERT_EQ(5u, queue.popBatch(output.begin(), 5));
+    ASSERT_EQ(3u, queue.popBatch(output.begin() + 5, 5));
+    ASSERT_EQ(0u, queue.popBatch(output.begin(), 5));
+
+    std::vector<int> expected = {0, 1, 2, 3, 4, 5, 0, 1, -1, -1};
+    ASSERT_EQ(expected, output);
+}
+
+TEST(SPSCBoundedQueue, producerConsumer)
+{
+    const int count = 1000000;
+    tp::SPSCBoundedQueue<int> queue(64);
+
+    std::thread producer([&queue]()
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                while (!queue.push(i))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+    for (int i = 0; i < count; ++i)
+    {
+        int value;
+        while (!queue.pop(value))
+        {
+            std::this_thread::yield();
+        }
+        ASSERT_EQ(i, value);
+    }
+
+    producer.join();
+
+    int value;
+    ASSERT_FALSE(queue.pop(value));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,254 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/thread_pool.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace
+{
+typedef tp::ThreadPoolImpl<tp::FixedFunction<void(), 128>,
+                           tp::MPMCBoundedQueue,
+                           tp::AtomicStatistics> StatisticsThreadPool;
+
+template <typename Pool>
+bool waitExecuted(const Pool& pool, uint64_t count)
+{
+    const auto deadline = std::chrono::steady_clock::now() +
+                          std::chrono::seconds(5);
+    while (pool.stats().total.tasks_executed < count)
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+        {
+            return false;
+        }
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+// Histogram reports bucket bounds, so compare with the lowest value of the
+// bucket containing the expected one.
+uint64_t bucketFloor(std::chrono::steady_clock::duration duration)
+{
+    const uint64_t value = static_cast<uint64_t>(std::max<int64_t>(0,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            duration).count()));
+    const size_t index = tp::LatencyHistogram::bucketIndex(value);
+    return index == 0
+        ? 0
+        : tp::LatencyHistogram::bucketUpperBound(index - 1) + 1;
+}
+}
+
+TEST(Statistics, noStatistics)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    tp::ThreadPool pool(options);
+
+    std::atomic<int> counter(0);
+    pool.post([&counter]() { ++counter; });
+    while (counter.load() == 0)
+    {
+        std::this_thread::yield();
+    }
+
+    const tp::ThreadPoolStatistics stats = pool.stats();
+    ASSERT_EQ(2u, stats.workers.size());
+    ASSERT_EQ(0u, stats.total.tasks_executed);
+    ASSERT_EQ(0u, stats.total.local_pops);
+}
+
+TEST(Statistics, countTasks)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    StatisticsThreadPool pool(options);
+
+    const size_t count = 1000;
+    std::atomic<size_t> counter(0);
+    for (size_t i = 0; i < count; ++i)
+    {
+        pool.post([&counter]() { ++counter; });
+    }
+
+    ASSERT_TRUE(waitExecuted(pool, count));
+
+    const tp::ThreadPoolStatistics stats = pool.stats();
+    ASSERT_EQ(2u, stats.workers.size());
+    ASSERT_EQ(count, stats.total.tasks_executed);
+    ASSERT_EQ(count, stats.workers[0].tasks_executed +
+                     stats.workers[1].tasks_executed);
+    ASSERT_EQ(count, stats.total.local_pops + stats.total.steals);
+    ASSERT_EQ(0u, stats.total.rejected_posts);
+}
+
+TEST(Statistics, rejectedPosts)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    options.setQueueSize(2);
+    StatisticsThreadPool pool(options);
+
+    std::atomic<bool> started(false);
+    std::atomic<bool> release(false);
+    pool.post([&started, &release]()
+        {
+            started = true;
+            while (!release.load())
+            {
+                std::this_thread::yield();
+            }
+        });
+
+    while (!started.load())
+    {
+        std::this_thread::yield();
+    }
+
+    size_t rejected = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        if (!pool.tryPost([]() {}))
+        {
+            ++rejected;
+        }
+    }
+    release = true;
+
+    ASSERT_EQ(2u, rejected);
+    ASSERT_EQ(2u, pool.stats().total.rejected_posts);
+}
+
+TEST(Statistics, spilledPosts)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    options.setQueueSize(2);
+    options.setOverflowPolicy(tp::OverflowPolicy::Spill);
+    StatisticsThreadPool pool(options);
+
+    std::atomic<bool> started(false);
+    std::atomic<bool> release(false);
+    pool.post([&started, &release]()
+        {
+            started = true;
+            while (!release.load())
+            {
+                std::this_thread::yield();
+            }
+        });
+
+    while (!started.load())
+    {
+        std::this_thread::yield();
+    }
+
+    for (int i = 0; i < 5; ++i)
+    {
+        ASSERT_TRUE(pool.tryPost([]() {}));
+    }
+    release = true;
+
+    ASSERT_TRUE(waitExecuted(pool, 6));
+    const tp::ThreadPoolStatistics stats = pool.stats();
+    ASSERT_EQ(3u, stats.total.rejected_posts);
+    ASSERT_EQ(3u, stats.total.spilled_posts);
+}
+
+TEST(Statistics, idleTime)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    options.setSpinCount(0);
+    options.setYieldCount(0);
+    StatisticsThreadPool pool(options);
+
+    for (int i = 0; i < 3; ++i)
+    {
+        // Let the worker park between tasks.
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        pool.post([]()
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            });
+        ASSERT_TRUE(waitExecuted(pool, i + 1));
+    }
+
+    // Busy period is accounted once the worker becomes idle.
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    const tp::ThreadPoolStatistics stats = pool.stats();
+    ASSERT_LE(3u, stats.total.idle_sleeps);
+    ASSERT_LE(3000000u, stats.total.busy_ns);
+    ASSERT_LE(20000000u, stats.total.idle_ns);
+}
+
+TEST(Statistics, latency)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    tp::ThreadPoolImpl<tp::FixedFunction<void(), 128>, tp::WorkStealingQueue,
+                       tp::LatencyStatistics<>> pool(options);
+
+    std::atomic<bool> release(false);
+    std::atomic<size_t> started(0);
+    auto blocker = [&release, &started]()
+    {
+        ++started;
+        while (!release.load())
+        {
+            std::this_thread::yield();
+        }
+    };
+    pool.post(blocker);
+    pool.post(blocker);
+    while (started.load() != 2)
+    {
+        std::this_thread::yield();
+    }
+    const auto blocked = std::chrono::steady_clock::now();
+
+    // Posted tasks wait in queues until both workers are released.
+    std::vector<std::function<void()>> tasks(8, []()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        });
+    pool.postBatch(tasks.begin(), tasks.end());
+    for (int i = 0; i < 8; ++i)
+    {
+        pool.post([]()
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            });
+    }
+
+    const auto posted = std::chrono::steady_clock::now();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    const auto released = std::chrono::steady_clock::now();
+    release = true;
+
+    ASSERT_TRUE(waitExecuted(pool, 18));
+
+    const tp::ThreadPoolStatistics stats = pool.stats();
+    ASSERT_EQ(18u, stats.total.queue_wait.count());
+    ASSERT_EQ(18u, stats.total.run_time.count());
+    ASSERT_EQ(18u, stats.workers[0].run_time.count() +
+                   stats.workers[1].run_time.count());
+    ASSERT_LE(bucketFloor(released - posted),
+              stats.total.queue_wait.percentile(0.5));
+    ASSERT_LE(bucketFloor(released - blocked), stats.total.run_time.max());
+    ASSERT_LE(bucketFloor(std::chrono::milliseconds(1)),
+              stats.total.run_time.percentile(0.5));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
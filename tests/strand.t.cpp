@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/strand.hpp>
+#include <thread_pool/thread_pool.hpp>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+typedef tp::Strand<tp::ThreadPool> Strand;
+
+TEST(Strand, order)
+{
+    tp::ThreadPool pool;
+    Strand strand(pool);
+
+    std::vector<int> order;
+    for (int i = 0; i < 10000; ++i)
+    {
+        strand.post([&order, i]()
+            {
+                order.push_back(i);
+            });
+    }
+    pool.waitIdle();
+
+    ASSERT_EQ(10000u, order.size());
+    for (int i = 0; i < 10000; ++i)
+    {
+        ASSERT_EQ(i, order[i]);
+    }
+}
+
+TEST(Strand, serial)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(4);
+    tp::ThreadPool pool(options);
+
+    const size_t strand_count = 16;
+    std::vector<std::unique_ptr<Strand>> strands;
+    std::vector<std::atomic<int>> running(strand_count);
+    std::vector<int> counters(strand_count, 0);
+    for (size_t i = 0; i < strand_count; ++i)
+    {
+        strands.emplace_back(new Strand(pool));
+        running[i] = 0;
+    }
+
+    // Tasks of a strand never overlap, even posted from many threads.
+    std::atomic<int> overlaps(0);
+    std::vector<std::thread> producers;
+    for (int p = 0; p < 4; ++p)
+    {
+        producers.emplace_back([&]()
+            {
+                for (int i = 0; i < 10000; ++i)
+                {
+                    const size_t s = i % strand_count;
+                    strands[s]->post([&, s]()
+                        {
+                            if (++running[s] != 1)
+                            {
+                                ++overlaps;
+                            }
+                            ++counters[s];
+                            --running[s];
+                        });
+                }
+            });
+    }
+    for (auto& producer : producers)
+    {
+        producer.join();
+    }
+    pool.waitIdle();
+
+    ASSERT_EQ(0, overlaps.load());
+    for (size_t i = 0; i < strand_count; ++i)
+    {
+        ASSERT_EQ(4 * 10000 / static_cast<int>(strand_count), counters[i]);
+    }
+}
+
+TEST(Strand, runningInThisThread)
+{
+    tp::ThreadPool pool;
+    Strand strand(pool);
+    Strand other(pool);
+
+    std::atomic<bool> inside(false);
+    std::atomic<bool> outside(true);
+    strand.post([&]()
+        {
+            inside = strand.runningInThisThread();
+            outside = other.runningInThisThread();
+        });
+    pool.waitIdle();
+
+    ASSERT_TRUE(inside.load());
+    ASSERT_FALSE(outside.load());
+    ASSERT_FALSE(strand.runningInThisThread());
+}
+
+TEST(Strand, fullQueue)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    options.setQueueSize(2);
+    tp::ThreadPool pool(options);
+
+    // Fill the queue while the worker is blocked.
+    std::atomic<bool> blocked(true);
+    pool.post([&blocked]()
+        {
+            while (blocked.load())
+            {
+                std::this_thread::yield();
+            }
+        });
+    while (pool.tryPost([]() {}))
+    {
+    }
+
+    // The runner doesn't fit into the queue and runs inline.
+    Strand strand(pool);
+    std::thread::id executor;
+    strand.post([&executor]()
+        {
+            executor = std::this_thread::get_id();
+        });
+    ASSERT_EQ(std::this_thread::get_id(), executor);
+
+    blocked = false;
+    pool.waitIdle();
+}
+
+TEST(Strand, exception)
+{
+    tp::ThreadPool pool;
+    Strand strand(pool);
+
+    std::atomic<int> counter(0);
+    strand.post([]()
+        {
+            throw std::runtime_error("failed");
+        });
+    strand.post([&counter]()
+        {
+            ++counter;
+        });
+    pool.waitIdle();
+
+    ASSERT_EQ(1, counter.load());
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
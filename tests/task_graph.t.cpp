@@ -0,0 +1,193 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/task_graph.hpp>
+
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <vector>
+
+TEST(TaskGraph, empty)
+{
+    tp::ThreadPool pool;
+    tp::TaskGraph graph;
+    ASSERT_EQ(0u, graph.size());
+    graph.run(pool);
+}
+
+TEST(TaskGraph, chain)
+{
+    tp::ThreadPool pool;
+    tp::TaskGraph graph;
+
+    std::vector<int> order;
+    for (int i = 0; i < 1000; ++i)
+    {
+        const size_t node = graph.addNode([&order, i]()
+            {
+                order.push_back(i);
+            });
+        if (i != 0)
+        {
+            graph.addEdge(node - 1, node);
+        }
+    }
+    ASSERT_EQ(1000u, graph.size());
+
+    graph.run(pool);
+    ASSERT_EQ(1000u, order.size());
+    for (int i = 0; i < 1000; ++i)
+    {
+        ASSERT_EQ(i, order[i]);
+    }
+}
+
+TEST(TaskGraph, dependencies)
+{
+    tp::ThreadPool pool;
+    tp::TaskGraph graph;
+
+    // Every node records the number of finished nodes when it runs. Nodes
+    // of a layer depend on all nodes of the previous one.
+    const size_t layers = 10;
+    const size_t width = 100;
+    std::atomic<size_t> finished(0);
+    std::vector<size_t> started(layers * width);
+    for (size_t layer = 0; layer < layers; ++layer)
+    {
+        for (size_t i = 0; i < width; ++i)
+        {
+            const size_t node = graph.addNode(
+                [&finished, &started, layer, i]()
+                {
+                    started[layer * width + i] = finished.load();
+                    ++finished;
+                });
+            for (size_t j = 0; layer != 0 && j < width; ++j)
+            {
+                graph.addEdge((layer - 1) * width + j, node);
+            }
+        }
+    }
+
+    graph.run(pool);
+    ASSERT_EQ(layers * width, finished.load());
+    for (size_t node = 0; node < layers * width; ++node)
+    {
+        ASSERT_GE(started[node], node / width * width);
+    }
+}
+
+TEST(TaskGraph, rerun)
+{
+    tp::ThreadPool pool;
+    tp::TaskGraph graph;
+
+    std::atomic<int> counter(0);
+    const size_t root = graph.addNode([&counter]() { ++counter; });
+    for (int i = 0; i < 100; ++i)
+    {
+        graph.addEdge(root, graph.addNode([&counter]() { ++counter; }));
+    }
+
+    for (int i = 1; i <= 10; ++i)
+    {
+        graph.run(pool);
+        ASSERT_EQ(i * 101, counter.load());
+    }
+
+    // Changed structure is compiled again.
+    graph.addEdge(root, graph.addNode([&counter]() { ++counter; }));
+    graph.run(pool);
+    ASSERT_EQ(1112, counter.load());
+
+    graph.clear();
+    ASSERT_EQ(0u, graph.size());
+    graph.run(pool);
+}
+
+TEST(TaskGraph, exception)
+{
+    tp::ThreadPool pool;
+    tp::TaskGraph graph;
+
+    std::atomic<int> counter(0);
+    const size_t failing = graph.addNode([]()
+        {
+            throw std::runtime_error("failed");
+        });
+    const size_t skipped = graph.addNode([&counter]() { ++counter; });
+    graph.addEdge(failing, skipped);
+
+    ASSERT_THROW(graph.run(pool), std::runtime_error);
+    ASSERT_EQ(0, counter.load());
+
+    // The failure is not kept for the next run.
+    tp::TaskGraph succeeding;
+    succeeding.addNode([&counter]() { ++counter; });
+    succeeding.run(pool);
+    ASSERT_EQ(1, counter.load());
+}
+
+TEST(TaskGraph, invalid)
+{
+    tp::ThreadPool pool;
+    tp::TaskGraph graph;
+
+    const size_t a = graph.addNode([]() {});
+    const size_t b = graph.addNode([]() {});
+    ASSERT_THROW(graph.addEdge(a, 2), std::out_of_range);
+
+    graph.addEdge(a, b);
+    graph.addEdge(b, a);
+    ASSERT_THROW(graph.run(pool), std::logic_error);
+}
+
+TEST(TaskGraph, runFromWorker)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    tp::ThreadPool pool(options);
+
+    // The single worker executes nodes of the nested graph while waiting.
+    std::atomic<int> counter(0);
+    std::promise<void> done;
+    pool.post([&pool, &counter, &done]()
+        {
+            tp::TaskGraph graph;
+            const size_t root = graph.addNode([&counter]() { ++counter; });
+            for (int i = 0; i < 100; ++i)
+            {
+                graph.addEdge(root,
+                              graph.addNode([&counter]() { ++counter; }));
+            }
+            graph.run(pool);
+            done.set_value();
+        });
+    done.get_future().wait();
+    ASSERT_EQ(101, counter.load());
+}
+
+TEST(TaskGraph, fullQueue)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    options.setQueueSize(2);
+    tp::ThreadPool pool(options);
+    tp::TaskGraph graph;
+
+    // Successors which don't fit into the queue are executed inline.
+    std::atomic<int> counter(0);
+    const size_t root = graph.addNode([&counter]() { ++counter; });
+    for (int i = 0; i < 1000; ++i)
+    {
+        graph.addEdge(root, graph.addNode([&counter]() { ++counter; }));
+    }
+    graph.run(pool);
+    ASSERT_EQ(1001, counter.load());
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
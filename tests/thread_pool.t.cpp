@@ -2,10 +2,18 @@
 
 #include <thread_pool/thread_pool.hpp>
 
+#include <array>
+#include <atomic>
 #include <thread>
 #include <future>
 #include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 namespace TestLinkage {
 size_t getWorkerIdForCurrentThread()
@@ -36,6 +44,1434 @@ TEST(ThreadPool, postJob)
     ASSERT_EQ(42, r.get());
 }
 
+TEST(ThreadPool, postToParkedWorkers)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    options.setSpinCount(0);
+    options.setYieldCount(0);
+    tp::ThreadPool pool(options);
+
+    for (int i = 0; i < 3; ++i)
+    {
+        // Let all workers exhaust idle budget and park.
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+        std::promise<int> p;
+        std::future<int> r = p.get_future();
+        pool.post([&p, i]()
+            {
+                p.set_value(i);
+            });
+
+        ASSERT_EQ(std::future_status::ready,
+                  r.wait_for(std::chrono::seconds(5)));
+        ASSERT_EQ(i, r.get());
+    }
+}
+
+TEST(ThreadPool, stealFromBusyWorker)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(4);
+    tp::ThreadPool pool(options);
+
+    std::promise<bool> outer;
+    std::future<bool> outer_result = outer.get_future();
+
+    pool.post([&pool, &outer]()
+        {
+            // Posted from a worker thread, so the task lands in this
+            // worker's own queue and can only run if a sibling steals it.
+            std::promise<void> inner;
+            std::future<void> inner_result = inner.get_future();
+            pool.post([&inner]()
+                {
+                    inner.set_value();
+                });
+
+            outer.set_value(std::future_status::ready ==
+                            inner_result.wait_for(std::chrono::seconds(5)));
+        });
+
+    ASSERT_TRUE(outer_result.get());
+}
+
+TEST(ThreadPool, workStealingQueue)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(4);
+    tp::WorkStealingThreadPool pool(options);
+
+    std::atomic<size_t> counter(0);
+    std::promise<void> done;
+
+    pool.post([&]()
+        {
+            // Local posts go to the owner deque, siblings steal them.
+            for (size_t i = 0; i < 1000; ++i)
+            {
+                pool.post([&]()
+                    {
+                        if (1000 == ++counter)
+                        {
+                            done.set_value();
+                        }
+                    });
+            }
+        });
+
+    ASSERT_EQ(std::future_status::ready,
+              done.get_future().wait_for(std::chrono::seconds(5)));
+}
+
+template <typename Pool>
+void checkSingleConsumerQueue()
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(4);
+    Pool pool(options);
+
+    std::promise<bool> outer;
+    std::future<bool> outer_result = outer.get_future();
+
+    pool.post([&pool, &outer]()
+        {
+            // Local posts go to the shared queue, siblings steal them
+            // from there.
+            std::promise<void> inner;
+            std::future<void> inner_result = inner.get_future();
+            pool.post([&inner]()
+                {
+                    inner.set_value();
+                });
+
+            outer.set_value(std::future_status::ready ==
+                            inner_result.wait_for(std::chrono::seconds(5)));
+        });
+
+    ASSERT_TRUE(outer_result.get());
+
+    // Posted by this thread only, so every queue has a single producer.
+    std::atomic<size_t> counter(0);
+    std::promise<void> done;
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        pool.postWait([&]()
+            {
+                if (1000 == ++counter)
+                {
+                    done.set_value();
+                }
+            });
+    }
+
+    ASSERT_EQ(std::future_status::ready,
+              done.get_future().wait_for(std::chrono::seconds(5)));
+}
+
+TEST(ThreadPool, singleConsumerQueue)
+{
+    checkSingleConsumerQueue<tp::MPSCThreadPool>();
+}
+
+TEST(ThreadPool, singleProducerQueue)
+{
+    checkSingleConsumerQueue<tp::SPSCThreadPool>();
+}
+
+TEST(ThreadPool, autoSizedPool)
+{
+    tp::AutoSizedThreadPool pool;
+
+    std::atomic<size_t> counter(0);
+    std::promise<void> done;
+    auto count = [&]()
+        {
+            if (300 == ++counter)
+            {
+                done.set_value();
+            }
+        };
+
+    std::array<char, 100> medium = {{}};
+    std::array<char, 200> large = {{}};
+    for (size_t i = 0; i < 100; ++i)
+    {
+        pool.post(count);
+        pool.post([count, medium]() mutable { count(); });
+        pool.post([count, large]() mutable { count(); });
+    }
+
+    ASSERT_EQ(std::future_status::ready,
+              done.get_future().wait_for(std::chrono::seconds(5)));
+}
+
+TEST(ThreadPool, submit)
+{
+    tp::ThreadPool pool;
+
+    tp::Future<int> r = pool.submit([](int a, int b)
+        {
+            return a + b;
+        }, 40, 2);
+    ASSERT_TRUE(r.valid());
+    ASSERT_EQ(42, r.get());
+    ASSERT_FALSE(r.valid());
+
+    std::atomic<bool> called(false);
+    tp::Future<void> v = pool.submit([&called]()
+        {
+            called = true;
+        });
+    v.wait();
+    ASSERT_TRUE(v.isReady());
+    ASSERT_TRUE(called);
+
+    tp::Future<std::string> s = pool.submit([]()
+        {
+            return std::string(100, 'x');
+        });
+    ASSERT_EQ(std::string(100, 'x'), s.get());
+}
+
+TEST(ThreadPool, submitException)
+{
+    tp::ThreadPool pool;
+
+    tp::Future<int> r = pool.submit([]() -> int
+        {
+            throw std::logic_error("error");
+        });
+    ASSERT_THROW(r.get(), std::logic_error);
+
+    tp::Future<int> empty;
+    ASSERT_THROW(empty.wait(), std::future_error);
+}
+
+TEST(ThreadPool, submitWaitFor)
+{
+    tp::ThreadPool pool;
+
+    std::promise<void> gate;
+    std::shared_future<void> gate_future = gate.get_future().share();
+
+    tp::Future<void> r = pool.submit([gate_future]()
+        {
+            gate_future.wait();
+        });
+    ASSERT_EQ(std::future_status::timeout,
+              r.waitFor(std::chrono::milliseconds(10)));
+
+    gate.set_value();
+    ASSERT_EQ(std::future_status::ready, r.waitFor(std::chrono::seconds(5)));
+}
+
+TEST(ThreadPool, submitNestedWait)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    tp::ThreadPool pool(options);
+
+    // The only worker waits for a task in its own queue, so it has to
+    // execute it while waiting.
+    tp::Future<int> r = pool.submit([&pool]()
+        {
+            tp::Future<int> inner = pool.submit([]()
+                {
+                    return 21;
+                });
+            return inner.get() * 2;
+        });
+
+    ASSERT_EQ(std::future_status::ready, r.waitFor(std::chrono::seconds(5)));
+    ASSERT_EQ(42, r.get());
+}
+
+struct BatchJob
+{
+    std::atomic<size_t>* counter;
+    std::promise<void>* done;
+    size_t total;
+
+    void operator()()
+    {
+        if (total == ++*counter)
+        {
+            done->set_value();
+        }
+    }
+};
+
+struct BlockingJob
+{
+    std::shared_future<void>* gate;
+
+    void operator()()
+    {
+        gate->wait();
+    }
+};
+
+TEST(ThreadPool, postBatch)
+{
+    // Outlives the pool which may still execute blocking jobs.
+    std::promise<void> gate;
+    std::shared_future<void> gate_future = gate.get_future().share();
+
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(4);
+    options.setQueueSize(16);
+    tp::ThreadPool pool(options);
+
+    std::atomic<size_t> counter(0);
+    std::promise<void> done;
+
+    std::vector<BatchJob> jobs(50, BatchJob{&counter, &done, 50});
+    ASSERT_EQ(50u, pool.tryPostBatch(jobs.begin(), jobs.end()));
+    ASSERT_EQ(std::future_status::ready,
+              done.get_future().wait_for(std::chrono::seconds(5)));
+
+    // Doesn't fit into 4 queues of 16 tasks.
+    std::vector<BlockingJob> blockers(100, BlockingJob{&gate_future});
+    ASSERT_THROW(pool.postBatch(blockers.begin(), blockers.end()),
+                 std::runtime_error);
+    gate.set_value();
+}
+
+TEST(ThreadPool, priorities)
+{
+    std::promise<void> gate;
+    std::shared_future<void> gate_future = gate.get_future().share();
+
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    options.setPriorityLevels(3);
+    tp::ThreadPool pool(options);
+
+    std::atomic<bool> blocked(false);
+    pool.post([&blocked, &gate_future]()
+        {
+            blocked = true;
+            gate_future.wait();
+        });
+    while (!blocked.load())
+    {
+        std::this_thread::yield();
+    }
+
+    std::mutex mutex;
+    std::vector<size_t> order;
+    std::promise<void> done;
+    for (size_t i = 0; i < 20; ++i)
+    {
+        // Priority 7 is clamped to the lowest level.
+        const size_t priority = i % 4 == 0 ? 0 : (i % 2 ? 7 : 1);
+        pool.post([&mutex, &order, &done, priority]()
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                order.push_back(priority);
+                if (order.size() == 20)
+                {
+                    done.set_value();
+                }
+            }, priority);
+    }
+    gate.set_value();
+
+    ASSERT_EQ(std::future_status::ready,
+              done.get_future().wait_for(std::chrono::seconds(5)));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_EQ(std::vector<size_t>(5, 0),
+              std::vector<size_t>(order.begin(), order.begin() + 5));
+    ASSERT_EQ(1u, order[5]);
+    ASSERT_EQ(7u, order.back());
+}
+
+struct RepostingJob
+{
+    tp::ThreadPool* pool;
+    std::atomic<bool>* stop;
+
+    void operator()()
+    {
+        if (!stop->load())
+        {
+            pool->post(*this, 0);
+        }
+    }
+};
+
+TEST(ThreadPool, lowPriorityProgress)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    options.setPriorityLevels(2);
+    tp::ThreadPool pool(options);
+
+    std::atomic<bool> stop(false);
+    for (int i = 0; i < 4; ++i)
+    {
+        pool.post(RepostingJob{&pool, &stop}, 0);
+    }
+
+    // High priority flood never ends until the low priority job runs.
+    std::promise<void> done;
+    pool.post([&stop, &done]()
+        {
+            stop = true;
+            done.set_value();
+        }, 1);
+
+    ASSERT_EQ(std::future_status::ready,
+              done.get_future().wait_for(std::chrono::seconds(5)));
+}
+
+/**
+ * @brief blockWorkers Occupy every worker of the pool until gate is opened.
+ */
+template <typename Pool>
+void blockWorkers(Pool& pool, size_t count, std::shared_future<void>& gate)
+{
+    std::atomic<size_t> started(0);
+    for (size_t i = 0; i < count; ++i)
+    {
+        pool.post([&started, &gate]()
+            {
+                ++started;
+                gate.wait();
+            });
+    }
+
+    while (started.load() != count)
+    {
+        std::this_thread::yield();
+    }
+}
+
+TEST(ThreadPool, postToAnyWorker)
+{
+    std::promise<void> gate;
+    std::shared_future<void> gate_future = gate.get_future().share();
+
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    options.setQueueSize(2);
+    tp::ThreadPool pool(options);
+    blockWorkers(pool, 2, gate_future);
+
+    // Posts go round-robin, but queues of both workers are filled anyway.
+    std::atomic<size_t> counter(0);
+    for (int i = 0; i < 4; ++i)
+    {
+        ASSERT_TRUE(pool.tryPost([&counter]() { ++counter; }));
+    }
+    ASSERT_FALSE(pool.tryPost([&counter]() { ++counter; }));
+    ASSERT_THROW(pool.post([&counter]() { ++counter; }), std::runtime_error);
+
+    gate.set_value();
+    while (counter.load() != 4)
+    {
+        std::this_thread::yield();
+    }
+}
+
+TEST(ThreadPool, spillOverflow)
+{
+    std::promise<void> gate;
+    std::shared_future<void> gate_future = gate.get_future().share();
+
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    options.setQueueSize(2);
+    options.setPriorityLevels(2);
+    options.setOverflowPolicy(tp::OverflowPolicy::Spill);
+    tp::ThreadPool pool(options);
+    blockWorkers(pool, 2, gate_future);
+
+    std::atomic<size_t> counter(0);
+    std::promise<void> done;
+    const BatchJob job{&counter, &done, 300};
+    for (int i = 0; i < 100; ++i)
+    {
+        ASSERT_TRUE(pool.tryPost(BatchJob(job), i % 2));
+    }
+    for (int i = 0; i < 100; ++i)
+    {
+        pool.post(BatchJob(job));
+    }
+
+    std::vector<BatchJob> jobs(100, job);
+    ASSERT_EQ(100u, pool.tryPostBatch(jobs.begin(), jobs.end()));
+
+    gate.set_value();
+    ASSERT_EQ(std::future_status::ready,
+              done.get_future().wait_for(std::chrono::seconds(5)));
+}
+
+TEST(ThreadPool, spillMillionTasks)
+{
+    std::promise<void> gate;
+    std::shared_future<void> gate_future = gate.get_future().share();
+
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    options.setQueueSize(2);
+    options.setOverflowPolicy(tp::OverflowPolicy::Spill);
+    tp::ThreadPool32 pool(options);
+    blockWorkers(pool, 1, gate_future);
+
+    // More than the overflow queue keeps in its slab.
+    const size_t count = 1100000;
+    std::atomic<size_t> counter(0);
+    for (size_t i = 0; i < count; ++i)
+    {
+        pool.post([&counter]() { ++counter; });
+    }
+
+    gate.set_value();
+    pool.waitIdle();
+    ASSERT_EQ(count, counter.load());
+}
+
+TEST(ThreadPool, blockOverflow)
+{
+    std::promise<void> gate;
+    std::shared_future<void> gate_future = gate.get_future().share();
+
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    options.setQueueSize(2);
+    options.setOverflowPolicy(tp::OverflowPolicy::Block);
+    tp::ThreadPool pool(options);
+    blockWorkers(pool, 1, gate_future);
+
+    std::atomic<size_t> counter(0);
+    for (int i = 0; i < 2; ++i)
+    {
+        ASSERT_TRUE(pool.tryPost([&counter]() { ++counter; }));
+    }
+    ASSERT_FALSE(pool.tryPost([&counter]() { ++counter; }));
+
+    std::atomic<bool> posted(false);
+    std::thread producer([&pool, &counter, &posted]()
+        {
+            for (int i = 0; i < 10; ++i)
+            {
+                pool.post([&counter]() { ++counter; });
+            }
+            posted = true;
+        });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_FALSE(posted.load());
+
+    gate.set_value();
+    producer.join();
+    while (counter.load() != 12)
+    {
+        std::this_thread::yield();
+    }
+}
+
+TEST(ThreadPool, postWait)
+{
+    std::promise<void> gate;
+    std::shared_future<void> gate_future = gate.get_future().share();
+
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    options.setQueueSize(2);
+    tp::ThreadPool pool(options);
+    blockWorkers(pool, 1, gate_future);
+
+    std::atomic<size_t> counter(0);
+    for (int i = 0; i < 2; ++i)
+    {
+        ASSERT_TRUE(pool.tryPost([&counter]() { ++counter; }));
+    }
+
+    const auto begin = std::chrono::steady_clock::now();
+    ASSERT_FALSE(pool.postWaitFor([&counter]() { ++counter; },
+                                  std::chrono::milliseconds(20)));
+    ASSERT_LE(std::chrono::milliseconds(20),
+              std::chrono::steady_clock::now() - begin);
+
+    std::atomic<bool> posted(false);
+    std::thread producer([&pool, &counter, &posted]()
+        {
+            for (int i = 0; i < 10; ++i)
+            {
+                pool.postWait([&counter]() { ++counter; });
+            }
+            ASSERT_TRUE(pool.postWaitFor([&counter]() { ++counter; },
+                                         std::chrono::seconds(5)));
+            posted = true;
+        });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_FALSE(posted.load());
+
+    gate.set_value();
+    producer.join();
+    while (counter.load() != 13)
+    {
+        std::this_thread::yield();
+    }
+}
+
+TEST(ThreadPool, postWaitFromWorker)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    options.setQueueSize(2);
+    tp::ThreadPool pool(options);
+
+    // The only worker runs queued tasks itself to free slots.
+    std::atomic<size_t> counter(0);
+    std::promise<void> done;
+    pool.post([&pool, &counter, &done]()
+        {
+            for (int i = 0; i < 10; ++i)
+            {
+                pool.postWait([&counter]() { ++counter; });
+            }
+            done.set_value();
+        });
+
+    ASSERT_EQ(std::future_status::ready,
+              done.get_future().wait_for(std::chrono::seconds(5)));
+    while (counter.load() != 10)
+    {
+        std::this_thread::yield();
+    }
+}
+
+TEST(ThreadPool, waitIdle)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(4);
+    tp::ThreadPool pool(options);
+
+    pool.waitIdle();
+    ASSERT_EQ(0u, pool.pendingTasks());
+
+    // Tasks posted by tasks are waited for as well.
+    std::atomic<size_t> counter(0);
+    for (size_t phase = 1; phase <= 10; ++phase)
+    {
+        for (size_t i = 0; i < 100; ++i)
+        {
+            pool.post([&pool, &counter]()
+                {
+                    std::this_thread::sleep_for(
+                        std::chrono::microseconds(10));
+                    pool.post([&counter]()
+                        {
+                            ++counter;
+                        });
+                    ++counter;
+                });
+        }
+
+        pool.waitIdle();
+        ASSERT_EQ(phase * 200, counter.load());
+        ASSERT_EQ(0u, pool.pendingTasks());
+    }
+
+    std::promise<void> gate;
+    std::shared_future<void> gate_future = gate.get_future().share();
+    pool.post([gate_future]()
+        {
+            gate_future.wait();
+        });
+    ASSERT_FALSE(pool.waitIdleFor(std::chrono::milliseconds(10)));
+    ASSERT_EQ(1u, pool.pendingTasks());
+
+    gate.set_value();
+    ASSERT_TRUE(pool.waitIdleFor(std::chrono::seconds(5)));
+}
+
+TEST(ThreadPool, waitIdleFromWorker)
+{
+    tp::ThreadPool pool;
+
+    std::packaged_task<void()> t([&pool]()
+        {
+            pool.waitIdle();
+        });
+    std::future<void> r = t.get_future();
+    pool.post(t);
+
+    ASSERT_THROW(r.get(), std::logic_error);
+}
+
+TEST(ThreadPool, shutdownDrain)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    tp::ThreadPool pool(options);
+
+    std::atomic<size_t> counter(0);
+    for (size_t i = 0; i < 100; ++i)
+    {
+        pool.post([&counter]()
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                ++counter;
+            });
+    }
+
+    pool.shutdown();
+    ASSERT_EQ(100u, counter.load());
+
+    // Repeated shutdown does nothing.
+    pool.shutdown(tp::DrainPolicy::Drop);
+}
+
+TEST(ThreadPool, shutdownDrop)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    tp::ThreadPool pool(options);
+
+    std::promise<void> started;
+    std::promise<void> gate;
+    std::shared_future<void> gate_future = gate.get_future().share();
+    std::atomic<size_t> counter(0);
+    pool.post([&started, gate_future, &counter]()
+        {
+            started.set_value();
+            gate_future.wait();
+            ++counter;
+        });
+    started.get_future().wait();
+
+    std::shared_ptr<int> payload = std::make_shared<int>(0);
+    for (size_t i = 0; i < 10; ++i)
+    {
+        pool.post([payload, &counter]()
+            {
+                ++counter;
+            });
+    }
+    ASSERT_EQ(11u, payload.use_count());
+
+    // Shutdown waits for the running task only.
+    std::thread opener([&gate]()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            gate.set_value();
+        });
+    pool.shutdown(tp::DrainPolicy::Drop);
+    opener.join();
+
+    ASSERT_EQ(1u, counter.load());
+    ASSERT_EQ(1u, payload.use_count());
+    ASSERT_EQ(0u, pool.pendingTasks());
+    pool.waitIdle();
+}
+
+TEST(ThreadPool, postAfterShutdown)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    tp::ThreadPool pool(options);
+
+    std::atomic<size_t> counter(0);
+    pool.post([&counter]()
+        {
+            ++counter;
+        });
+    pool.shutdown();
+    ASSERT_EQ(1u, counter.load());
+
+    // Late tasks are never executed, waiting for them returns at once.
+    std::shared_ptr<int> payload = std::make_shared<int>(0);
+    pool.post([payload, &counter]()
+        {
+            ++counter;
+        });
+    ASSERT_EQ(1u, pool.pendingTasks());
+    ASSERT_FALSE(pool.waitIdleFor(std::chrono::seconds(5)));
+    pool.waitIdle();
+
+    // Repeated shutdown drops them.
+    pool.shutdown();
+    ASSERT_EQ(1u, counter.load());
+    ASSERT_EQ(1u, payload.use_count());
+    ASSERT_EQ(0u, pool.pendingTasks());
+    ASSERT_TRUE(pool.waitIdleFor(std::chrono::seconds(5)));
+}
+
+TEST(ThreadPool, shutdownFor)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    tp::ThreadPool pool(options);
+
+    std::promise<void> gate;
+    std::shared_future<void> gate_future = gate.get_future().share();
+    std::atomic<size_t> counter(0);
+    pool.post([gate_future]()
+        {
+            gate_future.wait();
+        });
+    pool.post([&counter]()
+        {
+            ++counter;
+        });
+
+    std::thread opener([&gate]()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            gate.set_value();
+        });
+    ASSERT_FALSE(pool.shutdownFor(std::chrono::milliseconds(10)));
+    opener.join();
+    ASSERT_EQ(0u, counter.load());
+}
+
+TEST(ThreadPool, resize)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    options.setMaxThreadCount(4);
+    tp::ThreadPool pool(options);
+    ASSERT_EQ(2u, pool.threadCount());
+
+    pool.resize(4);
+    ASSERT_EQ(4u, pool.threadCount());
+    {
+        std::promise<void> gate;
+        std::shared_future<void> gate_future = gate.get_future().share();
+        blockWorkers(pool, 4, gate_future);
+        gate.set_value();
+    }
+
+    pool.resize(1);
+    ASSERT_EQ(1u, pool.threadCount());
+
+    std::atomic<size_t> counter(0);
+    for (int i = 0; i < 100; ++i)
+    {
+        pool.post([&counter]() { ++counter; });
+    }
+    pool.waitIdle();
+    ASSERT_EQ(100u, counter.load());
+
+    pool.resize(0);
+    ASSERT_EQ(1u, pool.threadCount());
+    pool.resize(100);
+    ASSERT_EQ(4u, pool.threadCount());
+    {
+        std::promise<void> gate;
+        std::shared_future<void> gate_future = gate.get_future().share();
+        blockWorkers(pool, 4, gate_future);
+        gate.set_value();
+    }
+}
+
+TEST(ThreadPool, resizeUnderLoad)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(4);
+    options.setQueueSize(4);
+    options.setOverflowPolicy(tp::OverflowPolicy::Spill);
+    tp::ThreadPool pool(options);
+
+    std::atomic<bool> posting(true);
+    std::atomic<size_t> posted(0);
+    std::atomic<size_t> counter(0);
+    std::thread producer([&]()
+        {
+            while (posting.load())
+            {
+                pool.post([&counter]() { ++counter; });
+                ++posted;
+            }
+        });
+
+    for (size_t i = 0; i < 20; ++i)
+    {
+        pool.resize(1 + i % 4);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    posting = false;
+    producer.join();
+    pool.waitIdle();
+    ASSERT_EQ(posted.load(), counter.load());
+}
+
+TEST(ThreadPool, stealAmongActiveWorkers)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(4);
+    options.setMaxThreadCount(64);
+    tp::ThreadPool pool(options);
+
+    // Tasks posted to the local queue of a busy worker are spread over
+    // the active siblings, not lost in probes of never started ones.
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    std::atomic<size_t> counter(0);
+    std::promise<void> done;
+    pool.post([&]()
+        {
+            for (int i = 0; i < 200; ++i)
+            {
+                pool.post([&]()
+                    {
+                        {
+                            std::lock_guard<std::mutex> lock(mutex);
+                            threads.insert(std::this_thread::get_id());
+                        }
+                        std::this_thread::sleep_for(
+                            std::chrono::microseconds(100));
+                        ++counter;
+                    });
+            }
+
+            while (counter.load() != 200)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            done.set_value();
+        });
+
+    ASSERT_EQ(std::future_status::ready,
+              done.get_future().wait_for(std::chrono::seconds(5)));
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_LT(1u, threads.size());
+}
+
+TEST(ThreadPool, resizeSingleConsumerQueue)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    options.setMaxThreadCount(3);
+    tp::MPSCThreadPool pool(options);
+
+    pool.resize(3);
+    ASSERT_EQ(3u, pool.threadCount());
+    ASSERT_THROW(pool.resize(1), std::logic_error);
+    ASSERT_EQ(3u, pool.threadCount());
+}
+
+TEST(ThreadPool, resizeFromWorker)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    tp::ThreadPool pool(options);
+
+    std::promise<bool> thrown;
+    pool.post([&pool, &thrown]()
+        {
+            try
+            {
+                pool.resize(2);
+                thrown.set_value(false);
+            }
+            catch(const std::logic_error&)
+            {
+                thrown.set_value(true);
+            }
+        });
+    ASSERT_TRUE(thrown.get_future().get());
+}
+
+TEST(ThreadPool, autoScaling)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    options.setMaxThreadCount(3);
+    options.setScalingInterval(std::chrono::milliseconds(1));
+    tp::ThreadPool pool(options);
+
+    // Queued tasks behind busy workers make the pool grow.
+    std::promise<void> gate;
+    std::shared_future<void> gate_future = gate.get_future().share();
+    for (int i = 0; i < 8; ++i)
+    {
+        pool.post([gate_future]()
+            {
+                gate_future.wait();
+            });
+    }
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (pool.threadCount() != 3 &&
+           std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(3u, pool.threadCount());
+
+    // Parked workers make it shrink back.
+    gate.set_value();
+    pool.waitIdle();
+    while (pool.threadCount() != 1 &&
+           std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(1u, pool.threadCount());
+}
+
+TEST(ThreadPool, moveConstruct)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    tp::ThreadPool pool(options);
+
+    // Tasks queued at the move are run by the new pool.
+    std::atomic<size_t> counter(0);
+    for (size_t i = 0; i < 100; ++i)
+    {
+        pool.post([&counter]()
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                ++counter;
+            });
+    }
+
+    tp::ThreadPool moved(std::move(pool));
+    ASSERT_EQ(2u, moved.threadCount());
+
+    for (size_t i = 0; i < 100; ++i)
+    {
+        moved.post([&moved, &counter]()
+            {
+                moved.post([&counter]()
+                    {
+                        ++counter;
+                    });
+                ++counter;
+            });
+    }
+    moved.waitIdle();
+    ASSERT_EQ(300u, counter.load());
+    ASSERT_EQ(42, moved.submit([]() { return 42; }).get());
+}
+
+TEST(ThreadPool, moveAssign)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    options.setMaxThreadCount(3);
+    options.setScalingInterval(std::chrono::milliseconds(1));
+    options.setStealKeyedTasks(false);
+    tp::ThreadPool pool(options);
+    tp::ThreadPool assigned;
+    assigned.post([]() {});
+
+    assigned = std::move(pool);
+    ASSERT_EQ(1u, assigned.threadCount());
+
+    // Workers of the assigned pool post, steal and park within it.
+    std::atomic<size_t> counter(0);
+    for (size_t i = 0; i < 100; ++i)
+    {
+        assigned.post([&assigned, &counter]()
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(10));
+                assigned.post([&counter]()
+                    {
+                        ++counter;
+                    });
+                ++counter;
+            });
+    }
+    assigned.waitIdle();
+    ASSERT_EQ(200u, counter.load());
+
+    std::promise<size_t> worker_id;
+    assigned.postTo(0, [&worker_id]()
+        {
+            worker_id.set_value(*tp::detail::thread_id());
+        });
+    ASSERT_EQ(0u, worker_id.get_future().get());
+
+    // The scaling thread moves with the workers.
+    std::promise<void> gate;
+    std::shared_future<void> gate_future = gate.get_future().share();
+    for (int i = 0; i < 8; ++i)
+    {
+        assigned.post([gate_future]()
+            {
+                gate_future.wait();
+            });
+    }
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (assigned.threadCount() != 3 &&
+           std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(3u, assigned.threadCount());
+    gate.set_value();
+    assigned.waitIdle();
+}
+
+TEST(ThreadPool, postAfter)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    tp::ThreadPool pool(options);
+
+    const auto delay = std::chrono::milliseconds(20);
+    const auto start = std::chrono::steady_clock::now();
+    std::promise<std::chrono::steady_clock::time_point> fired;
+    pool.postAfter(delay, [&fired]()
+        {
+            fired.set_value(std::chrono::steady_clock::now());
+        });
+
+    ASSERT_GE(fired.get_future().get() - start, delay);
+}
+
+TEST(ThreadPool, postAt)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    tp::ThreadPool pool(options);
+
+    const auto time =
+        std::chrono::system_clock::now() + std::chrono::milliseconds(10);
+    std::promise<void> fired;
+    pool.postAt(time, [&fired]()
+        {
+            fired.set_value();
+        });
+
+    ASSERT_EQ(std::future_status::ready,
+              fired.get_future().wait_for(std::chrono::seconds(5)));
+}
+
+TEST(ThreadPool, postEvery)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    tp::ThreadPool pool(options);
+
+    std::atomic<size_t> counter(0);
+    tp::TimerHandle handle = pool.postEvery(std::chrono::milliseconds(1),
+        [&counter]()
+        {
+            ++counter;
+        });
+
+    while (counter.load() < 5)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // A running handler may still finish.
+    ASSERT_TRUE(handle.cancel());
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    const size_t fired = counter.load();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_EQ(fired, counter.load());
+}
+
+TEST(ThreadPool, cancelTimer)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    tp::ThreadPool pool(options);
+
+    std::atomic<size_t> counter(0);
+    tp::TimerHandle handle = pool.postAfter(std::chrono::milliseconds(20),
+        [&counter]()
+        {
+            ++counter;
+        });
+    ASSERT_TRUE(handle.cancel());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_EQ(0u, counter.load());
+}
+
+TEST(ThreadPool, timersFromWorker)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    tp::ThreadPool pool(options);
+
+    std::atomic<size_t> counter(0);
+    std::promise<void> done;
+    pool.post([&pool, &counter, &done]()
+        {
+            for (int i = 0; i < 100; ++i)
+            {
+                pool.postAfter(std::chrono::milliseconds(i % 10),
+                    [&counter, &done]()
+                    {
+                        if (++counter == 100)
+                        {
+                            done.set_value();
+                        }
+                    });
+            }
+        });
+
+    ASSERT_EQ(std::future_status::ready,
+              done.get_future().wait_for(std::chrono::seconds(5)));
+}
+
+TEST(ThreadPool, timersOfRetiredWorker)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(4);
+    tp::ThreadPool pool(options);
+
+    std::atomic<size_t> counter(0);
+    for (int i = 0; i < 100; ++i)
+    {
+        pool.postAfter(std::chrono::milliseconds(20),
+                       [&counter]() { ++counter; });
+    }
+    pool.resize(1);
+
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (counter.load() != 100 &&
+           std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(100u, counter.load());
+}
+
+TEST(ThreadPool, jumpConsistentHash)
+{
+    // Growing the pool by one worker moves keys only to the new worker.
+    for (size_t buckets = 1; buckets < 16; ++buckets)
+    {
+        size_t moved = 0;
+        for (uint64_t key = 0; key < 10000; ++key)
+        {
+            const size_t before =
+                tp::detail::jump_consistent_hash(key, buckets);
+            const size_t after =
+                tp::detail::jump_consistent_hash(key, buckets + 1);
+            ASSERT_LT(before, buckets);
+            if (before != after)
+            {
+                ASSERT_EQ(buckets, after);
+                ++moved;
+            }
+        }
+        ASSERT_GT(moved, 0u);
+        ASSERT_LT(moved, 2 * 10000 / (buckets + 1));
+    }
+}
+
+TEST(ThreadPool, postTo)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(4);
+    options.setStealKeyedTasks(false);
+    tp::ThreadPool pool(options);
+
+    std::mutex mutex;
+    std::vector<std::thread::id> threads(4 * 100);
+    std::atomic<size_t> counter(0);
+    for (size_t i = 0; i < threads.size(); ++i)
+    {
+        pool.postTo(i % 4, [&, i]()
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                threads[i] = std::this_thread::get_id();
+                ++counter;
+            });
+    }
+    ASSERT_THROW(pool.postTo(4, []() {}), std::out_of_range);
+
+    while (counter.load() != threads.size())
+    {
+        std::this_thread::yield();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 4; i < threads.size(); ++i)
+    {
+        ASSERT_EQ(threads[i % 4], threads[i]);
+    }
+    for (size_t i = 1; i < 4; ++i)
+    {
+        ASSERT_NE(threads[0], threads[i]);
+    }
+}
+
+TEST(ThreadPool, postToBusyWorker)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(2);
+    options.setQueueSize(2);
+    options.setStealKeyedTasks(false);
+    tp::ThreadPool pool(options);
+
+    // Pinned jobs wait for the busy worker rather than being stolen by the
+    // idle one, and don't overflow its queue.
+    std::mutex mutex;
+    std::vector<std::thread::id> threads;
+    pool.postTo(0, []()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        });
+    for (int i = 0; i < 10; ++i)
+    {
+        pool.postTo(0, [&mutex, &threads]()
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                threads.push_back(std::this_thread::get_id());
+            });
+    }
+
+    std::promise<std::thread::id> last;
+    pool.postTo(0, [&last]() { last.set_value(std::this_thread::get_id()); });
+    const std::thread::id owner = last.get_future().get();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_EQ(10u, threads.size());
+    for (const std::thread::id& thread : threads)
+    {
+        ASSERT_EQ(owner, thread);
+    }
+}
+
+TEST(ThreadPool, postKeyed)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(4);
+    options.setStealKeyedTasks(false);
+    tp::ThreadPool pool(options);
+
+    std::mutex mutex;
+    std::map<std::string, std::set<std::thread::id>> threads;
+    std::atomic<size_t> counter(0);
+    const std::string keys[] = {"alpha", "beta", "gamma", "delta", "epsilon"};
+    for (int i = 0; i < 100; ++i)
+    {
+        for (const std::string& key : keys)
+        {
+            pool.postKeyed(key, [&, key]()
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    threads[key].insert(std::this_thread::get_id());
+                    ++counter;
+                });
+        }
+    }
+
+    while (counter.load() != 500)
+    {
+        std::this_thread::yield();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_EQ(5u, threads.size());
+    for (const auto& key_threads : threads)
+    {
+        ASSERT_EQ(1u, key_threads.second.size());
+    }
+}
+
+TEST(ThreadPool, postKeyedStealable)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(4);
+    options.setQueueSize(2);
+    options.setOverflowPolicy(tp::OverflowPolicy::Block);
+    tp::ThreadPool pool(options);
+
+    // Keyed jobs overflowing the queue of their worker go to the others.
+    std::atomic<size_t> counter(0);
+    for (int i = 0; i < 1000; ++i)
+    {
+        pool.postKeyed(42, [&counter]() { ++counter; });
+    }
+    pool.waitIdle();
+    ASSERT_EQ(1000u, counter.load());
+}
+
+TEST(ThreadPool, lifoSlot)
+{
+    for (size_t limit : {0, 3})
+    {
+        tp::ThreadPoolOptions options;
+        options.setThreadCount(1);
+        options.setLifoSlotLimit(limit);
+        tp::ThreadPool pool(options);
+
+        // Touched by the single worker only.
+        std::vector<int> order;
+        pool.post([&pool, &order]()
+            {
+                pool.post([&order]() { order.push_back(1); });
+                pool.post([&order]() { order.push_back(2); });
+            });
+        pool.waitIdle();
+
+        // The latest task runs first from the slot, the displaced one
+        // follows from the queue.
+        ASSERT_EQ(limit ? (std::vector<int>{2, 1})
+                        : (std::vector<int>{1, 2}), order);
+    }
+}
+
+TEST(ThreadPool, lifoSlotLimit)
+{
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(1);
+    options.setLifoSlotLimit(3);
+    tp::ThreadPool pool(options);
+
+    std::promise<void> gate;
+    std::shared_future<void> gate_future = gate.get_future().share();
+
+    // A task reposting its copies from the slot, while others wait in the
+    // queue. Touched by the single worker only.
+    std::vector<int> order;
+    size_t links = 0;
+    std::function<void()> chain = [&]()
+        {
+            order.push_back(0);
+            if (++links < 20)
+            {
+                pool.post(std::function<void()>(chain));
+            }
+        };
+    pool.post([&pool, &chain, gate_future]()
+        {
+            gate_future.wait();
+            pool.post(std::function<void()>(chain));
+        });
+    for (int i = 0; i < 3; ++i)
+    {
+        pool.post([&order]() { order.push_back(1); });
+    }
+    gate.set_value();
+    pool.waitIdle();
+
+    ASSERT_EQ(23u, order.size());
+    size_t streak = 0;
+    size_t queued = 0;
+    for (int task : order)
+    {
+        streak = task ? 0 : streak + 1;
+        queued += task;
+        if (queued < 3)
+        {
+            ASSERT_LE(streak, 3u);
+        }
+    }
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
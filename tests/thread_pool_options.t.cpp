@@ -3,14 +3,29 @@
 #include <thread_pool/thread_pool_options.hpp>
 
 #include <thread>
+#include <vector>
 
 TEST(ThreadPoolOptions, ctor)
 {
     tp::ThreadPoolOptions options;
 
     ASSERT_EQ(1024, options.queueSize());
+    ASSERT_EQ(256, options.spinCount());
+    ASSERT_EQ(64, options.yieldCount());
+    ASSERT_EQ(4, options.stealAttempts());
+    ASSERT_EQ(4, options.stealBatchSize());
+    ASSERT_EQ(1, options.priorityLevels());
+    ASSERT_EQ(tp::OverflowPolicy::Reject, options.overflowPolicy());
+    ASSERT_EQ(tp::AffinityPolicy::None, options.affinity());
+    ASSERT_TRUE(options.cpuList().empty());
     ASSERT_EQ(std::max<size_t>(1u, std::thread::hardware_concurrency()),
               options.threadCount());
+    ASSERT_EQ(options.threadCount(), options.maxThreadCount());
+    ASSERT_EQ(1, options.minThreadCount());
+    ASSERT_EQ(0, options.scalingInterval().count());
+    ASSERT_EQ(std::chrono::milliseconds(1), options.timerResolution());
+    ASSERT_TRUE(options.stealKeyedTasks());
+    ASSERT_EQ(3, options.lifoSlotLimit());
 }
 
 TEST(ThreadPoolOptions, modification)
@@ -20,8 +35,63 @@ TEST(ThreadPoolOptions, modification)
     options.setThreadCount(5);
     ASSERT_EQ(5, options.threadCount());
 
+    options.setMaxThreadCount(8);
+    ASSERT_EQ(8, options.maxThreadCount());
+
+    options.setMaxThreadCount(2);
+    ASSERT_EQ(5, options.maxThreadCount());
+
+    options.setMinThreadCount(3);
+    ASSERT_EQ(3, options.minThreadCount());
+
+    options.setMinThreadCount(7);
+    ASSERT_EQ(5, options.minThreadCount());
+
+    options.setScalingInterval(std::chrono::milliseconds(10));
+    ASSERT_EQ(10, options.scalingInterval().count());
+
     options.setQueueSize(32);
     ASSERT_EQ(32, options.queueSize());
+
+    options.setSpinCount(0);
+    ASSERT_EQ(0, options.spinCount());
+
+    options.setYieldCount(8);
+    ASSERT_EQ(8, options.yieldCount());
+
+    options.setStealAttempts(2);
+    ASSERT_EQ(2, options.stealAttempts());
+
+    options.setStealAttempts(0);
+    ASSERT_EQ(1, options.stealAttempts());
+
+    options.setStealBatchSize(16);
+    ASSERT_EQ(16, options.stealBatchSize());
+
+    options.setPriorityLevels(3);
+    ASSERT_EQ(3, options.priorityLevels());
+
+    options.setPriorityLevels(0);
+    ASSERT_EQ(1, options.priorityLevels());
+
+    options.setOverflowPolicy(tp::OverflowPolicy::Spill);
+    ASSERT_EQ(tp::OverflowPolicy::Spill, options.overflowPolicy());
+
+    options.setAffinity(tp::AffinityPolicy::Scatter);
+    ASSERT_EQ(tp::AffinityPolicy::Scatter, options.affinity());
+
+    options.setCpuList({1, 3});
+    ASSERT_EQ(tp::AffinityPolicy::Explicit, options.affinity());
+    ASSERT_EQ((std::vector<size_t>{1, 3}), options.cpuList());
+
+    options.setTimerResolution(std::chrono::microseconds(100));
+    ASSERT_EQ(std::chrono::microseconds(100), options.timerResolution());
+
+    options.setStealKeyedTasks(false);
+    ASSERT_FALSE(options.stealKeyedTasks());
+
+    options.setLifoSlotLimit(0);
+    ASSERT_EQ(0, options.lifoSlotLimit());
 }
 
 int main(int argc, char **argv) {
@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/fixed_function.hpp>
+#include <thread_pool/timer_wheel.hpp>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+typedef tp::FixedFunction<void(), 64> Task;
+typedef tp::TimerWheel<Task> Wheel;
+typedef Wheel::Clock Clock;
+
+namespace
+{
+    /**
+     * @brief post Push timer appending id to fired on expiry.
+     */
+    tp::TimerHandle post(Wheel& wheel, std::vector<int>& fired, int id,
+                         Clock::time_point deadline,
+                         Clock::duration period = Clock::duration::zero())
+    {
+        tp::detail::TimerTask<Task>* timer =
+            tp::detail::TimerTask<Task>::create([&fired, id]()
+                {
+                    fired.push_back(id);
+                },
+                deadline, period);
+        wheel.push(timer);
+        return tp::TimerHandle(timer);
+    }
+
+    size_t advance(Wheel& wheel, Clock::time_point now)
+    {
+        return wheel.advance(now, [](Task& task) { task(); });
+    }
+}
+
+TEST(TimerWheel, fireInOrder)
+{
+    const auto tick = std::chrono::milliseconds(1);
+    Wheel wheel(tick);
+    const Clock::time_point start = Clock::now();
+    ASSERT_TRUE(wheel.empty());
+    ASSERT_EQ(Clock::time_point::max(), wheel.nextDeadline());
+
+    std::vector<int> fired;
+    const Clock::duration delays[] = {
+        std::chrono::milliseconds(5),
+        std::chrono::milliseconds(70),
+        std::chrono::seconds(5),
+        std::chrono::hours(1),
+        // Beyond the range of the wheel.
+        std::chrono::hours(6)};
+    for (int i = 0; i < 5; ++i)
+    {
+        post(wheel, fired, i, start + delays[i]);
+    }
+    ASSERT_FALSE(wheel.empty());
+
+    for (int i = 0; i < 5; ++i)
+    {
+        // Never early, late by one tick at most.
+        ASSERT_EQ(0u, advance(wheel, start + delays[i] -
+                                     Clock::duration(1)));
+        ASSERT_LE(wheel.nextDeadline(), start + delays[i] + tick);
+        ASSERT_EQ(1u, advance(wheel, start + delays[i] + tick));
+        ASSERT_EQ(i + 1u, fired.size());
+        ASSERT_EQ(i, fired.back());
+    }
+    ASSERT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheel, pastDeadline)
+{
+    Wheel wheel(std::chrono::milliseconds(1));
+    const Clock::time_point start = Clock::now();
+
+    std::vector<int> fired;
+    post(wheel, fired, 1, start - std::chrono::seconds(1));
+    ASSERT_EQ(1u, advance(wheel, start));
+    ASSERT_EQ(std::vector<int>{1}, fired);
+}
+
+TEST(TimerWheel, cancel)
+{
+    const auto tick = std::chrono::milliseconds(1);
+    Wheel wheel(tick);
+    const Clock::time_point start = Clock::now();
+
+    std::vector<int> fired;
+    tp::TimerHandle canceled =
+        post(wheel, fired, 1, start + std::chrono::milliseconds(10));
+    tp::TimerHandle kept =
+        post(wheel, fired, 2, start + std::chrono::milliseconds(10));
+    ASSERT_TRUE(canceled.cancel());
+    ASSERT_FALSE(canceled.cancel());
+
+    ASSERT_EQ(1u, advance(wheel, start + std::chrono::milliseconds(20)));
+    ASSERT_EQ(std::vector<int>{2}, fired);
+    ASSERT_TRUE(wheel.empty());
+
+    // Fired already.
+    ASSERT_FALSE(kept.cancel());
+
+    tp::TimerHandle empty;
+    ASSERT_FALSE(empty.cancel());
+}
+
+TEST(TimerWheel, periodic)
+{
+    const auto period = std::chrono::milliseconds(10);
+    Wheel wheel(std::chrono::milliseconds(1));
+    const Clock::time_point start = Clock::now();
+
+    std::vector<int> fired;
+    tp::TimerHandle handle =
+        post(wheel, fired, 1, start + period, period);
+
+    ASSERT_EQ(1u, advance(wheel, start + std::chrono::milliseconds(11)));
+    ASSERT_EQ(0u, advance(wheel, start + std::chrono::milliseconds(19)));
+    ASSERT_EQ(1u, advance(wheel, start + std::chrono::milliseconds(21)));
+
+    // Missed periods are skipped.
+    ASSERT_EQ(1u, advance(wheel, start + std::chrono::milliseconds(55)));
+    ASSERT_EQ(0u, advance(wheel, start + std::chrono::milliseconds(59)));
+    ASSERT_EQ(1u, advance(wheel, start + std::chrono::milliseconds(61)));
+    ASSERT_EQ(4u, fired.size());
+
+    ASSERT_TRUE(handle.cancel());
+    ASSERT_EQ(0u, advance(wheel, start + std::chrono::milliseconds(100)));
+    ASSERT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheel, handOver)
+{
+    Wheel from(std::chrono::milliseconds(1));
+    Wheel to(std::chrono::milliseconds(1));
+    const Clock::time_point start = Clock::now();
+
+    std::vector<int> fired;
+    for (int i = 0; i < 100; ++i)
+    {
+        post(from, fired, i, start + std::chrono::milliseconds(i * 7));
+    }
+    ASSERT_EQ(10u, advance(from, start + std::chrono::milliseconds(64)));
+
+    from.handOver(to);
+    ASSERT_TRUE(from.empty());
+    ASSERT_TRUE(to.hasIncoming());
+    ASSERT_EQ(90u, advance(to, start + std::chrono::seconds(1)));
+    ASSERT_EQ(100u, fired.size());
+}
+
+TEST(TimerWheel, release)
+{
+    std::shared_ptr<int> counter = std::make_shared<int>(0);
+    tp::TimerHandle handle;
+    {
+        Wheel wheel(std::chrono::milliseconds(1));
+        tp::detail::TimerTask<Task>* timer =
+            tp::detail::TimerTask<Task>::create([counter]()
+                {
+                    ++*counter;
+                },
+                Clock::now() + std::chrono::seconds(10),
+                Clock::duration::zero());
+        wheel.push(timer);
+        handle = tp::TimerHandle(timer);
+        ASSERT_EQ(2, counter.use_count());
+    }
+
+    // Released by the wheel, the handle keeps it.
+    ASSERT_EQ(2, counter.use_count());
+    ASSERT_TRUE(handle.cancel());
+
+    handle = tp::TimerHandle();
+    ASSERT_EQ(1, counter.use_count());
+    ASSERT_EQ(0, *counter);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
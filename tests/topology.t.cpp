@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/thread_pool.hpp>
+#include <thread_pool/topology.hpp>
+
+#include <future>
+#include <vector>
+
+namespace
+{
+// Two nodes, one package per node, two cores per package, two hardware
+// threads per core. Hyper-threading siblings are numbered like on Linux.
+tp::Topology twoNodes()
+{
+    std::vector<tp::CpuInfo> cpus;
+    for (size_t id = 0; id < 8; ++id)
+    {
+        const size_t node = (id / 2) % 2;
+        cpus.push_back(tp::CpuInfo{id, id % 2, node, node});
+    }
+    return tp::Topology(cpus);
+}
+
+std::vector<size_t> placedCpus(const tp::Topology& topology,
+                               const tp::ThreadPoolOptions& options)
+{
+    std::vector<size_t> cpus;
+    for (const auto& placement : topology.placeWorkers(options))
+    {
+        cpus.push_back(placement.cpu);
+    }
+    return cpus;
+}
+}
+
+TEST(Topology, sorted)
+{
+    const tp::Topology topology = twoNodes();
+
+    ASSERT_EQ(2u, topology.nodeCount());
+    ASSERT_EQ(8u, topology.cpus().size());
+
+    const size_t ids[] = {0, 4, 1, 5, 2, 6, 3, 7};
+    for (size_t i = 0; i < 8; ++i)
+    {
+        ASSERT_EQ(ids[i], topology.cpus()[i].id);
+    }
+}
+
+TEST(Topology, placeWorkers)
+{
+    const tp::Topology topology = twoNodes();
+
+    tp::ThreadPoolOptions options;
+    options.setThreadCount(4);
+
+    ASSERT_EQ(std::vector<size_t>(4, tp::WorkerPlacement::NO_CPU),
+              placedCpus(topology, options));
+
+    options.setAffinity(tp::AffinityPolicy::Compact);
+    ASSERT_EQ((std::vector<size_t>{0, 4, 1, 5}),
+              placedCpus(topology, options));
+
+    options.setAffinity(tp::AffinityPolicy::Scatter);
+    ASSERT_EQ((std::vector<size_t>{0, 2, 4, 6}),
+              placedCpus(topology, options));
+
+    options.setAffinity(tp::AffinityPolicy::PhysicalCores);
+    options.setThreadCount(6);
+    ASSERT_EQ((std::vector<size_t>{0, 1, 2, 3, 0, 1}),
+              placedCpus(topology, options));
+
+    // Unavailable CPUs are skipped.
+    options.setCpuList({7, 42, 1});
+    ASSERT_EQ(tp::AffinityPolicy::Explicit, options.affinity());
+    ASSERT_EQ((std::vector<size_t>{7, 1, 7, 1, 7, 1}),
+              placedCpus(topology, options));
+
+    const auto placements = topology.placeWorkers(options);
+    ASSERT_EQ(1u, placements[0].node);
+    ASSERT_EQ(0u, placements[1].node);
+
+    options.setCpuList({42});
+    ASSERT_EQ(std::vector<size_t>(6, tp::WorkerPlacement::NO_CPU),
+              placedCpus(topology, options));
+}
+
+TEST(Topology, detect)
+{
+    const tp::Topology topology = tp::Topology::detect();
+
+    ASSERT_FALSE(topology.cpus().empty());
+    ASSERT_LE(1u, topology.nodeCount());
+}
+
+TEST(Topology, pinnedPool)
+{
+    const tp::AffinityPolicy policies[] = {
+        tp::AffinityPolicy::Compact, tp::AffinityPolicy::Scatter,
+        tp::AffinityPolicy::PhysicalCores};
+
+    for (auto policy : policies)
+    {
+        tp::ThreadPoolOptions options;
+        options.setThreadCount(3);
+        options.setAffinity(policy);
+        tp::ThreadPool pool(options);
+
+        std::promise<int> p;
+        std::future<int> r = p.get_future();
+        pool.post([&p]() { p.set_value(42); });
+
+        ASSERT_EQ(42, r.get());
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+
+#include <thread_pool/work_stealing_queue.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST(WorkStealingQueue, ctor)
+{
+    ASSERT_THROW(tp::WorkStealingQueue<int>(3), std::invalid_argument);
+    ASSERT_NO_THROW(tp::WorkStealingQueue<int>(4));
+}
+
+TEST(WorkStealingQueue, localLifoStealFifo)
+{
+    tp::WorkStealingQueue<int> queue(8);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        ASSERT_TRUE(queue.pushLocal(i));
+    }
+
+    int value = -1;
+    ASSERT_TRUE(queue.popLocal(value));
+    ASSERT_EQ(3, value);
+
+    ASSERT_TRUE(queue.steal(value));
+    ASSERT_EQ(0, value);
+
+    ASSERT_TRUE(queue.pop(value));
+    ASSERT_EQ(1, value);
+
+    ASSERT_TRUE(queue.popLocal(value));
+    ASSERT_EQ(2, value);
+
+    ASSERT_FALSE(queue.popLocal(value));
+    ASSERT_FALSE(queue.steal(value));
+}
+
+TEST(WorkStealingQueue, inbox)
+{
+    tp::WorkStealingQueue<int> queue(2);
+
+    ASSERT_TRUE(queue.push(1));
+    ASSERT_TRUE(queue.pushLocal(2));
+    ASSERT_TRUE(queue.pushLocal(3));
+    // Deque is full, so the task spills into the inbox.
+    ASSERT_TRUE(queue.pushLocal(4));
+    ASSERT_FALSE(queue.pushLocal(5));
+
+    int value = -1;
+    ASSERT_TRUE(queue.popLocal(value));
+    ASSERT_EQ(3, value);
+    ASSERT_TRUE(queue.popLocal(value));
+    ASSERT_EQ(2, value);
+    ASSERT_TRUE(queue.popLocal(value));
+    ASSERT_EQ(1, value);
+    ASSERT_TRUE(queue.steal(value));
+    ASSERT_EQ(4, value);
+    ASSERT_FALSE(queue.steal(value));
+}
+
+TEST(WorkStealingQueue, concurrentSteal)
+{
+    const int count = 100000;
+    tp::WorkStealingQueue<int> queue(1024);
+
+    std::vector<std::atomic<int>> taken(count);
+    for (auto& t : taken)
+    {
+        t = 0;
+    }
+
+    std::atomic<bool> done(false);
+    std::vector<std::thread> thieves;
+    for (int i = 0; i < 3; ++i)
+    {
+        thieves.emplace_back([&]()
+            {
+                int value;
+                while (!done.load())
+                {
+                    if (queue.steal(value))
+                    {
+                        ++taken[value];
+                    }
+                }
+            });
+    }
+
+    int value;
+    for (int i = 0; i < count;)
+    {
+        if (queue.pushLocal(i))
+        {
+            ++i;
+        }
+        if (i % 3 == 0 && queue.popLocal(value))
+        {
+            ++taken[value];
+        }
+    }
+    while (queue.popLocal(value))
+    {
+        ++taken[value];
+    }
+
+    done = true;
+    for (auto& thief : thieves)
+    {
+        thief.join();
+    }
+
+    for (auto& t : taken)
+    {
+        ASSERT_EQ(1, t.load());
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}